@@ -0,0 +1,40 @@
+# SPDX-License-Identifier: MIT
+# Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+# Helper CMake script to generate the build id header of the library during
+# build time (not CMake configure time), so the id follows local edits of the
+# sources. The id is a hash of the contents of the listed source files, it is
+# part of the assembly cache key.
+# You can manually run this script using the following synopsys:
+# cmake -P build_id.cmake <file_with_list_of_sources> <output_header> <version>
+# e.g. cmake -P build_id.cmake Debug/src/cpp/aiebu/src/gen/build_id_sources.txt Debug/src/cpp/aiebu/src/gen/aiebu_build_id.h 1.0.0
+
+cmake_minimum_required(VERSION 3.18)
+
+file(STRINGS "${CMAKE_ARGV3}" sources)
+list(SORT sources)
+
+set(digests "")
+foreach(source ${sources})
+
+  file(SHA256 "${source}" digest)
+  cmake_path(GET source FILENAME name)
+  string(APPEND digests "${digest}  ${name}\n")
+
+endforeach()
+
+string(SHA256 build_id "${digests}")
+
+set(content "// Generated by build_id.cmake, do not edit\n")
+string(APPEND content "#define AIEBU_BUILD_VERSION \"${CMAKE_ARGV5}\"\n")
+string(APPEND content "#define AIEBU_BUILD_ID \"${build_id}\"\n")
+
+# Rewritten only when the id changes, so sources including it are not rebuilt
+set(current "")
+if (EXISTS "${CMAKE_ARGV4}")
+  file(READ "${CMAKE_ARGV4}" current)
+endif()
+if (NOT current STREQUAL content)
+  message("-- Generating build id ${build_id} in ${CMAKE_ARGV4}")
+  file(WRITE "${CMAKE_ARGV4}" "${content}")
+endif()
@@ -0,0 +1,353 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "aiebu_report.h"
+#include "aiebu_error.h"
+#include "bd_decoder.h"
+#include "json_reader.h"
+#include "reporter.h"
+#include "text_writer.h"
+#include "txn_cursor.h"
+#include "xaiengine.h"
+
+namespace aiebu {
+
+namespace {
+
+// Buffer length, in 32 bit words, is word 0 of a BD
+constexpr uint32_t mem_buffer_length_mask = 0x1FFFF;
+
+// Figures per op for the command processor, DMA at the rate of one
+// channel. PHX is NPU1, STX is NPU4 with a faster controller and fabric.
+cost_table
+phx_table()
+{
+  cost_table t;
+  t.device = "phx";
+  t.write_ns = 20;
+  t.mask_write_ns = 40;
+  t.block_write_ns = 20;
+  t.block_write_byte_ns = 1.25;
+  t.mask_poll_ns = 200;
+  t.dma_byte_ns = 0.1;
+  t.tct_ns = 1000;
+  t.merge_sync_ns = 1000;
+  t.ddr_patch_ns = 30;
+  t.other_ns = 10;
+  return t;
+}
+
+cost_table
+stx_table()
+{
+  cost_table t;
+  t.device = "stx";
+  t.write_ns = 12;
+  t.mask_write_ns = 25;
+  t.block_write_ns = 12;
+  t.block_write_byte_ns = 0.8;
+  t.mask_poll_ns = 150;
+  t.dma_byte_ns = 0.05;
+  t.tct_ns = 700;
+  t.merge_sync_ns = 700;
+  t.ddr_patch_ns = 20;
+  t.other_ns = 6;
+  return t;
+}
+
+struct region_cost
+{
+  double ns = 0;
+  size_t section = 0;
+  uint32_t first_op = 0;
+  uint32_t num_ops = 0;
+  uint32_t offset = 0;
+  uint32_t size = 0;
+
+  bool
+  operator>(const region_cost& rhs) const
+  {
+    return ns > rhs.ns;
+  }
+};
+
+// Keeps the top_n most expensive regions in a min heap, the cheapest on
+// top is replaced, so memory does not grow with the number of regions
+class top_regions
+{
+  std::priority_queue<region_cost, std::vector<region_cost>, std::greater<region_cost>> m_heap;
+  size_t m_max;
+
+public:
+  explicit top_regions(size_t max) : m_max(max) {}
+
+  void
+  add(const region_cost& region)
+  {
+    if (!m_max)
+      return;
+    if (m_heap.size() < m_max)
+      m_heap.push(region);
+    else if (region.ns > m_heap.top().ns) {
+      m_heap.pop();
+      m_heap.push(region);
+    }
+  }
+
+  // most expensive first, empties the heap
+  std::vector<region_cost>
+  take()
+  {
+    std::vector<region_cost> regions(m_heap.size());
+    for (auto it = regions.rbegin(); it != regions.rend(); ++it) {
+      *it = m_heap.top();
+      m_heap.pop();
+    }
+    return regions;
+  }
+};
+
+struct cost_visitor : txn::visitor_base
+{
+  const cost_table& table;
+  cost_estimate::section& sec;
+  top_regions& top;
+  region_cost region;
+
+  cost_visitor(const cost_table& t, cost_estimate::section& s, top_regions& r, size_t index)
+    : table(t), sec(s), top(r)
+  {
+    region.section = index;
+  }
+
+  // Accounts an op to the section and to the open region, a wait closes it
+  void
+  add(const txn::op_ref& op, double ns, bool wait = false)
+  {
+    if (!region.num_ops) {
+      region.first_op = op.index;
+      region.offset = static_cast<uint32_t>(op.offset);
+    }
+    ++region.num_ops;
+    region.size = static_cast<uint32_t>(op.offset + op.size) - region.offset;
+    region.ns += ns;
+    sec.ns += ns;
+    if (wait)
+      close();
+  }
+
+  void
+  close()
+  {
+    if (region.num_ops)
+      top.add(region);
+    region.ns = 0;
+    region.num_ops = 0;
+  }
+
+  // DMA cost of a register write when it sets the length of a BD
+  double
+  dma(uint32_t reg, uint32_t value)
+  {
+    auto loc = aie2_bd::decode(reg);
+    if (!loc.valid() || loc.word != 0)
+      return 0;
+    uint64_t bytes = uint64_t(loc.kind == aie2_bd::tile::mem ? value & mem_buffer_length_mask : value) * 4;
+    sec.dma_bytes += bytes;
+    return bytes * table.dma_byte_ns;
+  }
+
+  template <typename Hdr>
+  void
+  on_write(const txn::op_ref& op, const Hdr& hdr)
+  {
+    ++sec.writes;
+    add(op, table.write_ns + dma(static_cast<uint32_t>(hdr.RegOff), hdr.Value));
+  }
+
+  template <typename Hdr>
+  void
+  on_block_write(const txn::op_ref& op, const Hdr& hdr)
+  {
+    const auto* payload = txn::payload<Hdr>(op);
+    const auto words = txn::payload_words<Hdr>(op);
+    double ns = table.block_write_ns + words * 4 * table.block_write_byte_ns;
+    for (size_t i = 0; i < words; ++i)
+      ns += dma(static_cast<uint32_t>(hdr.RegOff + i * 4), payload[i]);
+    sec.block_write_bytes += words * 4;
+    add(op, ns);
+  }
+
+  template <typename Hdr>
+  void
+  on_mask_write(const txn::op_ref& op, const Hdr&)
+  {
+    ++sec.writes;
+    add(op, table.mask_write_ns);
+  }
+
+  template <typename Hdr>
+  void
+  on_mask_poll(const txn::op_ref& op, const Hdr& hdr, bool)
+  {
+    sec.mask_polls.push_back({op.index, static_cast<uint32_t>(op.offset), static_cast<uint32_t>(hdr.RegOff)});
+    add(op, table.mask_poll_ns, true);
+  }
+
+  void on_noop(const txn::op_ref& op) { add(op, table.other_ns); }
+  void on_preempt(const txn::op_ref& op, const XAie_PreemptHdr&) { add(op, table.other_ns); }
+  void on_pm_load(const txn::op_ref& op, const XAie_PmLoadHdr&) { add(op, table.other_ns); }
+  void on_read_regs(const txn::op_ref& op) { add(op, table.other_ns); }
+  void on_record_timer(const txn::op_ref& op) { add(op, table.other_ns); }
+  void on_ddr_patch(const txn::op_ref& op, const patch_op_t&) { add(op, table.ddr_patch_ns); }
+
+  void
+  on_tct(const txn::op_ref& op)
+  {
+    ++sec.tct_waits;
+    add(op, table.tct_ns, true);
+  }
+
+  void
+  on_merge_sync(const txn::op_ref& op)
+  {
+    ++sec.merge_sync_waits;
+    add(op, table.merge_sync_ns, true);
+  }
+};
+
+double
+to_double(const json_reader::scalar& s, std::string_view key)
+{
+  std::string text(s.text);
+  char* end = nullptr;
+  double value = std::strtod(text.c_str(), &end);
+  if (s.type != json_reader::kind::number || end != text.c_str() + text.size())
+    throw error(error::error_code::internal_error, "Cost table: " + std::string(key) + " is not a number !!!");
+  return value;
+}
+
+}
+
+cost_table
+cost_table::
+get(const std::string& device)
+{
+  if (device == "phx")
+    return phx_table();
+  if (device == "stx")
+    return stx_table();
+  throw error(error::error_code::internal_error, "Unknown device " + device + " for cost table, expected phx or stx !!!");
+}
+
+cost_table
+cost_table::
+from_json(const_buffer json)
+{
+  json_reader reader(json.data, json.size);
+  if (reader.peek() != json_reader::kind::object)
+    throw error(error::error_code::internal_error, "Cost table is not a json object !!!");
+
+  // the base may come after the values it is overridden with
+  std::string base = "phx";
+  std::string device;
+  std::map<std::string, double, std::less<>> values;
+  reader.enter();
+  std::string_view key;
+  while (reader.next(&key)) {
+    std::string name(key);
+    auto value = reader.value();
+    if (name == "base")
+      base = value.text;
+    else if (name == "device")
+      device = value.text;
+    else
+      values[name] = to_double(value, name);
+  }
+  reader.finish();
+
+  auto table = get(base);
+  table.device = device.empty() ? "custom" : device;
+  const std::map<std::string_view, double cost_table::*> members = {
+    {"write_ns", &cost_table::write_ns},
+    {"mask_write_ns", &cost_table::mask_write_ns},
+    {"block_write_ns", &cost_table::block_write_ns},
+    {"block_write_byte_ns", &cost_table::block_write_byte_ns},
+    {"mask_poll_ns", &cost_table::mask_poll_ns},
+    {"dma_byte_ns", &cost_table::dma_byte_ns},
+    {"tct_ns", &cost_table::tct_ns},
+    {"merge_sync_ns", &cost_table::merge_sync_ns},
+    {"ddr_patch_ns", &cost_table::ddr_patch_ns},
+    {"other_ns", &cost_table::other_ns},
+  };
+  for (const auto& [name, value] : values) {
+    auto it = members.find(name);
+    if (it == members.end())
+      throw error(error::error_code::internal_error, "Cost table: unknown member " + name + " !!!");
+    table.*(it->second) = value;
+  }
+  return table;
+}
+
+cost_estimate
+estimate_cost(const elf_view& elf, const cost_table& table, size_t top_n)
+{
+  cost_estimate estimate;
+  estimate.device = table.device;
+  top_regions top(top_n);
+  for_each_ctrlcode(elf, [&](const elf_view::section& sec, const_buffer content) {
+    XAie_TxnHeader hdr;
+    if (content.size < sizeof(hdr))
+      throw error(error::error_code::invalid_buffer_type, "Corrupted transaction in " + std::string(sec.name) + " !!!");
+    std::memcpy(&hdr, content.data, sizeof(hdr));
+    if (hdr.TxnSize != content.size)
+      throw error(error::error_code::invalid_buffer_type, "Corrupted transaction in " + std::string(sec.name) + " !!!");
+
+    auto& esec = estimate.sections.emplace_back();
+    esec.name = sec.name;
+    cost_visitor visitor(table, esec, top, estimate.sections.size() - 1);
+    txn::walk(content.data, content.size, visitor);
+    visitor.close();
+    estimate.ns += esec.ns;
+  });
+
+  for (const auto& r : top.take())
+    estimate.top_regions.push_back({estimate.sections[r.section].name, r.first_op, r.num_ops, r.offset, r.size, r.ns});
+  return estimate;
+}
+
+void
+write_text(const cost_estimate& estimate, std::ostream& stream)
+{
+  text_writer out(stream);
+  out.text("Cost estimate (").text(estimate.device).text("): ").real(estimate.ns / 1000).text(" us\n");
+  for (const auto& sec : estimate.sections) {
+    out.text("  ").text(sec.name).text(": ").real(sec.ns / 1000).text(" us")
+       .text(" writes:").dec(sec.writes)
+       .text(" block_write_bytes:").dec(sec.block_write_bytes)
+       .text(" dma_bytes:").dec(sec.dma_bytes)
+       .text(" mask_polls:").dec(sec.mask_polls.size())
+       .text(" tct_waits:").dec(sec.tct_waits)
+       .text(" merge_sync_waits:").dec(sec.merge_sync_waits).text('\n');
+    for (const auto& poll : sec.mask_polls)
+      out.text("    MASKPOLL op:").dec(poll.op).text(" offset:0x").hex(poll.offset)
+         .text(" @0x").hex(poll.reg).text('\n');
+  }
+  if (!estimate.top_regions.empty())
+    out.text("Top regions:\n");
+  for (const auto& r : estimate.top_regions)
+    out.text("  ").text(r.section).text(" ops:").dec(r.first_op).text('-').dec(r.first_op + r.num_ops - 1)
+       .text(" offset:0x").hex(r.offset).text(" size:").dec(r.size)
+       .text(' ').real(r.ns / 1000).text(" us\n");
+  out.flush();
+}
+
+}
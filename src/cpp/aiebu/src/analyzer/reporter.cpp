@@ -5,72 +5,320 @@
 #include "aiebu_error.h"
 
 #include "transaction.hpp"
+#include "elfwriter.h"
+#include "symbol.h"
+#include "compressed_section.h"
 
-#include <boost/interprocess/streams/bufferstream.hpp>
-
-#ifdef _WIN32
-#pragma warning(push)
-#pragma warning(disable: 4245)
-#include <elfio/elfio_dump.hpp>
-#pragma warning(pop)
-#endif
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace aiebu {
 
-    reporter::reporter(aiebu::aiebu_assembler::buffer_type /*type*/, const std::vector<char>& elf_data)
+    namespace {
+
+    std::string schema_name(uint32_t type)
+    {
+        switch (static_cast<symbol::patch_schema>(type)) {
+        case symbol::patch_schema::uc_dma_remote_ptr_symbol: return "uc_dma_remote_ptr_symbol";
+        case symbol::patch_schema::shim_dma_57: return "shim_dma_57";
+        case symbol::patch_schema::scaler_32: return "scaler_32";
+        case symbol::patch_schema::control_packet_48: return "control_packet_48";
+        case symbol::patch_schema::shim_dma_48: return "shim_dma_48";
+        case symbol::patch_schema::shim_dma_57_aie4: return "shim_dma_57_aie4";
+        case symbol::patch_schema::unknown: return "unknown";
+        }
+        return std::to_string(type);
+    }
+
+    // json string with the quotes, names are plain ascii but escape anyway
+    void json_string(text_writer &out, std::string_view str)
     {
-        boost::interprocess::ibufferstream istr(elf_data.data(), elf_data.size());
-        bool result = my_elf_reader.load(istr);
-        if (!result)
-            throw error(error::error_code::invalid_buffer_type, "Invalid ELF buffer");
+        out.text('"');
+        for (char c : str) {
+            if (c == '"' || c == '\\')
+                out.text('\\').text(c);
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out.text("\\u").hex(static_cast<unsigned char>(c), 4);
+            else
+                out.text(c);
+        }
+        out.text('"');
     }
 
-    void reporter::elf_summary(std::ostream &stream) const
+    void json_ops(text_writer &out, const std::vector<elf_report::op> &ops, std::string_view indent)
     {
-        ELFIO::dump::header(stream, my_elf_reader );
-        ELFIO::dump::section_headers( stream, my_elf_reader);
-        ELFIO::dump::segment_headers( stream, my_elf_reader);
+        out.text('[');
+        for (size_t i = 0; i < ops.size(); ++i) {
+            out.text(i ? ",\n" : "\n").text(indent).text("  {\"name\": ");
+            json_string(out, ops[i].name);
+            out.text(", \"count\": ").dec(ops[i].count).text(", \"bytes\": ").dec(ops[i].bytes).text('}');
+        }
+        if (!ops.empty())
+            out.text('\n').text(indent);
+        out.text(']');
     }
 
-    void reporter::ctrlcode_summary(std::ostream &stream) const
+    // csv field, quoted when it holds a separator or a quote
+    void csv_field(text_writer &out, std::string_view str)
     {
-        ELFIO::Elf_Half sec_num = my_elf_reader.sections.size();
-        for ( int i = 0; i < sec_num; ++i ) {
-            const ELFIO::section* psec = my_elf_reader.sections[i];
-
-            // Decoding not supported for ".ctrldata" section
-            // for aie2 ".ctrldata" contain control packet and ".ctrlpkt-pm-N" contain
-            // pm control packet which cannot be decoded
-            if (psec->get_type() != ELFIO::SHT_PROGBITS || is_ctrldata(psec->get_name())
-               || is_pm_ctrlpkt(psec->get_name()))
+        if (str.find_first_of(",\"\n") == std::string_view::npos) {
+            out.text(str);
+            return;
+        }
+        out.text('"');
+        for (char c : str)
+            (c == '"' ? out.text("\"\"") : out.text(c));
+        out.text('"');
+    }
+
+    void csv_row(text_writer &out, std::string_view record, std::string_view section,
+                 std::string_view name, std::string_view schema, uint64_t value)
+    {
+        out.text(record).text(',');
+        csv_field(out, section);
+        out.text(',');
+        csv_field(out, name);
+        out.text(',').text(schema).text(',').dec(value).text('\n');
+    }
+
+    }
+
+    reporter::reporter(aiebu::aiebu_assembler::buffer_type /*type*/, const_buffer elf_data)
+      : m_view(elf_data)
+    {
+    }
+
+    reporter::reporter(elf_view view)
+      : m_view(std::move(view))
+    {
+    }
+
+    void reporter::report(text_writer &out) const
+    {
+        elf_summary(out);
+        relocation_summary(out);
+        ctrlcode_summary(out, true);
+        out.flush();
+    }
+
+    void reporter::elf_summary(text_writer &out) const
+    {
+        out.text("ELF Header\n\n")
+           .text("  Class:      ELF32\n")
+           .text("  Encoding:   Little endian\n")
+           .text("  OS/ABI:     0x").hex(m_view.get_os_abi()).text('\n')
+           .text("  ABI:        0x").hex(m_view.get_abi_version()).text('\n')
+           .text("  Type:       0x").hex(m_view.get_type()).text('\n')
+           .text("  Machine:    0x").hex(m_view.get_machine()).text('\n')
+           .text("  Flags:      0x").hex(m_view.get_flags()).text('\n')
+           .text("  Entry:      0x").hex(m_view.get_entry()).text("\n\n");
+
+        out.text("Section Headers:\n")
+           .text("[  Nr ] Type              Addr     Size     ES Flg Lk Inf Al Name\n");
+        for (size_t i = 0; i < m_view.num_sections(); ++i) {
+            const auto sec = m_view.get_section(i);
+            out.text('[').dec(i, 5).text("] ")
+               .hex(sec.type, 8).text("          ")
+               .hex(sec.addr, 8).text(' ')
+               .hex(sec.size, 8).text(' ')
+               .hex(sec.entsize, 2).text(' ')
+               .hex(sec.flags, 3).text(' ')
+               .dec(sec.link, 2).text(' ')
+               .dec(sec.info, 3).text(' ')
+               .dec(sec.addralign, 2).text(' ')
+               .text(sec.name).text('\n');
+        }
+        out.text('\n');
+
+        out.text("Segment headers:\n")
+           .text("[  Nr ] Type           VirtAddr PhysAddr FileSize Mem.Size Flags    Align\n");
+        for (size_t i = 0; i < m_view.num_segments(); ++i) {
+            const auto seg = m_view.get_segment(i);
+            out.text('[').dec(i, 5).text("] ")
+               .hex(seg.type, 8).text("       ")
+               .hex(seg.vaddr, 8).text(' ')
+               .hex(seg.paddr, 8).text(' ')
+               .hex(seg.filesz, 8).text(' ')
+               .hex(seg.memsz, 8).text(' ')
+               .hex(seg.flags, 8).text(' ')
+               .hex(seg.align, 8).text('\n');
+        }
+        out.text('\n');
+    }
+
+    void reporter::ctrlcode_summary(text_writer &out, bool detail) const
+    {
+        for_each_ctrlcode(m_view, [&out, detail](const elf_view::section& sec, const_buffer content) {
+            out.text("  [").dec(sec.index).text("] ").text(sec.name).text('\t')
+               .dec(content.size).text('\n');
+
+            transaction tprint(content.data, content.size);
+            tprint.write_report(out, detail);
+            out.text('\n');
+        });
+    }
+
+    void reporter::relocation_summary(text_writer &out) const
+    {
+        for (size_t i = 0; i < m_view.num_sections(); ++i) {
+            const auto sec = m_view.get_section(i);
+            const bool compact = sec.type == SHT_XRT_CRELA;
+            if (sec.type != ELFIO::SHT_RELA && !compact)
                 continue;
 
-            stream << "  [" << i << "] " << psec->get_name() << "\t"
-                   << psec->get_size() << std::endl;
+            // decode every entry, as a loader does, to time it
+            uint64_t entries = 0;
+            uint64_t checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            m_view.for_each_relocation(sec, [&](const elf_view::relocation& r) {
+                ++entries;
+                checksum += r.offset ^ r.symbol ^ r.type ^ r.addend;
+            });
+            std::chrono::duration<double, std::micro> us = std::chrono::steady_clock::now() - start;
 
-            transaction tprint(psec->get_data(), psec->get_size());
-            stream << tprint.get_txn_summary() << std::endl;
+            out.text("  ").text(sec.name).text(compact ? " (compact)" : " (rela)")
+               .text(" relocations:").dec(entries).text(" bytes:").dec(sec.size)
+               .text(" bytes/relocation:").real(entries ? double(sec.size) / entries : 0)
+               .text(" decode us:").real(us.count()).text(" checksum:").hex(checksum)
+               .text('\n');
         }
     }
 
-    void reporter::ctrlcode_detail_summary(std::ostream &stream) const
+    elf_report reporter::report_data() const
     {
-        ELFIO::Elf_Half sec_num = my_elf_reader.sections.size();
-        for ( int i = 0; i < sec_num; ++i ) {
-            const ELFIO::section* psec = my_elf_reader.sections[i];
-
-            // Decoding not supported for ".ctrldata" section
-            // for aie2 ".ctrldata" contain control packet and ".ctrlpkt-pm-N" contain
-            // pm control packet which cannot be decoded
-            if (psec->get_type() != ELFIO::SHT_PROGBITS || is_ctrldata(psec->get_name())
-                || is_pm_ctrlpkt(psec->get_name()))
+        elf_report report;
+        if (auto uid = m_view.find_section(".note.xrt.UID")) {
+            m_view.for_each_note(*uid, [&report](const elf_view::note& n) {
+                if (n.type == NT_XRT_UID && report.uid.empty())
+                    report.uid.assign(n.desc.data, strnlen(n.desc.data, n.desc.size));
+            });
+        }
+
+        for (size_t i = 0; i < m_view.num_sections(); ++i) {
+            const auto sec = m_view.get_section(i);
+            elf_report::section rsec;
+            rsec.index = sec.index;
+            rsec.name = sec.name;
+            rsec.type = sec.type;
+            rsec.flags = sec.flags;
+            rsec.size = sec.size;
+            rsec.content_size = sec.size;
+            // the size is in the compression header, nothing is decompressed
+            if (sec.data && (sec.flags & compressed_section::shf_compressed) && sec.size >= sizeof(compressed_section::header)) {
+                compressed_section::header hdr;
+                std::memcpy(&hdr, sec.data, sizeof(hdr));
+                rsec.content_size = hdr.ch_size;
+            }
+            report.sections.push_back(std::move(rsec));
+        }
+
+        for_each_ctrlcode(m_view, [&report](const elf_view::section& sec, const_buffer content) {
+            auto& rsec = report.sections[sec.index];
+            transaction(content.data, content.size).fill_report(rsec);
+            for (const auto& op : rsec.ops) {
+                auto it = std::find_if(report.ops.begin(), report.ops.end(),
+                                       [&op](const elf_report::op& o) { return o.name == op.name; });
+                if (it == report.ops.end())
+                    it = report.ops.insert(it, {op.name, 0, 0});
+                it->count += op.count;
+                it->bytes += op.bytes;
+            }
+        });
+
+        for (size_t i = 0; i < m_view.num_sections(); ++i) {
+            const auto sec = m_view.get_section(i);
+            if (sec.type != ELFIO::SHT_RELA && sec.type != SHT_XRT_CRELA)
                 continue;
 
-            stream << "  [" << i << "] " << psec->get_name() << "\t"
-                   << psec->get_size() << std::endl;
+            // counted by symbol index first, names are looked up once per key
+            std::map<std::pair<uint32_t, uint32_t>, uint64_t> counts;
+            m_view.for_each_relocation(sec, [&counts](const elf_view::relocation& r) {
+                ++counts[{r.symbol, r.type}];
+            });
+            std::optional<elf_view::section> symtab;
+            if (sec.link < m_view.num_sections())
+                symtab = m_view.get_section(sec.link);
+            for (const auto& [key, count] : counts) {
+                std::string symbol = std::to_string(key.first);
+                if (symtab && key.first < m_view.num_symbols(*symtab))
+                    symbol = m_view.get_symbol(*symtab, key.first).name;
+                report.relocations.push_back({std::string(sec.name), symbol, schema_name(key.second), count});
+            }
+        }
+        return report;
+    }
+
+    elf_report make_report(const elf_view& elf)
+    {
+        return reporter(elf).report_data();
+    }
+
+    void write_json(const elf_report& report, std::ostream& stream)
+    {
+        text_writer out(stream);
+        out.text("{\n  \"uid\": ");
+        json_string(out, report.uid);
+
+        out.text(",\n  \"sections\": [");
+        for (size_t i = 0; i < report.sections.size(); ++i) {
+            const auto& sec = report.sections[i];
+            out.text(i ? ",\n" : "\n").text("    {\"index\": ").dec(sec.index).text(", \"name\": ");
+            json_string(out, sec.name);
+            out.text(", \"type\": ").dec(sec.type).text(", \"flags\": ").dec(sec.flags)
+               .text(", \"size\": ").dec(sec.size).text(", \"content_size\": ").dec(sec.content_size);
+            if (!sec.txn_format.empty()) {
+                out.text(", \"txn_format\": ");
+                json_string(out, sec.txn_format);
+                out.text(", \"ops\": ");
+                json_ops(out, sec.ops, "    ");
+            }
+            out.text('}');
+        }
+        out.text("\n  ],\n  \"ops\": ");
+        json_ops(out, report.ops, "  ");
+
+        out.text(",\n  \"relocations\": [");
+        for (size_t i = 0; i < report.relocations.size(); ++i) {
+            const auto& rel = report.relocations[i];
+            out.text(i ? ",\n" : "\n").text("    {\"section\": ");
+            json_string(out, rel.section);
+            out.text(", \"symbol\": ");
+            json_string(out, rel.symbol);
+            out.text(", \"schema\": ");
+            json_string(out, rel.schema);
+            out.text(", \"count\": ").dec(rel.count).text('}');
+        }
+        out.text("\n  ]\n}\n");
+        out.flush();
+    }
 
-            transaction tprint(psec->get_data(), psec->get_size());
-            stream << tprint.get_all_ops() << std::endl;
+    void write_csv(const elf_report& report, std::ostream& stream)
+    {
+        text_writer out(stream);
+        out.text("record,section,name,schema,value\n");
+        out.text("uid,,");
+        csv_field(out, report.uid);
+        out.text(",,\n");
+        for (const auto& sec : report.sections) {
+            if (sec.type == ELFIO::SHT_NULL)
+                continue;
+            csv_row(out, "section_size", sec.name, "", "", sec.size);
+            csv_row(out, "content_size", sec.name, "", "", sec.content_size);
+            for (const auto& op : sec.ops) {
+                csv_row(out, "op_count", sec.name, op.name, "", op.count);
+                csv_row(out, "op_bytes", sec.name, op.name, "", op.bytes);
+            }
+        }
+        for (const auto& op : report.ops) {
+            csv_row(out, "op_count", "", op.name, "", op.count);
+            csv_row(out, "op_bytes", "", op.name, "", op.bytes);
         }
+        for (const auto& rel : report.relocations)
+            csv_row(out, "relocations", rel.section, rel.symbol, rel.schema, rel.count);
+        out.flush();
     }
 }
@@ -5,28 +5,61 @@
 #define _AIEBU_REPORTER_H_
 
 #include "aiebu_assembler.h"
+#include "aiebu_elf_view.h"
+#include "aiebu_report.h"
+#include "text_writer.h"
 
-#include <elfio/elfio_dump.hpp>
+#include <elfio/elfio.hpp>
+#include <vector>
 
 namespace aiebu {
 
+    // Call fn(section, content) for each section holding decodable control code.
+    // Decoding not supported for ".ctrldata" section
+    // for aie2 ".ctrldata" contain control packet and ".ctrlpkt-pm-N" contain
+    // pm control packet which cannot be decoded
+    template <typename Fn>
+    void for_each_ctrlcode(const elf_view& view, Fn&& fn)
+    {
+        // only compressed sections are copied, decompressed into storage
+        std::vector<char> storage;
+        for (size_t i = 0; i < view.num_sections(); ++i) {
+            const auto sec = view.get_section(i);
+            if (sec.type != ELFIO::SHT_PROGBITS || sec.name == ".ctrldata"
+                || sec.name.substr(0,8) == ".ctrlpkt")
+                continue;
+            fn(sec, view.get_content(sec, storage));
+        }
+    }
+
+    // Reports on an elf through an elf_view, nothing is loaded or copied
+    // up front, each summary decodes only the sections it prints. Text goes
+    // through a text_writer, so memory use does not grow with the report.
     class reporter {
     private:
-        ELFIO::elfio my_elf_reader;
+        elf_view m_view;
     public:
-        inline bool is_ctrldata(const std::string& name) const
+        inline bool is_ctrldata(std::string_view name) const
         {
-          return !name.compare(".ctrldata");
+          return name == ".ctrldata";
         }
 
-        inline bool is_pm_ctrlpkt(const std::string& name) const
+        inline bool is_pm_ctrlpkt(std::string_view name) const
         {
-          return !name.substr(0,8).compare(".ctrlpkt");
+          return name.substr(0,8) == ".ctrlpkt";
         }
-        reporter(aiebu::aiebu_assembler::buffer_type type, const std::vector<char>& elf_data);
-        void elf_summary(std::ostream &stream) const;
-        void ctrlcode_summary(std::ostream &stream) const;
-        void ctrlcode_detail_summary(std::ostream &stream) const;
+        reporter(aiebu::aiebu_assembler::buffer_type type, const_buffer elf_data);
+        explicit reporter(elf_view view);
+        // All of the summaries below, control code in detail
+        void report(text_writer &out) const;
+        void elf_summary(text_writer &out) const;
+        // Op counts of each control code section and, when detail is set,
+        // every op, in a single pass over the section
+        void ctrlcode_summary(text_writer &out, bool detail) const;
+        // Relocation count, size and decode time of .rela.dyn or .rela.compact
+        void relocation_summary(text_writer &out) const;
+        // Everything above as data, ops and relocations as counts
+        elf_report report_data() const;
     };
 }
 
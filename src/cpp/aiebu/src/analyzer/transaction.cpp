@@ -1,82 +1,59 @@
 // SPDX-License-Identifier: MIT
 // Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
 
-#include <iomanip>
-#include <map>
-#include <fstream>
-#include <iostream>
-#include <string>
-#include <cstring>
-#include <vector>
 #include <array>
-#include <sstream>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
 
 // https://gitenterprise.xilinx.com/tsiddaga/dynamic_op_dispatch/blob/main/include/transaction.hpp
 
 #include "xaiengine.h"
 #include "transaction.hpp"
+#include "bd_decoder.h"
+#include "txn_cursor.h"
+#include "text_writer.h"
 
 struct transaction::implementation {
 private:
-    static constexpr unsigned int field_width = 32;
-    static inline std::ostream& op_format(std::ostream& strm) {
-        strm << std::setw(field_width) << std::left;
-        return strm;
-    }
-
-    static inline std::ostream& dec_format(std::ostream& strm) {
-        strm << std::setw(field_width/2) << std::right;
-        return strm;
-    }
+    static constexpr size_t field_width = 32;
 
 private:
-    std::vector<uint8_t> txn_;
+    const uint8_t *txn_ = nullptr;
+    uint64_t size_ = 0;
 
-    std::string get_txn_summary(const uint8_t *txn_ptr) const {
-
-        std::stringstream ss;
-        auto Hdr = (XAie_TxnHeader *)txn_ptr;
-
-        ss << "v" << (int)Hdr->Major << "." << (int)Hdr->Minor << ", gen" << (int)Hdr->DevGen << std::endl;
-        ss << (int)Hdr->NumRows << "x" << (int)Hdr->NumCols << " M" << (int)Hdr->NumMemTileRows << std::endl;
-        ss << Hdr->TxnSize << "B, " << Hdr->NumOps << "ops" << std::endl;
-        return ss.str();
+    static void write_txn_summary(aiebu::text_writer &out, const XAie_TxnHeader &Hdr) {
+        out.text('v').dec(Hdr.Major).text('.').dec(Hdr.Minor).text(", gen").dec(Hdr.DevGen).text('\n');
+        out.dec(Hdr.NumRows).text('x').dec(Hdr.NumCols).text(" M").dec(Hdr.NumMemTileRows).text('\n');
+        out.dec(Hdr.TxnSize).text("B, ").dec(Hdr.NumOps).text("ops\n");
     }
 
 public:
+    // The transaction is referenced, not copied, it must outlive this object
     implementation(const char *txn, uint64_t size) {
 
         // TXN with transaction_op_t header is not suupported.
-        const auto *hdr = reinterpret_cast<const XAie_TxnHeader *>(txn);
-        if (hdr->TxnSize != size) {
+        if (size < sizeof(XAie_TxnHeader))
+            throw std::runtime_error("Corrupted transaction binary");
+        XAie_TxnHeader hdr;
+        std::memcpy(&hdr, txn, sizeof(hdr));
+        if (hdr.TxnSize != size) {
             throw std::runtime_error("Corrupted transaction binary");
         }
 
-        txn_.resize(hdr->TxnSize);
-
-        uint8_t *ptr = txn_.data();
-        std::memcpy(ptr, hdr, sizeof(XAie_TxnHeader));
-
-        uint8_t *txn_ptr = ptr + sizeof(*hdr);
-        std::memcpy((char *)txn_ptr, txn + sizeof(*hdr), hdr->TxnSize - sizeof(XAie_TxnHeader));
+        txn_ = reinterpret_cast<const uint8_t *>(txn);
+        size_ = size;
     }
 
-    [[nodiscard]] std::string get_txn_summary() const {
-        const uint8_t *ptr = txn_.data();
-        std::array<unsigned int, XAIE_IO_CUSTOM_OP_NEXT> op_count = {};
-        count_txn_ops(ptr, op_count);
-        std::stringstream ss;
-
-        ss << op_format << "XAIE_IO_WRITE " << dec_format << op_count[XAIE_IO_WRITE] << std::endl;
-        ss << op_format << "XAIE_IO_BLOCKWRITE " << dec_format << op_count[XAIE_IO_BLOCKWRITE] << std::endl;
-        ss << op_format << "XAIE_IO_MASKWRITE " << dec_format << op_count[XAIE_IO_MASKWRITE] << std::endl;
-        ss << op_format << "XAIE_IO_MASKPOLL " << dec_format << op_count[XAIE_IO_MASKPOLL] << std::endl;
-        ss << op_format << "XAIE_IO_MASKPOLL_BUSY " << dec_format << op_count[XAIE_IO_MASKPOLL_BUSY] << std::endl;
-        ss << op_format << "XAIE_IO_NOOP " << dec_format << op_count[XAIE_IO_NOOP] << std::endl;
-        ss << op_format << "XAIE_IO_PREEMPT " << dec_format << op_count[XAIE_IO_PREEMPT] << std::endl;
-        ss << op_format << "XAIE_IO_LOAD_PM_START " << dec_format << op_count[XAIE_IO_LOAD_PM_START] << std::endl;
-        ss << op_format << "XAIE_IO_CUSTOM_OP_TCT " << dec_format << op_count[XAIE_IO_CUSTOM_OP_TCT] << std::endl;
-        ss << op_format << "XAIE_IO_CUSTOM_OP_DDR_PATCH " << dec_format << op_count[XAIE_IO_CUSTOM_OP_DDR_PATCH] << std::endl;
+    void write_report(aiebu::text_writer &out, bool detail) const {
+        report_visitor visitor(&out, detail);
+        aiebu::txn::walk(reinterpret_cast<const char *>(txn_), size_, visitor);
+
+        const auto &op_count = visitor.op_count;
+        for (auto code : {XAIE_IO_WRITE, XAIE_IO_BLOCKWRITE, XAIE_IO_MASKWRITE, XAIE_IO_MASKPOLL,
+                          XAIE_IO_MASKPOLL_BUSY, XAIE_IO_NOOP, XAIE_IO_PREEMPT, XAIE_IO_LOAD_PM_START,
+                          XAIE_IO_CUSTOM_OP_TCT, XAIE_IO_CUSTOM_OP_DDR_PATCH})
+            out.text(aiebu::txn::op_name(code), field_width).dec(op_count[code], field_width / 2).text('\n');
         /*
         ss << "Number of read ops: " << std::to_string(num_read_ops) << std::endl;
         ss << "Number of timer ops: " << std::to_string(num_readtimer_ops)
@@ -84,501 +61,142 @@ public:
         ss << "Number of merge sync ops: " << std::to_string(num_merge_sync_ops)
            << std::endl;
         */
-        return get_txn_summary(txn_.data()) + ss.str();
     }
 
-    [[nodiscard]] std::string get_all_ops() const {
-        return stringify_txn_ops();
+    void fill_report(aiebu::elf_report::section &sec) const {
+        report_visitor visitor(nullptr, false);
+        aiebu::txn::walk(reinterpret_cast<const char *>(txn_), size_, visitor);
+
+        sec.txn_format = visitor.opt ? "opt" : "legacy";
+        sec.ops.clear();
+        for (size_t code = 0; code < visitor.op_count.size(); ++code)
+            if (visitor.op_count[code])
+                sec.ops.push_back({aiebu::txn::op_name(static_cast<uint8_t>(code)), visitor.op_count[code], visitor.op_bytes[code]});
     }
 
 private:
-    #define MAJOR_VER 1
-    #define MINOR_VER 0
-
-    template <std::size_t N>
-    void count_tnx(const uint8_t *ptr, std::array<unsigned int, N> &op_count) const {
-        auto Hdr = (const XAie_TxnHeader *)(ptr);
-        const auto num_ops = Hdr->NumOps;
-        ptr += sizeof(*Hdr);
-
-        for (auto i = 0U; i < num_ops; i++) {
-            auto op_hdr = (const XAie_OpHdr *)(ptr);
-            op_count[op_hdr->Op]++;
-            switch (op_hdr->Op) {
-            case XAIE_IO_WRITE: {
-                auto w_hdr = (const XAie_Write32Hdr *)(ptr);
-                ptr += w_hdr->Size;
-                break;
-            }
-            case XAIE_IO_BLOCKWRITE: {
-                auto bw_header = (const XAie_BlockWrite32Hdr *)(ptr);
-                ptr += bw_header->Size;
-                break;
-            }
-            case XAIE_IO_MASKWRITE: {
-                auto mw_header = (const XAie_MaskWrite32Hdr *)(ptr);
-                ptr += mw_header->Size;
-                break;
-            }
-            case XAIE_IO_MASKPOLL:
-            case XAIE_IO_MASKPOLL_BUSY: {
-                auto mp_header = (const XAie_MaskPoll32Hdr *)(ptr);
-                ptr += mp_header->Size;
-                break;
-            }
-            case XAIE_IO_NOOP: {
-                ptr +=  sizeof(XAie_NoOpHdr);
-                break;
-            }
-            case XAIE_IO_PREEMPT: {
-                ptr += sizeof(XAie_PreemptHdr);
-                break;
-            }
-            case XAIE_IO_LOAD_PM_START: {
-                ptr += sizeof(XAie_PmLoadHdr);
-                break;
-            }
-            case (XAIE_IO_CUSTOM_OP_TCT):
-            case (XAIE_IO_CUSTOM_OP_DDR_PATCH):
-            case (XAIE_IO_CUSTOM_OP_READ_REGS):
-            case (XAIE_IO_CUSTOM_OP_RECORD_TIMER):
-            case (XAIE_IO_CUSTOM_OP_MERGE_SYNC): {
-                auto Hdr = (const XAie_CustomOpHdr *)(ptr);
-                ptr += Hdr->Size;
-                break;
-            }
-            default:
-                throw std::runtime_error("Unknown op to pass through");
-                break;
-            }
+    // Name the BD word a patch op targets, e.g. ", shim_bd[3].word[1]"
+    static void bd_format(aiebu::text_writer &out, uint32_t reg) {
+        auto loc = aiebu::aie2_bd::decode(reg);
+        if (loc.valid())
+            out.text(", ").text(aiebu::aie2_bd::to_string(loc.kind)).text("_bd[")
+               .dec(loc.bd).text("].word[").dec(loc.word).text(']');
+    }
+
+    // Counts every op and its bytes. With a writer it writes the header
+    // summary and, when detail is set, every op on a line of its own.
+    struct report_visitor : aiebu::txn::visitor_base {
+        aiebu::text_writer *out;
+        const bool detail;
+        bool opt = false;
+        std::array<uint64_t, XAIE_IO_CUSTOM_OP_NEXT> op_count = {};
+        std::array<uint64_t, XAIE_IO_CUSTOM_OP_NEXT> op_bytes = {};
+
+        report_visitor(aiebu::text_writer *o, bool d) : out(o), detail(o && d) {}
+
+        void on_begin(const XAie_TxnHeader &hdr, bool o) {
+            opt = o;
+            if (!out)
+                return;
+            if (opt)
+                out->text("Optimized HEADER version detected\n");
+            write_txn_summary(*out, hdr);
         }
-    }
 
-    template <std::size_t N>
-    void count_tnx_opt(const uint8_t *ptr, std::array<unsigned int, N> &op_count) const {
-        auto Hdr = (const XAie_TxnHeader *)(ptr);
-        const auto num_ops = Hdr->NumOps;
-        ptr += sizeof(*Hdr);
-        for (auto i = 0U; i < num_ops; i++) {
-            auto op_hdr = (const XAie_OpHdr_opt *)(ptr);
-            op_count[op_hdr->Op]++;
-            switch (op_hdr->Op) {
-            case XAIE_IO_WRITE: {
-                ptr += sizeof(XAie_Write32Hdr_opt);
-                break;
-            }
-            case XAIE_IO_BLOCKWRITE: {
-                auto bw_header = (const XAie_BlockWrite32Hdr_opt *)(ptr);
-                ptr += bw_header->Size;
-                break;
-            }
-            case XAIE_IO_MASKWRITE: {
-                ptr += sizeof(XAie_MaskWrite32Hdr_opt);
-                break;
-            }
-            case XAIE_IO_MASKPOLL:
-            case XAIE_IO_MASKPOLL_BUSY: {
-                ptr += sizeof(XAie_MaskPoll32Hdr_opt);
-                break;
-            }
-            case XAIE_IO_NOOP: {
-                ptr +=  sizeof(XAie_NoOpHdr);
-                break;
-            }
-            case XAIE_IO_PREEMPT: {
-                ptr += sizeof(XAie_PreemptHdr);
-                break;
-            }
-            case XAIE_IO_LOAD_PM_START: {
-                ptr += sizeof(XAie_PmLoadHdr);
-                break;
-            }
-            case (XAIE_IO_CUSTOM_OP_TCT):
-            case (XAIE_IO_CUSTOM_OP_DDR_PATCH):
-            case (XAIE_IO_CUSTOM_OP_READ_REGS):
-            case (XAIE_IO_CUSTOM_OP_RECORD_TIMER):
-            case (XAIE_IO_CUSTOM_OP_MERGE_SYNC): {
-                auto Hdr = (const XAie_CustomOpHdr_opt *)(ptr);
-                ptr += Hdr->Size;
-                break;
-            }
-            default:
-                throw std::runtime_error("Unknown op to pass through");
-                break;
-            }
+        void on_op(const aiebu::txn::op_ref &op) {
+            op_count[op.code]++;
+            op_bytes[op.code] += op.size;
         }
-    }
 
-    template <std::size_t N>
-    void count_txn_ops(const uint8_t *ptr, std::array<unsigned int, N> &op_count) const {
-        auto Hdr = (const XAie_TxnHeader *)(ptr);
-
-        /**
-         * Check if Header Version is 1.0 then call optimized API else continue with this
-         * function to service the TXN buffer.
-         */
-        if ((Hdr->Major == MAJOR_VER) && (Hdr->Minor == MINOR_VER)) {
-            printf("Optimized HEADER version detected \n");
-            count_tnx_opt(ptr, op_count);
-        } else {
-            count_tnx(ptr, op_count);
+        template <typename Hdr>
+        void on_write(const aiebu::txn::op_ref &, const Hdr &w_hdr) {
+            if (detail)
+                out->text("XAIE_IO_WRITE, ", field_width).text("@0x").hex(w_hdr.RegOff)
+                   .text(", 0x").hex(w_hdr.Value).text('\n');
         }
-    }
-
-    size_t stringify_w32(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto w_hdr = (const XAie_Write32Hdr *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_WRITE, " << "@0x" << std::hex << w_hdr->RegOff << ", 0x" << w_hdr->Value
-                << std::endl;
-        return w_hdr->Size;
-    }
 
-    size_t stringify_bw32(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto bw_header = (const XAie_BlockWrite32Hdr *)(ptr);
-        u32 bw_size = bw_header->Size;
-        u32 Size = (bw_size - sizeof(*bw_header)) / 4;
-        const char *curr = (const char *)ptr;
-        curr += sizeof(*bw_header);
-        u32 *Payload = (u32 *)curr;
-        ss_ops_ << op_format << "XAIE_IO_BLOCKWRITE, " << "@0x" << std::hex << bw_header->RegOff;
-        for (u32 i = 0; i < Size; i++) {
-            ss_ops_ << ", 0x" << std::hex << *Payload;
-            Payload++;
+        template <typename Hdr>
+        void on_block_write(const aiebu::txn::op_ref &op, const Hdr &bw_header) {
+            if (!detail)
+                return;
+            auto Payload = aiebu::txn::payload<Hdr>(op);
+            auto Size = aiebu::txn::payload_words<Hdr>(op);
+            out->text("XAIE_IO_BLOCKWRITE, ", field_width).text("@0x").hex(bw_header.RegOff);
+            for (size_t i = 0; i < Size; i++)
+                out->text(", 0x").hex(Payload[i]);
+            out->text('\n');
         }
-        ss_ops_ << std::endl;
-        return bw_size;
-    }
-
-    size_t stringify_mw32(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto mw_header = (const XAie_MaskWrite32Hdr *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_MASKWRITE, " << "@0x" << std::hex << mw_header->RegOff << ", 0x" << mw_header->Mask
-                << ", 0x" << mw_header->Value << std::endl;
-        return mw_header->Size;
-    }
-
-    size_t stringify_mp32(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_MaskPoll32Hdr *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_MASKPOLL, " << "@0x" << std::hex << mp_header->RegOff << ", 0x" << mp_header->Mask
-                << ", 0x" << mp_header->Value << std::endl;
-        return mp_header->Size;
-    }
-
-    size_t stringify_mp32_busy(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_MaskPoll32Hdr *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_MASKPOLL_BUSY, " << "@0x" << std::hex << mp_header->RegOff << ", 0x" << mp_header->Mask
-                << ", 0x" << mp_header->Value << std::endl;
-        return mp_header->Size;
-    }
-
-    size_t stringify_noop(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        (void)ptr;
-        ss_ops_ << op_format << "XAIE_IO_NOOP, " << std::endl;
-        return sizeof(XAie_NoOpHdr);
-    }
-
-    size_t stringify_preempt(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_PreemptHdr *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_PREEMPT, " << "@0x" << mp_header->Preempt_level << std::endl;
-        return sizeof(XAie_PreemptHdr);
-    }
-
-    size_t stringify_pmload(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_PmLoadHdr *)(ptr);
-        uint32_t loadsequence = mp_header->LoadSequenceCount[2] << 16 | mp_header->LoadSequenceCount[1] << 8 | mp_header->LoadSequenceCount[0];
-        ss_ops_ << op_format << "XAIE_IO_LOAD_PM_START, " << "0x" <<  std::hex << loadsequence << ", 0x" << mp_header->PmLoadId << std::endl;
-        return sizeof(XAie_PmLoadHdr);
-    }
-
-    size_t stringify_tct(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto co_header = (const XAie_CustomOpHdr *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_CUSTOM_OP_TCT " << std::endl;
-        return co_header->Size;
-    }
-
-    size_t stringify_patchop(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto hdr = (const XAie_CustomOpHdr *)(ptr);
-        u32 size = hdr->Size;
-        ss_ops_ << op_format << "XAIE_IO_CUSTOM_OP_DDR_PATCH, ";
-        const char *curr = (const char *)ptr;
-        curr += sizeof(*hdr);
-        auto op = (const patch_op_t *)curr;
-        auto reg_off = op->regaddr;
-        auto arg_idx = op->argidx;
-        auto addr_offset = op->argplus;
-        ss_ops_ << "@0x" << std::hex << reg_off << std::dec << ", " << arg_idx
-                << std::hex << ", 0x" << addr_offset << std::endl;
-        return size;
-    }
 
-    size_t stringify_rdreg(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto Hdr = (const XAie_CustomOpHdr *)(ptr);
-        u32 size = Hdr->Size;
-        ss_ops_ << "ReadOp: " << std::endl;
-        return size;
-    }
-
-    size_t stringify_rectimer(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto Hdr = (const XAie_CustomOpHdr *)(ptr);
-        u32 size = Hdr->Size;
-        ss_ops_ << "TimerOp: " << std::endl;
-        return size;
-    }
-
-    size_t stringify_merge_sync(const XAie_OpHdr *ptr, std::ostream &ss_ops_) const {
-        auto Hdr = (const XAie_CustomOpHdr *)(ptr);
-        u32 size = Hdr->Size;
-        ss_ops_ << "MergeSync Op: " << std::endl;
-        return size;
-    }
-
-    size_t stringify_tct_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto co_header = (const XAie_CustomOpHdr_opt *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_CUSTOM_OP_TCT " << std::endl;
-        return co_header->Size;
-    }
-
-    size_t stringify_w32_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto w_hdr = (const XAie_Write32Hdr_opt *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_WRITE, " << "@0x" << std::hex << w_hdr->RegOff << ", 0x" << w_hdr->Value
-                << std::endl;
-        return sizeof(XAie_Write32Hdr_opt);
-    }
-
-    size_t stringify_bw32_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto bw_header = (const XAie_BlockWrite32Hdr_opt *)(ptr);
-        u32 bw_size = bw_header->Size;
-        u32 Size = (bw_size - sizeof(*bw_header)) / 4;
-        const char *curr = (const char *)ptr;
-        curr += sizeof(*bw_header);
-        u32 *Payload = (u32 *)curr;
-        ss_ops_ << op_format << "XAIE_IO_BLOCKWRITE, " << "@0x" << std::hex << bw_header->RegOff;
-        for (u32 i = 0; i < Size; i++) {
-            ss_ops_ << ", 0x" << std::hex << *Payload;
-            Payload++;
+        template <typename Hdr>
+        void on_mask_write(const aiebu::txn::op_ref &, const Hdr &mw_header) {
+            if (detail)
+                out->text("XAIE_IO_MASKWRITE, ", field_width).text("@0x").hex(mw_header.RegOff)
+                   .text(", 0x").hex(mw_header.Mask).text(", 0x").hex(mw_header.Value).text('\n');
         }
-        ss_ops_ << std::endl;
-        return bw_size;
-    }
-
-    size_t stringify_mw32_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto mw_header = (const XAie_MaskWrite32Hdr_opt *)(ptr);
-ss_ops_ << op_format << "XAIE_IO_MASKWRITE, " << "@0x" << std::hex << mw_header->RegOff << ", 0x" << mw_header->Mask
-                << ", 0x" << mw_header->Value << std::endl;
-        return sizeof(XAie_MaskWrite32Hdr_opt);
-    }
-
-    size_t stringify_mp32_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_MaskPoll32Hdr_opt *)(ptr);
-ss_ops_ << op_format << "XAIE_IO_MASKPOLL, " << "@0x" << std::hex << mp_header->RegOff << ", 0x" << mp_header->Mask
-                << ", 0x" << mp_header->Value << std::endl;
-        return sizeof(XAie_MaskPoll32Hdr_opt);
-    }
-
-    size_t stringify_mp32_busy_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_MaskPoll32Hdr_opt *)(ptr);
-ss_ops_ << op_format << "XAIE_IO_MASKPOLL_BUSY, " << "@0x" << std::hex << mp_header->RegOff << ", 0x" << mp_header->Mask
-                << ", 0x" << mp_header->Value << std::endl;
-        return sizeof(XAie_MaskPoll32Hdr_opt);
-    }
 
-    size_t stringify_noop_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        (void)ptr;
-        ss_ops_ << op_format << "XAIE_IO_NOOP, " << std::endl;
-        return sizeof(XAie_NoOpHdr);
-    }
-
-    size_t stringify_preempt_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_PreemptHdr *)(ptr);
-        ss_ops_ << op_format << "XAIE_IO_PREEMPT, " << "@0x" << std::hex << (uint32_t)mp_header->Preempt_level << std::endl;
-        return sizeof(XAie_PreemptHdr);
-    }
+        template <typename Hdr>
+        void on_mask_poll(const aiebu::txn::op_ref &, const Hdr &mp_header, bool busy) {
+            if (detail)
+                out->text(busy ? "XAIE_IO_MASKPOLL_BUSY, " : "XAIE_IO_MASKPOLL, ", field_width)
+                   .text("@0x").hex(mp_header.RegOff).text(", 0x").hex(mp_header.Mask)
+                   .text(", 0x").hex(mp_header.Value).text('\n');
+        }
 
-    size_t stringify_pmload_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto mp_header = (const XAie_PmLoadHdr *)(ptr);
-        uint32_t loadsequence = mp_header->LoadSequenceCount[2] << 16 | mp_header->LoadSequenceCount[1] << 8 | mp_header->LoadSequenceCount[0];
-        ss_ops_ << op_format << "XAIE_IO_LOAD_PM_START, " << "0x" <<  std::hex << loadsequence << ", 0x" << mp_header->PmLoadId << std::endl;
-        return sizeof(XAie_PmLoadHdr);
-    }
+        void on_noop(const aiebu::txn::op_ref &) {
+            if (detail)
+                out->text("XAIE_IO_NOOP, ", field_width).text('\n');
+        }
 
-    size_t stringify_patchop_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto hdr = (const XAie_CustomOpHdr_opt *)(ptr);
-        u32 size = hdr->Size;
-        ss_ops_ << op_format << "XAIE_IO_CUSTOM_OP_DDR_PATCH, ";
-        const char *curr = (const char *)ptr;
-        curr += sizeof(*hdr);
-        auto op = (const patch_op_t *)curr;
-        auto reg_off = op->regaddr;
-        auto arg_idx = op->argidx;
-        auto addr_offset = op->argplus;
-        ss_ops_ << "@0x" << std::hex << reg_off << std::dec << ", " << arg_idx
-                << std::hex << ", 0x" << addr_offset << std::endl;
-        return size;
-    }
+        void on_preempt(const aiebu::txn::op_ref &, const XAie_PreemptHdr &mp_header) {
+            if (detail)
+                out->text("XAIE_IO_PREEMPT, ", field_width).text("@0x").hex(mp_header.Preempt_level).text('\n');
+        }
 
-    size_t stringify_rdreg_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto Hdr = (const XAie_CustomOpHdr_opt *)(ptr);
-        u32 size = Hdr->Size;
-        ss_ops_ << "ReadOp: " << std::endl;
-        return size;
-    }
+        void on_pm_load(const aiebu::txn::op_ref &, const XAie_PmLoadHdr &mp_header) {
+            if (detail)
+                out->text("XAIE_IO_LOAD_PM_START, ", field_width).text("0x")
+                   .hex(aiebu::txn::load_sequence_count(mp_header)).text(", 0x").hex(mp_header.PmLoadId).text('\n');
+        }
 
-    size_t stringify_rectimer_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto Hdr = (const XAie_CustomOpHdr_opt *)(ptr);
-        u32 size = Hdr->Size;
-        ss_ops_ << "TimerOp: " << std::endl;
-        return size;
-    }
+        void on_tct(const aiebu::txn::op_ref &) {
+            if (detail)
+                out->text("XAIE_IO_CUSTOM_OP_TCT ", field_width).text('\n');
+        }
 
-    size_t stringify_merge_sync_opt(const XAie_OpHdr_opt *ptr, std::ostream &ss_ops_) const {
-        auto Hdr = (const XAie_CustomOpHdr_opt *)(ptr);
-        u32 size = Hdr->Size;
-        ss_ops_ << "MergeSync Op: " << std::endl;
-        return size;
-    }
+        void on_ddr_patch(const aiebu::txn::op_ref &, const patch_op_t &op) {
+            if (!detail)
+                return;
+            out->text("XAIE_IO_CUSTOM_OP_DDR_PATCH, ", field_width).text("@0x").hex(op.regaddr)
+               .text(", ").dec(op.argidx).text(", 0x").hex(op.argplus);
+            bd_format(*out, static_cast<uint32_t>(op.regaddr));
+            out->text('\n');
+        }
 
-    [[nodiscard]] std::string stringify_txn() const {
-        auto Hdr = (const XAie_TxnHeader *)txn_.data();
-        auto num_ops = Hdr->NumOps;
-        auto ptr = txn_.data() + sizeof(*Hdr);
-
-        std::stringstream ss;
-
-        for (auto i = 0U; i < num_ops; i++) {
-            const auto op_hdr = (const XAie_OpHdr *)ptr;
-            size_t size = 0;
-            switch (op_hdr->Op) {
-            case XAIE_IO_WRITE:
-                size = stringify_w32(op_hdr, ss);
-                break;
-            case XAIE_IO_BLOCKWRITE:
-                size = stringify_bw32(op_hdr, ss);
-                break;
-            case XAIE_IO_MASKWRITE:
-                size = stringify_mw32(op_hdr, ss);
-                break;
-            case XAIE_IO_MASKPOLL:
-                size = stringify_mp32(op_hdr, ss);
-                break;
-            case XAIE_IO_MASKPOLL_BUSY:
-                size = stringify_mp32_busy(op_hdr, ss);
-                break;
-            case XAIE_IO_NOOP:
-                size = stringify_noop(op_hdr, ss);
-                break;
-            case XAIE_IO_PREEMPT:
-                size = stringify_preempt(op_hdr, ss);
-                break;
-            case XAIE_IO_LOAD_PM_START:
-                size = stringify_pmload(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_TCT:
-                size = stringify_tct(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_DDR_PATCH:
-                size = stringify_patchop(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_READ_REGS:
-                size = stringify_rdreg(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_RECORD_TIMER:
-                size = stringify_rectimer(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_MERGE_SYNC:
-                size = stringify_merge_sync(op_hdr, ss);
-                break;
-            default:
-                throw std::runtime_error("Error: Unknown op code at offset at " +
-                                         std::to_string(ptr - txn_.data()) +
-                                         ". OpCode: " + std::to_string(op_hdr->Op));
-                break;
-            }
-            ptr += size;
+        void on_read_regs(const aiebu::txn::op_ref &) {
+            if (detail)
+                out->text("ReadOp: \n");
         }
-        return ss.str();
-    }
 
-    [[nodiscard]] std::string stringify_txn_opt() const {
-        auto Hdr = (const XAie_TxnHeader *)txn_.data();
-        auto num_ops = Hdr->NumOps;
-        auto ptr = txn_.data() + sizeof(*Hdr);
-
-        std::stringstream ss;
-        for (auto i = 0U; i < num_ops; i++) {
-            const auto op_hdr = (const XAie_OpHdr_opt *)ptr;
-            size_t size = 0;
-            switch (op_hdr->Op) {
-            case XAIE_IO_WRITE:
-                size = stringify_w32_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_BLOCKWRITE:
-                size = stringify_bw32_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_MASKWRITE:
-                size = stringify_mw32_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_MASKPOLL:
-                size = stringify_mp32_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_MASKPOLL_BUSY:
-                size = stringify_mp32_busy_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_NOOP:
-                size = stringify_noop_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_PREEMPT:
-                size = stringify_preempt_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_LOAD_PM_START:
-                size = stringify_pmload_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_TCT:
-                size = stringify_tct_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_DDR_PATCH:
-                size = stringify_patchop_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_READ_REGS:
-                size = stringify_rdreg_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_RECORD_TIMER:
-                size = stringify_rectimer_opt(op_hdr, ss);
-                break;
-            case XAIE_IO_CUSTOM_OP_MERGE_SYNC:
-                size = stringify_merge_sync_opt(op_hdr, ss);
-                break;
-            default:
-                throw std::runtime_error("Error: Unknown op code at offset at " +
-                                         std::to_string(ptr - txn_.data()) +
-                                         ". OpCode: " + std::to_string(op_hdr->Op));
-                break;
-            }
-            ptr += size;
+        void on_record_timer(const aiebu::txn::op_ref &) {
+            if (detail)
+                out->text("TimerOp: \n");
         }
-        return ss.str();
-    }
 
-    [[nodiscard]] std::string stringify_txn_ops() const {
-        auto Hdr = (const XAie_TxnHeader *)txn_.data();
-        /**
-         * Check if Header Version is 1.0 then call optimized API else continue with this
-         * function to service the TXN buffer.
-         */
-        if ((Hdr->Major == MAJOR_VER) && (Hdr->Minor == MINOR_VER)) {
-            printf("Optimized HEADER version detected \n");
-            return stringify_txn_opt();
-        } else {
-            return stringify_txn();
+        void on_merge_sync(const aiebu::txn::op_ref &) {
+            if (detail)
+                out->text("MergeSync Op: \n");
         }
-    }
+    };
 };
 
 transaction::transaction(const char *txn, uint64_t size) : impl(std::make_shared<transaction::implementation>(txn, size)) {}
 
-std::string transaction::get_txn_summary() const
+void transaction::write_report(aiebu::text_writer &out, bool detail) const
 {
-    return impl->get_txn_summary();
+    impl->write_report(out, detail);
 }
 
-std::string transaction::get_all_ops() const
+void transaction::fill_report(aiebu::elf_report::section &sec) const
 {
-    return impl->get_all_ops();
+    impl->fill_report(sec);
 }
@@ -9,9 +9,13 @@
 #include <cinttypes>
 #include <memory>
 
+#include "aiebu_report.h"
+
 // Original source code came from
 // https://gitenterprise.xilinx.com/tsiddaga/dynamic_op_dispatch/blob/main/include/transaction.hpp
 
+namespace aiebu { class text_writer; }
+
 class transaction {
 
   // aie-rt facing implementation is hidden in this struct
@@ -23,9 +27,13 @@ public:
     std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> amap;
   };
 
+  // txn is referenced, it must be alive as long as this object
   transaction(const char *txn, uint64_t size);
-  [[nodiscard]] std::string get_txn_summary() const;
-  [[nodiscard]] std::string get_all_ops() const;
+  // Writes the header summary, every op when detail is set, then the op
+  // counts. The ops are decoded once for both.
+  void write_report(aiebu::text_writer &out, bool detail) const;
+  // Sets the header format and the op histogram of a control code section
+  void fill_report(aiebu::elf_report::section &sec) const;
 
 //  void update_txns(struct arg_map &amap);
 
@@ -0,0 +1,552 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <elfio/elfio.hpp>
+
+#include "aiebu_report.h"
+#include "aiebu_error.h"
+#include "text_writer.h"
+#include "transaction.hpp"
+#include "txn_cursor.h"
+#include "xaiengine.h"
+
+namespace aiebu {
+
+namespace {
+
+// An op as compared: the key ops are aligned on, and the fields that make
+// an aligned pair changed. Fixed fields are decoded from the header, the
+// rest of the op is compared as bytes, so the header layout does not matter.
+struct op_entry
+{
+  uint64_t key = 0;
+  uint32_t index = 0;
+  uint32_t offset = 0;
+  uint32_t size = 0;
+  uint8_t code = 0;
+  uint32_t reg = 0;
+  uint32_t value = 0;
+  uint32_t mask = 0;
+  const char* payload = nullptr;
+  size_t payload_size = 0;
+
+  bool
+  same_fields(const op_entry& rhs) const
+  {
+    return reg == rhs.reg && value == rhs.value && mask == rhs.mask
+      && payload_size == rhs.payload_size
+      && (!payload_size || !std::memcmp(payload, rhs.payload, payload_size));
+  }
+};
+
+struct op_collector : txn::visitor_base
+{
+  std::vector<op_entry>& ops;
+  size_t custom_header = sizeof(txn::format_legacy::custom_op);
+
+  explicit op_collector(std::vector<op_entry>& o) : ops(o) {}
+
+  void
+  set(uint64_t reg, uint32_t value, uint32_t mask, const char* payload, size_t payload_size)
+  {
+    auto& e = ops.back();
+    e.reg = static_cast<uint32_t>(reg);
+    e.value = value;
+    e.mask = mask;
+    e.payload = payload;
+    e.payload_size = payload_size;
+    e.key = uint64_t(e.code) << 32 | e.reg;
+  }
+
+  // Custom ops compare on what follows their header
+  void
+  custom(const txn::op_ref& op)
+  {
+    set(0, 0, 0, op.data + custom_header, op.size - custom_header);
+  }
+
+  void
+  on_begin(const XAie_TxnHeader&, bool opt)
+  {
+    custom_header = opt ? sizeof(txn::format_opt::custom_op) : sizeof(txn::format_legacy::custom_op);
+  }
+
+  // Ops without fields of their own compare as bytes
+  void
+  on_op(const txn::op_ref& op)
+  {
+    ops.push_back({uint64_t(op.code) << 32, op.index, static_cast<uint32_t>(op.offset),
+                   static_cast<uint32_t>(op.size), op.code, 0, 0, 0, op.data, op.size});
+  }
+
+  template <typename Hdr>
+  void
+  on_write(const txn::op_ref&, const Hdr& hdr)
+  {
+    set(hdr.RegOff, hdr.Value, 0, nullptr, 0);
+  }
+
+  template <typename Hdr>
+  void
+  on_block_write(const txn::op_ref& op, const Hdr& hdr)
+  {
+    set(hdr.RegOff, 0, 0, reinterpret_cast<const char*>(txn::payload<Hdr>(op)),
+        txn::payload_words<Hdr>(op) * sizeof(uint32_t));
+  }
+
+  template <typename Hdr>
+  void
+  on_mask_write(const txn::op_ref&, const Hdr& hdr)
+  {
+    set(hdr.RegOff, hdr.Value, hdr.Mask, nullptr, 0);
+  }
+
+  template <typename Hdr>
+  void
+  on_mask_poll(const txn::op_ref&, const Hdr& hdr, bool)
+  {
+    set(hdr.RegOff, hdr.Value, hdr.Mask, nullptr, 0);
+  }
+
+  void on_tct(const txn::op_ref& op) { custom(op); }
+  void on_read_regs(const txn::op_ref& op) { custom(op); }
+  void on_record_timer(const txn::op_ref& op) { custom(op); }
+  void on_merge_sync(const txn::op_ref& op) { custom(op); }
+
+  void
+  on_ddr_patch(const txn::op_ref& op, const patch_op_t& patch)
+  {
+    custom(op);
+    set(patch.regaddr, static_cast<uint32_t>(patch.argidx), 0, ops.back().payload, ops.back().payload_size);
+  }
+};
+
+std::vector<op_entry>
+collect_ops(const_buffer txn, std::string_view name)
+{
+  XAie_TxnHeader hdr;
+  if (txn.size < sizeof(hdr))
+    throw error(error::error_code::invalid_buffer_type, "Corrupted transaction in " + std::string(name) + " !!!");
+  std::memcpy(&hdr, txn.data, sizeof(hdr));
+  if (hdr.TxnSize != txn.size)
+    throw error(error::error_code::invalid_buffer_type, "Corrupted transaction in " + std::string(name) + " !!!");
+
+  std::vector<op_entry> ops;
+  ops.reserve(hdr.NumOps);
+  op_collector visitor(ops);
+  txn::walk(txn.data, txn.size, visitor);
+  return ops;
+}
+
+// Aligns two op sequences on their keys with Myers' O(ND) algorithm in
+// linear space: common ends are trimmed, then the problem is split where
+// the forward and reverse searches for the shortest edit script meet.
+// Sink gets match(i, j), removed(i) and inserted(j) in sequence order.
+template <typename Sink>
+class aligner
+{
+  const std::vector<op_entry>& m_a;
+  const std::vector<op_entry>& m_b;
+  Sink& m_sink;
+  std::vector<int64_t> m_fwd;
+  std::vector<int64_t> m_bwd;
+
+  bool
+  same(size_t i, size_t j) const
+  {
+    return m_a[i].key == m_b[j].key;
+  }
+
+  void
+  replace(size_t a0, size_t a1, size_t b0, size_t b1)
+  {
+    for (; a0 < a1; ++a0)
+      m_sink.removed(a0);
+    for (; b0 < b1; ++b0)
+      m_sink.inserted(b0);
+  }
+
+  // Point on a shortest edit script of a[a0,a1) to b[b0,b1), both non
+  // empty, returns false when they have no key in common
+  bool
+  split(size_t a0, size_t a1, size_t b0, size_t b1, size_t& x, size_t& y)
+  {
+    const int64_t n = a1 - a0;
+    const int64_t m = b1 - b0;
+    const int64_t max_d = (n + m + 1) / 2;
+    const int64_t offset = max_d;
+    const int64_t length = 2 * max_d + 2;
+    const int64_t delta = n - m;
+    const bool front = delta % 2 != 0;
+    m_fwd.assign(length, -1);
+    m_bwd.assign(length, -1);
+    m_fwd[offset + 1] = 0;
+    m_bwd[offset + 1] = 0;
+
+    // diagonals that ran off the grid are not extended again
+    int64_t k1_start = 0, k1_end = 0, k2_start = 0, k2_end = 0;
+    for (int64_t d = 0; d < max_d; ++d) {
+      for (int64_t k1 = -d + k1_start; k1 <= d - k1_end; k1 += 2) {
+        const int64_t k1_offset = offset + k1;
+        int64_t x1 = (k1 == -d || (k1 != d && m_fwd[k1_offset - 1] < m_fwd[k1_offset + 1]))
+          ? m_fwd[k1_offset + 1] : m_fwd[k1_offset - 1] + 1;
+        int64_t y1 = x1 - k1;
+        while (x1 < n && y1 < m && same(a0 + x1, b0 + y1)) {
+          ++x1;
+          ++y1;
+        }
+        m_fwd[k1_offset] = x1;
+        if (x1 > n)
+          k1_end += 2;
+        else if (y1 > m)
+          k1_start += 2;
+        else if (front) {
+          const int64_t k2_offset = offset + delta - k1;
+          if (k2_offset >= 0 && k2_offset < length && m_bwd[k2_offset] != -1 && x1 >= n - m_bwd[k2_offset]) {
+            x = a0 + x1;
+            y = b0 + y1;
+            return true;
+          }
+        }
+      }
+
+      // the reverse search runs from the ends, x2 counts from a1
+      for (int64_t k2 = -d + k2_start; k2 <= d - k2_end; k2 += 2) {
+        const int64_t k2_offset = offset + k2;
+        int64_t x2 = (k2 == -d || (k2 != d && m_bwd[k2_offset - 1] < m_bwd[k2_offset + 1]))
+          ? m_bwd[k2_offset + 1] : m_bwd[k2_offset - 1] + 1;
+        int64_t y2 = x2 - k2;
+        while (x2 < n && y2 < m && same(a1 - x2 - 1, b1 - y2 - 1)) {
+          ++x2;
+          ++y2;
+        }
+        m_bwd[k2_offset] = x2;
+        if (x2 > n)
+          k2_end += 2;
+        else if (y2 > m)
+          k2_start += 2;
+        else if (!front) {
+          const int64_t k1_offset = offset + delta - k2;
+          if (k1_offset >= 0 && k1_offset < length && m_fwd[k1_offset] != -1) {
+            const int64_t x1 = m_fwd[k1_offset];
+            if (x1 >= n - x2) {
+              x = a0 + x1;
+              y = b0 + (offset + x1 - k1_offset);
+              return true;
+            }
+          }
+        }
+      }
+    }
+    return false;
+  }
+
+public:
+  aligner(const std::vector<op_entry>& a, const std::vector<op_entry>& b, Sink& sink)
+    : m_a(a), m_b(b), m_sink(sink)
+  {}
+
+  void
+  align(size_t a0, size_t a1, size_t b0, size_t b1)
+  {
+    for (; a0 < a1 && b0 < b1 && same(a0, b0); ++a0, ++b0)
+      m_sink.match(a0, b0);
+    size_t suffix = 0;
+    for (; a0 < a1 && b0 < b1 && same(a1 - 1, b1 - 1); --a1, --b1)
+      ++suffix;
+
+    size_t x = 0, y = 0;
+    if (a0 == a1 || b0 == b1)
+      replace(a0, a1, b0, b1);
+    else if (split(a0, a1, b0, b1, x, y) && (x != a0 || y != b0) && (x != a1 || y != b1)) {
+      align(a0, x, b0, y);
+      align(x, a1, y, b1);
+    }
+    else
+      replace(a0, a1, b0, b1);
+
+    for (size_t i = 0; i < suffix; ++i)
+      m_sink.match(a1 + i, b1 + i);
+  }
+};
+
+elf_diff::op
+to_op(const op_entry& e)
+{
+  return {e.index, e.offset, e.size, txn::op_name(e.code), e.reg, e.value};
+}
+
+// Counts the alignment into a section and keeps the first changes
+struct change_sink
+{
+  const std::vector<op_entry>& a;
+  const std::vector<op_entry>& b;
+  elf_diff::section& sec;
+  std::vector<elf_diff::change>& changes;
+  size_t max_changes;
+
+  void
+  add(elf_diff::kind type, const op_entry* old_op, const op_entry* new_op)
+  {
+    if (changes.size() >= max_changes)
+      return;
+    auto& c = changes.emplace_back();
+    c.type = type;
+    c.section = sec.name;
+    if (old_op)
+      c.old_op = to_op(*old_op);
+    if (new_op)
+      c.new_op = to_op(*new_op);
+  }
+
+  void
+  match(size_t i, size_t j)
+  {
+    if (a[i].same_fields(b[j])) {
+      ++sec.unchanged;
+      return;
+    }
+    ++sec.changed;
+    add(elf_diff::kind::changed, &a[i], &b[j]);
+  }
+
+  void
+  removed(size_t i)
+  {
+    ++sec.removed;
+    add(elf_diff::kind::removed, &a[i], nullptr);
+  }
+
+  void
+  inserted(size_t j)
+  {
+    ++sec.inserted;
+    add(elf_diff::kind::inserted, nullptr, &b[j]);
+  }
+};
+
+void
+diff_ops(const std::vector<op_entry>& a, const std::vector<op_entry>& b, elf_diff::section& sec,
+         elf_diff& result, size_t max_changes)
+{
+  change_sink sink{a, b, sec, result.changes, max_changes};
+  aligner<change_sink>(a, b, sink).align(0, a.size(), 0, b.size());
+}
+
+// Op counts of both sides by name, the deltas that are not zero
+void
+diff_histogram(const elf_report::section* old_sec, const elf_report::section* new_sec, elf_diff::section& sec)
+{
+  std::map<std::string, elf_diff::op_delta> deltas;
+  if (old_sec) {
+    for (const auto& op : old_sec->ops) {
+      auto& d = deltas[op.name];
+      d.count -= op.count;
+      d.bytes -= op.bytes;
+      sec.old_ops += op.count;
+    }
+  }
+  if (new_sec) {
+    for (const auto& op : new_sec->ops) {
+      auto& d = deltas[op.name];
+      d.count += op.count;
+      d.bytes += op.bytes;
+      sec.new_ops += op.count;
+    }
+  }
+  for (auto& [name, d] : deltas) {
+    if (!d.count && !d.bytes)
+      continue;
+    d.name = name;
+    sec.ops.push_back(std::move(d));
+  }
+}
+
+elf_diff::section
+diff_section(const elf_report::section* old_sec, const elf_report::section* new_sec)
+{
+  elf_diff::section sec;
+  sec.name = old_sec ? old_sec->name : new_sec->name;
+  if (old_sec) {
+    sec.in_old = true;
+    sec.old_size = old_sec->size;
+    sec.old_format = old_sec->txn_format;
+  }
+  if (new_sec) {
+    sec.in_new = true;
+    sec.new_size = new_sec->size;
+    sec.new_format = new_sec->txn_format;
+  }
+  diff_histogram(old_sec, new_sec, sec);
+  return sec;
+}
+
+elf_report::section
+txn_section(const_buffer txn)
+{
+  elf_report::section sec;
+  sec.name = "txn";
+  sec.size = sec.content_size = static_cast<uint32_t>(txn.size);
+  transaction(txn.data, txn.size).fill_report(sec);
+  return sec;
+}
+
+text_writer&
+write_signed(text_writer& out, int64_t value)
+{
+  return (value > 0 ? out.text('+') : out).sdec(value);
+}
+
+// " (+n)" or " (-n)", nothing when equal
+void
+write_delta(text_writer& out, int64_t delta)
+{
+  if (delta)
+    write_signed(out.text(" ("), delta).text(')');
+}
+
+void
+write_op(text_writer& out, const elf_diff::op& op)
+{
+  out.text(op.name.empty() ? "UNKNOWN" : op.name);
+  if (op.reg)
+    out.text(" @0x").hex(op.reg);
+  out.text(" value:0x").hex(op.value);
+}
+
+}
+
+elf_diff
+diff(const elf_view& old_elf, const elf_view& new_elf, size_t max_changes)
+{
+  const auto old_report = make_report(old_elf);
+  const auto new_report = make_report(new_elf);
+  elf_diff result;
+  result.old_uid = old_report.uid;
+  result.new_uid = new_report.uid;
+
+  std::map<std::string_view, const elf_report::section*> new_sections;
+  for (const auto& sec : new_report.sections)
+    new_sections.emplace(sec.name, &sec);
+
+  std::vector<char> old_storage, new_storage;
+  for (const auto& old_sec : old_report.sections) {
+    if (old_sec.type == ELFIO::SHT_NULL)
+      continue;
+    auto it = new_sections.find(old_sec.name);
+    const auto* new_sec = it == new_sections.end() ? nullptr : it->second;
+    auto& sec = result.sections.emplace_back(diff_section(&old_sec, new_sec));
+    if (!new_sec)
+      continue;
+    new_sections.erase(it);
+    if (old_sec.txn_format.empty() || new_sec->txn_format.empty())
+      continue;
+    auto old_content = old_elf.get_content(old_elf.get_section(old_sec.index), old_storage);
+    auto new_content = new_elf.get_content(new_elf.get_section(new_sec->index), new_storage);
+    diff_ops(collect_ops(old_content, sec.name), collect_ops(new_content, sec.name), sec, result, max_changes);
+  }
+  for (const auto& new_sec : new_report.sections)
+    if (new_sec.type != ELFIO::SHT_NULL && new_sections.count(new_sec.name))
+      result.sections.push_back(diff_section(nullptr, &new_sec));
+
+  using reloc_key = std::tuple<std::string, std::string, std::string>;
+  std::map<reloc_key, std::pair<uint64_t, uint64_t>> relocations;
+  for (const auto& r : old_report.relocations)
+    relocations[{r.section, r.symbol, r.schema}].first += r.count;
+  for (const auto& r : new_report.relocations)
+    relocations[{r.section, r.symbol, r.schema}].second += r.count;
+  for (const auto& [key, counts] : relocations)
+    if (counts.first != counts.second)
+      result.relocations.push_back({std::get<0>(key), std::get<1>(key), std::get<2>(key), counts.first, counts.second});
+  return result;
+}
+
+elf_diff
+diff_transaction(const_buffer old_txn, const_buffer new_txn, size_t max_changes)
+{
+  const auto a = collect_ops(old_txn, "txn");
+  const auto b = collect_ops(new_txn, "txn");
+  const auto old_sec = txn_section(old_txn);
+  const auto new_sec = txn_section(new_txn);
+  elf_diff result;
+  auto& sec = result.sections.emplace_back(diff_section(&old_sec, &new_sec));
+  diff_ops(a, b, sec, result, max_changes);
+  return result;
+}
+
+void
+write_text(const elf_diff& diff, std::ostream& stream)
+{
+  text_writer out(stream);
+  if (diff.old_uid != diff.new_uid)
+    out.text("UID: ").text(diff.old_uid).text(" -> ").text(diff.new_uid).text('\n');
+
+  uint64_t num_changes = 0;
+  for (const auto& sec : diff.sections) {
+    out.text("Section ").text(sec.name).text(": ");
+    if (!sec.in_new) {
+      out.text("only in old, size ").dec(sec.old_size).text('\n');
+      continue;
+    }
+    if (!sec.in_old) {
+      out.text("only in new, size ").dec(sec.new_size).text('\n');
+      continue;
+    }
+    out.text("size ").dec(sec.old_size).text(" -> ").dec(sec.new_size);
+    write_delta(out, int64_t(sec.new_size) - int64_t(sec.old_size));
+    if (sec.old_format != sec.new_format)
+      out.text(", header ").text(sec.old_format).text(" -> ").text(sec.new_format);
+    if (!sec.old_format.empty() && !sec.new_format.empty()) {
+      out.text(", ops ").dec(sec.old_ops).text(" -> ").dec(sec.new_ops);
+      write_delta(out, int64_t(sec.new_ops) - int64_t(sec.old_ops));
+      out.text(", inserted:").dec(sec.inserted).text(" removed:").dec(sec.removed)
+         .text(" changed:").dec(sec.changed).text(" unchanged:").dec(sec.unchanged);
+    }
+    out.text('\n');
+    for (const auto& op : sec.ops) {
+      write_signed(out.text("    ").text(op.name, 32).text(" count:"), op.count).text(" bytes:");
+      write_signed(out, op.bytes).text('\n');
+    }
+    num_changes += sec.inserted + sec.removed + sec.changed;
+  }
+
+  for (const auto& r : diff.relocations)
+    out.text("Relocations ").text(r.section).text(' ').text(r.symbol).text(' ').text(r.schema)
+       .text(": ").dec(r.old_count).text(" -> ").dec(r.new_count).text('\n');
+
+  if (!diff.changes.empty())
+    out.text("Changes:\n");
+  for (const auto& c : diff.changes) {
+    out.text("  ").text(c.section).text(' ');
+    switch (c.type) {
+    case elf_diff::kind::inserted:
+      out.text("+ op:").dec(c.new_op.index).text(" offset:0x").hex(c.new_op.offset).text(' ');
+      write_op(out, c.new_op);
+      break;
+    case elf_diff::kind::removed:
+      out.text("- op:").dec(c.old_op.index).text(" offset:0x").hex(c.old_op.offset).text(' ');
+      write_op(out, c.old_op);
+      break;
+    case elf_diff::kind::changed:
+      out.text("~ op:").dec(c.old_op.index).text(" -> ").dec(c.new_op.index).text(' ');
+      write_op(out, c.old_op);
+      out.text(" -> 0x").hex(c.new_op.value);
+      if (c.old_op.size != c.new_op.size)
+        out.text(" size:").dec(c.old_op.size).text(" -> ").dec(c.new_op.size);
+      break;
+    }
+    out.text('\n');
+  }
+  if (num_changes > diff.changes.size())
+    out.text("  ... ").dec(num_changes - diff.changes.size()).text(" more\n");
+  out.flush();
+}
+
+}
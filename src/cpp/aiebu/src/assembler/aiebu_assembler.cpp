@@ -1,8 +1,15 @@
 // SPDX-License-Identifier: MIT
 // Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
 #include <map>
 #include <string>
+#include <system_error>
+#include <thread>
 #include "assembler.h"
 #include "aiebu_assembler.h"
 #include "aiebu.h"
@@ -12,12 +19,123 @@
 #include "preprocessor.h"
 #include "encoder.h"
 #include "elfwriter.h"
+#include "aie2_blob_elfwriter.h"
 #include "preprocessor_input.h"
+#include "aie2_blob_preprocessor_input.h"
+#include "buffer_view.h"
+#include "assembly_cache.h"
+#include "assembler_session.h"
+#include "patch_metadata.h"
 
 #include "reporter.h"
+#include "xaiengine.h"
 
 namespace aiebu {
 
+namespace {
+
+assembler::elf_type
+get_elf_type(aiebu_assembler::buffer_type type)
+{
+  if (type == aiebu_assembler::buffer_type::blob_instr_dpu)
+    return assembler::elf_type::aie2_dpu_blob;
+  if (type == aiebu_assembler::buffer_type::blob_instr_transaction)
+    return assembler::elf_type::aie2_transaction_blob;
+  throw error(error::error_code::invalid_buffer_type, "Buffer_type not supported !!!");
+}
+
+// Lib files an assembly maps, resolved as the preprocessor input does
+// from the number of columns in the transaction header
+std::vector<std::string>
+lib_files(aiebu_assembler::buffer_type type,
+          const buffer_view& buffer1,
+          const std::vector<std::string>& libs,
+          const std::vector<std::string>& libpaths)
+{
+  if (libs.empty())
+    return {};
+
+  uint32_t num_cols = 0;
+  if (type == aiebu_assembler::buffer_type::blob_instr_transaction) {
+    if (buffer1.size() < sizeof(XAie_TxnHeader))
+      throw error(error::error_code::invalid_buffer_size, "Transaction buffer too small !!!");
+    num_cols = reinterpret_cast<const XAie_TxnHeader*>(buffer1.data())->NumCols;
+  }
+  return aie2_blob_preprocessor_input::resolve_libs(num_cols, libs, libpaths);
+}
+
+// Assemble straight from caller owned buffers, nothing is copied before
+// the buffers land in the elf, which is written into the buffer returned
+// by sink. Returns the counters of the assembly.
+assembly_stats
+assemble(aiebu_assembler::buffer_type type,
+         const buffer_view& buffer1,
+         const buffer_view& buffer2,
+         const buffer_view& patch_json,
+         const std::vector<std::string>& libs,
+         const std::vector<std::string>& libpaths,
+         const std::map<uint8_t, buffer_view>& ctrlpkt,
+         const elf_options& options,
+         const elf_sink& sink)
+{
+  if (type == aiebu_assembler::buffer_type::blob_instr_dpu)
+  {
+    aiebu::assembler a(assembler::elf_type::aie2_dpu_blob, options);
+    a.process(sink, buffer1, libs, libpaths, patch_json, buffer2);
+    return a.get_stats();
+  }
+  else if (type == aiebu_assembler::buffer_type::blob_instr_transaction)
+  {
+    aiebu::assembler a(assembler::elf_type::aie2_transaction_blob, options);
+    a.process(sink, buffer1, libs, libpaths, patch_json, buffer2, ctrlpkt);
+    return a.get_stats();
+  }
+  throw error(error::error_code::invalid_buffer_type, "Buffer_type not supported !!!");
+}
+
+// Run func(0) .. func(count-1) on up to num_workers threads, the calling
+// thread is one of the workers. func must not throw. When a thread can not
+// be started the work is shared among those that are, the started threads
+// are always joined before an exception leaves.
+void
+parallel_for(size_t count, unsigned int num_workers, const std::function<void(size_t)>& func)
+{
+  if (!num_workers)
+    num_workers = std::max(1u, std::thread::hardware_concurrency());
+  num_workers = static_cast<unsigned int>(std::min<size_t>(num_workers, count));
+
+  std::atomic<size_t> next{0};
+  auto worker = [&next, count, &func]() {
+    for (size_t i = next++; i < count; i = next++)
+      func(i);
+  };
+
+  std::vector<std::thread> pool;
+  auto join = [&pool]() {
+    for (auto& t : pool)
+      t.join();
+  };
+  try
+  {
+    pool.reserve(num_workers);
+    for (unsigned int i = 1; i < num_workers; ++i)
+      pool.emplace_back(worker);
+  }
+  catch (std::system_error &)
+  {
+    // out of threads, run with those started
+  }
+  catch (...)
+  {
+    join();
+    throw;
+  }
+  worker();
+  join();
+}
+
+}
+
 aiebu_assembler::
 aiebu_assembler(buffer_type type,
                 const std::vector<char>& buffer,
@@ -36,18 +154,68 @@ aiebu_assembler(buffer_type type,
                 const std::vector<std::string>& libpaths,
                 const std::map<uint8_t, std::vector<char> >& ctrlpkt) : _type(type)
 {
-  if (type == buffer_type::blob_instr_dpu)
-  {
-    aiebu::assembler a(assembler::elf_type::aie2_dpu_blob);
-    elf_data = a.process(buffer1, libs, libpaths, patch_json, buffer2);
-  }
-  else if (type == buffer_type::blob_instr_transaction)
-  {
-    aiebu::assembler a(assembler::elf_type::aie2_transaction_blob);
-    elf_data = a.process(buffer1, libs, libpaths, patch_json, buffer2, ctrlpkt);
+  std::map<uint8_t, buffer_view> vctrlpkt;
+  for (const auto& [id, buf] : ctrlpkt)
+    vctrlpkt.emplace(id, buffer_view(buf));
+
+  m_stats = assemble(type, buffer1, buffer2, patch_json, libs, libpaths, vctrlpkt, {},
+                     [this](size_t size) {
+                       elf_data.resize(size);
+                       return elf_data.data();
+                     });
+}
+
+aiebu_assembler::
+aiebu_assembler(buffer_type type,
+                const_buffer buffer1,
+                const_buffer buffer2,
+                const_buffer patch_json,
+                const std::vector<std::string>& libs,
+                const std::vector<std::string>& libpaths,
+                const std::map<uint8_t, const_buffer>& ctrlpkt,
+                const elf_options& options) : _type(type)
+{
+  std::map<uint8_t, buffer_view> vctrlpkt;
+  for (const auto& [id, buf] : ctrlpkt)
+    vctrlpkt.emplace(id, buffer_view(buf.data, buf.size));
+
+  m_stats = assemble(type, buffer_view(buffer1.data, buffer1.size), buffer_view(buffer2.data, buffer2.size),
+                     buffer_view(patch_json.data, patch_json.size), libs, libpaths, vctrlpkt, options,
+                     [this](size_t size) {
+                       elf_data.resize(size);
+                       return elf_data.data();
+                     });
+}
+
+aiebu_assembler::
+aiebu_assembler(aiebu_assembler_cache& cache,
+                buffer_type type,
+                const std::vector<char>& buffer1,
+                const std::vector<char>& buffer2,
+                const std::vector<char>& patch_json,
+                const std::vector<std::string>& libs,
+                const std::vector<std::string>& libpaths,
+                const std::map<uint8_t, std::vector<char> >& ctrlpkt) : _type(type)
+{
+  std::map<uint8_t, buffer_view> vctrlpkt;
+  for (const auto& [id, buf] : ctrlpkt)
+    vctrlpkt.emplace(id, buffer_view(buf));
+
+  // Only the lib files libs resolve to are looked at, not all of libpaths
+  auto key = assembly_cache::make_key(static_cast<int>(type), buffer1, buffer2, patch_json,
+                                      libs, lib_files(type, buffer1, libs, libpaths), vctrlpkt);
+  if (auto elf = cache.m_cache->get(key)) {
+    elf_data = elf->elf;
+    m_stats = elf->stats;
+    return;
   }
-  else
-    throw error(error::error_code::invalid_buffer_type, "Buffer_type not supported !!!");
+
+  m_stats = assemble(type, buffer1, buffer2, patch_json, libs, libpaths, vctrlpkt, {},
+                     [this](size_t size) {
+                       elf_data.resize(size);
+                       return elf_data.data();
+                     });
+  cache.m_cache->put(key, {elf_data, m_stats});
 }
 
 std::vector<char>
@@ -57,33 +225,227 @@ get_elf() const
   return elf_data;
 }
 
+const_buffer
+aiebu_assembler::
+get_elf_buffer() const
+{
+  return {elf_data.data(), elf_data.size()};
+}
+
+assembly_stats
+aiebu_assembler::
+get_stats() const
+{
+  return m_stats;
+}
 
 void
 aiebu_assembler::
 get_report(std::ostream &stream) const
 {
-    reporter rep(_type, elf_data);
-    rep.elf_summary(stream);
-    rep.ctrlcode_summary(stream);
-    rep.ctrlcode_detail_summary(stream);
+    reporter rep(_type, get_elf_buffer());
+    text_writer out(stream);
+    rep.report(out);
 }
 
+void
+aiebu_assembler::
+get_report(int fd) const
+{
+    reporter rep(_type, get_elf_buffer());
+    text_writer out(fd);
+    rep.report(out);
 }
 
-DRIVER_DLLESPEC
+void
+aiebu_assembler::
+get_report(std::ostream &stream, report_format format) const
+{
+    if (format == report_format::text) {
+        get_report(stream);
+        return;
+    }
+    auto report = make_report(elf_view(get_elf_buffer()));
+    if (format == report_format::json)
+        write_json(report, stream);
+    else
+        write_csv(report, stream);
+}
+
+aiebu_assembler_cache::
+aiebu_assembler_cache(size_t max_memory_bytes,
+                      const std::string& disk_dir,
+                      uint64_t max_disk_bytes)
+  : m_cache(std::make_shared<assembly_cache>(max_memory_bytes, disk_dir, max_disk_bytes))
+{ }
+
+aiebu_assembler_cache::stats
+aiebu_assembler_cache::
+get_stats() const
+{
+  return m_cache->get_stats();
+}
+
+void
+aiebu_assembler_cache::
+clear()
+{
+  m_cache->clear();
+}
+
+aiebu_assembler_batch::
+aiebu_assembler_batch(unsigned int num_workers) : m_num_workers(num_workers)
+{ }
+
+std::vector<aiebu_assembler_batch::result>
+aiebu_assembler_batch::
+run(const std::vector<job>& jobs) const
+{
+  std::vector<result> results(jobs.size());
+  parallel_for(jobs.size(), m_num_workers, [&jobs, &results](size_t i) {
+    const job& j = jobs[i];
+    result& r = results[i];
+    try
+    {
+      std::map<uint8_t, buffer_view> vctrlpkt;
+      for (const auto& [id, buf] : j.pm_ctrlpkt)
+        vctrlpkt.emplace(id, buffer_view(buf.data, buf.size));
+
+      r.stats = assemble(j.type, buffer_view(j.buffer1.data, j.buffer1.size), buffer_view(j.buffer2.data, j.buffer2.size),
+                         buffer_view(j.patch_json.data, j.patch_json.size), j.libs, j.libpaths, vctrlpkt, j.options,
+                         [&r](size_t size) {
+                           r.elf.resize(size);
+                           return r.elf.data();
+                         });
+    }
+    catch (error &ex)
+    {
+      r.elf.clear();
+      r.error_code = ex.get_code();
+      r.message = ex.what();
+    }
+    catch (std::exception &ex)
+    {
+      r.elf.clear();
+      r.error_code = static_cast<int>(error::error_code::internal_error);
+      r.message = ex.what();
+    }
+  });
+  return results;
+}
+
+aiebu_assembler_bundle::
+aiebu_assembler_bundle(const std::vector<kernel>& kernels, const elf_options& options)
+{
+  // assemblers hold the libs mapped for their kernel, they are alive
+  // until the bundle is written
+  std::vector<std::unique_ptr<assembler>> assemblers;
+  std::vector<elf_writer::bundle_kernel> bundle;
+  for (const auto& k : kernels)
+  {
+    const auto& j = k.job;
+    std::map<uint8_t, buffer_view> vctrlpkt;
+    for (const auto& [id, buf] : j.pm_ctrlpkt)
+      vctrlpkt.emplace(id, buffer_view(buf.data, buf.size));
+
+    const auto type = get_elf_type(j.type);
+    assemblers.push_back(std::make_unique<assembler>(type, options));
+    // dpu sequences have no pm control packets
+    bundle.push_back({k.name, assemblers.back()->encode(buffer_view(j.buffer1.data, j.buffer1.size), j.libs, j.libpaths,
+                                                          buffer_view(j.patch_json.data, j.patch_json.size),
+                                                          buffer_view(j.buffer2.data, j.buffer2.size),
+                                                          type == assembler::elf_type::aie2_dpu_blob
+                                                          ? std::map<uint8_t, buffer_view>() : vctrlpkt)});
+  }
+
+  aie2_blob_elf_writer writer(options);
+  writer.process_bundle(bundle, [this](size_t size) {
+    elf_data.resize(size);
+    return elf_data.data();
+  });
+}
+
+std::vector<char>
+aiebu_assembler_bundle::
+get_elf() const
+{
+  return elf_data;
+}
+
+const_buffer
+aiebu_assembler_bundle::
+get_elf_buffer() const
+{
+  return {elf_data.data(), elf_data.size()};
+}
+
+aiebu_assembler_session::
+aiebu_assembler_session(aiebu_assembler::buffer_type type,
+                        const_buffer buffer1,
+                        const std::vector<std::string>& libs,
+                        const std::vector<std::string>& libpaths,
+                        const elf_options& options)
+  : m_impl(std::make_unique<assembler_session>(get_elf_type(type), buffer_view(buffer1.data, buffer1.size),
+                                               libs, libpaths, options))
+{
+}
+
+aiebu_assembler_session::
+~aiebu_assembler_session() = default;
+
+bool
+aiebu_assembler_session::
+update(const_buffer patch_json, const_buffer buffer2, const std::map<uint8_t, const_buffer>& pm_ctrlpkt)
+{
+  // dpu sequences have no pm control packets
+  std::map<uint8_t, buffer_view> vctrlpkt;
+  if (m_impl->get_type() != assembler::elf_type::aie2_dpu_blob)
+    for (const auto& [id, buf] : pm_ctrlpkt)
+      vctrlpkt.emplace(id, buffer_view(buf.data, buf.size));
+
+  return m_impl->update(buffer_view(patch_json.data, patch_json.size),
+                        buffer_view(buffer2.data, buffer2.size), vctrlpkt);
+}
+
+const_buffer
+aiebu_assembler_session::
+get_elf_buffer() const
+{
+  const auto& elf = m_impl->get_elf();
+  return {elf.data(), elf.size()};
+}
+
+std::vector<char>
+aiebu_assembler_session::
+get_elf() const
+{
+  return m_impl->get_elf();
+}
+
+std::vector<char>
+aiebu_patch_metadata_from_json(const_buffer patch_json)
+{
+  return patch_metadata::from_json(patch_json.data, patch_json.size).serialize();
+}
+
+}
+
+namespace {
+
+// Common body of the C entry points, returns elf size or negative error code
 int
-aiebu_assembler_get_elf(enum aiebu_assembler_buffer_type type,
-                        const char* buffer1,
-                        size_t buffer1_size,
-                        const char* buffer2,
-                        size_t buffer2_size,
-                        void** elf_buf,
-                        const char* patch_json,
-                        size_t patch_json_size,
-                        const char* libs,
-                        const char* libpaths,
-                        struct pm_ctrlpkt* pm_ctrlpkts,
-                        size_t pm_ctrlpkt_size)
+get_elf(enum aiebu_assembler_buffer_type type,
+        const char* buffer1,
+        size_t buffer1_size,
+        const char* buffer2,
+        size_t buffer2_size,
+        const aiebu::elf_sink& sink,
+        const char* patch_json,
+        size_t patch_json_size,
+        const char* libs,
+        const char* libpaths,
+        struct pm_ctrlpkt* pm_ctrlpkts,
+        size_t pm_ctrlpkt_size)
 {
   int ret = 0;
   if (buffer2 == NULL && buffer2_size != 0)
@@ -100,13 +462,7 @@ aiebu_assembler_get_elf(enum aiebu_assembler_buffer_type type,
 
   try
   {
-    std::vector<char> v1, v2, v3;
-    std::vector<char> velf;
-
-    v1.assign(buffer1, buffer1+buffer1_size);
-    v2.assign(buffer2, buffer2+buffer2_size);
-    v3.assign(patch_json, patch_json+patch_json_size);
-    std::map<uint8_t, std::vector<char> > mctrlpkt;
+    std::map<uint8_t, aiebu::buffer_view> mctrlpkt;
 
     std::vector<std::string> vlibs;
     if (libs)
@@ -117,17 +473,19 @@ aiebu_assembler_get_elf(enum aiebu_assembler_buffer_type type,
       vlibpaths = aiebu::splitoption(libpaths);
 
     for (auto i=0ul; i < pm_ctrlpkt_size; i++)
-    {
-      std::vector<char> v(pm_ctrlpkts[i].pm_buffer, pm_ctrlpkts[i].pm_buffer + pm_ctrlpkts[i].pm_buffer_size);
-      mctrlpkt[pm_ctrlpkts[i].pm_id] = std::move(v);
-    }
+      mctrlpkt[pm_ctrlpkts[i].pm_id] = aiebu::buffer_view(pm_ctrlpkts[i].pm_buffer, pm_ctrlpkts[i].pm_buffer_size);
 
-    aiebu::aiebu_assembler handler((aiebu::aiebu_assembler::buffer_type)type, v1, v2, v3, vlibs, vlibpaths, mctrlpkt);
-    velf = handler.get_elf();
-    char *aelf = static_cast<char*>(std::malloc(sizeof(char)*velf.size()));
-    std::copy(velf.begin(), velf.end(), aelf);
-    *elf_buf = (void*)aelf;
-    ret = static_cast<int>(velf.size());
+    size_t elf_size = 0;
+    aiebu::assemble((aiebu::aiebu_assembler::buffer_type)type,
+                    aiebu::buffer_view(buffer1, buffer1_size),
+                    aiebu::buffer_view(buffer2, buffer2_size),
+                    aiebu::buffer_view(patch_json, patch_json_size),
+                    vlibs, vlibpaths, mctrlpkt, {},
+                    [&sink, &elf_size](size_t size) {
+                      elf_size = size;
+                      return sink(size);
+                    });
+    ret = static_cast<int>(elf_size);
   }
   catch (aiebu::error &ex)
   {
@@ -141,3 +499,142 @@ aiebu_assembler_get_elf(enum aiebu_assembler_buffer_type type,
   }
   return ret;
 }
+
+}
+
+DRIVER_DLLESPEC
+int
+aiebu_assembler_get_elf(enum aiebu_assembler_buffer_type type,
+                        const char* buffer1,
+                        size_t buffer1_size,
+                        const char* buffer2,
+                        size_t buffer2_size,
+                        void** elf_buf,
+                        const char* patch_json,
+                        size_t patch_json_size,
+                        const char* libs,
+                        const char* libpaths,
+                        struct pm_ctrlpkt* pm_ctrlpkts,
+                        size_t pm_ctrlpkt_size)
+{
+  // the buffer is handed to the caller only once the elf is complete, it
+  // is freed when anything fails after it was allocated
+  void* buf = NULL;
+  int ret = aiebu_assembler_get_elf_alloc(type, buffer1, buffer1_size, buffer2, buffer2_size,
+                                          [](size_t size, void* user_data) {
+                                            void* b = std::malloc(size);
+                                            *static_cast<void**>(user_data) = b;
+                                            return b;
+                                          },
+                                          &buf, patch_json, patch_json_size,
+                                          libs, libpaths, pm_ctrlpkts, pm_ctrlpkt_size);
+  if (ret < 0)
+  {
+    std::free(buf);
+    buf = NULL;
+  }
+  *elf_buf = buf;
+  return ret;
+}
+
+DRIVER_DLLESPEC
+int
+aiebu_assembler_get_elf_alloc(enum aiebu_assembler_buffer_type type,
+                              const char* buffer1,
+                              size_t buffer1_size,
+                              const char* buffer2,
+                              size_t buffer2_size,
+                              aiebu_elf_allocator allocator,
+                              void* user_data,
+                              const char* patch_json,
+                              size_t patch_json_size,
+                              const char* libs,
+                              const char* libpaths,
+                              struct pm_ctrlpkt* pm_ctrlpkts,
+                              size_t pm_ctrlpkt_size)
+{
+  if (allocator == NULL)
+    return -EINVAL;
+
+  return get_elf(type, buffer1, buffer1_size, buffer2, buffer2_size,
+                 [allocator, user_data](size_t size) {
+                   auto buf = static_cast<char*>(allocator(size, user_data));
+                   if (!buf)
+                     throw aiebu::error(aiebu::error::error_code::invalid_buffer_size,
+                                        "Allocator failed for " + std::to_string(size) + " bytes !!!");
+                   return buf;
+                 },
+                 patch_json, patch_json_size, libs, libpaths, pm_ctrlpkts, pm_ctrlpkt_size);
+}
+
+DRIVER_DLLESPEC
+int
+aiebu_assembler_get_elf_to_buffer(enum aiebu_assembler_buffer_type type,
+                                  const char* buffer1,
+                                  size_t buffer1_size,
+                                  const char* buffer2,
+                                  size_t buffer2_size,
+                                  void* elf_buf,
+                                  size_t elf_buf_size,
+                                  const char* patch_json,
+                                  size_t patch_json_size,
+                                  const char* libs,
+                                  const char* libpaths,
+                                  struct pm_ctrlpkt* pm_ctrlpkts,
+                                  size_t pm_ctrlpkt_size)
+{
+  return get_elf(type, buffer1, buffer1_size, buffer2, buffer2_size,
+                 [elf_buf, elf_buf_size](size_t size) {
+                   // size query, nothing is written
+                   if (!elf_buf)
+                     return static_cast<char*>(nullptr);
+                   if (elf_buf_size < size)
+                     throw aiebu::error(aiebu::error::error_code::invalid_buffer_size,
+                                        "Elf needs " + std::to_string(size) + " bytes, buffer has "
+                                        + std::to_string(elf_buf_size) + " !!!");
+                   return static_cast<char*>(elf_buf);
+                 },
+                 patch_json, patch_json_size, libs, libpaths, pm_ctrlpkts, pm_ctrlpkt_size);
+}
+
+DRIVER_DLLESPEC
+int
+aiebu_assembler_batch_get_elf(struct aiebu_assembler_job* jobs,
+                              size_t num_jobs,
+                              unsigned int num_workers)
+{
+  const int err = -(static_cast<int>(aiebu::error::error_code::internal_error));
+  if (jobs == NULL && num_jobs != 0)
+    return err;
+
+  for (size_t i = 0; i < num_jobs; ++i)
+  {
+    jobs[i].elf_buf = NULL;
+    jobs[i].elf_size = err;
+  }
+
+  std::atomic<int> failed{0};
+  try
+  {
+    aiebu::parallel_for(num_jobs, num_workers, [jobs, &failed](size_t i) {
+      aiebu_assembler_job& j = jobs[i];
+      j.elf_size = aiebu_assembler_get_elf(j.type, j.buffer1, j.buffer1_size,
+                                           j.buffer2, j.buffer2_size, &j.elf_buf,
+                                           j.patch_json, j.patch_json_size,
+                                           j.libs, j.libpaths, j.pm_ctrlpkts, j.pm_ctrlpkt_size);
+      if (j.elf_size < 0)
+        ++failed;
+    });
+  }
+  catch (std::exception&)
+  {
+    for (size_t i = 0; i < num_jobs; ++i)
+    {
+      std::free(jobs[i].elf_buf);
+      jobs[i].elf_buf = NULL;
+      jobs[i].elf_size = err;
+    }
+    return err;
+  }
+  return failed;
+}
@@ -15,19 +15,19 @@
 namespace aiebu {
 
 assembler::
-assembler(const elf_type type)
+assembler(const elf_type type, const elf_options& options)
 {
 
   if (type == elf_type::aie2_dpu_blob)  {
     m_preprocessor = std::make_unique<aie2_blob_preprocessor>();
     m_enoder = std::make_unique<aie2_blob_encoder>();
-    m_elfwriter = std::make_unique<aie2_blob_elf_writer>();
+    m_elfwriter = std::make_unique<aie2_blob_elf_writer>(options);
     m_ppi = std::make_shared<aie2_blob_dpu_preprocessor_input>();
   }
   else if (type == elf_type::aie2_transaction_blob)  {
     m_preprocessor = std::make_unique<aie2_blob_preprocessor>();
     m_enoder = std::make_unique<aie2_blob_encoder>();
-    m_elfwriter = std::make_unique<aie2_blob_elf_writer>();
+    m_elfwriter = std::make_unique<aie2_blob_elf_writer>(options);
     m_ppi = std::make_shared<aie2_blob_transaction_preprocessor_input>();
   }
   else
@@ -36,18 +36,55 @@ assembler(const elf_type type)
 
 std::vector<char>
 assembler::
-process(const std::vector<char>& buffer1,
+process(const buffer_view& buffer1,
         const std::vector<std::string>& libs,
         const std::vector<std::string>& libpaths,
-        const std::vector<char>& patch_json,
-        const std::vector<char>& buffer2,
-        const std::map<uint8_t, std::vector<char> >& ctrlpkt)
+        const buffer_view& patch_json,
+        const buffer_view& buffer2,
+        const std::map<uint8_t, buffer_view>& ctrlpkt)
 {
-  m_ppi->set_args(buffer1, patch_json, buffer2, libs, libpaths, ctrlpkt);
-  auto ppo = m_preprocessor->process(m_ppi);
-  auto w = m_enoder->process(ppo);
+  auto w = encode(buffer1, libs, libpaths, patch_json, buffer2, ctrlpkt);
   auto u = m_elfwriter->process(w);
   return u;
 }
 
+void
+assembler::
+process(const elf_sink& sink,
+        const buffer_view& buffer1,
+        const std::vector<std::string>& libs,
+        const std::vector<std::string>& libpaths,
+        const buffer_view& patch_json,
+        const buffer_view& buffer2,
+        const std::map<uint8_t, buffer_view>& ctrlpkt)
+{
+  auto w = encode(buffer1, libs, libpaths, patch_json, buffer2, ctrlpkt);
+  m_elfwriter->process(w, sink);
+}
+
+std::vector<writer>
+assembler::
+encode(const buffer_view& buffer1,
+       const std::vector<std::string>& libs,
+       const std::vector<std::string>& libpaths,
+       const buffer_view& patch_json,
+       const buffer_view& buffer2,
+       const std::map<uint8_t, buffer_view>& ctrlpkt)
+{
+  m_ppi->set_args(buffer1, patch_json, buffer2, libs, libpaths, ctrlpkt);
+  auto ppo = m_preprocessor->process(m_ppi);
+  return m_enoder->process(ppo);
+}
+
+assembly_stats
+assembler::
+get_stats() const
+{
+  auto stats = m_ppi->get_stats();
+  const auto& elf = m_elfwriter->get_stats();
+  stats.symbols = elf.symbols;
+  stats.symbol_memory = elf.symbol_memory;
+  return stats;
+}
+
 }
@@ -9,6 +9,10 @@
 #include <map>
 
 #include "symbol.h"
+#include "writer.h"
+#include "buffer_view.h"
+#include "elf_serializer.h"
+#include "aiebu_assembler.h"
 
 namespace aiebu {
 
@@ -30,14 +34,38 @@ public:
     aie2_dpu_blob
   };
 
-  explicit assembler(const elf_type type);
+  explicit assembler(const elf_type type, const elf_options& options = {});
 
-  std::vector<char> process(const std::vector<char>& buffer1,
+  // Input buffers are referenced, not copied, they must be alive until
+  // process() returns
+  std::vector<char> process(const buffer_view& buffer1,
                             const std::vector<std::string>& libs = {},
                             const std::vector<std::string>& libpaths = {},
-                            const std::vector<char>& patch_json = {},
-                            const std::vector<char>& buffer2 = {},
-                            const std::map<uint8_t, std::vector<char> >& ctrlpkt = {});
+                            const buffer_view& patch_json = {},
+                            const buffer_view& buffer2 = {},
+                            const std::map<uint8_t, buffer_view>& ctrlpkt = {});
+
+  // Same as above but the elf is written into the buffer returned by sink
+  void process(const elf_sink& sink,
+               const buffer_view& buffer1,
+               const std::vector<std::string>& libs = {},
+               const std::vector<std::string>& libpaths = {},
+               const buffer_view& patch_json = {},
+               const buffer_view& buffer2 = {},
+               const std::map<uint8_t, buffer_view>& ctrlpkt = {});
+
+  // Preprocess and encode only, for an elf written by someone else, e.g.
+  // a bundle. Sections reference the inputs and libs mapped by this
+  // assembler, both must be alive until the elf is written.
+  std::vector<writer> encode(const buffer_view& buffer1,
+                             const std::vector<std::string>& libs = {},
+                             const std::vector<std::string>& libpaths = {},
+                             const buffer_view& patch_json = {},
+                             const buffer_view& buffer2 = {},
+                             const std::map<uint8_t, buffer_view>& ctrlpkt = {});
+
+  // Counters of the last process(), encode() sets the BD counters only
+  assembly_stats get_stats() const;
 
 };
 
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <set>
+
+#include "assembler_session.h"
+#include "aie2_blob_preprocessor.h"
+#include "aie2_blob_encoder.h"
+#include "aie2_blob_elfwriter.h"
+#include "aiebu_error.h"
+
+namespace aiebu {
+
+assembler_session::
+assembler_session(assembler::elf_type type,
+                  const buffer_view& code,
+                  const std::vector<std::string>& libs,
+                  const std::vector<std::string>& libpaths,
+                  const elf_options& options)
+  : m_type(type), m_options(options), m_code(code), m_libs(libs), m_libpaths(libpaths)
+{
+  if (type != assembler::elf_type::aie2_dpu_blob && type != assembler::elf_type::aie2_transaction_blob)
+    throw error(error::error_code::invalid_buffer_type ,"Invalid elf type!!!");
+}
+
+bool
+assembler_session::
+update(const buffer_view& patch_json,
+       const buffer_view& buffer2,
+       const std::map<uint8_t, buffer_view>& ctrlpkt)
+{
+  std::shared_ptr<aie2_blob_preprocessor_input> ppi;
+  if (m_type == assembler::elf_type::aie2_dpu_blob)
+    ppi = std::make_shared<aie2_blob_dpu_preprocessor_input>();
+  else
+    ppi = std::make_shared<aie2_blob_transaction_preprocessor_input>();
+
+  ppi->set_patch_data(patch_json, buffer2, ctrlpkt);
+  std::set<std::string> unchanged;
+  if (m_cache && ppi->reuse_code(*m_cache)) {
+    for (const auto& entry : m_cache->data)
+      unchanged.insert(entry.first);
+  }
+  else {
+    ppi->set_code(m_code, m_libs, m_libpaths);
+    m_cache = std::make_unique<aie2_blob_preprocessor_input::code_cache>(ppi->save_code());
+  }
+
+  aie2_blob_preprocessor preprocessor;
+  aie2_blob_encoder encoder;
+  auto w = encoder.process(preprocessor.process(ppi));
+  aie2_blob_elf_writer writer(m_options);
+  try {
+    return writer.process(w, m_elf, unchanged);
+  }
+  catch (...) {
+    // a partly written elf must not be kept for the next update
+    m_elf.clear();
+    throw;
+  }
+}
+
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_ASSEMBLER_ASSEMBLER_SESSION_H_
+#define _AIEBU_ASSEMBLER_ASSEMBLER_SESSION_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "assembler.h"
+#include "buffer_view.h"
+#include "aiebu_assembler.h"
+#include "aie2_blob_preprocessor_input.h"
+
+namespace aiebu {
+
+// Assembles one control code again and again with new patch metadata,
+// control packet and pm control packets. The code and the libs are
+// walked for symbols once and reused as long as the patch metadata names
+// the same buffers and the same pm ids are given, the elf of the previous
+// update is then rewritten in place except for the code sections.
+class assembler_session
+{
+  const assembler::elf_type m_type;
+  const elf_options m_options;
+  const buffer_view m_code;
+  const std::vector<std::string> m_libs;
+  const std::vector<std::string> m_libpaths;
+  std::unique_ptr<aie2_blob_preprocessor_input::code_cache> m_cache;
+  std::vector<char> m_elf;
+
+public:
+  // code is referenced, it must be alive as long as the session
+  assembler_session(assembler::elf_type type,
+                    const buffer_view& code,
+                    const std::vector<std::string>& libs,
+                    const std::vector<std::string>& libpaths,
+                    const elf_options& options);
+
+  // Inputs are referenced while update() runs. Returns true when the
+  // elf was rewritten in place.
+  bool update(const buffer_view& patch_json,
+              const buffer_view& buffer2,
+              const std::map<uint8_t, buffer_view>& ctrlpkt);
+
+  assembler::elf_type
+  get_type() const
+  {
+    return m_type;
+  }
+
+  const std::vector<char>&
+  get_elf() const
+  {
+    return m_elf;
+  }
+};
+
+}
+#endif //_AIEBU_ASSEMBLER_ASSEMBLER_SESSION_H_
@@ -0,0 +1,287 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <tuple>
+
+#include "assembly_cache.h"
+#include "hash.h"
+
+// Generated at build time, see cmake/build_id.cmake. Without it elfs of
+// another build could be served from disk, the disk store is disabled.
+#if __has_include("aiebu_build_id.h")
+#include "aiebu_build_id.h"
+#endif
+
+#ifndef AIEBU_BUILD_VERSION
+#define AIEBU_BUILD_VERSION ""
+#endif
+
+#ifndef AIEBU_BUILD_ID
+#define AIEBU_BUILD_ID ""
+#endif
+
+namespace aiebu {
+
+namespace {
+
+// Bumped when the key or the file layout of the cache changes
+constexpr uint32_t cache_format_version = 2;
+
+const std::string elf_ext = ".elf";
+
+// Stats after the elf in a cache file, fixed size and native byte order,
+// the key covers the build so a file is only read by the build that wrote it
+constexpr size_t stats_size = 4 * sizeof(uint64_t);
+
+void
+write_stats(const assembly_stats& stats, char* dst)
+{
+  const uint64_t values[] = {stats.bd_writes_indexed, stats.bd_writes_patched, stats.symbols, stats.symbol_memory};
+  static_assert(sizeof(values) == stats_size);
+  std::memcpy(dst, values, sizeof(values));
+}
+
+assembly_stats
+read_stats(const char* src)
+{
+  uint64_t values[4];
+  std::memcpy(values, src, sizeof(values));
+  assembly_stats stats;
+  stats.bd_writes_indexed = static_cast<uint32_t>(values[0]);
+  stats.bd_writes_patched = static_cast<uint32_t>(values[1]);
+  stats.symbols = values[2];
+  stats.symbol_memory = values[3];
+  return stats;
+}
+
+constexpr bool has_build_id = sizeof(AIEBU_BUILD_ID) > 1;
+
+}
+
+assembly_cache::
+assembly_cache(size_t max_memory_bytes, const std::string& dir, uint64_t max_disk_bytes)
+  : m_max_memory_bytes(max_memory_bytes), m_dir(has_build_id ? dir : std::string()),
+    m_max_disk_bytes(max_disk_bytes)
+{
+  if (!m_dir.empty()) {
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+  }
+}
+
+std::string
+assembly_cache::
+make_key(int type,
+         const buffer_view& buffer1,
+         const buffer_view& buffer2,
+         const buffer_view& patch_json,
+         const std::vector<std::string>& libs,
+         const std::vector<std::string>& lib_files,
+         const std::map<uint8_t, buffer_view>& ctrlpkt)
+{
+  hash128 h;
+  h.update(AIEBU_BUILD_VERSION);
+  h.update(AIEBU_BUILD_ID);
+  h.update_value(cache_format_version);
+  h.update_value(type);
+  h.update(buffer1.data(), buffer1.size());
+  h.update(buffer2.data(), buffer2.size());
+  h.update(patch_json.data(), patch_json.size());
+
+  h.update_value(ctrlpkt.size());
+  for (const auto& [id, buf] : ctrlpkt) {
+    h.update_value(id);
+    h.update(buf.data(), buf.size());
+  }
+
+  h.update_value(libs.size());
+  for (const auto& lib : libs)
+    h.update(lib);
+
+  // Hashing the contents of lib files would cost as much as reading them,
+  // so path, size and modification time stand in for them.
+  h.update_value(lib_files.size());
+  for (const auto& file : lib_files) {
+    std::error_code ec;
+    h.update(file);
+    h.update_value(std::filesystem::file_size(file, ec));
+    h.update_value(std::filesystem::last_write_time(file, ec).time_since_epoch().count());
+  }
+  return h.hex();
+}
+
+void
+assembly_cache::
+insert_memory(const std::string& key, elf_ptr elf)
+{
+  if (elf->elf.size() > m_max_memory_bytes)
+    return;
+
+  auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    m_memory_bytes -= it->second->second->elf.size();
+    m_lru.erase(it->second);
+    m_index.erase(it);
+  }
+
+  m_memory_bytes += elf->elf.size();
+  m_lru.emplace_front(key, std::move(elf));
+  m_index[key] = m_lru.begin();
+
+  while (m_memory_bytes > m_max_memory_bytes) {
+    auto& last = m_lru.back();
+    m_memory_bytes -= last.second->elf.size();
+    m_index.erase(last.first);
+    m_lru.pop_back();
+  }
+}
+
+assembly_cache::elf_ptr
+assembly_cache::
+load_disk(const std::string& key) const
+{
+  if (m_dir.empty())
+    return nullptr;
+
+  const auto file = m_dir / (key + elf_ext);
+  std::error_code ec;
+  auto size = std::filesystem::file_size(file, ec);
+  if (ec || size < 4 + stats_size)
+    return nullptr;
+
+  std::vector<char> content(size);
+  std::ifstream input(file, std::ios::in | std::ios::binary);
+  if (!input.read(content.data(), content.size()))
+    return nullptr;
+
+  if (std::memcmp(content.data(), "\x7f" "ELF", 4))
+    return nullptr;
+
+  auto elf = std::make_shared<entry>();
+  elf->stats = read_stats(content.data() + size - stats_size);
+  content.resize(size - stats_size);
+  elf->elf = std::move(content);
+
+  // Mark as recently used for eviction
+  std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), ec);
+  return elf;
+}
+
+void
+assembly_cache::
+store_disk(const std::string& key, const entry& elf) const
+{
+  if (m_dir.empty() || (m_max_disk_bytes && elf.elf.size() + stats_size > m_max_disk_bytes))
+    return;
+
+  char stats[stats_size];
+  write_stats(elf.stats, stats);
+
+  std::random_device rd;
+  const auto tmp = m_dir / (key + ".tmp." + std::to_string(rd()));
+  std::error_code ec;
+  {
+    std::ofstream output(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.write(elf.elf.data(), elf.elf.size()) || !output.write(stats, sizeof(stats))) {
+      output.close();
+      std::filesystem::remove(tmp, ec);
+      return;
+    }
+  }
+
+  std::filesystem::rename(tmp, m_dir / (key + elf_ext), ec);
+  if (ec) {
+    std::filesystem::remove(tmp, ec);
+    return;
+  }
+  evict_disk();
+}
+
+void
+assembly_cache::
+evict_disk() const
+{
+  if (!m_max_disk_bytes)
+    return;
+
+  std::error_code ec;
+  std::vector<std::tuple<std::filesystem::file_time_type, uintmax_t, std::filesystem::path>> files;
+  uint64_t total = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(m_dir, ec)) {
+    if (entry.path().extension() != elf_ext || !entry.is_regular_file(ec))
+      continue;
+    auto size = entry.file_size(ec);
+    files.emplace_back(entry.last_write_time(ec), size, entry.path());
+    total += size;
+  }
+
+  // oldest first
+  std::sort(files.begin(), files.end());
+  for (const auto& [time, size, path] : files) {
+    if (total <= m_max_disk_bytes)
+      break;
+    if (std::filesystem::remove(path, ec))
+      total -= size;
+  }
+}
+
+assembly_cache::elf_ptr
+assembly_cache::
+get(const std::string& key)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+      m_lru.splice(m_lru.begin(), m_lru, it->second);
+      ++m_stats.memory_hits;
+      return it->second->second;
+    }
+  }
+
+  // Disk is read outside of the lock
+  auto elf = load_disk(key);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!elf) {
+    ++m_stats.misses;
+    return nullptr;
+  }
+  ++m_stats.disk_hits;
+  insert_memory(key, elf);
+  return elf;
+}
+
+void
+assembly_cache::
+put(const std::string& key, entry&& elf)
+{
+  auto ptr = std::make_shared<const entry>(std::move(elf));
+  store_disk(key, *ptr);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  insert_memory(key, std::move(ptr));
+}
+
+aiebu_assembler_cache::stats
+assembly_cache::
+get_stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+void
+assembly_cache::
+clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_lru.clear();
+  m_index.clear();
+  m_memory_bytes = 0;
+  m_stats = {};
+}
+
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_ASSEMBLER_ASSEMBLY_CACHE_H_
+#define _AIEBU_ASSEMBLER_ASSEMBLY_CACHE_H_
+
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aiebu_assembler.h"
+#include "buffer_view.h"
+
+namespace aiebu {
+
+// Content addressed store of assembled elfs and the stats of their assembly.
+// Elfs are kept in a memory LRU bounded by total size and optionally in a
+// directory, one <key>.elf file per entry holding the elf followed by the
+// stats. Files are written to a temporary name and renamed into place so
+// concurrent readers, in this or another process, never see a partial elf.
+// The directory is trimmed to its size limit by removing least recently
+// used files. All disk errors are ignored, the cache is best effort.
+class assembly_cache
+{
+public:
+  struct entry
+  {
+    std::vector<char> elf;
+    assembly_stats stats;
+  };
+  using elf_ptr = std::shared_ptr<const entry>;
+
+private:
+  using lru_list = std::list<std::pair<std::string, elf_ptr>>;
+
+  const size_t m_max_memory_bytes;
+  const std::filesystem::path m_dir;
+  const uint64_t m_max_disk_bytes;
+
+  mutable std::mutex m_mutex;
+  // most recently used first
+  lru_list m_lru;
+  std::unordered_map<std::string, lru_list::iterator> m_index;
+  size_t m_memory_bytes = 0;
+  aiebu_assembler_cache::stats m_stats;
+
+  void insert_memory(const std::string& key, elf_ptr elf);
+  elf_ptr load_disk(const std::string& key) const;
+  void store_disk(const std::string& key, const entry& elf) const;
+  void evict_disk() const;
+
+public:
+  assembly_cache(size_t max_memory_bytes, const std::string& dir, uint64_t max_disk_bytes);
+
+  // Key of one assembly, covers all inputs and the library build.
+  // lib_files are the files libs resolve to.
+  static std::string
+  make_key(int type,
+           const buffer_view& buffer1,
+           const buffer_view& buffer2,
+           const buffer_view& patch_json,
+           const std::vector<std::string>& libs,
+           const std::vector<std::string>& lib_files,
+           const std::map<uint8_t, buffer_view>& ctrlpkt);
+
+  // Returns nullptr on miss
+  elf_ptr get(const std::string& key);
+
+  void put(const std::string& key, entry&& elf);
+
+  aiebu_assembler_cache::stats get_stats() const;
+
+  // Drop memory entries and reset counters, disk entries are kept
+  void clear();
+};
+
+}
+#endif //_AIEBU_ASSEMBLER_ASSEMBLY_CACHE_H_
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_BD_DECODER_H_
+#define _AIEBU_COMMON_BD_DECODER_H_
+
+#include <cstdint>
+
+namespace aiebu::aie2_bd {
+
+// AIE2 DMA buffer descriptor register map. BDs of a tile are laid out
+// back to back, so a register offset is classified with a range check and
+// stride arithmetic instead of searching tables of BD addresses.
+
+constexpr uint32_t reg_mask = 0xFFFFF; // strips column and row bits
+constexpr uint32_t row_shift = 20;
+constexpr uint32_t row_mask = 0x1F;
+constexpr uint32_t col_shift = 25;
+constexpr uint32_t col_mask = 0x7F;
+constexpr uint32_t word_size = 4;
+
+constexpr uint32_t shim_bd0 = 0x0001D000;
+constexpr uint32_t shim_bd_num = 16;
+constexpr uint32_t shim_bd_size = 0x20; // 8*4bytes
+
+constexpr uint32_t mem_bd0 = 0x000A0000;
+constexpr uint32_t mem_bd_num = 48;
+constexpr uint32_t mem_bd_size = 0x20; // 8*4bytes
+
+enum class tile : uint8_t
+{
+  none,
+  shim,
+  mem
+};
+
+struct location
+{
+  tile kind = tile::none;
+  uint32_t bd = 0;   // BD index within the tile
+  uint32_t word = 0; // word index within the BD
+
+  constexpr bool
+  valid() const
+  {
+    return kind != tile::none;
+  }
+};
+
+constexpr location
+decode_in(tile kind, uint32_t reg, uint32_t bd0, uint32_t bd_num, uint32_t bd_size)
+{
+  // unsigned wrap around makes reg < bd0 fail the range check too
+  const uint32_t rel = reg - bd0;
+  if (rel >= bd_num * bd_size || (rel % word_size))
+    return {};
+  return {kind, rel / bd_size, (rel % bd_size) / word_size};
+}
+
+// Classify a register address, column and row bits are ignored
+constexpr location
+decode(uint32_t reg)
+{
+  reg &= reg_mask;
+  if (auto loc = decode_in(tile::shim, reg, shim_bd0, shim_bd_num, shim_bd_size); loc.valid())
+    return loc;
+  return decode_in(tile::mem, reg, mem_bd0, mem_bd_num, mem_bd_size);
+}
+
+constexpr uint32_t
+column(uint32_t reg)
+{
+  return (reg >> col_shift) & col_mask;
+}
+
+constexpr uint32_t
+row(uint32_t reg)
+{
+  return (reg >> row_shift) & row_mask;
+}
+
+constexpr const char*
+to_string(tile kind)
+{
+  switch (kind) {
+  case tile::shim: return "shim";
+  case tile::mem:  return "mem";
+  default:         return "none";
+  }
+}
+
+static_assert(decode(shim_bd0).kind == tile::shim && decode(shim_bd0).bd == 0);
+static_assert(decode(shim_bd0 + 15 * shim_bd_size + 4).bd == 15 && decode(shim_bd0 + 15 * shim_bd_size + 4).word == 1);
+static_assert(!decode(shim_bd0 + shim_bd_num * shim_bd_size).valid());
+static_assert(decode(mem_bd0 + 47 * mem_bd_size).kind == tile::mem && decode(mem_bd0 + 47 * mem_bd_size).bd == 47);
+static_assert(!decode(mem_bd0 - 4).valid() && !decode(mem_bd0 + 2).valid());
+static_assert(decode((5u << 25) | (shim_bd0 + 4)).word == 1);
+static_assert(column((5u << 25) | (1u << 20) | mem_bd0) == 5 && row((5u << 25) | (1u << 20) | mem_bd0) == 1);
+
+}
+#endif //_AIEBU_COMMON_BD_DECODER_H_
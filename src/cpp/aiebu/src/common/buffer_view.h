@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_BUFFER_VIEW_H_
+#define _AIEBU_COMMON_BUFFER_VIEW_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "aiebu_error.h"
+#include "utils.h"
+
+namespace aiebu {
+
+// Non-owning view of an input buffer.
+// The assembler never copies control code while preprocessing it; the
+// few bytes it has to modify (e.g. shim BD address bits which are set at
+// runtime) are recorded in a patch overlay and applied when the view is
+// copied into the ELF image. The owner of the underlying memory must keep
+// it alive until the ELF is generated.
+class buffer_view
+{
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+  std::vector<std::pair<offset_type, uint8_t>> m_patches;
+
+public:
+  buffer_view() = default;
+
+  buffer_view(const char* data, size_t size)
+    : m_data(data), m_size(data ? size : 0) {}
+
+  buffer_view(const std::vector<char>& data)
+    : m_data(data.data()), m_size(data.size()) {}
+
+  const char*
+  data() const
+  {
+    return m_data;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  bool
+  empty() const
+  {
+    return m_size == 0;
+  }
+
+  // Returns the original byte, patches are not visible through this accessor
+  uint8_t
+  operator[](size_t offset) const
+  {
+    return static_cast<uint8_t>(m_data[offset]);
+  }
+
+  // Overwrite one byte of the view. Later patches of the same byte win.
+  void
+  patch(offset_type offset, uint8_t byte)
+  {
+    if (offset >= m_size)
+      throw error(error::error_code::internal_error, "Patch offset " + std::to_string(offset) + " out of range !!!");
+    m_patches.emplace_back(offset, byte);
+  }
+
+  const std::vector<std::pair<offset_type, uint8_t>>&
+  get_patches() const
+  {
+    return m_patches;
+  }
+
+  // Apply the patch overlay to dst which already holds a copy of this view
+  void
+  apply_patches(char* dst) const
+  {
+    for (const auto& [offset, byte] : m_patches)
+      dst[offset] = static_cast<char>(byte);
+  }
+
+  // Copy the view with all patches applied to dst, dst must hold size() bytes
+  void
+  copy_to(char* dst) const
+  {
+    if (m_size)
+      std::memcpy(dst, m_data, m_size);
+    apply_patches(dst);
+  }
+
+  // Feed the patched content to func(const char*, size_t) in order, one chunk
+  // at a time. Chunks without patches are passed straight from the input
+  // buffer, others through a small scratch buffer.
+  template <typename Func>
+  void
+  for_each_chunk(Func&& func, size_t chunk_size = 64 * 1024) const
+  {
+    auto patches = m_patches;
+    std::stable_sort(patches.begin(), patches.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<char> scratch;
+    auto pit = patches.begin();
+    for (size_t pos = 0; pos < m_size; pos += chunk_size) {
+      const size_t len = std::min(chunk_size, m_size - pos);
+      if (pit == patches.end() || pit->first >= pos + len) {
+        func(m_data + pos, len);
+        continue;
+      }
+
+      scratch.assign(m_data + pos, m_data + pos + len);
+      for (; pit != patches.end() && pit->first < pos + len; ++pit)
+        scratch[pit->first - pos] = static_cast<char>(pit->second);
+      func(scratch.data(), len);
+    }
+  }
+};
+
+}
+#endif //_AIEBU_COMMON_BUFFER_VIEW_H_
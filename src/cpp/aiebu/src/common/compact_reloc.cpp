@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <algorithm>
+#include <tuple>
+
+#include "compact_reloc.h"
+
+namespace aiebu::compact_reloc {
+
+namespace {
+
+void
+put_uleb(std::vector<uint8_t>& out, uint64_t value)
+{
+  do {
+    uint8_t b = value & 0x7f;
+    value >>= 7;
+    out.push_back(value ? b | 0x80 : b);
+  } while (value);
+}
+
+void
+put_sleb(std::vector<uint8_t>& out, int64_t value)
+{
+  bool more = true;
+  while (more) {
+    uint8_t b = value & 0x7f;
+    value >>= 7;
+    more = !((value == 0 && !(b & 0x40)) || (value == -1 && (b & 0x40)));
+    out.push_back(more ? b | 0x80 : b);
+  }
+}
+
+bool
+same_group(const entry& a, const entry& b)
+{
+  return a.symbol == b.symbol && a.type == b.type && a.addend == b.addend;
+}
+
+}
+
+std::vector<uint8_t>
+encode(std::vector<entry>& entries)
+{
+  std::sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) {
+    return std::tie(a.symbol, a.type, a.addend, a.offset) < std::tie(b.symbol, b.type, b.addend, b.offset);
+  });
+
+  std::vector<uint8_t> out(std::begin(magic), std::end(magic));
+  out.push_back(version);
+
+  size_t groups = 0;
+  for (size_t i = 0; i < entries.size(); ++i)
+    groups += (i == 0 || !same_group(entries[i - 1], entries[i]));
+  put_uleb(out, groups);
+
+  // runs of a group are counted before they are written
+  std::vector<std::pair<size_t, size_t>> runs;  // first entry, count
+  for (size_t first = 0; first < entries.size();) {
+    size_t last = first + 1;
+    while (last < entries.size() && same_group(entries[first], entries[last]))
+      ++last;
+
+    runs.clear();
+    for (size_t i = first; i < last;) {
+      size_t count = 1;
+      if (i + 1 < last) {
+        const uint64_t stride = entries[i + 1].offset - entries[i].offset;
+        count = 2;
+        while (i + count < last && entries[i + count].offset - entries[i + count - 1].offset == stride)
+          ++count;
+      }
+      runs.emplace_back(i, count);
+      i += count;
+    }
+
+    put_uleb(out, entries[first].symbol);
+    out.push_back(entries[first].type);
+    put_sleb(out, entries[first].addend);
+    put_uleb(out, runs.size());
+    uint64_t prev = 0;
+    for (const auto& [start, count] : runs) {
+      put_uleb(out, entries[start].offset - prev);
+      put_uleb(out, count);
+      if (count > 1)
+        put_uleb(out, entries[start + 1].offset - entries[start].offset);
+      prev = entries[start + count - 1].offset;
+    }
+    first = last;
+  }
+  return out;
+}
+
+}
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_COMPACT_RELOC_H_
+#define _AIEBU_COMMON_COMPACT_RELOC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "aiebu_error.h"
+
+namespace aiebu::compact_reloc {
+
+// Compact encoding of the relocations otherwise written as RELA entries.
+//
+// Relocations are grouped by (symbol, type, addend) and the offsets of a
+// group, sorted, are stored as runs of equally spaced offsets. The BDs of
+// a transaction are patched at a fixed stride so a group is usually a few
+// runs however many patch sites it has. All numbers are LEB128.
+//
+//   magic "ACRL" | version u8 | uleb num_groups
+//   group: uleb symbol | u8 type | sleb addend | uleb num_runs
+//   run:   uleb delta from the last offset of the previous run of the
+//          group (from 0 for the first run) | uleb count | uleb stride
+//          when count > 1
+//
+// Decoded relocations are ordered by group then offset, not in the order
+// they were added.
+
+constexpr char magic[4] = {'A', 'C', 'R', 'L'};
+constexpr uint8_t version = 1;
+
+struct entry
+{
+  uint64_t offset;
+  uint32_t symbol;
+  uint8_t type;
+  int64_t addend;
+};
+
+// entries are sorted in place
+std::vector<uint8_t>
+encode(std::vector<entry>& entries);
+
+class reader
+{
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+
+  [[noreturn]] static void
+  truncated()
+  {
+    throw error(error::error_code::invalid_buffer_type, "Invalid compact relocation section");
+  }
+
+public:
+  reader(const uint8_t* data, size_t size) : m_cur(data), m_end(data + size) {}
+
+  uint8_t
+  byte()
+  {
+    if (m_cur == m_end)
+      truncated();
+    return *m_cur++;
+  }
+
+  uint64_t
+  uleb()
+  {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      uint8_t b = byte();
+      value |= uint64_t(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return value;
+    }
+    truncated();
+  }
+
+  int64_t
+  sleb()
+  {
+    uint64_t value = 0;
+    unsigned shift = 0;
+    uint8_t b = 0;
+    do {
+      if (shift >= 64)
+        truncated();
+      b = byte();
+      value |= uint64_t(b & 0x7f) << shift;
+      shift += 7;
+    } while (b & 0x80);
+    if (shift < 64 && (b & 0x40))
+      value |= ~uint64_t(0) << shift;
+    return static_cast<int64_t>(value);
+  }
+
+  bool
+  at_end() const
+  {
+    return m_cur == m_end;
+  }
+};
+
+// Call fn(const entry&) for each relocation, throws on a malformed section
+template <typename Fn>
+void
+decode(const uint8_t* data, size_t size, Fn&& fn)
+{
+  reader r(data, size);
+  for (char c : magic)
+    if (r.byte() != static_cast<uint8_t>(c))
+      throw error(error::error_code::invalid_buffer_type, "Invalid compact relocation magic");
+  if (r.byte() != version)
+    throw error(error::error_code::invalid_buffer_type, "Unsupported compact relocation version");
+
+  entry e = {};
+  for (uint64_t groups = r.uleb(); groups; --groups) {
+    e.symbol = static_cast<uint32_t>(r.uleb());
+    e.type = r.byte();
+    e.addend = r.sleb();
+    e.offset = 0;
+    for (uint64_t runs = r.uleb(); runs; --runs) {
+      e.offset += r.uleb();
+      uint64_t count = r.uleb();
+      uint64_t stride = count > 1 ? r.uleb() : 0;
+      for (uint64_t i = 0; i < count; ++i) {
+        fn(static_cast<const entry&>(e));
+        if (i + 1 < count)
+          e.offset += stride;
+      }
+    }
+  }
+  if (!r.at_end())
+    throw error(error::error_code::invalid_buffer_type, "Trailing bytes in compact relocation section");
+}
+
+}
+#endif //_AIEBU_COMMON_COMPACT_RELOC_H_
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_HASH_H_
+#define _AIEBU_COMMON_HASH_H_
+
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace aiebu {
+
+// Fast non-cryptographic 128bit hash (two MurmurHash64A lanes) used to
+// key cached assembly results. Not suitable where an adversary controls
+// the input.
+class hash128
+{
+  static constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
+  static constexpr int r = 47;
+
+  uint64_t m_h[2] = {0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL};
+
+  static uint64_t
+  mix(uint64_t k)
+  {
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    return k;
+  }
+
+  static uint64_t
+  murmur64(const char* data, size_t size, uint64_t seed)
+  {
+    uint64_t h = seed ^ (size * m);
+    const size_t words = size / 8;
+    for (size_t i = 0; i < words; ++i) {
+      uint64_t k;
+      std::memcpy(&k, data + i * 8, sizeof(k));
+      h ^= mix(k);
+      h *= m;
+    }
+
+    const auto* tail = reinterpret_cast<const unsigned char*>(data + words * 8);
+    switch (size & 7) {
+    case 7: h ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+    case 6: h ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+    case 5: h ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+    case 4: h ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+    case 3: h ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+    case 2: h ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+    case 1: h ^= uint64_t(tail[0]);
+            h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+  }
+
+public:
+  // Each update is hashed on its own and folded in, so ("ab", "c") and
+  // ("a", "bc") give different results
+  void
+  update(const char* data, size_t size)
+  {
+    for (auto& h : m_h)
+      h = mix(h ^ murmur64(data, size, h)) * m;
+  }
+
+  void
+  update(const std::string& str)
+  {
+    update(str.data(), str.size());
+  }
+
+  template <typename T>
+  void
+  update_value(T value)
+  {
+    update(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  std::string
+  hex() const
+  {
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0');
+    for (auto h : m_h)
+      ss << std::setw(16) << h;
+    return ss.str();
+  }
+};
+
+}
+#endif //_AIEBU_COMMON_HASH_H_
@@ -0,0 +1,410 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <cstring>
+#include <limits>
+
+#include "json_reader.h"
+#include "aiebu_error.h"
+
+namespace aiebu {
+
+namespace {
+
+inline bool
+is_ws(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool
+is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+int
+hex_value(char c)
+{
+  if (is_digit(c))
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+void
+append_utf8(std::string& out, uint32_t cp)
+{
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  }
+  else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+  else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+  else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+// Text of a scalar as ptree would hand it to a stream extractor, strings
+// may carry surrounding whitespace
+std::string_view
+trim(std::string_view text)
+{
+  while (!text.empty() && is_ws(text.front()))
+    text.remove_prefix(1);
+  while (!text.empty() && is_ws(text.back()))
+    text.remove_suffix(1);
+  return text;
+}
+
+}
+
+json_reader::
+json_reader(const char* data, size_t size)
+  : m_begin(data), m_cur(data), m_end(data + size)
+{
+  // UTF-8 byte order mark
+  if (size >= 3 && !std::memcmp(data, "\xEF\xBB\xBF", 3))
+    m_cur += 3;
+}
+
+void
+json_reader::
+fail(const std::string& msg) const
+{
+  throw error(error::error_code::invalid_asm,
+              "INVALID JSON: " + msg + " at offset " + std::to_string(m_cur - m_begin) + ". ");
+}
+
+void
+json_reader::
+skip_ws()
+{
+  while (m_cur != m_end && is_ws(*m_cur))
+    ++m_cur;
+}
+
+char
+json_reader::
+peek_char()
+{
+  skip_ws();
+  if (m_cur == m_end)
+    fail("unexpected end of input");
+  return *m_cur;
+}
+
+void
+json_reader::
+expect(char c)
+{
+  if (peek_char() != c)
+    fail(std::string("expected '") + c + "'");
+  ++m_cur;
+}
+
+json_reader::kind
+json_reader::
+peek()
+{
+  switch (peek_char()) {
+  case '{': return kind::object;
+  case '[': return kind::array;
+  case '"': return kind::string;
+  case 't':
+  case 'f':
+  case 'n': return kind::literal;
+  default:
+    if (*m_cur == '-' || is_digit(*m_cur))
+      return kind::number;
+    fail("unexpected character");
+  }
+}
+
+std::string_view
+json_reader::
+read_string(std::string& scratch)
+{
+  expect('"');
+  const char* start = m_cur;
+  // fast path, no escapes: a view of the input
+  while (m_cur != m_end && *m_cur != '"' && *m_cur != '\\') {
+    if (static_cast<unsigned char>(*m_cur) < 0x20)
+      fail("control character in string");
+    ++m_cur;
+  }
+  if (m_cur == m_end)
+    fail("unterminated string");
+  if (*m_cur == '"')
+    return {start, static_cast<size_t>(m_cur++ - start)};
+
+  scratch.assign(start, m_cur);
+  auto read_hex4 = [this]() {
+    if (m_end - m_cur < 4)
+      fail("truncated \\u escape");
+    uint32_t cp = 0;
+    for (int i = 0; i < 4; ++i) {
+      int v = hex_value(*m_cur++);
+      if (v < 0)
+        fail("invalid \\u escape");
+      cp = (cp << 4) | v;
+    }
+    return cp;
+  };
+
+  while (true) {
+    if (m_cur == m_end)
+      fail("unterminated string");
+    char c = *m_cur++;
+    if (c == '"')
+      break;
+    if (static_cast<unsigned char>(c) < 0x20)
+      fail("control character in string");
+    if (c != '\\') {
+      scratch += c;
+      continue;
+    }
+    if (m_cur == m_end)
+      fail("unterminated string");
+    switch (*m_cur++) {
+    case '"':  scratch += '"'; break;
+    case '\\': scratch += '\\'; break;
+    case '/':  scratch += '/'; break;
+    case 'b':  scratch += '\b'; break;
+    case 'f':  scratch += '\f'; break;
+    case 'n':  scratch += '\n'; break;
+    case 'r':  scratch += '\r'; break;
+    case 't':  scratch += '\t'; break;
+    case 'u': {
+      uint32_t cp = read_hex4();
+      if (cp >= 0xD800 && cp < 0xDC00) {
+        if (m_end - m_cur < 2 || m_cur[0] != '\\' || m_cur[1] != 'u')
+          fail("unpaired surrogate");
+        m_cur += 2;
+        uint32_t low = read_hex4();
+        if (low < 0xDC00 || low >= 0xE000)
+          fail("invalid surrogate pair");
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+      }
+      else if (cp >= 0xDC00 && cp < 0xE000)
+        fail("unpaired surrogate");
+      append_utf8(scratch, cp);
+      break;
+    }
+    default:
+      fail("invalid escape");
+    }
+  }
+  return scratch;
+}
+
+std::string_view
+json_reader::
+read_number()
+{
+  const char* start = m_cur;
+  auto digits = [this]() {
+    if (m_cur == m_end || !is_digit(*m_cur))
+      fail("invalid number");
+    while (m_cur != m_end && is_digit(*m_cur))
+      ++m_cur;
+  };
+
+  if (*m_cur == '-')
+    ++m_cur;
+  if (m_cur != m_end && *m_cur == '0')
+    ++m_cur;
+  else
+    digits();
+  if (m_cur != m_end && *m_cur == '.') {
+    ++m_cur;
+    digits();
+  }
+  if (m_cur != m_end && (*m_cur == 'e' || *m_cur == 'E')) {
+    ++m_cur;
+    if (m_cur != m_end && (*m_cur == '+' || *m_cur == '-'))
+      ++m_cur;
+    digits();
+  }
+  return {start, static_cast<size_t>(m_cur - start)};
+}
+
+std::string_view
+json_reader::
+read_literal()
+{
+  for (std::string_view lit : {"true", "false", "null"}) {
+    if (static_cast<size_t>(m_end - m_cur) >= lit.size() && !std::memcmp(m_cur, lit.data(), lit.size())) {
+      m_cur += lit.size();
+      return lit;
+    }
+  }
+  fail("invalid literal");
+}
+
+void
+json_reader::
+enter()
+{
+  char c = peek_char();
+  if (c != '{' && c != '[')
+    fail("expected object or array");
+  ++m_cur;
+  m_stack += c;
+  m_has_child = false;
+}
+
+bool
+json_reader::
+next(std::string_view* key)
+{
+  if (m_stack.empty())
+    fail("not in a container");
+
+  const bool object = m_stack.back() == '{';
+  char c = peek_char();
+  if (c == (object ? '}' : ']')) {
+    ++m_cur;
+    m_stack.pop_back();
+    // the container just left is a child of the enclosing one
+    m_has_child = true;
+    return false;
+  }
+  if (m_has_child)
+    expect(',');
+  m_has_child = true;
+
+  if (object) {
+    auto name = read_string(m_key_scratch);
+    if (key)
+      *key = name;
+    expect(':');
+  }
+  else if (key) {
+    // elements of an array have no name, like ptree children of an array
+    *key = {};
+  }
+  return true;
+}
+
+json_reader::scalar
+json_reader::
+value()
+{
+  auto k = peek();
+  switch (k) {
+  case kind::string: return {k, read_string(m_value_scratch)};
+  case kind::number: return {k, read_number()};
+  case kind::literal: return {k, read_literal()};
+  default:
+    fail("expected a scalar value");
+  }
+}
+
+void
+json_reader::
+skip()
+{
+  if (!is_container()) {
+    value();
+    return;
+  }
+
+  const size_t depth = m_stack.size();
+  enter();
+  while (m_stack.size() > depth) {
+    if (!next())
+      continue;
+    if (is_container())
+      enter();
+    else
+      value();
+  }
+}
+
+void
+json_reader::
+finish()
+{
+  skip_ws();
+  if (m_cur != m_end || !m_stack.empty())
+    fail("trailing characters");
+}
+
+bool
+json_reader::
+to_uint64(const scalar& s, uint64_t& out)
+{
+  if (s.type != kind::number && s.type != kind::string)
+    return false;
+
+  // stream extraction of an unsigned accepts a sign, a negative value wraps
+  auto text = trim(s.text);
+  bool negative = false;
+  if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+    negative = text.front() == '-';
+    text.remove_prefix(1);
+  }
+  if (text.empty())
+    return false;
+
+  uint64_t v = 0;
+  for (char c : text) {
+    if (!is_digit(c))
+      return false;
+    uint64_t d = c - '0';
+    if (v > (std::numeric_limits<uint64_t>::max() - d) / 10)
+      return false;
+    v = v * 10 + d;
+  }
+  out = negative ? 0 - v : v;
+  return true;
+}
+
+bool
+json_reader::
+to_uint32(const scalar& s, uint32_t& out)
+{
+  uint64_t v = 0;
+  if (!to_uint64(s, v))
+    return false;
+  // magnitude must fit, the sign is applied after the range check
+  auto text = trim(s.text);
+  bool negative = !text.empty() && text.front() == '-';
+  uint64_t magnitude = negative ? 0 - v : v;
+  if (magnitude > std::numeric_limits<uint32_t>::max())
+    return false;
+  out = static_cast<uint32_t>(v);
+  return true;
+}
+
+bool
+json_reader::
+to_bool(const scalar& s, bool& out)
+{
+  auto text = trim(s.text);
+  if (text == "true" || text == "1") {
+    out = true;
+    return true;
+  }
+  if (text == "false" || text == "0") {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+}
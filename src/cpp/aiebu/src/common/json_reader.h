@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_JSON_READER_H_
+#define _AIEBU_COMMON_JSON_READER_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace aiebu {
+
+// Streaming JSON reader.
+// Values are pulled one at a time from a contiguous buffer, nothing is
+// kept of the document but the nesting of the containers being read.
+// The whole input is validated, also the parts a caller skips, and any
+// syntax error throws error_code::invalid_asm.
+//
+// Scalars are returned as their text, like boost::property_tree stores
+// them, and converted with the to_* helpers which follow the conversion
+// rules of ptree::get.
+class json_reader
+{
+public:
+  enum class kind : uint8_t
+  {
+    object,
+    array,
+    string,
+    number,
+    literal // true, false or null
+  };
+
+  struct scalar
+  {
+    kind type;
+    // contents of a string without quotes and escapes, the literal text of
+    // anything else; valid until the next call on the reader
+    std::string_view text;
+  };
+
+private:
+  const char* m_begin;
+  const char* m_cur;
+  const char* m_end;
+  // '{' or '[' for each open container, outermost first
+  std::string m_stack;
+  // a member or element was read from the innermost container
+  bool m_has_child = false;
+  // unescaped strings, separate for keys so a key survives reading its value
+  std::string m_key_scratch;
+  std::string m_value_scratch;
+
+  [[noreturn]] void fail(const std::string& msg) const;
+  void skip_ws();
+  char peek_char();
+  void expect(char c);
+  std::string_view read_string(std::string& scratch);
+  std::string_view read_number();
+  std::string_view read_literal();
+
+public:
+  json_reader(const char* data, size_t size);
+
+  // Kind of the next value
+  kind peek();
+
+  bool
+  is_container()
+  {
+    auto k = peek();
+    return k == kind::object || k == kind::array;
+  }
+
+  // Consume the '{' or '[' opening the next value
+  void enter();
+
+  // Move to the next member or element of the innermost container.
+  // For objects the member name is stored in key when key is not null.
+  // Returns false, and leaves the container, at its closing bracket.
+  bool next(std::string_view* key = nullptr);
+
+  // Read the next value which must not be a container
+  scalar value();
+
+  // Skip the next value including everything nested in it
+  void skip();
+
+  // Check that only whitespace follows the top level value
+  void finish();
+
+  // Conversions, return false when text is not a valid representation
+  static bool to_uint64(const scalar& s, uint64_t& out);
+  static bool to_uint32(const scalar& s, uint32_t& out);
+  static bool to_bool(const scalar& s, bool& out);
+};
+
+}
+#endif //_AIEBU_COMMON_JSON_READER_H_
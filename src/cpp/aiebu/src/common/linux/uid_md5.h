@@ -25,10 +25,15 @@ public:
   }
 
   void update(const std::vector<uint8_t>& data)
+  {
+    update(data.data(), data.size());
+  }
+
+  void update(const uint8_t* data, size_t size)
   {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-    MD5_Update(&context, data.data(), data.size());
+    MD5_Update(&context, data, size);
 #pragma GCC diagnostic pop
   }
 
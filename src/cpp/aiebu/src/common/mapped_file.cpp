@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.h"
+#include "aiebu_error.h"
+
+namespace aiebu {
+
+#ifdef _WIN32
+
+mapped_file::
+mapped_file(const std::string& filename)
+{
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw error(error::error_code::internal_error, "file:" + filename + " not found\n");
+  m_file = file;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    unmap();
+    throw error(error::error_code::internal_error, "file:" + filename + " size unknown\n");
+  }
+  m_size = static_cast<size_t>(size.QuadPart);
+  if (!m_size)
+    return;
+
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping)
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!m_data) {
+    unmap();
+    throw error(error::error_code::internal_error, "file:" + filename + " cannot be mapped\n");
+  }
+}
+
+void
+mapped_file::
+unmap()
+{
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle(m_mapping);
+  if (m_file)
+    CloseHandle(m_file);
+  m_data = nullptr;
+  m_mapping = nullptr;
+  m_file = nullptr;
+  m_size = 0;
+}
+
+mapped_file::
+mapped_file(mapped_file&& other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr)),
+    m_size(std::exchange(other.m_size, 0)),
+    m_file(std::exchange(other.m_file, nullptr)),
+    m_mapping(std::exchange(other.m_mapping, nullptr))
+{
+}
+
+mapped_file&
+mapped_file::
+operator=(mapped_file&& other) noexcept
+{
+  if (this != &other) {
+    unmap();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_file = std::exchange(other.m_file, nullptr);
+    m_mapping = std::exchange(other.m_mapping, nullptr);
+  }
+  return *this;
+}
+
+void
+write_file(const std::string& filename, const char* data, size_t size)
+{
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw error(error::error_code::internal_error, "file:" + filename + " cannot be created\n");
+
+  while (size) {
+    DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+    DWORD written = 0;
+    if (!WriteFile(file, data, chunk, &written, nullptr) || !written) {
+      CloseHandle(file);
+      throw error(error::error_code::internal_error, "file:" + filename + " write failed\n");
+    }
+    data += written;
+    size -= written;
+  }
+  CloseHandle(file);
+}
+
+#else
+
+mapped_file::
+mapped_file(const std::string& filename)
+{
+  m_fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (m_fd < 0)
+    throw error(error::error_code::internal_error, "file:" + filename + " not found\n");
+
+  struct stat st;
+  if (::fstat(m_fd, &st) < 0) {
+    unmap();
+    throw error(error::error_code::internal_error, "file:" + filename + " size unknown\n");
+  }
+  m_size = static_cast<size_t>(st.st_size);
+  if (!m_size)
+    return;
+
+  void* addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+  if (addr == MAP_FAILED) {
+    unmap();
+    throw error(error::error_code::internal_error, "file:" + filename + " cannot be mapped\n");
+  }
+  m_data = static_cast<const char*>(addr);
+  // input is consumed front to back
+  ::madvise(addr, m_size, MADV_SEQUENTIAL);
+}
+
+void
+mapped_file::
+unmap()
+{
+  if (m_data)
+    ::munmap(const_cast<char*>(m_data), m_size);
+  if (m_fd >= 0)
+    ::close(m_fd);
+  m_data = nullptr;
+  m_size = 0;
+  m_fd = -1;
+}
+
+mapped_file::
+mapped_file(mapped_file&& other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr)),
+    m_size(std::exchange(other.m_size, 0)),
+    m_fd(std::exchange(other.m_fd, -1))
+{
+}
+
+mapped_file&
+mapped_file::
+operator=(mapped_file&& other) noexcept
+{
+  if (this != &other) {
+    unmap();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_fd = std::exchange(other.m_fd, -1);
+  }
+  return *this;
+}
+
+void
+write_file(const std::string& filename, const char* data, size_t size)
+{
+  int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    throw error(error::error_code::internal_error, "file:" + filename + " cannot be created\n");
+
+  off_t offset = 0;
+  while (size) {
+    ssize_t written = ::pwrite(fd, data, size, offset);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0) {
+      std::string msg = std::strerror(errno);
+      ::close(fd);
+      throw error(error::error_code::internal_error, "file:" + filename + " write failed: " + msg + "\n");
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  ::close(fd);
+}
+
+#endif
+
+mapped_file::
+~mapped_file()
+{
+  unmap();
+}
+
+}
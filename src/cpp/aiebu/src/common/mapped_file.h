@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_MAPPED_FILE_H_
+#define _AIEBU_COMMON_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace aiebu {
+
+// Read-only memory mapping of a whole file.
+// Pages are loaded on access straight from the page cache, the file is
+// never copied into a heap buffer. An empty file maps to data() nullptr.
+class mapped_file
+{
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#else
+  int m_fd = -1;
+#endif
+
+  void unmap();
+
+public:
+  mapped_file() = default;
+  explicit mapped_file(const std::string& filename);
+  ~mapped_file();
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+  mapped_file(mapped_file&& other) noexcept;
+  mapped_file& operator=(mapped_file&& other) noexcept;
+
+  const char*
+  data() const
+  {
+    return m_data;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+};
+
+// Create or truncate filename and write size bytes with a single
+// positioned write (looping only on short writes)
+void write_file(const std::string& filename, const char* data, size_t size);
+
+}
+#endif //_AIEBU_COMMON_MAPPED_FILE_H_
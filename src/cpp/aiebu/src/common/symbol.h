@@ -4,15 +4,21 @@
 #ifndef _AIEBU_COMMOM_SYMBOL_H_
 #define _AIEBU_COMMOM_SYMBOL_H_
 
+#include <deque>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 #include "utils.h"
 #include <elfio/elfio.hpp>
 
 namespace aiebu {
 
-class symbol
+// One patch site. Names are ids interned by the symbol_table the record
+// belongs to, so records are trivially copyable.
+struct symbol
 {
-public:
-
   enum class patch_schema : uint8_t
   {
     uc_dma_remote_ptr_symbol = 1,
@@ -24,43 +30,145 @@ public:
     unknown = 8,
   };
 
-private:
-  std::string m_name;
-  patch_schema m_schema;
-  offset_type m_pos;
-  uint32_t m_colnum;
-  uint32_t m_pagenum;
-  uint32_t m_addend;
+  uint32_t name;
+  uint32_t section_name;
+  offset_type pos;
+  uint32_t addend;
   // size is overloaded
   // for scaler_32, it contaim mask
   // for shim_dma_48, it contain size of dma
-  uint64_t m_size;
-  std::string m_section_name;
-  ELFIO::Elf_Word m_index;
+  uint64_t size;
+  patch_schema schema;
+};
+
+static_assert(std::is_trivially_copyable_v<symbol>);
+static_assert(sizeof(symbol) <= 32);
+
+// Symbols of an assembly, stored column wise with symbol and section
+// names interned. A name used by many patch sites, e.g. an argument
+// index or ".ctrltext", is stored once.
+class symbol_table
+{
+  // id -> name, a deque keeps the strings in place for the keys of m_ids
+  std::deque<std::string> m_strings;
+  std::unordered_map<std::string_view, uint32_t> m_ids;
+
+  std::vector<uint32_t> m_name;
+  std::vector<uint32_t> m_section_name;
+  std::vector<offset_type> m_pos;
+  std::vector<uint32_t> m_addend;
+  std::vector<uint64_t> m_size;
+  std::vector<symbol::patch_schema> m_schema;
 
 public:
+  symbol_table() = default;
+  symbol_table(const symbol_table&) = delete;
+  symbol_table& operator=(const symbol_table&) = delete;
+  symbol_table(symbol_table&&) = default;
+  symbol_table& operator=(symbol_table&&) = default;
+
+  uint32_t
+  intern(std::string_view name)
+  {
+    auto it = m_ids.find(name);
+    if (it != m_ids.end())
+      return it->second;
+    auto id = static_cast<uint32_t>(m_strings.size());
+    m_ids.emplace(m_strings.emplace_back(name), id);
+    return id;
+  }
+
+  const std::string&
+  get_string(uint32_t id) const
+  {
+    return m_strings[id];
+  }
+
+  // Ids in sym must be of this table
+  void
+  add(const symbol& sym)
+  {
+    m_name.push_back(sym.name);
+    m_section_name.push_back(sym.section_name);
+    m_pos.push_back(sym.pos);
+    m_addend.push_back(sym.addend);
+    m_size.push_back(sym.size);
+    m_schema.push_back(sym.schema);
+  }
+
+  void
+  add(std::string_view name, offset_type pos, uint32_t addend, uint64_t size,
+      std::string_view section_name, symbol::patch_schema schema = symbol::patch_schema::unknown)
+  {
+    add({intern(name), intern(section_name), pos, addend, size, schema});
+  }
 
-  symbol(const std::string& name, uint32_t pos, uint32_t colnum, uint32_t pagenum, uint32_t addend,
-         uint64_t size, const std::string& section_name,
-         patch_schema schema=patch_schema::unknown)
-         :m_name(name), m_schema(schema), m_pos(pos), m_colnum(colnum),
-          m_pagenum(pagenum), m_addend(addend), m_size(size), m_section_name(section_name)  { }
+  // Append the symbols of other, its names are interned in this table
+  void
+  append(symbol_table&& other)
+  {
+    if (m_name.empty() && m_strings.empty()) {
+      *this = std::move(other);
+      return;
+    }
+    std::vector<uint32_t> ids;
+    ids.reserve(other.m_strings.size());
+    for (const auto& str : other.m_strings)
+      ids.push_back(intern(str));
+    for (size_t i = 0; i < other.size(); ++i) {
+      auto sym = other.get(i);
+      sym.name = ids[sym.name];
+      sym.section_name = ids[sym.section_name];
+      add(sym);
+    }
+  }
 
-  symbol(const symbol& rhs) = default;
-  symbol& operator=(const symbol& rhs) = default;
-  symbol(symbol &&s) = default;
+  symbol
+  get(size_t i) const
+  {
+    return {m_name[i], m_section_name[i], m_pos[i], m_addend[i], m_size[i], m_schema[i]};
+  }
 
-  std::string get_name() const
+  size_t
+  size() const
   {
-    return m_name;
+    return m_name.size();
   }
 
-  HEADER_ACCESS_GET_SET(patch_schema, schema);
-  HEADER_ACCESS_GET_SET(offset_type, pos);
-  HEADER_ACCESS_GET_SET(uint32_t, addend);
-  HEADER_ACCESS_GET_SET(std::string, section_name);
-  HEADER_ACCESS_GET_SET(ELFIO::Elf_Word, index);
-  HEADER_ACCESS_GET_SET(uint64_t, size);
+  bool
+  empty() const
+  {
+    return m_name.empty();
+  }
+
+  const std::string& get_name(size_t i) const { return m_strings[m_name[i]]; }
+  const std::string& get_section_name(size_t i) const { return m_strings[m_section_name[i]]; }
+  uint32_t get_name_id(size_t i) const { return m_name[i]; }
+  uint32_t get_section_id(size_t i) const { return m_section_name[i]; }
+  offset_type get_pos(size_t i) const { return m_pos[i]; }
+  uint32_t get_addend(size_t i) const { return m_addend[i]; }
+  uint64_t get_size(size_t i) const { return m_size[i]; }
+  void set_size(size_t i, uint64_t size) { m_size[i] = size; }
+  symbol::patch_schema get_schema(size_t i) const { return m_schema[i]; }
+
+  // Approximate heap bytes held by the table
+  size_t
+  memory_footprint() const
+  {
+    size_t bytes = m_name.capacity() * sizeof(uint32_t)
+                 + m_section_name.capacity() * sizeof(uint32_t)
+                 + m_pos.capacity() * sizeof(offset_type)
+                 + m_addend.capacity() * sizeof(uint32_t)
+                 + m_size.capacity() * sizeof(uint64_t)
+                 + m_schema.capacity() * sizeof(symbol::patch_schema);
+    for (const auto& str : m_strings)
+      bytes += sizeof(std::string) + (str.capacity() > 15 ? str.capacity() + 1 : 0);
+    // buckets and nodes of the id map
+    bytes += m_ids.bucket_count() * sizeof(void*)
+           + m_ids.size() * (sizeof(std::pair<const std::string_view, uint32_t>) + 2 * sizeof(void*));
+    return bytes;
+  }
 };
+
 }
 #endif //_AIEBU_COMMOM_SYMBOL_H_
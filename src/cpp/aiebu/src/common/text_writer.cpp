@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "text_writer.h"
+#include "aiebu_error.h"
+
+namespace aiebu {
+
+text_writer::
+text_writer(std::ostream& stream)
+  : m_stream(&stream), m_buffer(new char[buffer_size])
+{
+}
+
+text_writer::
+text_writer(int fd)
+  : m_fd(fd), m_buffer(new char[buffer_size])
+{
+}
+
+text_writer::
+~text_writer()
+{
+  // text is flushed explicitly when errors matter
+  try {
+    flush();
+  }
+  catch (...) {
+  }
+}
+
+void
+text_writer::
+write_out(const char* data, size_t size)
+{
+  if (m_stream) {
+    if (!m_stream->write(data, static_cast<std::streamsize>(size)))
+      throw error(error::error_code::internal_error, "Report write failed !!!");
+    return;
+  }
+
+  while (size) {
+#ifdef _WIN32
+    int written = ::_write(m_fd, data, static_cast<unsigned int>(std::min<size_t>(size, 0x40000000)));
+#else
+    ssize_t written = ::write(m_fd, data, size);
+    if (written < 0 && errno == EINTR)
+      continue;
+#endif
+    if (written <= 0)
+      throw error(error::error_code::internal_error, "Report write failed: " + std::to_string(errno) + " !!!");
+    data += written;
+    size -= written;
+  }
+}
+
+void
+text_writer::
+flush()
+{
+  size_t size = m_size;
+  m_size = 0;
+  if (size)
+    write_out(m_buffer.get(), size);
+}
+
+text_writer&
+text_writer::
+real(double value)
+{
+  char str[32];
+  int size = std::snprintf(str, sizeof(str), "%g", value);
+  return text(std::string_view(str, size > 0 ? size : 0));
+}
+
+}
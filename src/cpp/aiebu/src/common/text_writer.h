@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_TEXT_WRITER_H_
+#define _AIEBU_COMMON_TEXT_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string_view>
+
+namespace aiebu {
+
+// Buffered text formatter for reports.
+// Text is formatted straight into a fixed size buffer which is handed to
+// an ostream or written to a file descriptor whenever it fills up, so the
+// memory used does not depend on the size of the report. Numbers are
+// formatted by hand, there is no stream state and no locale.
+class text_writer
+{
+  static constexpr size_t buffer_size = 64 * 1024;
+
+  std::ostream* m_stream = nullptr;
+  int m_fd = -1;
+  std::unique_ptr<char[]> m_buffer;
+  size_t m_size = 0;
+
+  void write_out(const char* data, size_t size);
+
+  char*
+  reserve(size_t size)
+  {
+    if (buffer_size - m_size < size)
+      flush();
+    return m_buffer.get() + m_size;
+  }
+
+  text_writer&
+  pad(char fill, size_t count)
+  {
+    while (count) {
+      size_t chunk = std::min(count, buffer_size);
+      std::memset(reserve(chunk), fill, chunk);
+      m_size += chunk;
+      count -= chunk;
+    }
+    return *this;
+  }
+
+  text_writer&
+  number(uint64_t value, unsigned base, size_t width, char fill)
+  {
+    char digits[20];
+    size_t count = 0;
+    do {
+      digits[count++] = "0123456789abcdef"[value % base];
+      value /= base;
+    } while (value);
+    if (count < width)
+      pad(fill, width - count);
+    char* dst = reserve(count);
+    for (size_t i = 0; i < count; ++i)
+      dst[i] = digits[count - 1 - i];
+    m_size += count;
+    return *this;
+  }
+
+public:
+  explicit text_writer(std::ostream& stream);
+
+  // fd is not closed
+  explicit text_writer(int fd);
+
+  ~text_writer();
+
+  text_writer(const text_writer&) = delete;
+  text_writer& operator=(const text_writer&) = delete;
+
+  // Writes out the buffered text, throws aiebu::error when that fails
+  void flush();
+
+  text_writer&
+  text(char c)
+  {
+    *reserve(1) = c;
+    ++m_size;
+    return *this;
+  }
+
+  text_writer&
+  text(std::string_view str)
+  {
+    if (str.size() > buffer_size) {
+      flush();
+      write_out(str.data(), str.size());
+      return *this;
+    }
+    std::memcpy(reserve(str.size()), str.data(), str.size());
+    m_size += str.size();
+    return *this;
+  }
+
+  // Left justified in a field of width, like std::setw with std::left
+  text_writer&
+  text(std::string_view str, size_t width)
+  {
+    text(str);
+    return str.size() < width ? pad(' ', width - str.size()) : *this;
+  }
+
+  text_writer&
+  dec(uint64_t value, size_t width = 0, char fill = ' ')
+  {
+    return number(value, 10, width, fill);
+  }
+
+  text_writer&
+  sdec(int64_t value)
+  {
+    if (value < 0)
+      return text('-').dec(~static_cast<uint64_t>(value) + 1);
+    return dec(static_cast<uint64_t>(value));
+  }
+
+  // Lower case digits without prefix, like std::hex
+  text_writer&
+  hex(uint64_t value, size_t width = 0, char fill = '0')
+  {
+    return number(value, 16, width, fill);
+  }
+
+  // Shortest of fixed and scientific notation, as an ostream prints a double
+  text_writer&
+  real(double value);
+};
+
+}
+#endif //_AIEBU_COMMON_TEXT_WRITER_H_
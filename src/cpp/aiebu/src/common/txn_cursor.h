@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_TXN_CURSOR_H_
+#define _AIEBU_COMMON_TXN_CURSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "aiebu_error.h"
+#include "xaiengine.h"
+
+namespace aiebu::txn {
+
+// Walks the ops of an aie-rt transaction buffer.
+//
+// A buffer is in one of two header formats, selected by the version in
+// XAie_TxnHeader. The format is detected once per buffer by walk() and the
+// op loop is instantiated for each format, so a visitor sees typed headers
+// and its handlers are dispatched and inlined at compile time.
+//
+// Visitors derive from visitor_base and hide the handlers they care about,
+// handlers are plain (not virtual) members looked up on the visitor type.
+// Handlers taking a header are templates over the header type when the
+// layout differs between formats; the fields used by the tools (RegOff,
+// Value, Mask, Size) have the same names in both.
+
+// Header format of transactions older than version 1.0
+struct format_legacy
+{
+  using op_hdr = XAie_OpHdr;
+  using write32 = XAie_Write32Hdr;
+  using block_write32 = XAie_BlockWrite32Hdr;
+  using mask_write32 = XAie_MaskWrite32Hdr;
+  using mask_poll32 = XAie_MaskPoll32Hdr;
+  using custom_op = XAie_CustomOpHdr;
+
+  template <typename Hdr>
+  static constexpr size_t
+  size(const Hdr& hdr)
+  {
+    return hdr.Size;
+  }
+};
+
+// Header format 1.0, fixed size ops carry no Size field
+struct format_opt
+{
+  using op_hdr = XAie_OpHdr_opt;
+  using write32 = XAie_Write32Hdr_opt;
+  using block_write32 = XAie_BlockWrite32Hdr_opt;
+  using mask_write32 = XAie_MaskWrite32Hdr_opt;
+  using mask_poll32 = XAie_MaskPoll32Hdr_opt;
+  using custom_op = XAie_CustomOpHdr_opt;
+
+  static constexpr size_t size(const write32&) { return sizeof(write32); }
+  static constexpr size_t size(const mask_write32&) { return sizeof(mask_write32); }
+  static constexpr size_t size(const mask_poll32&) { return sizeof(mask_poll32); }
+  static constexpr size_t size(const block_write32& hdr) { return hdr.Size; }
+  static constexpr size_t size(const custom_op& hdr) { return hdr.Size; }
+};
+
+constexpr uint8_t opt_major = 1;
+constexpr uint8_t opt_minor = 0;
+
+inline bool
+is_opt(const XAie_TxnHeader& hdr)
+{
+  return hdr.Major == opt_major && hdr.Minor == opt_minor;
+}
+
+// One op of the buffer
+struct op_ref
+{
+  const char* data;  // first byte of the op header
+  size_t offset;     // byte offset of the op from the start of the buffer
+  size_t size;       // byte size of the op including payload
+  uint32_t index;    // op number
+  uint8_t code;      // XAie_TxnOpcode
+};
+
+// Returns the payload following the op header Hdr
+template <typename Hdr>
+inline const uint32_t*
+payload(const op_ref& op)
+{
+  return reinterpret_cast<const uint32_t*>(op.data + sizeof(Hdr));
+}
+
+// Number of 32 bit words following the op header Hdr
+template <typename Hdr>
+inline size_t
+payload_words(const op_ref& op)
+{
+  return (op.size - sizeof(Hdr)) / sizeof(uint32_t);
+}
+
+// Name of an op code, empty when unknown
+inline const char*
+op_name(uint8_t code)
+{
+  switch (code) {
+  case XAIE_IO_WRITE: return "XAIE_IO_WRITE";
+  case XAIE_IO_BLOCKWRITE: return "XAIE_IO_BLOCKWRITE";
+  case XAIE_IO_MASKWRITE: return "XAIE_IO_MASKWRITE";
+  case XAIE_IO_MASKPOLL: return "XAIE_IO_MASKPOLL";
+  case XAIE_IO_MASKPOLL_BUSY: return "XAIE_IO_MASKPOLL_BUSY";
+  case XAIE_IO_NOOP: return "XAIE_IO_NOOP";
+  case XAIE_IO_PREEMPT: return "XAIE_IO_PREEMPT";
+  case XAIE_IO_LOAD_PM_START: return "XAIE_IO_LOAD_PM_START";
+  case XAIE_IO_CUSTOM_OP_TCT: return "XAIE_IO_CUSTOM_OP_TCT";
+  case XAIE_IO_CUSTOM_OP_DDR_PATCH: return "XAIE_IO_CUSTOM_OP_DDR_PATCH";
+  case XAIE_IO_CUSTOM_OP_READ_REGS: return "XAIE_IO_CUSTOM_OP_READ_REGS";
+  case XAIE_IO_CUSTOM_OP_RECORD_TIMER: return "XAIE_IO_CUSTOM_OP_RECORD_TIMER";
+  case XAIE_IO_CUSTOM_OP_MERGE_SYNC: return "XAIE_IO_CUSTOM_OP_MERGE_SYNC";
+  default: return "";
+  }
+}
+
+inline uint32_t
+load_sequence_count(const XAie_PmLoadHdr& hdr)
+{
+  return hdr.LoadSequenceCount[2] << 16 | hdr.LoadSequenceCount[1] << 8 | hdr.LoadSequenceCount[0];
+}
+
+struct visitor_base
+{
+  // Called once per buffer before the first op
+  void on_begin(const XAie_TxnHeader&, bool /*opt*/) {}
+  // Called for every op before its handler
+  void on_op(const op_ref&) {}
+
+  template <typename Hdr> void on_write(const op_ref&, const Hdr&) {}
+  template <typename Hdr> void on_block_write(const op_ref&, const Hdr&) {}
+  template <typename Hdr> void on_mask_write(const op_ref&, const Hdr&) {}
+  template <typename Hdr> void on_mask_poll(const op_ref&, const Hdr&, bool /*busy*/) {}
+  void on_noop(const op_ref&) {}
+  void on_preempt(const op_ref&, const XAie_PreemptHdr&) {}
+  void on_pm_load(const op_ref&, const XAie_PmLoadHdr&) {}
+  void on_tct(const op_ref&) {}
+  void on_ddr_patch(const op_ref&, const patch_op_t&) {}
+  void on_read_regs(const op_ref&) {}
+  void on_record_timer(const op_ref&) {}
+  void on_merge_sync(const op_ref&) {}
+
+  // The size of an unknown op is unknown, the walk cannot continue
+  [[noreturn]] void
+  on_unknown(const op_ref& op)
+  {
+    throw std::runtime_error("Error: Unknown op code at offset at " + std::to_string(op.offset) +
+                             ". OpCode: " + std::to_string(op.code));
+  }
+};
+
+template <typename Hdr>
+inline const Hdr&
+header(const char* ptr)
+{
+  return *reinterpret_cast<const Hdr*>(ptr);
+}
+
+// Byte size of the fixed header of an op, what must be present before its
+// size can be read, 0 if code is not a known op
+template <typename Format>
+inline size_t
+header_size(uint8_t code)
+{
+  switch (code) {
+  case XAIE_IO_WRITE:
+    return sizeof(typename Format::write32);
+  case XAIE_IO_BLOCKWRITE:
+    return sizeof(typename Format::block_write32);
+  case XAIE_IO_MASKWRITE:
+    return sizeof(typename Format::mask_write32);
+  case XAIE_IO_MASKPOLL:
+  case XAIE_IO_MASKPOLL_BUSY:
+    return sizeof(typename Format::mask_poll32);
+  case XAIE_IO_NOOP:
+    return sizeof(XAie_NoOpHdr);
+  case XAIE_IO_PREEMPT:
+    return sizeof(XAie_PreemptHdr);
+  case XAIE_IO_LOAD_PM_START:
+    return sizeof(XAie_PmLoadHdr);
+  case XAIE_IO_CUSTOM_OP_DDR_PATCH:
+    return sizeof(typename Format::custom_op) + sizeof(patch_op_t);
+  case XAIE_IO_CUSTOM_OP_TCT:
+  case XAIE_IO_CUSTOM_OP_READ_REGS:
+  case XAIE_IO_CUSTOM_OP_RECORD_TIMER:
+  case XAIE_IO_CUSTOM_OP_MERGE_SYNC:
+    return sizeof(typename Format::custom_op);
+  default:
+    return 0;
+  }
+}
+
+[[noreturn]] inline void
+out_of_bounds(uint32_t index, size_t offset)
+{
+  throw error(error::error_code::invalid_buffer_type,
+              "Corrupted transaction, op " + std::to_string(index) + " at offset " + std::to_string(offset) +
+              " runs past the end !!!");
+}
+
+// Byte size of the op at ptr, 0 if code is not a known op
+template <typename Format>
+inline size_t
+op_size(uint8_t code, const char* ptr)
+{
+  switch (code) {
+  case XAIE_IO_WRITE:
+    return Format::size(header<typename Format::write32>(ptr));
+  case XAIE_IO_BLOCKWRITE:
+    return Format::size(header<typename Format::block_write32>(ptr));
+  case XAIE_IO_MASKWRITE:
+    return Format::size(header<typename Format::mask_write32>(ptr));
+  case XAIE_IO_MASKPOLL:
+  case XAIE_IO_MASKPOLL_BUSY:
+    return Format::size(header<typename Format::mask_poll32>(ptr));
+  case XAIE_IO_NOOP:
+    return sizeof(XAie_NoOpHdr);
+  case XAIE_IO_PREEMPT:
+    return sizeof(XAie_PreemptHdr);
+  case XAIE_IO_LOAD_PM_START:
+    return sizeof(XAie_PmLoadHdr);
+  case XAIE_IO_CUSTOM_OP_TCT:
+  case XAIE_IO_CUSTOM_OP_DDR_PATCH:
+  case XAIE_IO_CUSTOM_OP_READ_REGS:
+  case XAIE_IO_CUSTOM_OP_RECORD_TIMER:
+  case XAIE_IO_CUSTOM_OP_MERGE_SYNC:
+    return Format::size(header<typename Format::custom_op>(ptr));
+  default:
+    return 0;
+  }
+}
+
+// Walk all ops of txn in Format, no op header or payload is read beyond
+// size bytes
+template <typename Format, typename Visitor>
+void
+walk_ops(const char* txn, size_t size, Visitor& visitor)
+{
+  const auto& txn_hdr = header<XAie_TxnHeader>(txn);
+  const char* ptr = txn + sizeof(XAie_TxnHeader);
+
+  for (uint32_t i = 0; i < txn_hdr.NumOps; ++i) {
+    const size_t offset = static_cast<size_t>(ptr - txn);
+    const size_t left = size - offset;
+    if (left < sizeof(typename Format::op_hdr))
+      out_of_bounds(i, offset);
+    const uint8_t code = header<typename Format::op_hdr>(ptr).Op;
+    const size_t min_size = header_size<Format>(code);
+    if (left < min_size)
+      out_of_bounds(i, offset);
+    op_ref op{ptr, offset, min_size ? op_size<Format>(code, ptr) : 0, i, code};
+    // a zero sized op would never advance, treat it as unknown
+    if (!op.size) {
+      visitor.on_unknown(op);
+      return;
+    }
+    // the size field covers the header, payload words follow it
+    if (op.size < min_size || op.size > left)
+      out_of_bounds(i, offset);
+
+    visitor.on_op(op);
+    switch (code) {
+    case XAIE_IO_WRITE:
+      visitor.on_write(op, header<typename Format::write32>(ptr));
+      break;
+    case XAIE_IO_BLOCKWRITE:
+      visitor.on_block_write(op, header<typename Format::block_write32>(ptr));
+      break;
+    case XAIE_IO_MASKWRITE:
+      visitor.on_mask_write(op, header<typename Format::mask_write32>(ptr));
+      break;
+    case XAIE_IO_MASKPOLL:
+    case XAIE_IO_MASKPOLL_BUSY:
+      visitor.on_mask_poll(op, header<typename Format::mask_poll32>(ptr), code == XAIE_IO_MASKPOLL_BUSY);
+      break;
+    case XAIE_IO_NOOP:
+      visitor.on_noop(op);
+      break;
+    case XAIE_IO_PREEMPT:
+      visitor.on_preempt(op, header<XAie_PreemptHdr>(ptr));
+      break;
+    case XAIE_IO_LOAD_PM_START:
+      visitor.on_pm_load(op, header<XAie_PmLoadHdr>(ptr));
+      break;
+    case XAIE_IO_CUSTOM_OP_TCT:
+      visitor.on_tct(op);
+      break;
+    case XAIE_IO_CUSTOM_OP_DDR_PATCH:
+      visitor.on_ddr_patch(op, header<patch_op_t>(ptr + sizeof(typename Format::custom_op)));
+      break;
+    case XAIE_IO_CUSTOM_OP_READ_REGS:
+      visitor.on_read_regs(op);
+      break;
+    case XAIE_IO_CUSTOM_OP_RECORD_TIMER:
+      visitor.on_record_timer(op);
+      break;
+    case XAIE_IO_CUSTOM_OP_MERGE_SYNC:
+      visitor.on_merge_sync(op);
+      break;
+    }
+    ptr += op.size;
+  }
+}
+
+// Detect the header format of txn and walk its ops, size is the byte size
+// of the buffer. its throws aiebu::error object when the ops of the header
+// do not fit.
+template <typename Visitor>
+void
+walk(const char* txn, size_t size, Visitor& visitor)
+{
+  if (size < sizeof(XAie_TxnHeader))
+    throw error(error::error_code::invalid_buffer_type,
+                "Corrupted transaction, " + std::to_string(size) + " bytes is less than its header !!!");
+  const auto& txn_hdr = header<XAie_TxnHeader>(txn);
+  const bool opt = is_opt(txn_hdr);
+  visitor.on_begin(txn_hdr, opt);
+  if (opt)
+    walk_ops<format_opt>(txn, size, visitor);
+  else
+    walk_ops<format_legacy>(txn, size, visitor);
+}
+
+}
+#endif //_AIEBU_COMMON_TXN_CURSOR_H_
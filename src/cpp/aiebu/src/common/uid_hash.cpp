@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include "uid_hash.h"
+#include "uid_md5.h"
+#include "xxh3.h"
+#include "aiebu_error.h"
+
+namespace aiebu {
+
+namespace {
+
+class md5_hasher : public uid_hasher
+{
+  uid_md5 m_md5;
+
+public:
+  void update(const uint8_t* data, size_t size) override
+  {
+    m_md5.update(data, size);
+  }
+
+  std::string calculate() override
+  {
+    return m_md5.calculate();
+  }
+
+  size_t size() const override
+  {
+    return 32;
+  }
+};
+
+class xxh3_hasher : public uid_hasher
+{
+  static constexpr const char* prefix = "xxh3_128:";
+  xxh3_128 m_xxh3;
+
+public:
+  void update(const uint8_t* data, size_t size) override
+  {
+    m_xxh3.update(data, size);
+  }
+
+  std::string calculate() override
+  {
+    return prefix + m_xxh3.calculate();
+  }
+
+  size_t size() const override
+  {
+    return std::char_traits<char>::length(prefix) + 32;
+  }
+};
+
+}
+
+std::unique_ptr<uid_hasher>
+uid_hasher::
+create(elf_options::uid_algorithm algorithm)
+{
+  switch (algorithm) {
+  case elf_options::uid_algorithm::md5:
+    return std::make_unique<md5_hasher>();
+  case elf_options::uid_algorithm::xxh3_128:
+    return std::make_unique<xxh3_hasher>();
+  }
+  throw error(error::error_code::internal_error, "Unknown uid algorithm !!!");
+}
+
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_UID_HASH_H_
+#define _AIEBU_COMMON_UID_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "aiebu_assembler.h"
+
+namespace aiebu {
+
+// Hash of the elf content recorded in the .note.xrt.UID note
+class uid_hasher
+{
+public:
+  virtual ~uid_hasher() = default;
+
+  virtual void update(const uint8_t* data, size_t size) = 0;
+
+  // Note descriptor, plain hex for md5 as before, other algorithms are
+  // prefixed by their name, e.g. "xxh3_128:<hex>"
+  virtual std::string calculate() = 0;
+
+  // Length of calculate(), fixed so the note can be laid out before the
+  // content is hashed
+  virtual size_t size() const = 0;
+
+  static std::unique_ptr<uid_hasher>
+  create(elf_options::uid_algorithm algorithm);
+};
+
+}
+#endif //_AIEBU_COMMON_UID_HASH_H_
@@ -19,7 +19,12 @@ public:
 
   void update(const std::vector<uint8_t>& data)
   {
-      hasher.process_bytes(data.data(), data.size());
+      update(data.data(), data.size());
+  }
+
+  void update(const uint8_t* data, size_t size)
+  {
+      hasher.process_bytes(data, size);
   }
 
   std::string calculate()
@@ -33,7 +38,11 @@ public:
     std::stringstream md5;
     md5 << std::hex << std::setfill('0');
     for (auto ele : digest) {
-        md5 << ele;
+        // digest words are 32bit before boost 1.86, bytes after
+        if constexpr (sizeof(ele) == 1)
+            md5 << std::setw(2) << static_cast<unsigned int>(ele);
+        else
+            md5 << std::setw(2 * sizeof(ele)) << ele;
     }
     return md5.str();
   }
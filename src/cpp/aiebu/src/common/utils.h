@@ -79,9 +79,11 @@ inline std::vector<std::string> splitoption(const char* data, char delimiter = '
 // Custom stream buffer that reads from a vector<char>
 class vector_streambuf : public std::streambuf {
 public:
-    vector_streambuf(const std::vector<char>& vec) {
-        char* begin = const_cast<char*>(vec.data());
-        this->setg(begin, begin, begin + vec.size());
+    vector_streambuf(const std::vector<char>& vec) : vector_streambuf(vec.data(), vec.size()) {}
+
+    vector_streambuf(const char* data, size_t size) {
+        char* begin = const_cast<char*>(data);
+        this->setg(begin, begin, begin + size);
     }
 };
 
@@ -33,9 +33,16 @@ uid_md5()
 void
 uid_md5::
 update(const std::vector<uint8_t>& data)
+{
+  update(data.data(), data.size());
+}
+
+void
+uid_md5::
+update(const uint8_t* data, size_t size)
 {
   // Hash the input string
-  if (!CryptHashData(hHash, (BYTE*)data.data(), data.size(), 0))
+  if (!CryptHashData(hHash, (BYTE*)data, static_cast<DWORD>(size), 0))
     throw error(error::error_code::internal_error, "Error: CryptHashData!!!");
 }
 
@@ -21,6 +21,7 @@ class uid_md5
 public:
   uid_md5();
   void update(const std::vector<uint8_t>& data);
+  void update(const uint8_t* data, size_t size);
   std::string calculate();
   ~uid_md5();
 };
@@ -8,20 +8,25 @@
 #include <string>
 #include <vector>
 #include "symbol.h"
+#include "buffer_view.h"
 #include "code_section.h"
 
 namespace aiebu {
 
 // Class to hold sections name, data, symbols, type
+// Section content is either emitted by the encoder through write_byte()/write_word()
+// or is a view of an input buffer which was passed through unchanged.
 class writer
 {
   const std::string m_name;
   const code_section m_type;
   std::vector<uint8_t> m_data;
-  std::vector<symbol> m_symbols;
+  buffer_view m_view;
+  symbol_table m_symbols;
 
 public:
   writer(const std::string name, code_section type, std::vector<uint8_t>& data): m_name(name), m_type(type), m_data(std::move(data)) {}
+  writer(const std::string name, code_section type, buffer_view& data): m_name(name), m_type(type), m_view(std::move(data)) {}
   writer(const std::string name, code_section type): m_name(name), m_type(type) {}
 
   virtual void write_byte(uint8_t byte);
@@ -36,6 +41,16 @@ public:
     return m_data;
   }
 
+  // View of the section content, valid as long as the writer and the
+  // input buffers are alive
+  const buffer_view&
+  get_view()
+  {
+    if (!m_data.empty())
+      m_view = buffer_view(reinterpret_cast<const char*>(m_data.data()), m_data.size());
+    return m_view;
+  }
+
   const std::string&
   get_name() const
   {
@@ -53,25 +68,26 @@ public:
     m_data = std::move(data);
   }
 
-  const std::vector<symbol>&
+  const symbol_table&
   get_symbols() const
   {
     return m_symbols;
   }
 
-  void add_symbol(symbol sym)
+  symbol_table&
+  get_symbols()
   {
-    m_symbols.emplace_back(sym);
+    return m_symbols;
   }
 
-  void add_symbols(std::vector<symbol>& syms)
+  void add_symbols(symbol_table& syms)
   {
     m_symbols = std::move(syms);
   }
 
   bool hassymbols() const
   {
-    return m_symbols.size();
+    return !m_symbols.empty();
   }
 
   void padding(offset_type size);
@@ -0,0 +1,369 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "xxh3.h"
+
+namespace aiebu {
+
+namespace {
+
+// Constants and mixing steps of the reference xxHash 0.8, scalar path
+
+constexpr uint64_t prime32_1 = 0x9E3779B1U;
+constexpr uint64_t prime32_2 = 0x85EBCA77U;
+constexpr uint64_t prime32_3 = 0xC2B2AE3DU;
+constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5ULL;
+constexpr uint64_t prime_mx1 = 0x165667919E3779F9ULL;
+constexpr uint64_t prime_mx2 = 0x9FB21C651E98DF25ULL;
+
+constexpr size_t secret_size = 192;
+constexpr size_t secret_consume_rate = 8;
+constexpr size_t secret_lastacc_start = 7;
+constexpr size_t secret_mergeaccs_start = 11;
+constexpr size_t midsize_startoffset = 3;
+constexpr size_t midsize_lastoffset = 17;
+constexpr size_t secret_size_min = 136;
+
+alignas(64) constexpr uint8_t secret[secret_size] = {
+  0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+  0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+  0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+  0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+  0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+  0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+  0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+  0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+  0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+  0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+  0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+  0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+struct hash128
+{
+  uint64_t low;
+  uint64_t high;
+};
+
+// Host and target are little endian
+uint32_t
+read32(const uint8_t* p)
+{
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint64_t
+read64(const uint8_t* p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint32_t
+swap32(uint32_t x)
+{
+  return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+uint64_t
+swap64(uint64_t x)
+{
+  return (static_cast<uint64_t>(swap32(static_cast<uint32_t>(x))) << 32) | swap32(static_cast<uint32_t>(x >> 32));
+}
+
+uint32_t
+rotl32(uint32_t x, int r)
+{
+  return (x << r) | (x >> (32 - r));
+}
+
+uint64_t
+mult32to64(uint64_t x, uint64_t y)
+{
+  return (x & 0xffffffff) * (y & 0xffffffff);
+}
+
+hash128
+mult64to128(uint64_t lhs, uint64_t rhs)
+{
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+  return {static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+#else
+  const uint64_t lo_lo = mult32to64(lhs, rhs);
+  const uint64_t hi_lo = mult32to64(lhs >> 32, rhs);
+  const uint64_t lo_hi = mult32to64(lhs, rhs >> 32);
+  const uint64_t hi_hi = mult32to64(lhs >> 32, rhs >> 32);
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  return {(cross << 32) | (lo_lo & 0xffffffff), (hi_lo >> 32) + (cross >> 32) + hi_hi};
+#endif
+}
+
+uint64_t
+mul128_fold64(uint64_t lhs, uint64_t rhs)
+{
+  const hash128 product = mult64to128(lhs, rhs);
+  return product.low ^ product.high;
+}
+
+uint64_t
+xxh64_avalanche(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= prime64_2;
+  h ^= h >> 29;
+  h *= prime64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+uint64_t
+avalanche(uint64_t h)
+{
+  h ^= h >> 37;
+  h *= prime_mx1;
+  h ^= h >> 32;
+  return h;
+}
+
+hash128
+len_1to3(const uint8_t* input, size_t len)
+{
+  const uint32_t c1 = input[0];
+  const uint32_t c2 = input[len >> 1];
+  const uint32_t c3 = input[len - 1];
+  const uint32_t combinedl = (c1 << 16) | (c2 << 24) | c3 | (static_cast<uint32_t>(len) << 8);
+  const uint32_t combinedh = rotl32(swap32(combinedl), 13);
+  const uint64_t bitflipl = read32(secret) ^ read32(secret + 4);
+  const uint64_t bitfliph = read32(secret + 8) ^ read32(secret + 12);
+  return {xxh64_avalanche(combinedl ^ bitflipl), xxh64_avalanche(combinedh ^ bitfliph)};
+}
+
+hash128
+len_4to8(const uint8_t* input, size_t len)
+{
+  const uint64_t input_64 = read32(input) + (static_cast<uint64_t>(read32(input + len - 4)) << 32);
+  const uint64_t bitflip = read64(secret + 16) ^ read64(secret + 24);
+  hash128 m = mult64to128(input_64 ^ bitflip, prime64_1 + (len << 2));
+  m.high += m.low << 1;
+  m.low ^= m.high >> 3;
+  m.low ^= m.low >> 35;
+  m.low *= prime_mx2;
+  m.low ^= m.low >> 28;
+  m.high = avalanche(m.high);
+  return m;
+}
+
+hash128
+len_9to16(const uint8_t* input, size_t len)
+{
+  const uint64_t bitflipl = read64(secret + 32) ^ read64(secret + 40);
+  const uint64_t bitfliph = read64(secret + 48) ^ read64(secret + 56);
+  const uint64_t input_lo = read64(input);
+  uint64_t input_hi = read64(input + len - 8);
+  hash128 m = mult64to128(input_lo ^ input_hi ^ bitflipl, prime64_1);
+  m.low += static_cast<uint64_t>(len - 1) << 54;
+  input_hi ^= bitfliph;
+  m.high += input_hi + mult32to64(input_hi, prime32_2 - 1);
+  m.low ^= swap64(m.high);
+  hash128 h = mult64to128(m.low, prime64_2);
+  h.high += m.high * prime64_2;
+  return {avalanche(h.low), avalanche(h.high)};
+}
+
+uint64_t
+mix16(const uint8_t* input, const uint8_t* key, uint64_t seed)
+{
+  return mul128_fold64(read64(input) ^ (read64(key) + seed), read64(input + 8) ^ (read64(key + 8) - seed));
+}
+
+void
+mix32(hash128& acc, const uint8_t* input_1, const uint8_t* input_2, const uint8_t* key, uint64_t seed)
+{
+  acc.low += mix16(input_1, key, seed);
+  acc.low ^= read64(input_2) + read64(input_2 + 8);
+  acc.high += mix16(input_2, key + 16, seed);
+  acc.high ^= read64(input_1) + read64(input_1 + 8);
+}
+
+hash128
+mix_final(const hash128& acc, size_t len)
+{
+  const uint64_t low = acc.low + acc.high;
+  const uint64_t high = acc.low * prime64_1 + acc.high * prime64_4 + len * prime64_2;
+  return {avalanche(low), 0 - avalanche(high)};
+}
+
+hash128
+len_17to128(const uint8_t* input, size_t len)
+{
+  hash128 acc = {len * prime64_1, 0};
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96)
+        mix32(acc, input + 48, input + len - 64, secret + 96, 0);
+      mix32(acc, input + 32, input + len - 48, secret + 64, 0);
+    }
+    mix32(acc, input + 16, input + len - 32, secret + 32, 0);
+  }
+  mix32(acc, input, input + len - 16, secret, 0);
+  return mix_final(acc, len);
+}
+
+hash128
+len_129to240(const uint8_t* input, size_t len)
+{
+  hash128 acc = {len * prime64_1, 0};
+  for (size_t i = 0; i < 4; ++i)
+    mix32(acc, input + 32 * i, input + 32 * i + 16, secret + 32 * i, 0);
+  acc = {avalanche(acc.low), avalanche(acc.high)};
+  for (size_t i = 4; i < len / 32; ++i)
+    mix32(acc, input + 32 * i, input + 32 * i + 16, secret + midsize_startoffset + 32 * (i - 4), 0);
+  mix32(acc, input + len - 16, input + len - 32, secret + secret_size_min - midsize_lastoffset - 16, 0);
+  return mix_final(acc, len);
+}
+
+hash128
+hash_short(const uint8_t* input, size_t len)
+{
+  if (len > 128)
+    return len_129to240(input, len);
+  if (len > 16)
+    return len_17to128(input, len);
+  if (len > 8)
+    return len_9to16(input, len);
+  if (len >= 4)
+    return len_4to8(input, len);
+  if (len)
+    return len_1to3(input, len);
+  return {xxh64_avalanche(read64(secret + 64) ^ read64(secret + 72)),
+          xxh64_avalanche(read64(secret + 80) ^ read64(secret + 88))};
+}
+
+void
+accumulate_512(uint64_t* acc, const uint8_t* input, const uint8_t* key)
+{
+  for (size_t i = 0; i < 8; ++i) {
+    const uint64_t data_val = read64(input + 8 * i);
+    const uint64_t data_key = data_val ^ read64(key + 8 * i);
+    acc[i ^ 1] += data_val;
+    acc[i] += mult32to64(data_key, data_key >> 32);
+  }
+}
+
+void
+scramble(uint64_t* acc, const uint8_t* key)
+{
+  for (size_t i = 0; i < 8; ++i) {
+    uint64_t a = acc[i];
+    a ^= a >> 47;
+    a ^= read64(key + 8 * i);
+    a *= prime32_1;
+    acc[i] = a;
+  }
+}
+
+uint64_t
+merge_accs(const uint64_t* acc, const uint8_t* key, uint64_t start)
+{
+  uint64_t result = start;
+  for (size_t i = 0; i < 4; ++i)
+    result += mul128_fold64(acc[2 * i] ^ read64(key + 16 * i), acc[2 * i + 1] ^ read64(key + 16 * i + 8));
+  return avalanche(result);
+}
+
+}
+
+xxh3_128::
+xxh3_128()
+  : m_acc{prime32_3, prime64_1, prime64_2, prime64_3, prime64_4, prime32_2, prime64_5, prime32_1}
+{
+}
+
+void
+xxh3_128::
+consume(const uint8_t* stripe)
+{
+  accumulate_512(m_acc, stripe, secret + m_stripes_in_block * secret_consume_rate);
+  if (++m_stripes_in_block == stripes_per_block) {
+    scramble(m_acc, secret + secret_size - stripe_len);
+    m_stripes_in_block = 0;
+  }
+}
+
+void
+xxh3_128::
+update(const uint8_t* data, size_t size)
+{
+  if (!size)
+    return;
+  if (m_total < midsize_max) {
+    const size_t n = std::min<size_t>(size, midsize_max - m_total);
+    std::memcpy(m_head + m_total, data, n);
+  }
+  m_total += size;
+
+  // A stripe is consumed only when input follows it, the stripe holding
+  // the last byte is left for calculate()
+  if (m_stripe_size) {
+    const size_t n = std::min(size, stripe_len - m_stripe_size);
+    std::memcpy(m_stripe + m_stripe_size, data, n);
+    m_stripe_size += n;
+    data += n;
+    size -= n;
+    if (!size)
+      return;
+    consume(m_stripe);
+    std::memcpy(m_last, m_stripe, stripe_len);
+    m_stripe_size = 0;
+  }
+
+  if (size > stripe_len) {
+    for (; size > stripe_len; data += stripe_len, size -= stripe_len)
+      consume(data);
+    std::memcpy(m_last, data - stripe_len, stripe_len);
+  }
+  std::memcpy(m_stripe, data, size);
+  m_stripe_size = size;
+}
+
+std::string
+xxh3_128::
+calculate() const
+{
+  hash128 h;
+  if (m_total <= midsize_max)
+    h = hash_short(m_head, static_cast<size_t>(m_total));
+  else {
+    uint64_t acc[8];
+    std::copy(m_acc, m_acc + 8, acc);
+
+    // last 64 bytes of the input, may overlap the last consumed stripe
+    uint8_t last[stripe_len];
+    const size_t tail = stripe_len - m_stripe_size;
+    std::memcpy(last, m_last + m_stripe_size, tail);
+    std::memcpy(last + tail, m_stripe, m_stripe_size);
+    accumulate_512(acc, last, secret + secret_size - stripe_len - secret_lastacc_start);
+
+    h.low = merge_accs(acc, secret + secret_mergeaccs_start, m_total * prime64_1);
+    h.high = merge_accs(acc, secret + secret_size - sizeof(acc) - secret_mergeaccs_start, ~(m_total * prime64_2));
+  }
+
+  std::stringstream hex;
+  hex << std::hex << std::setfill('0') << std::setw(16) << h.high << std::setw(16) << h.low;
+  return hex.str();
+}
+
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_COMMON_XXH3_H_
+#define _AIEBU_COMMON_XXH3_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace aiebu {
+
+// Streaming XXH3 128 bit hash with the default secret and seed 0,
+// portable scalar code. Matches XXH3_128bits() of the reference xxHash
+// for any split of the input into update() calls.
+class xxh3_128
+{
+  static constexpr size_t stripe_len = 64;
+  static constexpr size_t stripes_per_block = 16;
+  static constexpr size_t midsize_max = 240;
+
+  uint64_t m_acc[8];
+  // stripe not consumed yet, it is consumed once more input follows
+  uint8_t m_stripe[stripe_len];
+  size_t m_stripe_size = 0;
+  // last consumed stripe, its tail is part of the final stripe
+  uint8_t m_last[stripe_len];
+  size_t m_stripes_in_block = 0;
+  // short inputs are hashed in one go at the end
+  uint8_t m_head[midsize_max];
+  uint64_t m_total = 0;
+
+  void consume(const uint8_t* stripe);
+
+public:
+  xxh3_128();
+
+  void update(const uint8_t* data, size_t size);
+
+  // Canonical 32 hex digits, high half first as printed by xxhsum
+  std::string calculate() const;
+};
+
+}
+#endif //_AIEBU_COMMON_XXH3_H_
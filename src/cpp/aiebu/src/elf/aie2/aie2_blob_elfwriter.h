@@ -13,7 +13,7 @@ class aie2_blob_elf_writer: public elf_writer
   constexpr static unsigned char ob_abi = 0x45;
   constexpr static unsigned char version = 0x02;
 public:
-  aie2_blob_elf_writer(): elf_writer(ob_abi, version)
+  explicit aie2_blob_elf_writer(const elf_options& options = {}): elf_writer(ob_abi, version, options)
   { }
 };
 
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <cstring>
+#include <string>
+
+#include "compressed_section.h"
+#include "aiebu_error.h"
+
+#ifdef AIEBU_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace aiebu::compressed_section {
+
+bool
+available()
+{
+#ifdef AIEBU_HAVE_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::vector<char>
+compress(const buffer_view& content, uint32_t align)
+{
+#ifdef AIEBU_HAVE_ZLIB
+  z_stream zs = {};
+  if (deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK)
+    throw error(error::error_code::internal_error, "deflateInit failed !!!");
+
+  // output is sized for the worst case so each chunk is consumed at once
+  const header hdr = {elfcompress_zlib, static_cast<uint32_t>(content.size()), align};
+  std::vector<char> out(sizeof(hdr) + deflateBound(&zs, static_cast<uLong>(content.size())));
+  std::memcpy(out.data(), &hdr, sizeof(hdr));
+  zs.next_out = reinterpret_cast<Bytef*>(out.data() + sizeof(hdr));
+  zs.avail_out = static_cast<uInt>(out.size() - sizeof(hdr));
+
+  bool ok = true;
+  content.for_each_chunk([&zs, &ok](const char* data, size_t size) {
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs.avail_in = static_cast<uInt>(size);
+    ok = ok && deflate(&zs, Z_NO_FLUSH) == Z_OK && zs.avail_in == 0;
+  });
+  ok = ok && deflate(&zs, Z_FINISH) == Z_STREAM_END;
+  out.resize(sizeof(hdr) + zs.total_out);
+  deflateEnd(&zs);
+  if (!ok)
+    throw error(error::error_code::internal_error, "Section compression failed !!!");
+  return out;
+#else
+  (void)content;
+  (void)align;
+  throw error(error::error_code::internal_error, "Compressed sections need aiebu built with zlib !!!");
+#endif
+}
+
+std::vector<char>
+decompress(const char* data, size_t size)
+{
+  header hdr;
+  if (size < sizeof(hdr))
+    throw error(error::error_code::invalid_buffer_type, "Truncated compressed section");
+  std::memcpy(&hdr, data, sizeof(hdr));
+  if (hdr.ch_type != elfcompress_zlib)
+    throw error(error::error_code::invalid_buffer_type,
+                "Unsupported section compression " + std::to_string(hdr.ch_type));
+
+#ifdef AIEBU_HAVE_ZLIB
+  std::vector<char> out(hdr.ch_size);
+  if (out.empty())
+    return out;
+  uLongf out_size = hdr.ch_size;
+  int ret = uncompress(reinterpret_cast<Bytef*>(out.data()), &out_size,
+                       reinterpret_cast<const Bytef*>(data + sizeof(hdr)), static_cast<uLong>(size - sizeof(hdr)));
+  if (ret != Z_OK || out_size != hdr.ch_size)
+    throw error(error::error_code::invalid_buffer_type, "Invalid compressed section");
+  return out;
+#else
+  throw error(error::error_code::internal_error, "Compressed sections need aiebu built with zlib !!!");
+#endif
+}
+
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_ELF_COMPRESSED_SECTION_H_
+#define _AIEBU_ELF_COMPRESSED_SECTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "buffer_view.h"
+
+namespace aiebu::compressed_section {
+
+// Content of a SHF_COMPRESSED section as in the gABI: an Elf32_Chdr
+// followed by the compressed bytes. Only zlib is supported, and only
+// when the library is built with zlib.
+
+constexpr uint32_t shf_compressed = 0x800;
+constexpr uint32_t elfcompress_zlib = 1;
+
+struct header       // Elf32_Chdr
+{
+  uint32_t ch_type;
+  uint32_t ch_size;
+  uint32_t ch_addralign;
+};
+
+// True when the library is built with zlib
+bool
+available();
+
+// Compress the patched content of a section, throws when not available()
+std::vector<char>
+compress(const buffer_view& content, uint32_t align);
+
+// Content of a compressed section, throws on a malformed section or an
+// unsupported compression
+std::vector<char>
+decompress(const char* data, size_t size);
+
+}
+#endif //_AIEBU_ELF_COMPRESSED_SECTION_H_
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "elf_serializer.h"
+#include "aiebu_error.h"
+
+namespace aiebu {
+
+namespace {
+
+uint64_t
+align_up(uint64_t pos, uint64_t align)
+{
+  return align > 1 ? (pos + align - 1) / align * align : pos;
+}
+
+// Zero the gap between the last written byte and the next item
+void
+fill(char* dst, uint32_t& cursor, uint32_t next)
+{
+  if (next > cursor)
+    std::memset(dst + cursor, 0, next - cursor);
+  cursor = next;
+}
+
+}
+
+elf_serializer::
+elf_serializer(const ELFIO::elfio& elfio) : m_elfio(elfio)
+{
+}
+
+void
+elf_serializer::
+set_content(ELFIO::Elf_Half index, const buffer_view* content)
+{
+  m_content[index] = content;
+}
+
+void
+elf_serializer::
+keep_content(ELFIO::Elf_Half index)
+{
+  m_keep.insert(index);
+}
+
+size_t
+elf_serializer::
+layout()
+{
+  // Host and target are both little endian, headers are written as is
+  if (m_elfio.get_class() != ELFIO::ELFCLASS32 || m_elfio.get_encoding() != ELFIO::ELFDATA2LSB)
+    throw error(error::error_code::internal_error, "Only 32bit little endian elf can be serialized !!!");
+
+  const ELFIO::Elf_Half sec_num = m_elfio.sections.size();
+  const ELFIO::Elf_Half seg_num = m_elfio.segments.size();
+
+  uint64_t pos = sizeof(ELFIO::Elf32_Ehdr);
+  m_phoff = seg_num ? static_cast<uint32_t>(pos) : 0;
+  pos += seg_num * sizeof(ELFIO::Elf32_Phdr);
+
+  // Section data in section index order, each aligned to its addr_align
+  m_section_offset.assign(sec_num, 0);
+  for (ELFIO::Elf_Half i = 1; i < sec_num; ++i) {
+    const ELFIO::section* sec = m_elfio.sections[i];
+    auto it = m_content.find(i);
+    if (it != m_content.end() && it->second->size() != sec->get_size())
+      throw error(error::error_code::internal_error, "Size mismatch for section " + sec->get_name() + " !!!");
+
+    pos = align_up(pos, sec->get_addr_align());
+    m_section_offset[i] = static_cast<uint32_t>(pos);
+    if (sec->get_type() != ELFIO::SHT_NOBITS)
+      pos += sec->get_size();
+  }
+
+  // Segments span the sections assigned to them
+  m_segment_range.assign(seg_num, {0, 0});
+  for (ELFIO::Elf_Half i = 0; i < seg_num; ++i) {
+    const ELFIO::segment* seg = m_elfio.segments[i];
+    if (seg->get_sections_num() == 0) {
+      if (seg->get_type() == ELFIO::PT_PHDR)
+        m_segment_range[i] = {m_phoff, static_cast<uint32_t>(seg_num * sizeof(ELFIO::Elf32_Phdr))};
+      continue;
+    }
+
+    uint64_t start = std::numeric_limits<uint64_t>::max();
+    uint64_t end = 0;
+    for (ELFIO::Elf_Half j = 0; j < seg->get_sections_num(); ++j) {
+      auto index = seg->get_section_index_at(j);
+      const ELFIO::section* sec = m_elfio.sections[index];
+      const uint64_t sec_size = sec->get_type() == ELFIO::SHT_NOBITS ? 0 : sec->get_size();
+      start = std::min<uint64_t>(start, m_section_offset[index]);
+      end = std::max<uint64_t>(end, m_section_offset[index] + sec_size);
+    }
+    m_segment_range[i] = {static_cast<uint32_t>(start), static_cast<uint32_t>(end - start)};
+  }
+
+  pos = align_up(pos, sizeof(ELFIO::Elf_Word));
+  m_shoff = sec_num ? static_cast<uint32_t>(pos) : 0;
+  pos += sec_num * sizeof(ELFIO::Elf32_Shdr);
+
+  if (pos > std::numeric_limits<uint32_t>::max())
+    throw error(error::error_code::internal_error, "Elf size exceeds 32bit elf limit !!!");
+
+  m_size = static_cast<uint32_t>(pos);
+  return m_size;
+}
+
+bool
+elf_serializer::
+same_layout(const char* image, size_t size) const
+{
+  if (!image || size != m_size || size < sizeof(ELFIO::Elf32_Ehdr))
+    return false;
+
+  ELFIO::Elf32_Ehdr ehdr;
+  std::memcpy(&ehdr, image, sizeof(ehdr));
+  if (ehdr.e_shoff != m_shoff || ehdr.e_shnum != m_elfio.sections.size()
+      || ehdr.e_phoff != m_phoff || ehdr.e_phnum != m_elfio.segments.size())
+    return false;
+
+  for (ELFIO::Elf_Half i = 1; i < m_elfio.sections.size(); ++i) {
+    const ELFIO::section* sec = m_elfio.sections[i];
+    ELFIO::Elf32_Shdr shdr;
+    std::memcpy(&shdr, image + m_shoff + i * sizeof(shdr), sizeof(shdr));
+    if (shdr.sh_name != sec->get_name_string_offset() || shdr.sh_type != sec->get_type()
+        || shdr.sh_offset != m_section_offset[i] || shdr.sh_size != sec->get_size())
+      return false;
+  }
+
+  // same name offsets can still be other names
+  const ELFIO::section* shstrtab = m_elfio.sections[m_elfio.get_section_name_str_index()];
+  return shstrtab && shstrtab->get_data()
+      && std::memcmp(image + m_section_offset[shstrtab->get_index()], shstrtab->get_data(), shstrtab->get_size()) == 0;
+}
+
+void
+elf_serializer::
+write_header(char* dst) const
+{
+  ELFIO::Elf32_Ehdr ehdr = {};
+  ehdr.e_ident[ELFIO::EI_MAG0] = ELFIO::ELFMAG0;
+  ehdr.e_ident[ELFIO::EI_MAG1] = ELFIO::ELFMAG1;
+  ehdr.e_ident[ELFIO::EI_MAG2] = ELFIO::ELFMAG2;
+  ehdr.e_ident[ELFIO::EI_MAG3] = ELFIO::ELFMAG3;
+  ehdr.e_ident[ELFIO::EI_CLASS] = m_elfio.get_class();
+  ehdr.e_ident[ELFIO::EI_DATA] = m_elfio.get_encoding();
+  ehdr.e_ident[ELFIO::EI_VERSION] = m_elfio.get_elf_version();
+  ehdr.e_ident[ELFIO::EI_OSABI] = m_elfio.get_os_abi();
+  ehdr.e_ident[ELFIO::EI_ABIVERSION] = m_elfio.get_abi_version();
+  ehdr.e_type = m_elfio.get_type();
+  ehdr.e_machine = m_elfio.get_machine();
+  ehdr.e_version = m_elfio.get_version();
+  ehdr.e_entry = static_cast<ELFIO::Elf32_Addr>(m_elfio.get_entry());
+  ehdr.e_phoff = m_phoff;
+  ehdr.e_shoff = m_shoff;
+  ehdr.e_flags = m_elfio.get_flags();
+  ehdr.e_ehsize = sizeof(ELFIO::Elf32_Ehdr);
+  ehdr.e_phentsize = sizeof(ELFIO::Elf32_Phdr);
+  ehdr.e_phnum = m_elfio.segments.size();
+  ehdr.e_shentsize = sizeof(ELFIO::Elf32_Shdr);
+  ehdr.e_shnum = m_elfio.sections.size();
+  ehdr.e_shstrndx = m_elfio.get_section_name_str_index();
+  std::memcpy(dst, &ehdr, sizeof(ehdr));
+}
+
+void
+elf_serializer::
+write_segment_headers(char* dst) const
+{
+  char* cur = dst + m_phoff;
+  for (ELFIO::Elf_Half i = 0; i < m_elfio.segments.size(); ++i) {
+    const ELFIO::segment* seg = m_elfio.segments[i];
+    ELFIO::Elf32_Phdr phdr = {};
+    phdr.p_type = seg->get_type();
+    phdr.p_offset = m_segment_range[i].first;
+    phdr.p_vaddr = static_cast<ELFIO::Elf32_Addr>(seg->get_virtual_address());
+    phdr.p_paddr = static_cast<ELFIO::Elf32_Addr>(seg->get_physical_address());
+    phdr.p_filesz = m_segment_range[i].second;
+    phdr.p_memsz = m_segment_range[i].second;
+    phdr.p_flags = seg->get_flags();
+    phdr.p_align = static_cast<ELFIO::Elf_Word>(seg->get_align());
+    std::memcpy(cur, &phdr, sizeof(phdr));
+    cur += sizeof(phdr);
+  }
+}
+
+void
+elf_serializer::
+write_sections(char* dst, const content_observer& observer) const
+{
+  uint32_t cursor = m_phoff + m_elfio.segments.size() * sizeof(ELFIO::Elf32_Phdr);
+  for (ELFIO::Elf_Half i = 1; i < m_elfio.sections.size(); ++i) {
+    const ELFIO::section* sec = m_elfio.sections[i];
+    if (sec->get_type() == ELFIO::SHT_NOBITS || !sec->get_size())
+      continue;
+
+    fill(dst, cursor, m_section_offset[i]);
+    auto it = m_content.find(i);
+    if (it != m_content.end()) {
+      if (!m_keep.count(i))
+        it->second->copy_to(dst + cursor);
+      if (observer)
+        observer(dst + cursor, it->second->size());
+    }
+    else if (sec->get_data())
+      std::memcpy(dst + cursor, sec->get_data(), sec->get_size());
+    else
+      std::memset(dst + cursor, 0, sec->get_size());
+    cursor += static_cast<uint32_t>(sec->get_size());
+  }
+  fill(dst, cursor, m_shoff ? m_shoff : m_size);
+}
+
+void
+elf_serializer::
+write_section_headers(char* dst) const
+{
+  char* cur = dst + m_shoff;
+  for (ELFIO::Elf_Half i = 0; i < m_elfio.sections.size(); ++i) {
+    const ELFIO::section* sec = m_elfio.sections[i];
+    ELFIO::Elf32_Shdr shdr = {};
+    if (i) {
+      shdr.sh_name = sec->get_name_string_offset();
+      shdr.sh_type = sec->get_type();
+      shdr.sh_flags = static_cast<ELFIO::Elf_Word>(sec->get_flags());
+      shdr.sh_addr = static_cast<ELFIO::Elf32_Addr>(sec->get_address());
+      shdr.sh_offset = m_section_offset[i];
+      shdr.sh_size = static_cast<ELFIO::Elf_Word>(sec->get_size());
+      shdr.sh_link = sec->get_link();
+      shdr.sh_info = sec->get_info();
+      shdr.sh_addralign = static_cast<ELFIO::Elf_Word>(sec->get_addr_align());
+      shdr.sh_entsize = static_cast<ELFIO::Elf_Word>(sec->get_entry_size());
+    }
+    std::memcpy(cur, &shdr, sizeof(shdr));
+    cur += sizeof(shdr);
+  }
+}
+
+void
+elf_serializer::
+write(char* dst, const content_observer& observer) const
+{
+  if (!dst)
+    throw error(error::error_code::internal_error, "No buffer to write elf !!!");
+
+  write_header(dst);
+  write_segment_headers(dst);
+  write_sections(dst, observer);
+  write_section_headers(dst);
+}
+
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_ELF_ELF_SERIALIZER_H_
+#define _AIEBU_ELF_ELF_SERIALIZER_H_
+
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+#include "buffer_view.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4245)
+#endif
+#include "elfio/elfio.hpp"
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+namespace aiebu {
+
+// Destination of a serialized elf. Called once with the exact image size,
+// returns the buffer the image is written to, or nullptr when only the
+// size is wanted.
+using elf_sink = std::function<char*(size_t size)>;
+
+// Serializes an ELFCLASS32 little endian elf described by an ELFIO model.
+// The file layout is computed up front so the image is written in a single
+// pass into a buffer of its final size, instead of going through ELFIO::save()
+// and a stream. Sections whose content was registered with set_content() are
+// copied straight from the input buffers, all other sections from ELFIO.
+class elf_serializer
+{
+public:
+  // Sees the content registered with set_content() right after it is
+  // copied into the image, section by section in index order
+  using content_observer = std::function<void(const char* data, size_t size)>;
+
+private:
+  const ELFIO::elfio& m_elfio;
+  std::map<ELFIO::Elf_Half, const buffer_view*> m_content;
+  std::set<ELFIO::Elf_Half> m_keep;
+  std::vector<uint32_t> m_section_offset;
+  std::vector<std::pair<uint32_t, uint32_t>> m_segment_range;
+  uint32_t m_phoff = 0;
+  uint32_t m_shoff = 0;
+  uint32_t m_size = 0;
+
+  void write_header(char* dst) const;
+  void write_segment_headers(char* dst) const;
+  void write_sections(char* dst, const content_observer& observer) const;
+  void write_section_headers(char* dst) const;
+
+public:
+  explicit elf_serializer(const ELFIO::elfio& elfio);
+
+  // Section content held outside of ELFIO, must be alive until write()
+  void set_content(ELFIO::Elf_Half index, const buffer_view* content);
+
+  // Content of this section is already in the destination, written by
+  // an earlier write() of the same layout, see same_layout(). It is not
+  // copied again but still passed to the observer.
+  void keep_content(ELFIO::Elf_Half index);
+
+  // Compute file offsets of all headers, sections and segments.
+  // Returns the size of the image.
+  size_t layout();
+
+  // True when image, an elf written earlier, has the size and the
+  // sections, names and offsets this layout() gives
+  bool same_layout(const char* image, size_t size) const;
+
+  // Write the image to dst which must hold layout() bytes
+  void write(char* dst, const content_observer& observer = nullptr) const;
+
+  void write(const elf_sink& sink) const
+  {
+    if (char* dst = sink(m_size))
+      write(dst);
+  }
+
+  uint32_t
+  get_section_offset(ELFIO::Elf_Half index) const
+  {
+    return m_section_offset.at(index);
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+};
+
+}
+#endif //_AIEBU_ELF_ELF_SERIALIZER_H_
@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "aiebu_elf_view.h"
+#include "aiebu_error.h"
+#include "compact_reloc.h"
+#include "compressed_section.h"
+#include "elfwriter.h"
+#include "mapped_file.h"
+
+namespace aiebu {
+
+// Either a buffer owned by the caller or a mapped file
+struct elf_view::image
+{
+  mapped_file file;
+  const char* data = nullptr;
+  size_t size = 0;
+  ELFIO::Elf32_Ehdr ehdr = {};
+  const char* shstrtab = nullptr;
+  size_t shstrtab_size = 0;
+};
+
+namespace {
+
+[[noreturn]] void
+malformed(const std::string& what)
+{
+  throw error(error::error_code::invalid_buffer_type, "Invalid ELF buffer, " + what);
+}
+
+// Entries are read with memcpy, the image has no alignment guarantee
+template <typename T>
+T
+read(const char* data, size_t size, uint64_t offset)
+{
+  T value;
+  if (offset > size || size - offset < sizeof(T))
+    malformed("read out of bounds at " + std::to_string(offset));
+  std::memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+uint64_t
+align4(uint64_t size)
+{
+  return (size + 3) & ~uint64_t(3);
+}
+
+// Null terminated string at offset of a string table, bounded by the table
+std::string_view
+string_at(const char* table, size_t table_size, uint32_t offset)
+{
+  if (!table || offset >= table_size)
+    return {};
+  const char* str = table + offset;
+  return {str, strnlen(str, table_size - offset)};
+}
+
+}
+
+void
+elf_view::
+open(std::shared_ptr<image> img)
+{
+  const auto& hdr = img->ehdr = read<ELFIO::Elf32_Ehdr>(img->data, img->size, 0);
+  if (hdr.e_ident[ELFIO::EI_MAG0] != ELFIO::ELFMAG0 || hdr.e_ident[ELFIO::EI_MAG1] != ELFIO::ELFMAG1
+      || hdr.e_ident[ELFIO::EI_MAG2] != ELFIO::ELFMAG2 || hdr.e_ident[ELFIO::EI_MAG3] != ELFIO::ELFMAG3)
+    malformed("bad magic");
+  if (hdr.e_ident[ELFIO::EI_CLASS] != ELFIO::ELFCLASS32 || hdr.e_ident[ELFIO::EI_DATA] != ELFIO::ELFDATA2LSB)
+    malformed("only ELFCLASS32 little endian is supported");
+  if (hdr.e_shnum && hdr.e_shentsize != sizeof(ELFIO::Elf32_Shdr))
+    malformed("bad section header size");
+  if (hdr.e_phnum && hdr.e_phentsize != sizeof(ELFIO::Elf32_Phdr))
+    malformed("bad program header size");
+  if (uint64_t(hdr.e_shoff) + uint64_t(hdr.e_shnum) * sizeof(ELFIO::Elf32_Shdr) > img->size)
+    malformed("section headers out of bounds");
+  if (uint64_t(hdr.e_phoff) + uint64_t(hdr.e_phnum) * sizeof(ELFIO::Elf32_Phdr) > img->size)
+    malformed("program headers out of bounds");
+  if (hdr.e_shnum && hdr.e_shstrndx >= hdr.e_shnum)
+    malformed("bad section name table index");
+  m_image = img;
+
+  if (hdr.e_shnum) {
+    auto names = get_section(hdr.e_shstrndx);
+    img->shstrtab = names.data;
+    img->shstrtab_size = names.data ? names.size : 0;
+  }
+}
+
+elf_view::
+elf_view(const_buffer elf)
+{
+  auto img = std::make_shared<image>();
+  img->data = elf.data;
+  img->size = elf.data ? elf.size : 0;
+  open(std::move(img));
+}
+
+elf_view::
+elf_view(const std::string& filename)
+{
+  auto img = std::make_shared<image>();
+  img->file = mapped_file(filename);
+  img->data = img->file.data();
+  img->size = img->file.size();
+  open(std::move(img));
+}
+
+const_buffer
+elf_view::
+get_buffer() const
+{
+  return {m_image->data, m_image->size};
+}
+
+uint16_t
+elf_view::
+get_type() const
+{
+  return m_image->ehdr.e_type;
+}
+
+uint16_t
+elf_view::
+get_machine() const
+{
+  return m_image->ehdr.e_machine;
+}
+
+uint8_t
+elf_view::
+get_os_abi() const
+{
+  return m_image->ehdr.e_ident[ELFIO::EI_OSABI];
+}
+
+uint8_t
+elf_view::
+get_abi_version() const
+{
+  return m_image->ehdr.e_ident[ELFIO::EI_ABIVERSION];
+}
+
+uint32_t
+elf_view::
+get_flags() const
+{
+  return m_image->ehdr.e_flags;
+}
+
+uint32_t
+elf_view::
+get_entry() const
+{
+  return m_image->ehdr.e_entry;
+}
+
+size_t
+elf_view::
+num_sections() const
+{
+  return m_image->ehdr.e_shnum;
+}
+
+elf_view::section
+elf_view::
+get_section(size_t index) const
+{
+  const auto& img = *m_image;
+  if (index >= img.ehdr.e_shnum)
+    throw error(error::error_code::invalid_offset, "Section index " + std::to_string(index) + " out of range !!!");
+
+  auto shdr = read<ELFIO::Elf32_Shdr>(img.data, img.size, img.ehdr.e_shoff + index * sizeof(ELFIO::Elf32_Shdr));
+  section sec = {static_cast<uint16_t>(index), string_at(img.shstrtab, img.shstrtab_size, shdr.sh_name),
+                 shdr.sh_type, shdr.sh_flags, shdr.sh_addr, shdr.sh_offset, shdr.sh_size,
+                 shdr.sh_link, shdr.sh_info, shdr.sh_addralign, shdr.sh_entsize, nullptr};
+  if (sec.type != ELFIO::SHT_NOBITS && sec.type != ELFIO::SHT_NULL) {
+    if (uint64_t(sec.offset) + sec.size > img.size)
+      malformed("section " + std::to_string(index) + " out of bounds");
+    sec.data = img.data + sec.offset;
+  }
+  return sec;
+}
+
+std::optional<elf_view::section>
+elf_view::
+find_section(std::string_view name) const
+{
+  // only the name offset of the other headers is read
+  const auto& img = *m_image;
+  for (size_t i = 0; i < img.ehdr.e_shnum; ++i) {
+    auto sh_name = read<ELFIO::Elf_Word>(img.data, img.size, img.ehdr.e_shoff + i * sizeof(ELFIO::Elf32_Shdr));
+    if (string_at(img.shstrtab, img.shstrtab_size, sh_name) == name)
+      return get_section(i);
+  }
+  return std::nullopt;
+}
+
+size_t
+elf_view::
+num_segments() const
+{
+  return m_image->ehdr.e_phnum;
+}
+
+elf_view::segment
+elf_view::
+get_segment(size_t index) const
+{
+  const auto& img = *m_image;
+  if (index >= img.ehdr.e_phnum)
+    throw error(error::error_code::invalid_offset, "Segment index " + std::to_string(index) + " out of range !!!");
+
+  auto phdr = read<ELFIO::Elf32_Phdr>(img.data, img.size, img.ehdr.e_phoff + index * sizeof(ELFIO::Elf32_Phdr));
+  return {phdr.p_type, phdr.p_offset, phdr.p_vaddr, phdr.p_paddr,
+          phdr.p_filesz, phdr.p_memsz, phdr.p_flags, phdr.p_align};
+}
+
+const_buffer
+elf_view::
+get_content(const section& sec, std::vector<char>& storage) const
+{
+  if (!sec.data)
+    return {};
+  if (!(sec.flags & compressed_section::shf_compressed))
+    return {sec.data, sec.size};
+  storage = compressed_section::decompress(sec.data, sec.size);
+  return storage;
+}
+
+size_t
+elf_view::
+num_symbols(const section& symtab) const
+{
+  if (symtab.type != ELFIO::SHT_SYMTAB && symtab.type != ELFIO::SHT_DYNSYM)
+    throw error(error::error_code::invalid_buffer_type, "Section " + std::string(symtab.name) + " is not a symbol table !!!");
+  return symtab.size / sizeof(ELFIO::Elf32_Sym);
+}
+
+elf_view::symbol
+elf_view::
+get_symbol(const section& symtab, size_t index) const
+{
+  if (index >= num_symbols(symtab))
+    throw error(error::error_code::invalid_offset, "Symbol index " + std::to_string(index) + " out of range !!!");
+
+  auto sym = read<ELFIO::Elf32_Sym>(symtab.data, symtab.size, index * sizeof(ELFIO::Elf32_Sym));
+  std::string_view name;
+  if (symtab.link < num_sections()) {
+    auto strtab = get_section(symtab.link);
+    name = string_at(strtab.data, strtab.data ? strtab.size : 0, sym.st_name);
+  }
+  return {name, sym.st_value, sym.st_size, static_cast<uint8_t>(ELF_ST_BIND(sym.st_info)),
+          static_cast<uint8_t>(ELF_ST_TYPE(sym.st_info)), sym.st_shndx};
+}
+
+void
+elf_view::
+for_each_relocation(const section& rel, const std::function<void(const relocation&)>& func) const
+{
+  if (rel.type == SHT_XRT_CRELA) {
+    compact_reloc::decode(reinterpret_cast<const uint8_t*>(rel.data), rel.size,
+                          [&func](const compact_reloc::entry& e) {
+                            func({e.offset, e.symbol, e.type, e.addend});
+                          });
+    return;
+  }
+  if (rel.type != ELFIO::SHT_RELA)
+    throw error(error::error_code::invalid_buffer_type, "Section " + std::string(rel.name) + " is not a relocation section !!!");
+
+  for (size_t offset = 0; offset + sizeof(ELFIO::Elf32_Rela) <= rel.size; offset += sizeof(ELFIO::Elf32_Rela)) {
+    auto rela = read<ELFIO::Elf32_Rela>(rel.data, rel.size, offset);
+    func({rela.r_offset, static_cast<uint32_t>(ELF32_R_SYM(rela.r_info)),
+          static_cast<uint32_t>(ELF32_R_TYPE(rela.r_info)), rela.r_addend});
+  }
+}
+
+void
+elf_view::
+for_each_note(const section& notes, const std::function<void(const note&)>& func) const
+{
+  if (notes.type != ELFIO::SHT_NOTE)
+    throw error(error::error_code::invalid_buffer_type, "Section " + std::string(notes.name) + " is not a note section !!!");
+
+  constexpr uint32_t note_header = 3 * sizeof(uint32_t);
+  uint64_t offset = 0;
+  while (offset + note_header <= notes.size) {
+    auto namesz = read<uint32_t>(notes.data, notes.size, offset);
+    auto descsz = read<uint32_t>(notes.data, notes.size, offset + 4);
+    auto type = read<uint32_t>(notes.data, notes.size, offset + 8);
+    uint64_t name_offset = offset + note_header;
+    uint64_t desc_offset = name_offset + align4(namesz);
+    if (desc_offset + descsz > notes.size)
+      malformed("note out of bounds in " + std::string(notes.name));
+
+    // the name size includes the terminating null
+    std::string_view name(notes.data + name_offset, namesz ? strnlen(notes.data + name_offset, namesz) : 0);
+    func({type, name, {notes.data + desc_offset, descsz}});
+    offset = desc_offset + align4(descsz);
+  }
+}
+
+}
@@ -1,23 +1,36 @@
 // SPDX-License-Identifier: MIT
 // Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <unordered_map>
 #include "elfwriter.h"
+#include "string_table.h"
+#include "compact_reloc.h"
+#include "hash.h"
+#include "compressed_section.h"
 
 namespace aiebu {
 
 ELFIO::section*
 elf_writer::
-add_section(elf_section data)
+add_section(const elf_section& data)
 {
   // add section
   ELFIO::section* sec = m_elfio.sections.add(data.get_name());
   sec->set_type(data.get_type());
   sec->set_flags(data.get_flags());
   sec->set_addr_align(data.get_align());
-  std::vector<uint8_t> buf = data.get_buffer();
+  const buffer_view* buf = data.get_buffer();
 
-  if(buf.size())
-    sec->set_data(reinterpret_cast<char*>(buf.data()), static_cast<ELFIO::Elf_Word>(buf.size()));
+  if(buf && buf->size())
+  {
+    // content is copied only once, straight into the serialized image
+    sec->set_size(buf->size());
+    m_content[sec->get_index()] = buf;
+  }
   //sec->set_info( data.get_info() );
   if (!data.get_link().empty())
   {
@@ -29,7 +42,7 @@ add_section(elf_section data)
 
 ELFIO::segment*
 elf_writer::
-add_segment(elf_segment data)
+add_segment(const elf_segment& data)
 {
   // add segment
   ELFIO::segment* seg = m_elfio.segments.add();
@@ -47,21 +60,80 @@ add_segment(elf_segment data)
   return seg;
 }
 
-ELFIO::string_section_accessor
+namespace {
+
+// Identity of a dynsym, names are compared by their interned id
+struct dynsym_key
+{
+  uint32_t section;
+  uint32_t name;
+  uint64_t size;
+
+  bool
+  operator==(const dynsym_key& rhs) const
+  {
+    return section == rhs.section && name == rhs.name && size == rhs.size;
+  }
+};
+
+struct dynsym_key_hash
+{
+  size_t
+  operator()(const dynsym_key& key) const
+  {
+    uint64_t h = (uint64_t(key.section) << 32 | key.name) * 0x9e3779b97f4a7c15ULL;
+    h ^= (key.size + (h >> 29)) * 0xbf58476d1ce4e5b9ULL;
+    return static_cast<size_t>(h ^ (h >> 32));
+  }
+};
+
+std::vector<char>
+patched_content(const buffer_view& view)
+{
+  std::vector<char> content(view.size());
+  view.copy_to(content.data());
+  return content;
+}
+
+// Bytewise equality of two sections with the same content hash
+bool
+same_content(const buffer_view& a, const buffer_view& b)
+{
+  if (a.size() != b.size())
+    return false;
+  if (a.get_patches().empty() && b.get_patches().empty())
+    return std::memcmp(a.data(), b.data(), a.size()) == 0;
+  return patched_content(a) == patched_content(b);
+}
+
+void
+put_word(std::string& desc, uint32_t value)
+{
+  desc.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Descriptor of a note follows the namesz, descsz and type words and the
+// name padded to 4 bytes
+constexpr char note_name[] = "XRT";
+constexpr size_t note_desc_offset = 3 * sizeof(ELFIO::Elf_Word) + (sizeof(note_name) + 3) / 4 * 4;
+
+}
+
+ELFIO::section*
 elf_writer::
 add_dynstr_section()
 {
-  // add .dynstr section
+  // add .dynstr section, content is set by add_dynsym_section
   ELFIO::section* dstr_sec = m_elfio.sections.add( ".dynstr" );
   dstr_sec->set_type( ELFIO::SHT_STRTAB );
   dstr_sec->set_entry_size( 0 );
-  ELFIO::string_section_accessor stra( dstr_sec );
-  return stra;
+  return dstr_sec;
 }
 
 void
 elf_writer::
-add_dynsym_section(ELFIO::string_section_accessor* stra, std::vector<symbol>& syms)
+add_dynsym_section(ELFIO::section* dstr_sec, const symbol_table& syms,
+                   std::vector<ELFIO::Elf_Word>& indices)
 {
   // add .dynsym section
   ELFIO::section* dsym_sec = m_elfio.sections.add(".dynsym");
@@ -69,36 +141,85 @@ add_dynsym_section(ELFIO::string_section_accessor* stra, std::vector<symbol>& sy
   dsym_sec->set_flags(ELFIO::SHF_ALLOC);
   dsym_sec->set_addr_align( phdr_align );
   dsym_sec->set_entry_size(m_elfio.get_default_entry_size(ELFIO::SHT_SYMTAB));
-  ELFIO::section* dstr_sec = m_elfio.sections[".dynstr"];
   dsym_sec->set_link( dstr_sec->get_index() );
   dsym_sec->set_info( 1 );
 
-  // Create symbol table writer
-  ELFIO::symbol_section_accessor syma( m_elfio, dsym_sec );
-  std::map<std::string, ELFIO::Elf_Word> hash;
-  for (auto & sym : syms) {
-    std::string key = sym.get_section_name() + "_" + sym.get_name() + "_" +
-                      std::to_string(sym.get_size());
-    auto it = hash.find(key);
-    if (it == hash.end())
+  // One dynsym per (section, name, size) in order of first use. Unique
+  // symbols are collected first so .dynstr can be built, with its
+  // strings tail merged, before the symbols referencing it.
+  std::unordered_map<dynsym_key, uint32_t, dynsym_key_hash> hash;
+  std::vector<size_t> unique;         // first symbol of each dynsym
+  std::unordered_map<uint32_t, uint32_t> name_handle;
+  std::vector<uint32_t> unique_name;  // string_table handle of each dynsym
+  string_table strtab;
+  hash.reserve(syms.size());
+  indices.resize(syms.size());
+  for (size_t i = 0; i < syms.size(); ++i) {
+    auto [it, inserted] = hash.try_emplace({syms.get_section_id(i), syms.get_name_id(i), syms.get_size(i)},
+                                           static_cast<uint32_t>(unique.size()));
+    if (inserted)
     {
-      const ELFIO::section* sec = m_elfio.sections[sym.get_section_name()];
-      auto index = syma.add_symbol(*stra, sym.get_name().c_str(), 0,
-                                   sym.get_size(), ELFIO::STB_GLOBAL, ELFIO::STT_OBJECT,
-                                   0, sec->get_index());
-      hash[key] = index;
+      unique.push_back(i);
+      auto name = name_handle.try_emplace(syms.get_name_id(i), 0);
+      if (name.second)
+        name.first->second = strtab.add(syms.get_name(i));
+      unique_name.push_back(name.first->second);
     }
-    sym.set_index(hash[key]);
+    indices[i] = it->second;
   }
+  strtab.finalize();
+  dstr_sec->set_data(strtab.data());
 
+  // Create symbol table writer
+  ELFIO::symbol_section_accessor syma( m_elfio, dsym_sec );
+  std::unordered_map<uint32_t, ELFIO::Elf_Half> section_index;
+  std::vector<ELFIO::Elf_Word> dynsym_index(unique.size());
+  for (size_t u = 0; u < unique.size(); ++u) {
+    const size_t i = unique[u];
+    auto sec = section_index.try_emplace(syms.get_section_id(i), 0);
+    if (sec.second)
+      sec.first->second = m_elfio.sections[syms.get_section_name(i)]->get_index();
+    dynsym_index[u] = syma.add_symbol(strtab.offset(unique_name[u]), 0, syms.get_size(i),
+                                      ELFIO::STB_GLOBAL, ELFIO::STT_OBJECT, 0, sec.first->second);
+  }
+  for (auto& index : indices)
+    index = dynsym_index[index];
 }
 
-void
+// Relocations sorted by (target section, argument, offset), so the
+// sites of one argument in one section are contiguous and in address
+// order. Arguments are ordered by first use.
+std::vector<uint32_t>
+elf_writer::
+relocation_order(const symbol_table& syms, size_t first, size_t count)
+{
+  std::unordered_map<uint32_t, ELFIO::Elf_Half> section_index;
+  std::vector<ELFIO::Elf_Half> shndx(syms.size());
+  for (size_t i = first; i < first + count; ++i) {
+    auto sec = section_index.try_emplace(syms.get_section_id(i), 0);
+    if (sec.second)
+      sec.first->second = m_elfio.sections[syms.get_section_name(i)]->get_index();
+    shndx[i] = sec.first->second;
+  }
+
+  std::vector<uint32_t> order(count);
+  for (uint32_t i = 0; i < order.size(); ++i)
+    order[i] = static_cast<uint32_t>(first + i);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return std::make_tuple(shndx[a], syms.get_name_id(a), syms.get_pos(a))
+         < std::make_tuple(shndx[b], syms.get_name_id(b), syms.get_pos(b));
+  });
+  return order;
+}
+
+ELFIO::section*
 elf_writer::
-add_reldyn_section(std::vector<symbol>& syms)
+add_reldyn_section(const std::string& name, const symbol_table& syms,
+                   const std::vector<ELFIO::Elf_Word>& indices,
+                   const std::vector<uint32_t>& order)
 {
   // Create relocation table section
-  ELFIO::section* rel_sec = m_elfio.sections.add( ".rela.dyn" );
+  ELFIO::section* rel_sec = m_elfio.sections.add( name );
   rel_sec->set_type( ELFIO::SHT_RELA );
   rel_sec->set_flags(ELFIO::SHF_ALLOC);
   //section* data_sec = m_elfio.sections[".data"];
@@ -110,9 +231,76 @@ add_reldyn_section(std::vector<symbol>& syms)
 
   // Create relocation table writer
   ELFIO::relocation_section_accessor rela( m_elfio, rel_sec );
-  for (auto & sym : syms) {
-      rela.add_entry(sym.get_pos(), sym.get_index(), (unsigned char)sym.get_schema(), (ELFIO::Elf_Sxword)sym.get_addend());
+  for (auto i : order) {
+      rela.add_entry(syms.get_pos(i), indices[i], (unsigned char)syms.get_schema(i), (ELFIO::Elf_Sxword)syms.get_addend(i));
   }
+  return rel_sec;
+}
+
+// Index of .rela.dyn, all fields uint32:
+//   version | num_sections | num_arguments
+//   num_sections x   (section index, first relocation, count)
+//   num_arguments x  (section index, dynsym index, first relocation, count)
+// An argument is identified by the dynsym of its first relocation, only
+// its name matters. A loader updating one argument patches its range(s)
+// instead of scanning all relocations.
+void
+elf_writer::
+add_reloc_index_note(const std::string& name, const symbol_table& syms,
+                     const std::vector<ELFIO::Elf_Word>& indices,
+                     const std::vector<uint32_t>& order)
+{
+  std::vector<std::array<uint32_t, 3>> sections;
+  std::vector<std::array<uint32_t, 4>> arguments;
+  uint32_t prev_section = 0;
+  for (uint32_t r = 0; r < order.size(); ++r) {
+    const auto i = order[r];
+    const uint32_t section = syms.get_section_id(i);
+    if (r == 0 || section != prev_section) {
+      sections.push_back({m_elfio.sections[syms.get_section_name(i)]->get_index(), r, 0});
+      arguments.push_back({sections.back()[0], indices[i], r, 0});
+    }
+    else if (syms.get_name_id(i) != syms.get_name_id(order[r - 1])) {
+      arguments.push_back({sections.back()[0], indices[i], r, 0});
+    }
+    ++sections.back()[2];
+    ++arguments.back()[3];
+    prev_section = section;
+  }
+
+  std::string desc;
+  put_word(desc, reloc_index_version);
+  put_word(desc, static_cast<uint32_t>(sections.size()));
+  put_word(desc, static_cast<uint32_t>(arguments.size()));
+  for (const auto& sec : sections)
+    for (auto value : sec)
+      put_word(desc, value);
+  for (const auto& arg : arguments)
+    for (auto value : arg)
+      put_word(desc, value);
+  add_note(NT_XRT_RELOC_INDEX, name, desc);
+}
+
+ELFIO::section*
+elf_writer::
+add_compact_reldyn_section(const std::string& name, const symbol_table& syms,
+                           const std::vector<ELFIO::Elf_Word>& indices,
+                           const std::vector<uint32_t>& order)
+{
+  std::vector<compact_reloc::entry> entries;
+  entries.reserve(order.size());
+  for (auto i : order)
+    entries.push_back({syms.get_pos(i), indices[i], static_cast<uint8_t>(syms.get_schema(i)), syms.get_addend(i)});
+  auto encoded = compact_reloc::encode(entries);
+
+  ELFIO::section* rel_sec = m_elfio.sections.add( name );
+  rel_sec->set_type( SHT_XRT_CRELA );
+  rel_sec->set_flags(ELFIO::SHF_ALLOC);
+  rel_sec->set_addr_align(1);
+  rel_sec->set_entry_size(0);
+  rel_sec->set_link( m_elfio.sections[".dynsym"]->get_index() );
+  rel_sec->set_data(reinterpret_cast<const char*>(encoded.data()), static_cast<ELFIO::Elf_Word>(encoded.size()));
+  return rel_sec;
 }
 
 void
@@ -133,9 +321,16 @@ add_dynamic_section_segment()
   dyn_sec->set_info( 0 );
 
   ELFIO::dynamic_section_accessor dyn(m_elfio, dyn_sec);
-  ELFIO::section* rel_sec = m_elfio.sections[".rela.dyn"];
-  dyn.add_entry(ELFIO::DT_RELA, rel_sec->get_index());
-  dyn.add_entry(ELFIO::DT_RELASZ, rel_sec->get_size());
+  if (m_options.compact_relocations) {
+    ELFIO::section* rel_sec = m_elfio.sections[".rela.compact"];
+    dyn.add_entry(DT_XRT_CRELA, rel_sec->get_index());
+    dyn.add_entry(DT_XRT_CRELASZ, rel_sec->get_size());
+  }
+  else {
+    ELFIO::section* rel_sec = m_elfio.sections[".rela.dyn"];
+    dyn.add_entry(ELFIO::DT_RELA, rel_sec->get_index());
+    dyn.add_entry(ELFIO::DT_RELASZ, rel_sec->get_size());
+  }
 
 
   elf_segment seg_data;
@@ -148,7 +343,7 @@ add_dynamic_section_segment()
   add_segment(seg_data);
 }
 
-void
+ELFIO::section*
 elf_writer::
 add_note(ELFIO::Elf_Word type, std::string name, std::string dec)
 {
@@ -157,83 +352,334 @@ add_note(ELFIO::Elf_Word type, std::string name, std::string dec)
   note_sec->set_addr_align( 1 );
 
   ELFIO::note_section_accessor note_writer( m_elfio, note_sec );
-  note_writer.add_note( type, "XRT", dec.c_str(), dec.size() );
+  note_writer.add_note( type, note_name, dec.c_str(), dec.size() );
+  return note_sec;
 }
 
-std::vector<char>
+// Page alignment note, uint32 alignment of the loadable code segments
+void
 elf_writer::
-finalize()
+add_page_align_note()
 {
-  std::cout << "UID:" << m_uid.calculate() << "\n";
-  add_note(NT_XRT_UID, ".note.xrt.UID", m_uid.calculate());
-  std::stringstream stream;
-  stream << std::noskipws;
-  //m_elfio.save( "hello_32" );
-  m_elfio.save( stream );
-  std::vector<char> v;
-  std::copy(std::istream_iterator<char>(stream),
-            std::istream_iterator<char>( ),
-            std::back_inserter(v));
-  return v;
+  if (!m_options.page_align)
+    return;
+  std::string desc;
+  put_word(desc, m_options.page_align);
+  add_note(NT_XRT_PAGE_ALIGN, ".note.xrt.page_align", desc);
+}
+
+void
+elf_writer::
+finalize(const elf_sink& sink)
+{
+  write_image([&sink](elf_serializer& serializer) {
+    return sink(serializer.size());
+  });
+}
+
+bool
+elf_writer::
+finalize(std::vector<char>& image, const std::set<std::string>& unchanged)
+{
+  bool in_place = false;
+  write_image([this, &image, &unchanged, &in_place](elf_serializer& serializer) {
+    // compressed content is not kept as is in the image
+    in_place = !m_options.compress_sections && serializer.same_layout(image.data(), image.size());
+    if (in_place) {
+      for (const auto& [index, content] : m_content)
+        if (unchanged.count(m_elfio.sections[index]->get_name()))
+          serializer.keep_content(index);
+    }
+    else
+      image.resize(serializer.size());
+    return image.data();
+  });
+  return in_place;
 }
 
 void
 elf_writer::
-add_text_data_section(std::vector<writer>& mwriter, std::vector<symbol>& syms)
+write_image(const std::function<char*(elf_serializer&)>& target)
 {
-  for(auto buffer : mwriter)
+  // Compressed sections are hashed up front. All others are hashed as
+  // they are copied into the image, the note is laid out with a
+  // placeholder of the same size and the UID is written over it after.
+  const bool hashed = m_options.compress_sections;
+  const std::string placeholder = hashed ? m_uid->calculate() : std::string(m_uid->size(), '0');
+  const ELFIO::section* note = add_note(NT_XRT_UID, ".note.xrt.UID", placeholder);
+  elf_serializer serializer(m_elfio);
+  for (const auto& [index, content] : m_content)
+    serializer.set_content(index, content);
+  serializer.layout();
+  char* dst = target(serializer);
+  if (!dst)
+    return;
+
+  if (hashed) {
+    serializer.write(dst);
+    return;
+  }
+
+  serializer.write(dst, [this](const char* data, size_t size) {
+    m_uid->update(reinterpret_cast<const uint8_t*>(data), size);
+  });
+  const std::string uid = m_uid->calculate();
+  // a UID longer than the placeholder would overrun the note
+  if (uid.size() != placeholder.size())
+    throw error(error::error_code::internal_error, "UID size " + std::to_string(uid.size())
+                + " differs from its placeholder size " + std::to_string(placeholder.size()) + " !!!");
+  std::memcpy(dst + serializer.get_section_offset(note->get_index()) + note_desc_offset, uid.data(), uid.size());
+}
+
+void
+elf_writer::
+serialize(const elf_sink& sink)
+{
+  elf_serializer serializer(m_elfio);
+  for (const auto& [index, content] : m_content)
+    serializer.set_content(index, content);
+  serializer.layout();
+  serializer.write(sink);
+}
+
+ELFIO::section*
+elf_writer::
+add_code_section(writer& buffer, const std::string& name)
+{
+  const buffer_view& view = buffer.get_view();
+  elf_section sec_data;
+  sec_data.set_name(name);
+  sec_data.set_type(ELFIO::SHT_PROGBITS);
+  if (buffer.get_type() == code_section::text)
+    sec_data.set_flags(ELFIO::SHF_ALLOC | ELFIO::SHF_EXECINSTR);
+  else
+    sec_data.set_flags(ELFIO::SHF_ALLOC | ELFIO::SHF_WRITE);
+  sec_data.set_align(align);
+  sec_data.set_link("");
+
+  if (m_options.compress_sections)
   {
-    if(buffer.get_data().size())
+    // gABI does not allow SHF_ALLOC with SHF_COMPRESSED, the section is
+    // not part of a segment
+    sec_data.set_flags((sec_data.get_flags() & ~ELFIO::SHF_ALLOC) | compressed_section::shf_compressed);
+    ELFIO::section* sec = add_section(sec_data);
+    auto content = compressed_section::compress(view, align);
+    sec->set_data(content.data(), static_cast<ELFIO::Elf_Word>(content.size()));
+    return sec;
+  }
+  sec_data.set_buffer(&view);
+  if (m_options.page_align)
+    sec_data.set_align(m_options.page_align);
+
+  // segment offset is aligned like the section, vaddr 0 stays congruent
+  elf_segment seg_data;
+  seg_data.set_type(ELFIO::PT_LOAD);
+  if (buffer.get_type() == code_section::text)
+    seg_data.set_flags(ELFIO::PF_X | ELFIO::PF_R);
+  else
+    seg_data.set_flags(ELFIO::PF_W | ELFIO::PF_R);
+  seg_data.set_vaddr(0x0);
+  seg_data.set_paddr(0x0);
+  seg_data.set_link(name);
+  seg_data.set_align(m_options.page_align ? m_options.page_align : text_align);
+
+  ELFIO::section* sec = add_section(sec_data);
+  add_segment(seg_data);
+  return sec;
+}
+
+void
+elf_writer::
+add_text_data_section(std::vector<writer>& mwriter, symbol_table& syms)
+{
+  for(auto& buffer : mwriter)
+  {
+    const buffer_view& view = buffer.get_view();
+    if(view.size())
     {
-      m_uid.update(buffer.get_data());
-      elf_section sec_data;
-      sec_data.set_name(buffer.get_name());
-      sec_data.set_type(ELFIO::SHT_PROGBITS);
-      if (buffer.get_type() == code_section::text)
-        sec_data.set_flags(ELFIO::SHF_ALLOC | ELFIO::SHF_EXECINSTR);
-      else
-        sec_data.set_flags(ELFIO::SHF_ALLOC | ELFIO::SHF_WRITE);
-      sec_data.set_align(align);
-      sec_data.set_buffer(buffer.get_data());
-      sec_data.set_link("");
-
-      elf_segment seg_data;
-      seg_data.set_type(ELFIO::PT_LOAD);
-      if (buffer.get_type() == code_section::text)
-        seg_data.set_flags(ELFIO::PF_X | ELFIO::PF_R);
-      else
-        seg_data.set_flags(ELFIO::PF_W | ELFIO::PF_R);
-      seg_data.set_vaddr(0x0);
-      seg_data.set_paddr(0x0);
-      seg_data.set_link(buffer.get_name());
-      seg_data.set_align(text_align);
-
-      add_section(sec_data);
-      add_segment(seg_data);
+      add_code_section(buffer, buffer.get_name());
+      if (m_options.compress_sections)
+        view.for_each_chunk([this](const char* data, size_t size) {
+          m_uid->update(reinterpret_cast<const uint8_t*>(data), size);
+        });
+      // symbols are moved, mwriter is not used after the elf is written
       if (buffer.hassymbols())
-      {
-        auto lsyms = buffer.get_symbols();
-        syms.insert(syms.end(), lsyms.begin(), lsyms.end());
-      }
+        syms.append(std::move(buffer.get_symbols()));
     }
   }
 }
 
-std::vector<char>
+void
 elf_writer::
-process(std::vector<writer> mwriter)
+add_sections(std::vector<writer>& mwriter)
 {
-  // add sections
-  std::vector<symbol> syms;
+  symbol_table syms;
   add_text_data_section(mwriter, syms);
+  m_stats.symbols = syms.size();
+  m_stats.symbol_memory = syms.memory_footprint();
   if (syms.size())
   {
-    ELFIO::string_section_accessor str = add_dynstr_section();
-    add_dynsym_section(&str, syms);
-    add_reldyn_section(syms);
+    std::vector<ELFIO::Elf_Word> indices;
+    ELFIO::section* dstr_sec = add_dynstr_section();
+    add_dynsym_section(dstr_sec, syms, indices);
+    auto order = relocation_order(syms, 0, syms.size());
+    if (m_options.compact_relocations)
+      add_compact_reldyn_section(".rela.compact", syms, indices, order);
+    else {
+      add_reldyn_section(".rela.dyn", syms, indices, order);
+      add_reloc_index_note(".note.xrt.reloc_index", syms, indices, order);
+    }
     add_dynamic_section_segment();
   }
-  return finalize();
+  add_page_align_note();
+}
+
+void
+elf_writer::
+process(std::vector<writer>& mwriter, const elf_sink& sink)
+{
+  add_sections(mwriter);
+  finalize(sink);
+}
+
+bool
+elf_writer::
+process(std::vector<writer>& mwriter, std::vector<char>& image, const std::set<std::string>& unchanged)
+{
+  add_sections(mwriter);
+  return finalize(image, unchanged);
+}
+
+// Kernel note of a bundle, fields uint32:
+//   version | relocation section index (0 when none) | num_sections
+//   num_sections x (section index, name offset)
+//   string area: kernel name, section names, NUL terminated
+// Name offsets are relative to the string area, section names are the
+// names the kernel would have in an elf of its own.
+void
+elf_writer::
+process_bundle(std::vector<bundle_kernel>& kernels, const elf_sink& sink)
+{
+  std::unordered_map<std::string, size_t> names;
+  for (size_t k = 0; k < kernels.size(); ++k) {
+    if (kernels[k].name.empty())
+      throw error(error::error_code::invalid_asm, "Bundle kernel " + std::to_string(k) + " has no name");
+    if (!names.emplace(kernels[k].name, k).second)
+      throw error(error::error_code::invalid_asm, "Duplicate bundle kernel name " + kernels[k].name);
+  }
+
+  struct kernel_view
+  {
+    std::vector<std::pair<std::string, ELFIO::Elf_Half>> sections;
+    size_t first_symbol;
+    size_t num_symbols;
+    std::string uid;
+  };
+  std::vector<kernel_view> views(kernels.size());
+
+  // sections of all kernels by content hash, the hash includes the type
+  std::unordered_multimap<std::string, std::pair<const buffer_view*, ELFIO::Elf_Half>> shared;
+  symbol_table syms;
+  for (size_t k = 0; k < kernels.size(); ++k) {
+    auto& kernel = kernels[k];
+    auto& kview = views[k];
+    // per kernel UID over sections shared with other kernels, hashed here
+    auto uid = uid_hasher::create(m_options.uid);
+    std::unordered_map<std::string, std::string> section_names;
+    for (auto& buffer : kernel.sections) {
+      const buffer_view& view = buffer.get_view();
+      if (!view.size())
+        continue;
+
+      hash128 hash;
+      hash.update_value(buffer.get_type());
+      view.for_each_chunk([&hash, &uid](const char* data, size_t size) {
+        hash.update(data, size);
+        uid->update(reinterpret_cast<const uint8_t*>(data), size);
+      });
+      const std::string key = hash.hex();
+
+      ELFIO::Elf_Half index = 0;
+      auto range = shared.equal_range(key);
+      for (auto it = range.first; it != range.second && !index; ++it)
+        if (same_content(*it->second.first, view))
+          index = it->second.second;
+      if (!index) {
+        index = add_code_section(buffer, buffer.get_name() + "." + kernel.name)->get_index();
+        shared.emplace(key, std::make_pair(&view, index));
+      }
+      kview.sections.emplace_back(buffer.get_name(), index);
+      section_names[buffer.get_name()] = m_elfio.sections[index]->get_name();
+    }
+
+    // symbols refer to the sections of the kernel by their own names
+    symbol_table ksyms;
+    for (auto& buffer : kernel.sections) {
+      if (!buffer.hassymbols())
+        continue;
+      const auto& bsyms = buffer.get_symbols();
+      for (size_t i = 0; i < bsyms.size(); ++i) {
+        auto it = section_names.find(bsyms.get_section_name(i));
+        if (it == section_names.end())
+          throw error(error::error_code::internal_error, "Symbol " + bsyms.get_name(i) + " of kernel " + kernel.name
+                      + " refers to missing section " + bsyms.get_section_name(i));
+        ksyms.add(bsyms.get_name(i), bsyms.get_pos(i), bsyms.get_addend(i), bsyms.get_size(i),
+                  it->second, bsyms.get_schema(i));
+      }
+    }
+    kview.first_symbol = syms.size();
+    kview.num_symbols = ksyms.size();
+    syms.append(std::move(ksyms));
+    kview.uid = uid->calculate();
+  }
+
+  // one .dynsym for all kernels, relocations per kernel
+  std::vector<ELFIO::Elf_Word> indices;
+  if (!syms.empty())
+    add_dynsym_section(add_dynstr_section(), syms, indices);
+
+  for (size_t k = 0; k < kernels.size(); ++k) {
+    const auto& name = kernels[k].name;
+    const auto& kview = views[k];
+    ELFIO::Elf_Word rel_index = 0;
+    if (kview.num_symbols) {
+      auto order = relocation_order(syms, kview.first_symbol, kview.num_symbols);
+      if (m_options.compact_relocations)
+        rel_index = add_compact_reldyn_section(".rela.compact." + name, syms, indices, order)->get_index();
+      else {
+        rel_index = add_reldyn_section(".rela.dyn." + name, syms, indices, order)->get_index();
+        add_reloc_index_note(".note.xrt.reloc_index." + name, syms, indices, order);
+      }
+    }
+
+    add_note(NT_XRT_UID, ".note.xrt.UID." + name, kview.uid);
+
+    std::string desc;
+    std::string strings = name + '\0';
+    put_word(desc, bundle_kernel_version);
+    put_word(desc, rel_index);
+    put_word(desc, static_cast<uint32_t>(kview.sections.size()));
+    for (const auto& [section, index] : kview.sections) {
+      put_word(desc, index);
+      put_word(desc, static_cast<uint32_t>(strings.size()));
+      strings += section + '\0';
+    }
+    add_note(NT_XRT_BUNDLE_KERNEL, ".note.xrt.kernel." + name, desc + strings);
+  }
+  add_page_align_note();
+  serialize(sink);
+}
+
+std::vector<char>
+elf_writer::
+process(std::vector<writer>& mwriter)
+{
+  std::vector<char> v;
+  process(mwriter, [&v](size_t size) {
+    v.resize(size);
+    return v.data();
+  });
+  return v;
 }
 
 }
@@ -4,11 +4,17 @@
 #ifndef _AIEBU_ELF_ELF_WRITER_H_
 #define _AIEBU_ELF_ELF_WRITER_H_
 
-#include <sstream>
-#include <iterator>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
 #include "writer.h"
 #include "symbol.h"
-#include "uid_md5.h"
+#include "buffer_view.h"
+#include "uid_hash.h"
+#include "elf_serializer.h"
+#include "aiebu_assembler.h"
+#include "aiebu_error.h"
 
 #ifdef _WIN32
 #pragma warning(push)
@@ -28,10 +34,29 @@ constexpr int program_header_dynamic_count = 3;
 
 constexpr ELFIO::Elf_Word NT_XRT_UID = 4;
 
+// Relocation ranges of each patched section and argument, see
+// elf_writer::add_reloc_index_note
+constexpr ELFIO::Elf_Word NT_XRT_RELOC_INDEX = 5;
+constexpr uint32_t reloc_index_version = 1;
+
+// Kernel of a bundle elf, see elf_writer::process_bundle
+constexpr ELFIO::Elf_Word NT_XRT_BUNDLE_KERNEL = 6;
+constexpr uint32_t bundle_kernel_version = 1;
+
+// Alignment of the loadable code segments, see elf_options::page_align
+constexpr ELFIO::Elf_Word NT_XRT_PAGE_ALIGN = 7;
+
+// Compact relocations, see compact_reloc.h. Section type in the user
+// range, dynamic tags in the OS specific range.
+constexpr ELFIO::Elf_Word SHT_XRT_CRELA = 0x80000001;
+constexpr ELFIO::Elf_Sxword DT_XRT_CRELA = 0x6ffff100;
+constexpr ELFIO::Elf_Sxword DT_XRT_CRELASZ = 0x6ffff101;
+
 class elf_section
 {
   std::string m_name;
-  std::vector<uint8_t> m_buffer;
+  // section content is not copied here, only into the elf
+  const buffer_view* m_buffer = nullptr;
   int m_type;
   int m_flags;
   int m_version;
@@ -49,7 +74,7 @@ public:
   HEADER_ACCESS_GET_SET(uint64_t, size);
   HEADER_ACCESS_GET_SET(uint64_t, offset);
   HEADER_ACCESS_GET_SET(uint64_t, align);
-  HEADER_ACCESS_GET_SET(std::vector<uint8_t>,  buffer);
+  HEADER_ACCESS_GET_SET(const buffer_view*,  buffer);
   HEADER_ACCESS_GET_SET(std::string, link);
 
 };
@@ -79,22 +104,52 @@ class elf_writer
 {
 protected:
   ELFIO::elfio m_elfio;
-  uid_md5 m_uid;
-
-  ELFIO::section* add_section(elf_section data);
-  ELFIO::segment* add_segment(elf_segment data);
-  ELFIO::string_section_accessor add_dynstr_section();
-  void add_dynsym_section(ELFIO::string_section_accessor* stra, std::vector<symbol>& syms);
-  void add_reldyn_section(std::vector<symbol>& syms);
+  const elf_options m_options;
+  // hashes the code sections, see finalize()
+  std::unique_ptr<uid_hasher> m_uid;
+  // section index -> content, copied into the image by elf_serializer
+  std::map<ELFIO::Elf_Half, const buffer_view*> m_content;
+  // symbol counters of add_sections()
+  assembly_stats m_stats;
+
+  ELFIO::section* add_section(const elf_section& data);
+  ELFIO::segment* add_segment(const elf_segment& data);
+  ELFIO::section* add_dynstr_section();
+  // indices receives the dynsym index of each symbol
+  void add_dynsym_section(ELFIO::section* dstr_sec, const symbol_table& syms,
+                          std::vector<ELFIO::Elf_Word>& indices);
+  // Symbols first .. first+count-1 in relocation order
+  std::vector<uint32_t> relocation_order(const symbol_table& syms, size_t first, size_t count);
+  ELFIO::section* add_reldyn_section(const std::string& name, const symbol_table& syms,
+                                     const std::vector<ELFIO::Elf_Word>& indices,
+                                     const std::vector<uint32_t>& order);
+  void add_reloc_index_note(const std::string& name, const symbol_table& syms,
+                            const std::vector<ELFIO::Elf_Word>& indices,
+                            const std::vector<uint32_t>& order);
+  ELFIO::section* add_compact_reldyn_section(const std::string& name, const symbol_table& syms,
+                                             const std::vector<ELFIO::Elf_Word>& indices,
+                                             const std::vector<uint32_t>& order);
   void add_dynamic_section_segment();
-  std::vector<char> finalize();
-  void add_text_data_section(std::vector<writer>& mwriter, std::vector<symbol>& syms);
-  void add_note(ELFIO::Elf_Word type, std::string name, std::string dec);
+  void add_sections(std::vector<writer>& mwriter);
+  void finalize(const elf_sink& sink);
+  bool finalize(std::vector<char>& image, const std::set<std::string>& unchanged);
+  void write_image(const std::function<char*(elf_serializer&)>& target);
+  void serialize(const elf_sink& sink);
+  ELFIO::section* add_code_section(writer& buffer, const std::string& name);
+  void add_text_data_section(std::vector<writer>& mwriter, symbol_table& syms);
+  ELFIO::section* add_note(ELFIO::Elf_Word type, std::string name, std::string dec);
+  void add_page_align_note();
 
 public:
 
-  elf_writer(unsigned char abi, unsigned char version)
+  elf_writer(unsigned char abi, unsigned char version, const elf_options& options = {})
+    : m_options(options), m_uid(uid_hasher::create(options.uid))
   {
+    const uint32_t page = options.page_align;
+    if (page && (page < align || (page & (page - 1))))
+      throw error(error::error_code::internal_error,
+                  "Page alignment " + std::to_string(page) + " is not a power of two >= " + std::to_string(align) + " !!!");
+
     m_elfio.create(ELFIO::ELFCLASS32, ELFIO::ELFDATA2LSB);
     m_elfio.set_os_abi(abi);
     m_elfio.set_abi_version(version);
@@ -113,7 +168,37 @@ public:
 
   }
 
-  std::vector<char> process(std::vector<writer> mwriter);
+  std::vector<char> process(std::vector<writer>& mwriter);
+
+  // Write the elf into the buffer returned by sink
+  void process(std::vector<writer>& mwriter, const elf_sink& sink);
+
+  // Write the elf over image, the elf of an earlier process() whose
+  // sections named in unchanged had the same content. When the layout is
+  // the same only the other sections and the headers are written, else
+  // image is resized and written in full. Returns true when written in
+  // place.
+  bool process(std::vector<writer>& mwriter, std::vector<char>& image,
+               const std::set<std::string>& unchanged);
+
+  // Symbol counters of the elf written, the BD counters are not set
+  const assembly_stats&
+  get_stats() const
+  {
+    return m_stats;
+  }
+
+  struct bundle_kernel
+  {
+    std::string name;
+    std::vector<writer> sections;
+  };
+
+  // Write the sections of many kernels into one elf. Sections with
+  // identical content are stored once and shared by the kernels using
+  // them. Each kernel has its own relocation section and UID note and a
+  // kernel note mapping its section names to the sections of the bundle.
+  void process_bundle(std::vector<bundle_kernel>& kernels, const elf_sink& sink);
 
   virtual ~elf_writer() = default;
 
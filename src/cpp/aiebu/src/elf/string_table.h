@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_ELF_STRING_TABLE_H_
+#define _AIEBU_ELF_STRING_TABLE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace aiebu {
+
+// ELF string table with tail merging: a string that is a suffix of
+// another one, e.g. "arg" of "scratch-arg", is not stored, it points into
+// the longer string. Offset 0 is the empty string.
+class string_table
+{
+  // strings must stay alive until finalize()
+  std::vector<std::string_view> m_strings;
+  std::vector<uint32_t> m_offsets;
+  std::string m_data{'\0'};
+
+public:
+  // Returns a handle for offset(), duplicates are merged by finalize()
+  uint32_t
+  add(std::string_view str)
+  {
+    m_strings.push_back(str);
+    return static_cast<uint32_t>(m_strings.size() - 1);
+  }
+
+  void
+  finalize()
+  {
+    // Sorted by reversed string, longest first, each string is either a
+    // suffix of the string emitted just before it or is emitted itself
+    std::vector<uint32_t> order(m_strings.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+      const auto& sa = m_strings[a];
+      const auto& sb = m_strings[b];
+      return std::lexicographical_compare(sb.rbegin(), sb.rend(), sa.rbegin(), sa.rend());
+    });
+
+    m_offsets.assign(m_strings.size(), 0);
+    std::string_view last;
+    uint32_t last_offset = 0;
+    for (auto i : order) {
+      const auto& str = m_strings[i];
+      if (str.empty())
+        continue;
+      if (str.size() <= last.size() && last.compare(last.size() - str.size(), str.size(), str) == 0) {
+        m_offsets[i] = last_offset + static_cast<uint32_t>(last.size() - str.size());
+        continue;
+      }
+      last = str;
+      last_offset = static_cast<uint32_t>(m_data.size());
+      m_offsets[i] = last_offset;
+      m_data.append(str.data(), str.size());
+      m_data += '\0';
+    }
+  }
+
+  // Offset of the string added as handle, valid after finalize()
+  uint32_t
+  offset(uint32_t handle) const
+  {
+    return m_offsets[handle];
+  }
+
+  const std::string&
+  data() const
+  {
+    return m_data;
+  }
+};
+
+}
+#endif //_AIEBU_ELF_STRING_TABLE_H_
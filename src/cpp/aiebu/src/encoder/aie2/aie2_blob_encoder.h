@@ -22,7 +22,7 @@ public:
     auto rinput = std::static_pointer_cast<aie2_blob_preprocessed_output>(input);
     std::vector<writer> rwriter;
 
-    for(auto key : rinput->get_keys())
+    for(const auto& key : rinput->get_keys())
       if ( !key.compare(".ctrltext") )
         rwriter.emplace_back(key, code_section::text, rinput->get_data(key));
       else
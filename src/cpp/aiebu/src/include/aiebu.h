@@ -23,7 +23,8 @@ enum aiebu_error_code {
   aiebu_invalid_batch_buffer_type,
   aiebu_invalid_buffer_type,
   aiebu_invalid_offset,
-  aiebu_invalid_internal_error
+  aiebu_invalid_internal_error,
+  aiebu_invalid_buffer_size
 };
 
 enum aiebu_assembler_buffer_type {
@@ -39,10 +40,17 @@ struct pm_ctrlpkt {
   size_t pm_buffer_size;
 };
 
+/*
+ * Allocator used by aiebu_assembler_get_elf_alloc. Called once with the
+ * exact elf size, returns the buffer elf is written to or NULL on failure.
+ */
+typedef void* (*aiebu_elf_allocator)(size_t size, void* user_data);
+
 /*
  * This API takes buffer type, 2 buffers, their sizes and external_buffer_id json
  * it also allocate elf_buf and It fill elf content in it.
  * return, on success return return elf size, else posix error(negative).
+ * On error elf_buf is set to NULL, nothing is left allocated.
  * User may pass any combination like
  * 1. type as aiebu_assembler_buffer_type_blob_instr_transaction, buffer1 as instruction buffer
  *    and buffer2 as control_packet: in this case it will package buffers in text and data
@@ -78,6 +86,99 @@ aiebu_assembler_get_elf(enum aiebu_assembler_buffer_type type,
                         struct pm_ctrlpkt* pm_ctrlpkts,
                         size_t pm_ctrlpkt_size);
 
+/*
+ * Same as aiebu_assembler_get_elf but elf is written directly into memory
+ * returned by the caller's allocator, e.g. a pinned or BO backed buffer,
+ * instead of being copied into a malloc'ed buffer.
+ * return, on success return elf size, else posix error(negative).
+ * If allocator is NULL -EINVAL is returned, if it returns NULL
+ * -aiebu_invalid_buffer_size is returned.
+ *
+ * @allocator           called once with elf size
+ * @user_data           passed to allocator as is
+ * Rest of the arguments are same as aiebu_assembler_get_elf
+ */
+DRIVER_DLLESPEC
+int
+aiebu_assembler_get_elf_alloc(enum aiebu_assembler_buffer_type type,
+                              const char* buffer1,
+                              size_t buffer1_size,
+                              const char* buffer2,
+                              size_t buffer2_size,
+                              aiebu_elf_allocator allocator,
+                              void* user_data,
+                              const char* patch_json,
+                              size_t patch_json_size,
+                              const char* libs,
+                              const char* libpaths,
+                              struct pm_ctrlpkt* pm_ctrlpkts,
+                              size_t pm_ctrlpkt_size);
+
+/*
+ * Same as aiebu_assembler_get_elf but elf is written into caller owned buffer.
+ * Call with elf_buf as NULL to query elf size, nothing is written in that case.
+ * return, on success return elf size, else posix error(negative).
+ * If elf_buf_size is smaller than elf size -aiebu_invalid_buffer_size is
+ * returned and elf_buf is left untouched.
+ *
+ * @elf_buf             caller owned buffer or NULL for size query
+ * @elf_buf_size        size of elf_buf
+ * Rest of the arguments are same as aiebu_assembler_get_elf
+ */
+DRIVER_DLLESPEC
+int
+aiebu_assembler_get_elf_to_buffer(enum aiebu_assembler_buffer_type type,
+                                  const char* buffer1,
+                                  size_t buffer1_size,
+                                  const char* buffer2,
+                                  size_t buffer2_size,
+                                  void* elf_buf,
+                                  size_t elf_buf_size,
+                                  const char* patch_json,
+                                  size_t patch_json_size,
+                                  const char* libs,
+                                  const char* libpaths,
+                                  struct pm_ctrlpkt* pm_ctrlpkts,
+                                  size_t pm_ctrlpkt_size);
+
+/*
+ * One job of aiebu_assembler_batch_get_elf. Inputs are same as arguments
+ * of aiebu_assembler_get_elf. On return elf_size holds elf size on success,
+ * else posix error(negative). On success elf_buf is allocated with malloc
+ * and must be freed by the caller.
+ */
+struct aiebu_assembler_job {
+  enum aiebu_assembler_buffer_type type;
+  const char* buffer1;
+  size_t buffer1_size;
+  const char* buffer2;
+  size_t buffer2_size;
+  const char* patch_json;
+  size_t patch_json_size;
+  const char* libs;
+  const char* libpaths;
+  struct pm_ctrlpkt* pm_ctrlpkts;
+  size_t pm_ctrlpkt_size;
+  void* elf_buf;
+  int elf_size;
+};
+
+/*
+ * This API assembles num_jobs independent jobs concurrently.
+ * return, number of failed jobs, per job status is in elf_size of each job.
+ * When the batch itself fails posix error(negative) is returned and no
+ * job has an elf_buf.
+ *
+ * @jobs                array of jobs
+ * @num_jobs            size of jobs array
+ * @num_workers         number of worker threads, 0 uses hardware concurrency
+ */
+DRIVER_DLLESPEC
+int
+aiebu_assembler_batch_get_elf(struct aiebu_assembler_job* jobs,
+                              size_t num_jobs,
+                              unsigned int num_workers);
+
 #ifdef __cplusplus
 }
 #endif
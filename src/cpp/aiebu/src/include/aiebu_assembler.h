@@ -9,6 +9,7 @@
 #include <vector>
 #include <iostream>
 #include <map>
+#include <memory>
 
 #if defined(_WIN32)
 #define DRIVER_DLLESPEC __declspec(dllexport)
@@ -18,10 +19,104 @@
 
 namespace aiebu {
 
+class assembly_cache;
+class assembler_session;
+
+// Non-owning view of a caller owned buffer, e.g. a memory mapped file
+
+struct const_buffer {
+  const char* data = nullptr;
+  size_t size = 0;
+
+  const_buffer() = default;
+  const_buffer(const char* d, size_t s) : data(d), size(s) {}
+  const_buffer(const std::vector<char>& v) : data(v.data()), size(v.size()) {}
+};
+
+// Output of aiebu_assembler::get_report()
+enum class report_format { text, json, csv };
+
+// Optional elf encodings, the defaults give the standard elf
+
+struct elf_options {
+  // Relocations are written to a compact .rela.compact section, runs of
+  // equally spaced patch sites grouped by symbol, instead of one RELA
+  // entry each in .rela.dyn. Only for loaders that support it.
+  bool compact_relocations = false;
+
+  // Control code sections are stored zlib compressed (SHF_COMPRESSED)
+  // and are not loadable segments, a loader decompresses them. Needs
+  // the library built with zlib.
+  bool compress_sections = false;
+
+  // Hash of the content in the .note.xrt.UID note. md5 is what existing
+  // loaders expect. xxh3_128 is several times faster, its note reads
+  // "xxh3_128:<hex>".
+  enum class uid_algorithm { md5, xxh3_128 };
+  uid_algorithm uid = uid_algorithm::md5;
+
+  // When not 0, the loadable control code segments start at multiples of
+  // this alignment in the file, e.g. 4096 so a runtime can mmap them
+  // without a copy. Power of two, at least 16. Recorded in the
+  // .note.xrt.page_align note.
+  uint32_t page_align = 0;
+};
+
+// Counters of one assembly, for tools and tests
+struct assembly_stats {
+  // BD writes found in the control code, and those a patch op refers to
+  uint32_t bd_writes_indexed = 0;
+  uint32_t bd_writes_patched = 0;
+  // relocated symbols, and approximate heap bytes of their table
+  uint64_t symbols = 0;
+  uint64_t symbol_memory = 0;
+};
+
+// Cache of assembled elfs, shared by all assemblers it is passed to.
+// Identical inputs are looked up by a hash of all inputs and the library
+// version and are returned without assembling again.
+
+class aiebu_assembler_cache {
+  std::shared_ptr<assembly_cache> m_cache;
+  friend class aiebu_assembler;
+
+  public:
+    struct stats {
+      uint64_t memory_hits = 0;
+      uint64_t disk_hits = 0;
+      uint64_t misses = 0;
+    };
+
+    /*
+     * @max_memory_bytes  size limit of elfs kept in memory
+     * @disk_dir          directory of elfs kept on disk, empty disables disk store.
+     *                    Library builds without a build id never use the disk store.
+     * @max_disk_bytes    size limit of disk_dir, 0 for no limit
+     */
+    DRIVER_DLLESPEC
+    explicit
+    aiebu_assembler_cache(size_t max_memory_bytes = 64 * 1024 * 1024,
+                          const std::string& disk_dir = "",
+                          uint64_t max_disk_bytes = 1024 * 1024 * 1024);
+
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    stats
+    get_stats() const;
+
+    /*
+     * Drops elfs kept in memory and resets stats, disk store is kept
+     */
+    DRIVER_DLLESPEC
+    void
+    clear();
+};
+
 // Assembler Class
 
 class aiebu_assembler {
   std::vector<char> elf_data;
+  assembly_stats m_stats;
 
   public:
 
@@ -66,6 +161,38 @@ class aiebu_assembler {
                const std::vector<std::string>& libpaths = {},
                const std::map<uint8_t, std::vector<char> >& pm_ctrlpkt = {});
 
+    /*
+     * Same as above but buffers are referenced, not copied, and must be
+     * alive while the constructor runs.
+     *
+     * @options        optional elf encodings
+     */
+     DRIVER_DLLESPEC
+     aiebu_assembler(buffer_type type,
+               const_buffer buffer1,
+               const_buffer buffer2,
+               const_buffer patch_json,
+               const std::vector<std::string>& libs,
+               const std::vector<std::string>& libpaths,
+               const std::map<uint8_t, const_buffer>& pm_ctrlpkt,
+               const elf_options& options = {});
+
+    /*
+     * Same as above, elf is looked up in cache first and added to
+     * cache when it had to be assembled.
+     *
+     * @cache          cache to use
+     */
+     DRIVER_DLLESPEC
+     aiebu_assembler(aiebu_assembler_cache& cache,
+               buffer_type type,
+               const std::vector<char>& buffer1,
+               const std::vector<char>& buffer2,
+               const std::vector<char>& patch_json,
+               const std::vector<std::string>& libs = {},
+               const std::vector<std::string>& libpaths = {},
+               const std::map<uint8_t, std::vector<char> >& pm_ctrlpkt = {});
+
     /*
      * Constructor takes buffer type, buffer,
      * and a vector of symbols with their patching information as argument.
@@ -100,11 +227,210 @@ class aiebu_assembler {
     std::vector<char>
     get_elf() const;
 
+    /*
+     * Same as get_elf() without a copy, valid while this object is alive.
+     */
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    const_buffer
+    get_elf_buffer() const;
+
+    /*
+     * Counters of the assembly. An elf from a cache has the counters of
+     * the assembly that added it.
+     */
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    assembly_stats
+    get_stats() const;
+
     DRIVER_DLLESPEC
     void
     get_report(std::ostream &stream) const;
+
+    /*
+     * Same as above, written to a file descriptor which is not closed.
+     * The report is formatted through a fixed size buffer, memory used
+     * does not grow with the size of the elf.
+     */
+    DRIVER_DLLESPEC
+    void
+    get_report(int fd) const;
+
+    /*
+     * Report in the given format, json and csv carry the summary of
+     * aiebu::make_report() (aiebu_report.h), text is the report above.
+     */
+    DRIVER_DLLESPEC
+    void
+    get_report(std::ostream &stream, report_format format) const;
 };
 
+// Assembles many independent control code sets concurrently
+
+class aiebu_assembler_batch {
+  const unsigned int m_num_workers;
+
+  public:
+    /*
+     * One assembly job, same arguments as aiebu_assembler constructor.
+     * Buffers are referenced, not copied, the caller keeps them alive
+     * until the jobs have run.
+     */
+    struct job {
+      aiebu_assembler::buffer_type type;
+      const_buffer buffer1;
+      const_buffer buffer2;
+      const_buffer patch_json;
+      std::vector<std::string> libs;
+      std::vector<std::string> libpaths;
+      std::map<uint8_t, const_buffer> pm_ctrlpkt;
+      elf_options options;
+    };
+
+    /*
+     * Outcome of one job. On success elf holds elf content and
+     * error_code is 0, else error_code is aiebu_error_code and
+     * message has the error description.
+     */
+    struct result {
+      std::vector<char> elf;
+      assembly_stats stats;
+      int error_code = 0;
+      std::string message;
+    };
+
+    /*
+     * @num_workers    number of worker threads, 0 uses hardware concurrency
+     */
+    DRIVER_DLLESPEC
+    explicit
+    aiebu_assembler_batch(unsigned int num_workers = 0);
+
+    /*
+     * Assemble all jobs, returns one result per job in job order.
+     * Errors of a job are reported in its result, never thrown.
+     */
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    std::vector<result>
+    run(const std::vector<job>& jobs) const;
+};
+
+// Packs the control code of many kernels into one elf. Sections with
+// identical content, e.g. the preempt libs or a pm control packet used by
+// several kernels, are stored once. Each kernel has its own relocation
+// section, UID note and a kernel note listing its sections.
+
+class aiebu_assembler_bundle {
+  std::vector<char> elf_data;
+
+  public:
+    /*
+     * One kernel of the bundle, name must be unique and is appended to
+     * the names of its sections. Options of the job are not used, the
+     * options of the bundle apply to the whole elf.
+     */
+    struct kernel {
+      std::string name;
+      aiebu_assembler_batch::job job;
+    };
+
+    /*
+     * its throws aiebu::error object.
+     *
+     * @kernels        kernels to pack, in elf order
+     * @options        optional elf encodings
+     */
+    DRIVER_DLLESPEC
+    explicit
+    aiebu_assembler_bundle(const std::vector<kernel>& kernels,
+                           const elf_options& options = {});
+
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    std::vector<char>
+    get_elf() const;
+
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    const_buffer
+    get_elf_buffer() const;
+};
+
+// Assembles one control code again with changing patch metadata and
+// control packets, e.g. in a tuning loop. The instruction buffer and libs
+// are walked for patch sites once. Later updates whose patch metadata
+// names the same buffers, with the same pm control packet ids, only redo
+// the patch dependent parts and rewrite the elf of the previous update in
+// place. The elf of an update is the same as aiebu_assembler gives.
+
+class aiebu_assembler_session {
+  std::unique_ptr<assembler_session> m_impl;
+
+  public:
+    /*
+     * its throws aiebu::error object.
+     *
+     * @type           buffer type
+     * @buffer1        instruction buffer, referenced not copied, must be
+     *                 alive as long as the session
+     * @libs           libs to include in elf
+     * @libpaths       paths to search for libs
+     * @options        optional elf encodings
+     */
+    DRIVER_DLLESPEC
+    aiebu_assembler_session(aiebu_assembler::buffer_type type,
+                            const_buffer buffer1,
+                            const std::vector<std::string>& libs = {},
+                            const std::vector<std::string>& libpaths = {},
+                            const elf_options& options = {});
+
+    DRIVER_DLLESPEC
+    ~aiebu_assembler_session();
+
+    /*
+     * Assemble buffer1 with these inputs, same as the aiebu_assembler
+     * arguments. They are referenced while update runs.
+     * its throws aiebu::error object.
+     *
+     * return: true when the previous elf was rewritten in place
+     */
+    DRIVER_DLLESPEC
+    bool
+    update(const_buffer patch_json,
+           const_buffer buffer2 = {},
+           const std::map<uint8_t, const_buffer>& pm_ctrlpkt = {});
+
+    /*
+     * Elf of the last update, valid until the next update.
+     */
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    const_buffer
+    get_elf_buffer() const;
+
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    std::vector<char>
+    get_elf() const;
+};
+
+/*
+ * Converts a patch json (aiecompiler external_buffers or dmacompiler
+ * ctrl_pkt_patch_info) to the binary patch metadata format. The result
+ * can be passed as patch_json to aiebu_assembler and is used without
+ * parsing. its throws aiebu::error object.
+ *
+ * @patch_json     external_buffer_id json
+ *
+ * return: vector of char with binary patch metadata
+ */
+[[nodiscard]]
+DRIVER_DLLESPEC
+std::vector<char>
+aiebu_patch_metadata_from_json(const_buffer patch_json);
+
 } //namespace aiebu
 
 #endif // _AIEBU_ASSEMBLER_H_
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_ELF_VIEW_H_
+#define _AIEBU_ELF_VIEW_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aiebu_assembler.h"
+
+namespace aiebu {
+
+// Read only view of an elf written by aiebu, 32 bit little endian.
+// Opening checks the elf header only and copies nothing. Section,
+// segment and symbol entries, names, relocations and notes are decoded
+// from the image when accessed, so the cost of an inspection is what it
+// looks at. Names and data point into the image and are valid while a
+// view on it is alive.
+
+class elf_view {
+  struct image;
+  std::shared_ptr<const image> m_image;
+
+  void open(std::shared_ptr<image> img);
+
+  public:
+    struct section {
+      uint16_t index;
+      std::string_view name;
+      uint32_t type;
+      uint32_t flags;
+      uint32_t addr;
+      uint32_t offset;
+      uint32_t size;
+      uint32_t link;
+      uint32_t info;
+      uint32_t addralign;
+      uint32_t entsize;
+      // raw content in the image, nullptr for SHT_NOBITS
+      const char* data;
+    };
+
+    struct segment {
+      uint32_t type;
+      uint32_t offset;
+      uint32_t vaddr;
+      uint32_t paddr;
+      uint32_t filesz;
+      uint32_t memsz;
+      uint32_t flags;
+      uint32_t align;
+    };
+
+    struct symbol {
+      std::string_view name;
+      uint32_t value;
+      uint32_t size;
+      uint8_t bind;
+      uint8_t type;
+      uint16_t shndx;
+    };
+
+    struct relocation {
+      uint64_t offset;
+      uint32_t symbol;
+      uint32_t type;
+      int64_t addend;
+    };
+
+    struct note {
+      uint32_t type;
+      std::string_view name;
+      const_buffer desc;
+    };
+
+    /*
+     * View of an elf in memory, referenced not copied, it must be alive
+     * as long as the view. its throws aiebu::error object.
+     */
+    DRIVER_DLLESPEC
+    explicit
+    elf_view(const_buffer elf);
+
+    /*
+     * View of an elf file, the file is memory mapped not read.
+     * its throws aiebu::error object.
+     */
+    DRIVER_DLLESPEC
+    explicit
+    elf_view(const std::string& filename);
+
+    [[nodiscard]] DRIVER_DLLESPEC const_buffer get_buffer() const;
+
+    // elf header
+    [[nodiscard]] DRIVER_DLLESPEC uint16_t get_type() const;
+    [[nodiscard]] DRIVER_DLLESPEC uint16_t get_machine() const;
+    [[nodiscard]] DRIVER_DLLESPEC uint8_t get_os_abi() const;
+    [[nodiscard]] DRIVER_DLLESPEC uint8_t get_abi_version() const;
+    [[nodiscard]] DRIVER_DLLESPEC uint32_t get_flags() const;
+    [[nodiscard]] DRIVER_DLLESPEC uint32_t get_entry() const;
+
+    [[nodiscard]] DRIVER_DLLESPEC size_t num_sections() const;
+
+    [[nodiscard]] DRIVER_DLLESPEC section get_section(size_t index) const;
+
+    // First section of this name, looked up by a scan of the headers
+    [[nodiscard]] DRIVER_DLLESPEC std::optional<section> find_section(std::string_view name) const;
+
+    [[nodiscard]] DRIVER_DLLESPEC size_t num_segments() const;
+
+    [[nodiscard]] DRIVER_DLLESPEC segment get_segment(size_t index) const;
+
+    /*
+     * Content of a section. Points into the image, unless the section is
+     * SHF_COMPRESSED, then it is decompressed into storage.
+     */
+    [[nodiscard]]
+    DRIVER_DLLESPEC
+    const_buffer
+    get_content(const section& sec, std::vector<char>& storage) const;
+
+    // Entries of a SHT_SYMTAB or SHT_DYNSYM section
+    [[nodiscard]] DRIVER_DLLESPEC size_t num_symbols(const section& symtab) const;
+
+    [[nodiscard]] DRIVER_DLLESPEC symbol get_symbol(const section& symtab, size_t index) const;
+
+    /*
+     * Relocations of a SHT_RELA or compact relocation section in section
+     * order, decoded one at a time. its throws aiebu::error object.
+     */
+    DRIVER_DLLESPEC
+    void
+    for_each_relocation(const section& rel, const std::function<void(const relocation&)>& func) const;
+
+    // Notes of a SHT_NOTE section in section order
+    DRIVER_DLLESPEC
+    void
+    for_each_note(const section& notes, const std::function<void(const note&)>& func) const;
+};
+
+}
+
+#endif
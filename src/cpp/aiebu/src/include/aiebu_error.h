@@ -26,7 +26,8 @@ public:
     invalid_patch_buffer_type = aiebu_invalid_batch_buffer_type,
     invalid_buffer_type = aiebu_invalid_buffer_type,
     invalid_offset = aiebu_invalid_offset,
-    internal_error = aiebu_invalid_internal_error
+    internal_error = aiebu_invalid_internal_error,
+    invalid_buffer_size = aiebu_invalid_buffer_size
   };
 
   DRIVER_DLLESPEC
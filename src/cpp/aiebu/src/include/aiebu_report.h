@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_REPORT_H_
+#define _AIEBU_REPORT_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "aiebu_elf_view.h"
+
+namespace aiebu {
+
+// Machine readable summary of an elf, what aiebu_assembler::get_report()
+// writes as json or csv. Meant for tracking control code size and op mix
+// across releases.
+struct elf_report {
+  // ops of one opcode
+  struct op {
+    std::string name;
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+  };
+
+  struct section {
+    uint16_t index = 0;
+    std::string name;
+    uint32_t type = 0;
+    uint32_t flags = 0;
+    // size in the elf, and once decompressed when SHF_COMPRESSED
+    uint32_t size = 0;
+    uint32_t content_size = 0;
+    // control code only: "legacy" or "opt" transaction header, and the
+    // ops of each opcode that occurs, in opcode order
+    std::string txn_format;
+    std::vector<op> ops;
+  };
+
+  // relocations of one symbol and patch schema in a relocation section
+  struct relocation {
+    std::string section;
+    std::string symbol;
+    std::string schema;
+    uint64_t count = 0;
+  };
+
+  std::string uid;
+  std::vector<section> sections;
+  // over all control code sections
+  std::vector<op> ops;
+  std::vector<relocation> relocations;
+};
+
+/*
+ * Decodes the summary of an elf. its throws aiebu::error object.
+ */
+[[nodiscard]]
+DRIVER_DLLESPEC
+elf_report
+make_report(const elf_view& elf);
+
+/*
+ * One json object with the members of elf_report.
+ */
+DRIVER_DLLESPEC
+void
+write_json(const elf_report& report, std::ostream& stream);
+
+/*
+ * One row per value, columns record,section,name,schema,value. record
+ * is uid, section_size, content_size, op_count, op_bytes or relocations,
+ * the section is empty for totals over the elf. The uid row has the uid
+ * in the name column and no value.
+ */
+DRIVER_DLLESPEC
+void
+write_csv(const elf_report& report, std::ostream& stream);
+
+// Device side cost, in ns, of the ops of a transaction. The built in
+// tables are rough figures for the command processor of each device, a
+// static estimate is meant to catch regressions, not to predict the
+// run time of a kernel.
+struct cost_table {
+  std::string device;
+  double write_ns = 0;            // WRITE
+  double mask_write_ns = 0;       // MASKWRITE, read modify write
+  double block_write_ns = 0;      // BLOCKWRITE, per op
+  double block_write_byte_ns = 0; // BLOCKWRITE, per payload byte
+  double mask_poll_ns = 0;        // MASKPOLL(_BUSY), one round trip
+  double dma_byte_ns = 0;         // per byte of the buffer a BD describes
+  double tct_ns = 0;              // TCT wait
+  double merge_sync_ns = 0;       // MERGE_SYNC wait
+  double ddr_patch_ns = 0;        // DDR_PATCH
+  double other_ns = 0;            // any other op
+
+  /*
+   * Table of a device, "phx" or "stx".
+   * its throws aiebu::error object.
+   */
+  DRIVER_DLLESPEC
+  static cost_table
+  get(const std::string& device);
+
+  /*
+   * Table from a json object with the members above, those not given
+   * are taken from the table of the device named by "base", phx when
+   * there is none. its throws aiebu::error object.
+   */
+  DRIVER_DLLESPEC
+  static cost_table
+  from_json(const_buffer json);
+};
+
+struct cost_estimate {
+  // location of a MASKPOLL
+  struct poll {
+    uint32_t op = 0;
+    uint32_t offset = 0;
+    uint32_t reg = 0;
+  };
+
+  struct section {
+    std::string name;
+    uint64_t writes = 0;            // WRITE and MASKWRITE ops
+    uint64_t block_write_bytes = 0; // BLOCKWRITE payload
+    uint64_t dma_bytes = 0;         // buffer lengths written to BDs
+    uint64_t tct_waits = 0;
+    uint64_t merge_sync_waits = 0;
+    std::vector<poll> mask_polls;
+    double ns = 0;
+  };
+
+  // Ops up to and including a wait (TCT, MERGE_SYNC or MASKPOLL), or
+  // up to the end of the section
+  struct region {
+    std::string section;
+    uint32_t first_op = 0;
+    uint32_t num_ops = 0;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    double ns = 0;
+  };
+
+  std::string device;
+  std::vector<section> sections;
+  // the most expensive regions over all sections, most expensive first
+  std::vector<region> top_regions;
+  double ns = 0;
+};
+
+/*
+ * Static cost of the control code of an elf, with the top_n most
+ * expensive regions. its throws aiebu::error object.
+ */
+[[nodiscard]]
+DRIVER_DLLESPEC
+cost_estimate
+estimate_cost(const elf_view& elf, const cost_table& table, size_t top_n = 10);
+
+/*
+ * Predicted latency, the counters of each section and the top regions
+ * as text.
+ */
+DRIVER_DLLESPEC
+void
+write_text(const cost_estimate& estimate, std::ostream& stream);
+
+// Differences between an old and a new elf, or transaction buffer. The
+// ops of control code present in both are aligned on opcode and register
+// address, an aligned pair whose fields differ is changed. Fields are
+// compared decoded, so buffers in different header formats compare.
+struct elf_diff {
+  struct op {
+    uint32_t index = 0;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    std::string name;
+    uint32_t reg = 0;   // register address, 0 for ops without one
+    uint32_t value = 0; // value written or polled for
+  };
+
+  enum class kind { inserted, removed, changed };
+
+  struct change {
+    kind type = kind::changed;
+    std::string section;
+    op old_op; // not set when inserted
+    op new_op; // not set when removed
+  };
+
+  // count and bytes of ops of one opcode, new minus old
+  struct op_delta {
+    std::string name;
+    int64_t count = 0;
+    int64_t bytes = 0;
+  };
+
+  struct section {
+    std::string name;
+    bool in_old = false;
+    bool in_new = false;
+    uint32_t old_size = 0;
+    uint32_t new_size = 0;
+    // control code only
+    std::string old_format;
+    std::string new_format;
+    uint64_t old_ops = 0;
+    uint64_t new_ops = 0;
+    uint64_t inserted = 0;
+    uint64_t removed = 0;
+    uint64_t changed = 0;
+    uint64_t unchanged = 0;
+    std::vector<op_delta> ops;
+  };
+
+  // relocations of one symbol and patch schema whose count differs
+  struct relocation {
+    std::string section;
+    std::string symbol;
+    std::string schema;
+    uint64_t old_count = 0;
+    uint64_t new_count = 0;
+  };
+
+  std::string old_uid;
+  std::string new_uid;
+  // old sections in order, then those only in new
+  std::vector<section> sections;
+  std::vector<relocation> relocations;
+  // in section and op order, the first max_changes only
+  std::vector<change> changes;
+};
+
+/*
+ * Diff of two elfs, sections are matched by name. Alignment is a
+ * shortest edit script, time grows with the number of ops times the
+ * number of differences. its throws aiebu::error object.
+ */
+[[nodiscard]]
+DRIVER_DLLESPEC
+elf_diff
+diff(const elf_view& old_elf, const elf_view& new_elf, size_t max_changes = 1000);
+
+/*
+ * Diff of two transaction buffers, reported as one section "txn".
+ * its throws aiebu::error object.
+ */
+[[nodiscard]]
+DRIVER_DLLESPEC
+elf_diff
+diff_transaction(const_buffer old_txn, const_buffer new_txn, size_t max_changes = 1000);
+
+/*
+ * Section, op count and relocation deltas, then the changed ops as text.
+ */
+DRIVER_DLLESPEC
+void
+write_text(const elf_diff& diff, std::ostream& stream);
+
+}
+
+#endif
@@ -5,7 +5,9 @@
 #define _AIEBU_PREPROCESSOR_AIE2_BLOB_PREPROCESSED_OUTPUT_H_
 
 #include <string>
+#include <unordered_map>
 #include "symbol.h"
+#include "buffer_view.h"
 #include "preprocessed_output.h"
 
 namespace aiebu {
@@ -13,28 +15,23 @@ namespace aiebu {
 class aie2_blob_preprocessed_output : public preprocessed_output
 {
 
-  std::unordered_map<std::string, std::vector<uint8_t>> m_data;
-  std::vector<symbol> m_sym;
+  std::unordered_map<std::string, buffer_view> m_data;
+  symbol_table m_sym;
 
 public:
   aie2_blob_preprocessed_output() {}
 
-  std::vector<symbol>& get_symbols()
+  symbol_table& get_symbols()
   {
     return m_sym;
   }
 
-  void add_data(const std::string& name, const std::vector<uint8_t>& buf)
+  void add_data(const std::string& name, buffer_view&& buf)
   {
-    m_data[name] = buf;
+    m_data[name] = std::move(buf);
   }
 
-  void add_symbol(const symbol buf)
-  {
-    m_sym.emplace_back(buf);
-  }
-
-  void add_symbols(std::vector<symbol>& syms)
+  void add_symbols(symbol_table& syms)
   {
     m_sym = std::move(syms);
   }
@@ -47,12 +44,12 @@ public:
     return keys;
   }
 
-  std::vector<uint8_t>& get_data(std::string& key)
+  buffer_view& get_data(const std::string& key)
   {
     auto it = m_data.find(key);
     if (it == m_data.end())
       throw error(error::error_code::internal_error, "Key (" + key + ") not found!!!");
-    return m_data[key];
+    return it->second;
   }
 };
 
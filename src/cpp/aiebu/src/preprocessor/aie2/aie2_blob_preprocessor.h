@@ -16,15 +16,6 @@ class aie2_blob_preprocessor: public preprocessor
 public:
   aie2_blob_preprocessor() {}
 
-  std::vector<uint8_t> transform(const std::vector<char>& in)
-  {
-    // transform vector<char> to vector<uint8_t>
-    std::vector<uint8_t> out;
-    out.resize(in.size());
-    std::transform(in.begin(), in.end(), out.begin(), [](char c) {return static_cast<uint8_t>(c);});
-    return out;
-  }
-
   virtual std::shared_ptr<preprocessed_output>
   process(std::shared_ptr<preprocessor_input> input) override
   {
@@ -32,8 +23,9 @@ public:
     auto rinput = std::static_pointer_cast<aie2_blob_preprocessor_input>(input);
     auto routput = std::make_shared<aie2_blob_preprocessed_output>();
 
-    for(auto key : rinput->get_keys())
-      routput->add_data(key, transform(rinput->get_data(key)));
+    // hand over the views, buffer content is copied only once into the elf
+    for(const auto& key : rinput->get_keys())
+      routput->add_data(key, std::move(rinput->get_data(key)));
 
     routput->add_symbols(rinput->get_symbols());
     return routput;
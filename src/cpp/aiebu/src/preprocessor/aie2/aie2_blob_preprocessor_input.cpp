@@ -1,621 +1,323 @@
 // SPDX-License-Identifier: MIT
 // Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
 
+#include <cstring>
+#include <iterator>
 #include "aie2_blob_preprocessor_input.h"
 #include "xaiengine.h"
+#include "txn_cursor.h"
+#include "bd_index.h"
 
 namespace aiebu {
 
 
-  /*
-  sample json
-  {
-      "external_buffers": {
-          "buffer0": {
-              "xrt_id": 1,
-              "size_in_bytes": 345088,
-              "name": "coalesed_weights",
-              "coalesed_buffers": [
-                  {
-                      "logical_id": 0,
-                      "offset_in_bytes": 0,
-                      "name": "compute_graph.resnet_layers[0].wts_ddr",
-                      "control_packet_patch_locations": [
-                          {
-                              "offset": 17420,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 17484,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 17548,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 17612,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          }
-                      ]
-                  },
-                  {
-                      "logical_id": 1,
-                      "offset_in_bytes": 37888,
-                      "name": "compute_graph.resnet_layers[1].wts_ddr",
-                      "control_packet_patch_locations": [
-                          {
-                              "offset": 19404,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 19468,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 19532,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 19596,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          }
-                      ]
-                  },
-                  {
-                      "logical_id": 2,
-                      "offset_in_bytes": 195584,
-                      "name": "compute_graph.resnet_layers[2].wts_ddr",
-                      "control_packet_patch_locations": [
-                          {
-                              "offset": 40012,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 40076,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 40140,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          },
-                          {
-                              "offset": 40204,
-                              "size": 6,
-                              "operation": "read_add_write"
-                          }
-                      ]
-                  }
-              ]
-          },
-          "buffer1": {
-              "xrt_id": 2,
-              "logical_id": 3,
-              "size_in_bytes": 802816,
-              "name": "compute_graph.ifm_ddr",
-              "control_packet_patch_locations": [
-                  {
-                      "offset": 12,
-                      "size": 6,
-                      "operation": "read_add_write"
-                  },
-                  {
-                      "offset": 76,
-                      "size": 6,
-                      "operation": "read_add_write"
-                  }
-              ]
-          },
-          "buffer2": {
-              "xrt_id": 3,
-              "logical_id": 4,
-              "size_in_bytes": 458752,
-              "name": "compute_graph.ofm_ddr",
-              "control_packet_patch_locations": [
-                  {
-                      "offset": 60428,
-                      "size": 6,
-                      "operation": "read_add_write"
-                  },
-                  {
-                      "offset": 60492,
-                      "size": 6,
-                      "operation": "read_add_write"
-                  }
-              ]
-          },
-          "buffer3": {
-              "xrt_id": 0,
-              "logical_id": -1,
-              "size_in_bytes": 60736,
-              "ctrl_pkt_buffer": 1,
-              "name": "runtime_control_packet"
-          }
-      }
-  }
-  */
-
   void
   aie2_blob_preprocessor_input::
-  validate_json(uint32_t offset, uint32_t size, uint32_t arg_index, offset_type type) const {
-    // Return if the offset and arg_index are within their respective sizes.
-    if ((offset <= size) && (arg_index <= MAX_ARG_INDEX)) {
-      return;
-    }
-    std::string errorMessage;
-    if (offset > size ) {
-      errorMessage = std::string("INVALID JSON: Offset(")
-      + std::to_string(offset)
-      + ") is greater than size("
-      + std::to_string(size)
-      + ") for offset Type: "
-      + (type == offset_type::CONTROL_PACKET ? "CONTROL PACKET" : "BUFFER")
-      + " and arg index is "
-      + (arg_index > MAX_ARG_INDEX ? "INVALID = " : "VALID = ")
-      + std::to_string(arg_index) + ". ";
-    }
-    else {
-      errorMessage = std::string("INVALID JSON: arg index (")
-      + std::to_string(arg_index)
-      + ") is greater than Max arg index ="
-      + std::to_string(MAX_ARG_INDEX)
-      + ". ";
+  add_patch_metadata(const patch_metadata::view& metadata)
+  {
+    for (size_t i = 0; i < metadata.num_buffers; ++i)
+    {
+      // added ARG_OFFSET to argidx to match with kernel argument index in xclbin
+      const auto& buffer = metadata.buffers[i];
+      if (buffer.flags & patch_metadata::buffer_flag_control_packet)
+        xrt_id_map.insert({buffer.xrt_id, "control-packet"});
+      else
+        xrt_id_map.insert({buffer.xrt_id, std::to_string(buffer.xrt_id + ARG_OFFSET)});
     }
-    throw error(error::error_code::invalid_asm, errorMessage);
-  }
 
-  void
-  aie2_blob_preprocessor_input::
-  extract_coalesed_buffers(const std::string& name,
-                           const boost::property_tree::ptree& pt)
-  {
-    uint32_t buffer_size = pt.get<uint32_t>("size_in_bytes");
-    const auto coalesed_buffers_pt = pt.get_child_optional("coalesed_buffers");
-    if (!coalesed_buffers_pt)
+    if (!metadata.num_patches)
       return;
 
-    const auto coalesed_buffers = coalesed_buffers_pt.get();
-    for (auto coalesed_buffer : coalesed_buffers) {
-      uint32_t buffer_offset = coalesed_buffer.second.get<uint32_t>("offset_in_bytes");
-      uint32_t arg_index = pt.get<uint32_t>("xrt_id");
-      // Check if the buffer offset is within the buffer size
-      validate_json(buffer_offset, buffer_size, arg_index, offset_type::COALESED_BUFFER);
-      // extract control packet patch
-      extract_control_packet_patch(name, arg_index, coalesed_buffer.second);
+    // Check all records in one branch free pass, the records that fail
+    // are only looked for to report them
+    const uint32_t control_packet_size = m_data[".ctrldata"].size();
+    const auto* patches = metadata.patches;
+    uint32_t bad = 0;
+    for (size_t i = 0; i < metadata.num_patches; ++i)
+      bad |= (patches[i].offset > control_packet_size)
+           | (patches[i].xrt_id > patch_metadata::max_arg_index)
+           | (patches[i].addend > patch_metadata::max_addend);
+    if (bad)
+    {
+      for (size_t i = 0; i < metadata.num_patches; ++i)
+      {
+        patch_metadata::validate_offset(patches[i].offset, control_packet_size, patches[i].xrt_id, true);
+        patch_metadata::validate_addend(patches[i].addend);
+      }
+    }
+
+    for (size_t i = 0; i < metadata.num_patches; ++i)
+    {
+      const auto& patch = patches[i];
+      // move 8 bytes(header) up for unifying the patching scheme between DPU sequence and transaction-buffer
+      uint32_t offset = patch.offset - 8;
+      add_symbol(std::to_string(patch.xrt_id + ARG_OFFSET), offset, static_cast<uint32_t>(patch.addend), 0,
+                 ctrlData, static_cast<symbol::patch_schema>(patch.schema));
     }
   }
 
   void
   aie2_blob_preprocessor_input::
-  extract_control_packet_patch(const std::string& name,
-                               const uint32_t arg_index,
-                               const boost::property_tree::ptree& pt)
+  readmetajson(const buffer_view& patch_json)
   {
-    const uint32_t addend = validate_and_return_addend(pt.get<uint64_t>("offset_in_bytes", 0));
-    const auto control_packet_patch_pt = pt.get_child_optional("control_packet_patch_locations");
-    if (!control_packet_patch_pt)
-      return;
-    const auto patchs = control_packet_patch_pt.get();
-    for (auto pat : patchs)
+    if (patch_metadata::is_binary(patch_json.data(), patch_json.size()))
     {
-      auto patch = pat.second;
-      uint32_t control_packet_size = m_data[".ctrldata"].size();
-      uint32_t control_packet_offset = patch.get<uint32_t>("offset");
-      // Check if the control packet offset is within the control packet size
-      validate_json(control_packet_offset, control_packet_size, arg_index, offset_type::CONTROL_PACKET);
-      // move 8 bytes(header) up for unifying the patching scheme between DPU sequence and transaction-buffer
-      uint32_t offset = patch.get<uint32_t>("offset") - 8;
-      add_symbol({name, offset, 0, 0, addend, 0, ctrlData, symbol::patch_schema::control_packet_48});
+      // used in place, unless the buffer is not aligned for the records
+      if (reinterpret_cast<uintptr_t>(patch_json.data()) % alignof(patch_metadata::header) == 0) {
+        add_patch_metadata(patch_metadata::parse(patch_json.data(), patch_json.size()));
+        return;
+      }
+      std::vector<uint64_t> aligned((patch_json.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+      std::memcpy(aligned.data(), patch_json.data(), patch_json.size());
+      add_patch_metadata(patch_metadata::parse(reinterpret_cast<const char*>(aligned.data()), patch_json.size()));
+      return;
     }
+
+    auto metadata = patch_metadata::from_json(patch_json.data(), patch_json.size());
+    add_patch_metadata(metadata.get_view());
   }
 
   void
   aie2_blob_preprocessor_input::
-  aiecompiler_json_parser(const boost::property_tree::ptree& pt)
+  set_patch_data(const buffer_view& patch_json,
+                 const buffer_view& control_packet,
+                 const std::map<uint8_t, buffer_view>& ctrlpkt)
   {
-    const auto pt_external_buffers = pt.get_child_optional("external_buffers");
-    if (!pt_external_buffers)
-      return;
+    if(control_packet.size())
+      m_data[".ctrldata"] = control_packet;
 
-    const auto external_buffers = pt_external_buffers.get();
-    for (auto& external_buffer : external_buffers)
+    for (auto& pm_ctrl : ctrlpkt)
     {
-      const auto pt_coalesed_buffers = external_buffer.second.get_child_optional("coalesed_buffers");
-      // added ARG_OFFSET to argidx to match with kernel argument index in xclbin
-      auto arg = external_buffer.second.get<uint32_t>("xrt_id");
-      std::string name = std::to_string(arg + ARG_OFFSET);
-      if (external_buffer.second.get<bool>("ctrl_pkt_buffer", false))
-        xrt_id_map.insert({arg, "control-packet"});
-      else
-        xrt_id_map.insert({arg, name});
-
-      if (pt_coalesed_buffers)
-        extract_coalesed_buffers(name, external_buffer.second);
-      else
-        extract_control_packet_patch(name, arg, external_buffer.second);
+      m_data[".ctrlpkt.pm." + std::to_string(pm_ctrl.first)] = pm_ctrl.second;
+      pm_id_list.push_back(pm_ctrl.first);
     }
+
+    if (patch_json.size() !=0 )
+      readmetajson(patch_json);
   }
 
   void
   aie2_blob_preprocessor_input::
-  dmacompiler_json_parser(const boost::property_tree::ptree& pt)
+  set_code(const buffer_view& mc_code,
+           const std::vector<std::string>& libs,
+           const std::vector<std::string>& libpaths)
   {
+    m_first_code_symbol = m_sym.size();
+    m_data[".ctrltext"] = mc_code;
+    m_code_keys.push_back(".ctrltext");
 
-    // fixed in dma compiler
-    xrt_id_map.insert({0, "3"});
-    xrt_id_map.insert({1, "4"});
-    xrt_id_map.insert({2, "5"});
-    xrt_id_map.insert({3, "6"});
-    xrt_id_map.insert({4, "7"});
+    auto col = extractSymbolFromBuffer(m_data[".ctrltext"], ctrlText, "");
 
-    const auto pt_ctrl_xrt_arg_idx = pt.get_optional<uint32_t>("ctrl_pkt_xrt_arg_idx");
-    if (pt_ctrl_xrt_arg_idx)
+    for (const auto& lib: libs)
     {
-      // if "ctrl_pkt_xrt_arg_idx" present make that as controlpacket index
-      xrt_id_map.insert_or_assign(pt_ctrl_xrt_arg_idx.get(), "control-packet");
-    } else {
-      // if "ctrl_pkt_xrt_arg_idx" not present default arg4 is controlpacket
-      xrt_id_map[4] = "control-packet";
+      if (lib == preempt_lib)
+      {
+        auto files = resolve_libs(col, {lib}, libpaths);
+        m_data[preempt_save] = map_file(files[0]);
+        m_data[preempt_restore] = map_file(files[1]);
+        m_code_keys.push_back(preempt_save);
+        m_code_keys.push_back(preempt_restore);
+        extractSymbolFromBuffer(m_data[preempt_save], preempt_save, scratch_pad);
+        extractSymbolFromBuffer(m_data[preempt_restore], preempt_restore, scratch_pad);
+      }
+      else
+        std::cerr << "Invalid flag: " << lib << ", ignored !!!" << std::endl;
     }
+  }
 
-    const auto pt_ctrl_pkt_patch_info = pt.get_child_optional("ctrl_pkt_patch_info");
-    if (!pt_ctrl_pkt_patch_info)
-      return;
-
-    const auto patchs = pt_ctrl_pkt_patch_info.get();
-    for (auto pat : patchs)
+  std::vector<std::string>
+  aie2_blob_preprocessor_input::
+  resolve_libs(uint32_t num_cols,
+               const std::vector<std::string>& libs,
+               const std::vector<std::string>& libpaths)
+  {
+    std::vector<std::string> files;
+    for (const auto& lib: libs)
     {
-      auto patch = pat.second;
-      uint32_t control_packet_offset = patch.get<uint32_t>("offset");
-      uint32_t control_packet_size = m_data[".ctrldata"].size();
-      uint32_t arg_index = patch.get<uint32_t>("xrt_arg_idx");
-      // check if the offset is less than the size of the control packet
-      validate_json(control_packet_offset, control_packet_size, arg_index, offset_type::CONTROL_PACKET);
-      // move 8 bytes(header) up for unifying the patching scheme between DPU sequence and transaction-buffer
-      uint32_t offset = patch.get<uint32_t>("offset") - 8;
-      const uint32_t addend = validate_and_return_addend(patch.get<uint64_t>("bo_offset"));
-      const uint32_t arg = patch.get<uint32_t>("xrt_arg_idx");
-      add_symbol({std::to_string(arg + ARG_OFFSET), offset, 0, 0, addend, 0, ctrlData, symbol::patch_schema::control_packet_48});
+      if (lib != preempt_lib)
+        continue;
+      files.push_back(findFilePath("preempt_save_stx_4x" + std::to_string(num_cols) + ".bin", libpaths));
+      files.push_back(findFilePath("preempt_restore_stx_4x" + std::to_string(num_cols) + ".bin", libpaths));
     }
-
+    return files;
   }
 
-  void
+  aie2_blob_preprocessor_input::code_cache
   aie2_blob_preprocessor_input::
-  readmetajson(std::istream& patch_json)
+  save_code()
   {
-    boost::property_tree::ptree pt;
-    boost::property_tree::read_json(patch_json, pt);
+    code_cache cache;
+    for (const auto& key : m_code_keys)
+      cache.data[key] = m_data[key];
+
+    // added in walk order, names are interned in the same order as by the walk
+    for (size_t i = m_first_code_symbol; i < m_sym.size(); ++i)
+      cache.symbols.add(m_sym.get_name(i), m_sym.get_pos(i), m_sym.get_addend(i), m_sym.get_size(i),
+                        m_sym.get_section_name(i), m_sym.get_schema(i));
+    cache.xrt_id_map = xrt_id_map;
+    cache.pm_id_list = pm_id_list;
+    cache.storage = std::move(m_storage);
+    m_storage.clear();
+    return cache;
+  }
 
-    const auto aiecompiler_json = pt.get_child_optional("external_buffers");
-    if (aiecompiler_json)
-    {
-      aiecompiler_json_parser(pt);
-      return;
-    }
+  bool
+  aie2_blob_preprocessor_input::
+  reuse_code(const code_cache& cache)
+  {
+    if (cache.xrt_id_map != xrt_id_map || cache.pm_id_list != pm_id_list)
+      return false;
 
-    const auto dmacompiler_json = pt.get_child_optional("ctrl_pkt_patch_info");
-    if (dmacompiler_json)
+    for (const auto& [key, view] : cache.data)
     {
-      dmacompiler_json_parser(pt);
-      return;
+      m_data[key] = view;
+      m_code_keys.push_back(key);
     }
+    m_first_code_symbol = m_sym.size();
+    for (size_t i = 0; i < cache.symbols.size(); ++i)
+      add_symbol(cache.symbols.get_name(i), cache.symbols.get_pos(i), cache.symbols.get_addend(i),
+                 cache.symbols.get_size(i), cache.symbols.get_section_name(i), cache.symbols.get_schema(i));
+    return true;
   }
 
-
   uint32_t
   aie2_blob_preprocessor_input::
   validate_and_return_addend(uint64_t addend64) const
   {
-    // we dont support addend greater then 32 bit
-    if (addend64 > MAX_ARGPLUS)
-    {
-      auto error_msg = boost::format("Invalid addend (0x%x) > 32bit found") % addend64;
-      throw error(error::error_code::invalid_asm, error_msg.str());
-    }
-    return static_cast<uint32_t>(addend64);
+    return patch_metadata::validate_addend(addend64);
   }
 
+
   // 20 Lower bits
   #define GET_REG(reg) (reg & 0xFFFFF)
 
   void
   aie2_blob_preprocessor_input::
-  clear_shimBD_address_bits(std::vector<char>& mc_code, uint32_t offset) const
+  clear_shimBD_address_bits(buffer_view& mc_code, uint32_t offset) const
   {
     constexpr static uint32_t DMA_BD_1_IN_BYTES = 1 * 4;
     constexpr static uint32_t DMA_BD_2_IN_BYTES = 2 * 4;
     //Clearing address bits as they are set at runtime during patching(xrt/firmware).
     //Lower Base Address. 30 LSB of a 46-bit long 32-bit-word-address. (bits [31:2] in DMA_BD_1 of a 48-bit byte-address)
     //Upper Base Address. 16 MSB of a 46-bit long 32-bit-word-address. (bits [47:32] in DMA_BD_2 of a 48-bit byte-address)
-    mc_code[offset + DMA_BD_1_IN_BYTES] = mc_code[offset + DMA_BD_1_IN_BYTES] & (0x03);
-    mc_code[offset + DMA_BD_1_IN_BYTES + 1] = mc_code[offset + DMA_BD_1_IN_BYTES + 1] & (0x00);
-    mc_code[offset + DMA_BD_1_IN_BYTES + 2] = mc_code[offset + DMA_BD_1_IN_BYTES + 2] & (0x00);
-    mc_code[offset + DMA_BD_1_IN_BYTES + 3] = mc_code[offset + DMA_BD_1_IN_BYTES + 3] & (0x00);
-    mc_code[offset + DMA_BD_2_IN_BYTES] = mc_code[offset + DMA_BD_2_IN_BYTES] & (0x00);
-    mc_code[offset + DMA_BD_2_IN_BYTES + 1] = mc_code[offset + DMA_BD_2_IN_BYTES + 1] & (0x00);
+    //The input buffer is not modified, cleared bytes go to the patch overlay of the view.
+    mc_code.patch(offset + DMA_BD_1_IN_BYTES, mc_code[offset + DMA_BD_1_IN_BYTES] & (0x03));
+    mc_code.patch(offset + DMA_BD_1_IN_BYTES + 1, mc_code[offset + DMA_BD_1_IN_BYTES + 1] & (0x00));
+    mc_code.patch(offset + DMA_BD_1_IN_BYTES + 2, mc_code[offset + DMA_BD_1_IN_BYTES + 2] & (0x00));
+    mc_code.patch(offset + DMA_BD_1_IN_BYTES + 3, mc_code[offset + DMA_BD_1_IN_BYTES + 3] & (0x00));
+    mc_code.patch(offset + DMA_BD_2_IN_BYTES, mc_code[offset + DMA_BD_2_IN_BYTES] & (0x00));
+    mc_code.patch(offset + DMA_BD_2_IN_BYTES + 1, mc_code[offset + DMA_BD_2_IN_BYTES + 1] & (0x00));
   }
 
-  #define MAJOR_VER 1
-  #define MINOR_VER 0
-
-  uint32_t aie2_blob_transaction_preprocessor_input::process_txn(const char *ptr, std::vector<char>& mc_code, const std::string& section_name, const std::string& argname)
+  struct aie2_blob_transaction_preprocessor_input::txn_visitor : txn::visitor_base
   {
-    std::map<uint64_t,std::pair<uint32_t, uint64_t>> blockWriteRegOffsetMap;
-    auto txn_header = reinterpret_cast<const XAie_TxnHeader *>(ptr);
-    uint32_t loadsequence = 0;
-    uint8_t pm_id = 0;
-
-    ptr += sizeof(XAie_TxnHeader);
-    for(uint32_t num = 0; num < txn_header->NumOps; num++) {
-      auto op_header = reinterpret_cast<const XAie_OpHdr *>(ptr);
-      switch(op_header->Op) {
-        case XAIE_IO_WRITE: {
-          auto w_header = reinterpret_cast<const XAie_Write32Hdr *>(ptr);
-          ptr += w_header->Size;
-          break;
-        }
-        case XAIE_IO_BLOCKWRITE: {
-          auto bw_header = reinterpret_cast<const XAie_BlockWrite32Hdr *>(ptr);
-          auto payload = reinterpret_cast<const char*>(ptr + sizeof(XAie_BlockWrite32Hdr));
-          auto offset = static_cast<uint32_t>(payload-mc_code.data());
-          uint32_t size = (bw_header->Size - sizeof(*bw_header));
-          if (loadsequence > 0)
-          {
-            uint64_t buffer_length_in_bytes = reinterpret_cast<const uint32_t*>(payload)[0] * byte_in_word;
-            patch_helper_input input = {section_name, ctrlpkt_pm + std::to_string(pm_id),
-                                        static_cast<uint32_t>(GET_REG(bw_header->RegOff)+ 4),
-                                        0, offset, buffer_length_in_bytes, 0};
-            patch_helper(mc_code, input);
-          }
-          else
-          {
-            // we can combine multiple bd writes in one blockwrite and have patch opcodes after that
-            // we divide the blockwrite in bd chuncks and add in blockWriteRegOffsetMap
-            for (auto bd = 0U ; bd < size; bd += SHIM_DMA_BD_SIZE) { //size and bd in bytes
-              uint64_t buffer_length_in_bytes = reinterpret_cast<const uint32_t*>(payload)[bd/byte_in_word] * byte_in_word;
-              blockWriteRegOffsetMap[bw_header->RegOff + bd] = std::make_pair(offset + bd, buffer_length_in_bytes);
-            }
-          }
-          ptr += bw_header->Size;
-          break;
-        }
-        case XAIE_IO_MASKWRITE: {
-          auto mw_header = reinterpret_cast<const XAie_MaskWrite32Hdr *>(ptr);
-          ptr += mw_header->Size;
-          break;
-        }
-        case XAIE_IO_MASKPOLL:
-        case XAIE_IO_MASKPOLL_BUSY: {
-          auto mp_header = reinterpret_cast<const XAie_MaskPoll32Hdr *>(ptr);
-          ptr += mp_header->Size;
-          break;
-        }
-        case XAIE_IO_NOOP: {
-            ptr += sizeof(XAie_NoOpHdr);
-            break;
-        }
-        case XAIE_IO_PREEMPT: {
-            ptr += sizeof(XAie_PreemptHdr);
-            break;
-        }
-        case XAIE_IO_LOAD_PM_START: {
-          auto mp_header = (const XAie_PmLoadHdr *)(ptr);
-          loadsequence = mp_header->LoadSequenceCount[2] << 16 | mp_header->LoadSequenceCount[1] << 8 | mp_header->LoadSequenceCount[0];
-          loadsequence = loadsequence + 1;
-          pm_id = mp_header->PmLoadId;
-          if (std::find(pm_id_list.begin(), pm_id_list.end(), pm_id) == pm_id_list.end())
-            throw error(error::error_code::invalid_asm, "PM id:" + std::to_string(pm_id) + " has no corresponding pm control packet !!!");
-          ptr += sizeof(XAie_PmLoadHdr);
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_BEGIN: {
-          auto co_header = reinterpret_cast<const XAie_CustomOpHdr *>(ptr);
-          ptr += co_header->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_BEGIN+1: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr *>(ptr);
-          if (loadsequence)
-            throw error(error::error_code::invalid_asm, "Patch opcode found in PM Load Sequence!!!");
-          auto op = reinterpret_cast<const patch_op_t *>(ptr + sizeof(*hdr));
-          uint64_t reg = op->regaddr & 0xFFFFFFF0; // regaddr point either to 1st word or 2nd word of BD
-          auto it = blockWriteRegOffsetMap.find(reg);
-          if ( it == blockWriteRegOffsetMap.end()) {
-            auto error_msg = boost::format("Invalid Control Code. No block-write opcode"
-            " present before the patch opcode for address 0x%x") % reg;
-            throw error(error::error_code::invalid_asm, error_msg.str());
-          }
-          uint32_t offset = blockWriteRegOffsetMap[reg].first;
-          uint64_t buffer_length_in_bytes = blockWriteRegOffsetMap[reg].second;
-          patch_helper_input input = {section_name, argname, static_cast<uint32_t>(GET_REG(op->regaddr)),
-                                      static_cast<uint32_t>(op->argidx + ARG_OFFSET), offset,
-                                      buffer_length_in_bytes, op->argplus};
-          patch_helper(mc_code, input);
-          ptr += hdr->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_BEGIN+2: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr *>(ptr);
-          ptr += hdr->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_BEGIN+3: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr *>(ptr);
-          ptr += hdr->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_MERGE_SYNC: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr *>(ptr);
-          ptr += hdr->Size;
-          break;
+    aie2_blob_transaction_preprocessor_input& m_input;
+    buffer_view& m_mc_code;
+    const std::string& m_section_name;
+    const std::string& m_argname;
+    // BDs written outside of a PM load sequence
+    bd_index m_bd_index;
+    uint32_t m_loadsequence = 0;
+    uint8_t m_pm_id = 0;
+
+    txn_visitor(aie2_blob_transaction_preprocessor_input& input, buffer_view& mc_code,
+                const std::string& section_name, const std::string& argname,
+                const XAie_TxnHeader& txn_header)
+      : m_input(input), m_mc_code(mc_code), m_section_name(section_name), m_argname(argname),
+        m_bd_index(txn_header.NumCols, txn_header.NumRows)
+    {}
+
+    void
+    on_op(const txn::op_ref&)
+    {
+      // ops following a LOAD_PM_START belong to its load sequence
+      m_loadsequence = m_loadsequence > 0 ? m_loadsequence-1 : 0;
+    }
+
+    template <typename Hdr>
+    void
+    on_block_write(const txn::op_ref& op, const Hdr& bw_header)
+    {
+      auto payload = txn::payload<Hdr>(op);
+      auto offset = static_cast<uint32_t>(op.offset + sizeof(Hdr));
+      uint32_t size = (bw_header.Size - sizeof(Hdr));
+      if (m_loadsequence > 0)
+      {
+        uint64_t buffer_length_in_bytes = payload[0] * byte_in_word;
+        patch_helper_input input = {m_section_name, m_input.ctrlpkt_pm + std::to_string(m_pm_id),
+                                    static_cast<uint32_t>(GET_REG(bw_header.RegOff)+ 4),
+                                    0, offset, buffer_length_in_bytes, 0};
+        m_input.patch_helper(m_mc_code, input);
+      }
+      else
+      {
+        // we can combine multiple bd writes in one blockwrite and have patch opcodes after that
+        // we divide the blockwrite in bd chuncks and add in m_bd_index
+        for (auto bd = 0U ; bd < size; bd += SHIM_DMA_BD_SIZE) { //size and bd in bytes
+          uint64_t buffer_length_in_bytes = payload[bd/byte_in_word] * byte_in_word;
+          m_bd_index.insert(bw_header.RegOff + bd, offset + bd, buffer_length_in_bytes);
         }
-        default:
-          throw error(error::error_code::invalid_asm, "Invalid txn opcode: " + std::to_string(op_header->Op) + " !!!");
       }
-
-      loadsequence = loadsequence > 0 ? loadsequence-1 : 0;
     }
-    return txn_header->NumCols;
-  }
 
+    void
+    on_pm_load(const txn::op_ref&, const XAie_PmLoadHdr& hdr)
+    {
+      // counts the LOAD_PM_START op itself, which is dropped by the next on_op
+      m_loadsequence = txn::load_sequence_count(hdr) + 1;
+      m_pm_id = hdr.PmLoadId;
+      const auto& pm_id_list = m_input.pm_id_list;
+      if (std::find(pm_id_list.begin(), pm_id_list.end(), m_pm_id) == pm_id_list.end())
+        throw error(error::error_code::invalid_asm, "PM id:" + std::to_string(m_pm_id) + " has no corresponding pm control packet !!!");
+    }
 
-  uint32_t aie2_blob_transaction_preprocessor_input::process_txn_opt(const char *ptr, std::vector<char>& mc_code, const std::string& section_name, const std::string& argname)
-  {
-    std::map<uint32_t,std::pair<uint32_t, uint64_t>> blockWriteRegOffsetMap;
-    auto txn_header = reinterpret_cast<const XAie_TxnHeader *>(ptr);
-    uint32_t loadsequence = 0;
-    uint8_t pm_id = 0;
-
-    ptr += sizeof(XAie_TxnHeader);
-    for(uint32_t num = 0; num < txn_header->NumOps; num++) {
-      auto op_header = reinterpret_cast<const XAie_OpHdr_opt *>(ptr);
-      switch(op_header->Op) {
-        case XAIE_IO_WRITE: {
-          ptr += sizeof(XAie_Write32Hdr_opt);
-          break;
-        }
-        case XAIE_IO_BLOCKWRITE: {
-          auto bw_header = reinterpret_cast<const XAie_BlockWrite32Hdr_opt *>(ptr);
-          auto payload = reinterpret_cast<const char*>(ptr + sizeof(XAie_BlockWrite32Hdr_opt));
-          auto offset = static_cast<uint32_t>(payload-mc_code.data());
-          uint32_t size = (bw_header->Size - sizeof(*bw_header));
-          if (loadsequence > 0)
-          {
-            uint64_t buffer_length_in_bytes = reinterpret_cast<const uint32_t*>(payload)[0] * byte_in_word;
-            patch_helper_input input = {section_name, ctrlpkt_pm + std::to_string(pm_id),
-                                        static_cast<uint32_t>(GET_REG(bw_header->RegOff)+ 4),
-                                        0, offset, buffer_length_in_bytes, 0};
-            patch_helper(mc_code, input);
-          }
-          else
-          {
-            // we can combine multiple bd writes in one blockwrite and have patch opcodes after that
-            // we divide the blockwrite in bd chuncks and add in blockWriteRegOffsetMap
-            for (auto bd = 0U ; bd < size; bd+=SHIM_DMA_BD_SIZE) { //size and bd in bytes
-              uint64_t buffer_length_in_bytes = reinterpret_cast<const uint32_t*>(payload)[bd/byte_in_word] * byte_in_word;
-              blockWriteRegOffsetMap[bw_header->RegOff + bd] = std::make_pair(offset + bd, buffer_length_in_bytes);
-            }
-          }
-          ptr += bw_header->Size;
-          break;
-        }
-        case XAIE_IO_MASKWRITE: {
-          ptr += sizeof(XAie_MaskWrite32Hdr_opt);
-          break;
-        }
-        case XAIE_IO_MASKPOLL:
-        case XAIE_IO_MASKPOLL_BUSY: {
-          ptr += sizeof(XAie_MaskPoll32Hdr_opt);
-          break;
-        }
-        case XAIE_IO_NOOP: {
-            ptr += sizeof(XAie_NoOpHdr);
-            break;
-        }
-        case XAIE_IO_PREEMPT: {
-            ptr += sizeof(XAie_PreemptHdr);
-            break;
-        }
-        case XAIE_IO_LOAD_PM_START: {
-          auto mp_header = (const XAie_PmLoadHdr *)(ptr);
-          loadsequence = mp_header->LoadSequenceCount[2] << 16 | mp_header->LoadSequenceCount[1] << 8 | mp_header->LoadSequenceCount[0];
-          loadsequence = loadsequence + 1;
-          pm_id = mp_header->PmLoadId;
-          if (std::find(pm_id_list.begin(), pm_id_list.end(), pm_id) == pm_id_list.end())
-            throw error(error::error_code::invalid_asm, "PM id:" + std::to_string(pm_id) + " has no corresponding pm control packet !!!");
-          ptr += sizeof(XAie_PmLoadHdr);
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_TCT: {
-          auto co_header = reinterpret_cast<const XAie_CustomOpHdr_opt *>(ptr);
-          ptr += co_header->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_DDR_PATCH: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr_opt *>(ptr);
-          if (loadsequence)
-            throw error(error::error_code::invalid_asm, "Patch opcode found in PM Load Sequence!!!");
-          auto op = reinterpret_cast<const patch_op_t *>(ptr + sizeof(*hdr));
-          uint64_t reg = op->regaddr & 0xFFFFFFF0; // regaddr point either to 1st word or 2nd word of BD
-          auto it = blockWriteRegOffsetMap.find(reg);
-          if ( it == blockWriteRegOffsetMap.end()) {
-            auto error_msg = boost::format("Invalid Control Code. No block-write opcode"
-            " present before the patch opcode for address 0x%x") % reg;
-            throw error(error::error_code::invalid_asm, error_msg.str());
-          }
-          uint32_t offset = blockWriteRegOffsetMap[reg].first;
-          uint64_t buffer_length_in_bytes = blockWriteRegOffsetMap[reg].second;
-          patch_helper_input input = {section_name, argname, static_cast<uint32_t>(GET_REG(op->regaddr)),
-                                      static_cast<uint32_t>(op->argidx + ARG_OFFSET), offset,
-                                      buffer_length_in_bytes, op->argplus};
-          patch_helper(mc_code, input);
-          ptr += hdr->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_READ_REGS: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr_opt *>(ptr);
-          ptr += hdr->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_RECORD_TIMER: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr_opt *>(ptr);
-          ptr += hdr->Size;
-          break;
-        }
-        case XAIE_IO_CUSTOM_OP_MERGE_SYNC: {
-          auto hdr = reinterpret_cast<const XAie_CustomOpHdr_opt *>(ptr);
-          ptr += hdr->Size;
-          break;
-        }
-        default:
-          throw error(error::error_code::invalid_asm, "Invalid txn opcode: " + std::to_string(op_header->Op) + " !!!");
+    void
+    on_ddr_patch(const txn::op_ref&, const patch_op_t& op)
+    {
+      if (m_loadsequence)
+        throw error(error::error_code::invalid_asm, "Patch opcode found in PM Load Sequence!!!");
+      uint64_t reg = op.regaddr & 0xFFFFFFF0; // regaddr point either to 1st word or 2nd word of BD
+      auto bd = m_bd_index.patch(reg);
+      if (!bd) {
+        auto error_msg = boost::format("Invalid Control Code. No block-write opcode"
+        " present before the patch opcode for address 0x%x") % reg;
+        throw error(error::error_code::invalid_asm, error_msg.str());
       }
+      patch_helper_input input = {m_section_name, m_argname, static_cast<uint32_t>(GET_REG(op.regaddr)),
+                                  static_cast<uint32_t>(op.argidx + ARG_OFFSET), bd->offset,
+                                  bd->buffer_length_in_bytes, op.argplus};
+      m_input.patch_helper(m_mc_code, input);
     }
-    return txn_header->NumCols;
-  }
+
+    [[noreturn]] void
+    on_unknown(const txn::op_ref& op)
+    {
+      throw error(error::error_code::invalid_asm, "Invalid txn opcode: " + std::to_string(op.code) + " !!!");
+    }
+  };
 
   uint32_t
   aie2_blob_transaction_preprocessor_input::
-  extractSymbolFromBuffer(std::vector<char>& mc_code,
+  extractSymbolFromBuffer(buffer_view& mc_code,
                           const std::string& section_name,
                           const std::string& argname)
   {
     const char *ptr = (mc_code.data());
+    if (mc_code.size() < sizeof(XAie_TxnHeader))
+      throw error(error::error_code::invalid_buffer_type, "Corrupted transaction in " + section_name + " !!!");
     auto txn_header = reinterpret_cast<const XAie_TxnHeader *>(ptr);
 
-    printf("Header version %d.%d\n", txn_header->Major, txn_header->Minor);
-    printf("Device Generation: %d\n", txn_header->DevGen);
-    printf("Cols, Rows, NumMemRows : (%d, %d, %d)\n", txn_header->NumCols,
-         txn_header->NumRows, txn_header->NumMemTileRows);
-    printf("TransactionSize: %u\n", txn_header->TxnSize);
-    printf("NumOps: %u\n", txn_header->NumOps);
-
-    /**
-     * Check if Header Version is 1.0 then call optimized API else continue with this
-     * function to service the TXN buffer.
-     */
-    if ((txn_header->Major == MAJOR_VER) && (txn_header->Minor == MINOR_VER)) {
-        printf("Optimized HEADER version detected \n");
-        return process_txn_opt(ptr, mc_code, section_name, argname);
-    }
-    return process_txn(ptr, mc_code, section_name, argname);
+    txn_visitor visitor(*this, mc_code, section_name, argname, *txn_header);
+    txn::walk(ptr, mc_code.size(), visitor);
+    const auto& bd_stats = visitor.m_bd_index.get_stats();
+    m_stats.bd_writes_indexed += bd_stats.indexed;
+    m_stats.bd_writes_patched += bd_stats.patched;
+    return txn_header->NumCols;
    }
 
   void
   aie2_blob_transaction_preprocessor_input::
-  patch_helper(std::vector<char>& mc_code,
+  patch_helper(buffer_view& mc_code,
                const patch_helper_input& input)
   {
     const std::string& section_name = input.section_name;
@@ -626,69 +328,44 @@ namespace aiebu {
     uint64_t buffer_length_in_bytes = input.buffer_length_in_bytes;
     uint32_t addend = validate_and_return_addend(input.addend);
 
-    std::vector<uint32_t> MEM_BD_ADDRESS;
-    for (auto i=0U; i < MEM_DMA_BD_NUM; ++i)
-      MEM_BD_ADDRESS.push_back(MEM_DMA_BD0_0 + i * MEM_DMA_BD_SIZE);
-
-    std::vector<uint32_t> SHIM_BD_ADDRESS;
-    for (auto i=0U; i < SHIM_DMA_BD_NUM; ++i)
-      SHIM_BD_ADDRESS.push_back(SHIM_DMA_BD0_0 + i * SHIM_DMA_BD_SIZE);
-
+    // reg points to word 0 (buffer length) or word 1 (base address) of a BD
+    const auto loc = aie2_bd::decode(reg);
+    if (loc.kind == aie2_bd::tile::mem && loc.word == 0)
     {
-      //MEM bd buffer length patch: reg point to mem bd_0
-      auto it = std::find(MEM_BD_ADDRESS.begin(), MEM_BD_ADDRESS.end(), reg);
-      if (it != MEM_BD_ADDRESS.end())
-      {
-        // size is overloaded, for scaler_32 size contain mask
-        add_symbol({std::to_string(argidx), offset, 0, 0, addend, register_mask[register_id::MEM_BUFFER_LENGTH], section_name, symbol::patch_schema::scaler_32});
-        return;
-      }
+      //MEM bd buffer length patch
+      // size is overloaded, for scaler_32 size contain mask
+      add_symbol(std::to_string(argidx), offset, addend, register_mask(register_id::MEM_BUFFER_LENGTH), section_name, symbol::patch_schema::scaler_32);
     }
-
+    else if (loc.kind == aie2_bd::tile::mem && loc.word == 1)
     {
-      //MEM bd base address patch: reg point to mem bd_1
-      auto it = std::find(MEM_BD_ADDRESS.begin(), MEM_BD_ADDRESS.end(), reg-4);
-      if (it != MEM_BD_ADDRESS.end())
-      {
-        // size is overloaded, for scaler_32 size contain mask
-        add_symbol({std::to_string(argidx), offset + 4, 0, 0, addend, register_mask[register_id::MEM_BASE_ADDRESS], section_name, symbol::patch_schema::scaler_32});
-        return;
-      }
+      //MEM bd base address patch
+      // size is overloaded, for scaler_32 size contain mask
+      add_symbol(std::to_string(argidx), offset + 4, addend, register_mask(register_id::MEM_BASE_ADDRESS), section_name, symbol::patch_schema::scaler_32);
     }
-
+    else if (loc.kind == aie2_bd::tile::shim && loc.word == 0)
     {
-      //SHIM bd buffer length patch: reg point to shim bd_0
-      auto it = std::find(SHIM_BD_ADDRESS.begin(), SHIM_BD_ADDRESS.end(), reg);
-      if (it != SHIM_BD_ADDRESS.end())
-      {
-        // size is overloaded, for scaler_32 size contain mask
-        add_symbol({std::to_string(argidx), offset, 0, 0, addend, register_mask[register_id::SHIM_BUFFER_LENGTH], section_name, symbol::patch_schema::scaler_32});
-        return;
-      }
+      //SHIM bd buffer length patch
+      // size is overloaded, for scaler_32 size contain mask
+      add_symbol(std::to_string(argidx), offset, addend, register_mask(register_id::SHIM_BUFFER_LENGTH), section_name, symbol::patch_schema::scaler_32);
     }
-
+    else if (loc.kind == aie2_bd::tile::shim && loc.word == 1)
     {
-      //SHIM bd base address patch: reg point to shim bd_1
-      auto it = std::find(SHIM_BD_ADDRESS.begin(), SHIM_BD_ADDRESS.end(), reg-4);
-      if (it != SHIM_BD_ADDRESS.end())
+      //SHIM bd base address patch
+      clear_shimBD_address_bits(mc_code, offset);
+      if (!argname.empty())
       {
-        clear_shimBD_address_bits(mc_code, offset);
-        if (!argname.empty())
-        {
-          // in case of scratchpad
-          add_symbol({argname, offset, 0, 0, addend, buffer_length_in_bytes, section_name, symbol::patch_schema::shim_dma_48});
-        }
-        else if (xrt_id_map.find(argidx-ARG_OFFSET) != xrt_id_map.end())
-        {
-          // incase external buffer json is provided with xrt_id
-          add_symbol({xrt_id_map[argidx-ARG_OFFSET], offset, 0, 0, addend, buffer_length_in_bytes, section_name, symbol::patch_schema::shim_dma_48});
-        }
-        else
-        {
-          // added ARG_OFFSET to argidx to match with kernel argument index in xclbin
-          add_symbol({std::to_string(argidx), offset, 0, 0, addend, buffer_length_in_bytes, section_name, symbol::patch_schema::shim_dma_48});
-        }
-        return;
+        // in case of scratchpad
+        add_symbol(argname, offset, addend, buffer_length_in_bytes, section_name, symbol::patch_schema::shim_dma_48);
+      }
+      else if (xrt_id_map.find(argidx-ARG_OFFSET) != xrt_id_map.end())
+      {
+        // incase external buffer json is provided with xrt_id
+        add_symbol(xrt_id_map[argidx-ARG_OFFSET], offset, addend, buffer_length_in_bytes, section_name, symbol::patch_schema::shim_dma_48);
+      }
+      else
+      {
+        // added ARG_OFFSET to argidx to match with kernel argument index in xclbin
+        add_symbol(std::to_string(argidx), offset, addend, buffer_length_in_bytes, section_name, symbol::patch_schema::shim_dma_48);
       }
     }
   }
@@ -698,26 +375,26 @@ namespace aiebu {
   patch_shimbd(const uint32_t* instr_ptr, size_t pc, const std::string& section_name)
   {
     uint32_t regId = (instr_ptr[pc] & 0x000000F0) >> 4;
-    static std::map<uint32_t, std::string> arg2name = {
-      {0, "ifm"},
-      {1, "param"},
-      {2, "ofm"},
-      {3, "inter"},
-      {4, "out2"},
-      {5, "control-packet"}
+    // immutable, indexed by regId, safe to use from concurrent assemblers
+    constexpr const char* arg2name[] = {
+      "ifm",
+      "param",
+      "ofm",
+      "inter",
+      "out2",
+      "control-packet"
     };
 
-    auto it = arg2name.find(regId);
-    if ( it == arg2name.end() )
+    if (regId >= std::size(arg2name))
       throw error(error::error_code::invalid_asm, "Invalid dpu arg:" + std::to_string(regId) + " !!!");
 
     uint32_t offset = static_cast<uint32_t>((pc+1)*4); //point to start of BD
-    add_symbol({arg2name[regId], offset, 0, 0, 0, 0, section_name, symbol::patch_schema::shim_dma_48});
+    add_symbol(arg2name[regId], offset, 0, 0, section_name, symbol::patch_schema::shim_dma_48);
   }
 
   uint32_t
   aie2_blob_dpu_preprocessor_input::
-  extractSymbolFromBuffer(std::vector<char>& mc_code,
+  extractSymbolFromBuffer(buffer_view& mc_code,
                           const std::string& section_name,
                           const std::string& /*argname*/)
   {
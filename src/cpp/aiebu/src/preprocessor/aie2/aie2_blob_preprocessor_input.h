@@ -7,10 +7,11 @@
 #include <map>
 #include "symbol.h"
 #include "utils.h"
+#include "bd_decoder.h"
 #include "aiebu_assembler.h"
 #include "preprocessor_input.h"
 #include <boost/format.hpp>
-#include <boost/property_tree/json_parser.hpp>
+#include "patch_metadata.h"
 
 namespace aiebu {
 
@@ -21,103 +22,110 @@ protected:
   const std::string ctrlData = ".ctrldata";
   const std::string preempt_save = ".preempt_save";
   const std::string preempt_restore = ".preempt_restore";
-  const std::string preempt_lib = "preempt";
+  inline static const std::string preempt_lib = "preempt";
   const std::string scratch_pad = "scratch-pad-mem";
   const std::string ctrlpkt_pm = "ctrlpkt-pm-";
 
-  constexpr static uint32_t SHIM_DMA_BD0_0 = 0x0001D000;
-  constexpr static uint32_t SHIM_DMA_BD_NUM = 16;
-  constexpr static uint32_t SHIM_DMA_BD_SIZE = 0x20; // 8*4bytes
+  constexpr static uint32_t SHIM_DMA_BD0_0 = aie2_bd::shim_bd0;
+  constexpr static uint32_t SHIM_DMA_BD_NUM = aie2_bd::shim_bd_num;
+  constexpr static uint32_t SHIM_DMA_BD_SIZE = aie2_bd::shim_bd_size;
 
-  constexpr static uint32_t MEM_DMA_BD0_0 = 0x000A0000;
-  constexpr static uint32_t MEM_DMA_BD_NUM = 48;
-  constexpr static uint32_t MEM_DMA_BD_SIZE = 0x20; // 8*4bytes
+  constexpr static uint32_t MEM_DMA_BD0_0 = aie2_bd::mem_bd0;
+  constexpr static uint32_t MEM_DMA_BD_NUM = aie2_bd::mem_bd_num;
+  constexpr static uint32_t MEM_DMA_BD_SIZE = aie2_bd::mem_bd_size;
   constexpr static uint32_t byte_in_word = 4;
-  constexpr static uint32_t MAX_ARG_INDEX = 24; // approximated value 24 to limit the number of arguments in XRT kernel call
+  constexpr static uint32_t MAX_ARG_INDEX = patch_metadata::max_arg_index;
 
-  constexpr static uint64_t MAX_ARGPLUS = 0xFFFFFFFF; // Max argplus/addend supported
+  constexpr static uint64_t MAX_ARGPLUS = patch_metadata::max_addend;
 
   // For transaction buffer flow. In Xclbin kernel argument, actual argument start from 3,
   // 0th is opcode, 1st is instruct buffer, 2nd is instruct buffer size.
   constexpr static uint32_t ARG_OFFSET = 3;
 
-  enum class offset_type {
-    CONTROL_PACKET,
-    COALESED_BUFFER
-  };
-
   enum class register_id {
     MEM_BUFFER_LENGTH,
     MEM_BASE_ADDRESS,
     SHIM_BUFFER_LENGTH
   };
 
-  std::map<register_id, uint32_t> register_mask = {
-    { register_id::MEM_BUFFER_LENGTH, 0x1FFFF},
-    { register_id::MEM_BASE_ADDRESS, 0x7FFFF},
-    { register_id::SHIM_BUFFER_LENGTH, 0xFFFFFFFF}
-  };
+  constexpr static uint32_t
+  register_mask(register_id id)
+  {
+    switch (id) {
+    case register_id::MEM_BUFFER_LENGTH: return 0x1FFFF;
+    case register_id::MEM_BASE_ADDRESS: return 0x7FFFF;
+    default: return 0xFFFFFFFF;
+    }
+  }
 
   std::map<uint32_t, std::string> xrt_id_map;
   std::vector<uint8_t> pm_id_list;
-  virtual uint32_t extractSymbolFromBuffer(std::vector<char>& mc_code, const std::string& section_name, const std::string& argname) = 0;
-  void aiecompiler_json_parser(const boost::property_tree::ptree& pt);
-  void dmacompiler_json_parser(const boost::property_tree::ptree& pt);
-  void readmetajson(std::istream& patch_json);
-  void extract_control_packet_patch(const std::string& name, const uint32_t arg_index, const boost::property_tree::ptree& _pt);
-  void extract_coalesed_buffers(const std::string& name, const boost::property_tree::ptree& _pt);
-  void clear_shimBD_address_bits(std::vector<char>& mc_code, uint32_t offset) const;
-  void validate_json(uint32_t offset, uint32_t size, uint32_t arg_index, offset_type type) const;
+  // symbols and sections added by set_code()
+  size_t m_first_code_symbol = 0;
+  std::vector<std::string> m_code_keys;
+  virtual uint32_t extractSymbolFromBuffer(buffer_view& mc_code, const std::string& section_name, const std::string& argname) = 0;
+  // Patch json or binary patch metadata, see patch_metadata.h
+  void readmetajson(const buffer_view& patch_json);
+  void add_patch_metadata(const patch_metadata::view& metadata);
+  void clear_shimBD_address_bits(buffer_view& mc_code, uint32_t offset) const;
   uint32_t validate_and_return_addend(uint64_t addend64) const;
 public:
+  // Code sections, their symbols and what the symbols depend on from
+  // the patch metadata, see set_code()
+  struct code_cache
+  {
+    std::map<std::string, buffer_view> data;
+    symbol_table symbols;
+    std::map<uint32_t, std::string> xrt_id_map;
+    std::vector<uint8_t> pm_id_list;
+    // libs the views in data point into
+    std::vector<mapped_file> storage;
+  };
+
   aie2_blob_preprocessor_input() {}
-  virtual void set_args(const std::vector<char>& mc_code,
-                        const std::vector<char>& patch_json,
-                        const std::vector<char>& control_packet,
+  virtual void set_args(const buffer_view& mc_code,
+                        const buffer_view& patch_json,
+                        const buffer_view& control_packet,
                         const std::vector<std::string>& libs,
                         const std::vector<std::string>& libpaths,
-                        const std::map<uint8_t, std::vector<char> >& ctrlpkt) override
+                        const std::map<uint8_t, buffer_view>& ctrlpkt) override
   {
-    m_data[".ctrltext"] = mc_code;
-
-    if(control_packet.size())
-      m_data[".ctrldata"] = control_packet;
-
-    for (auto& pm_ctrl : ctrlpkt)
-    {
-      m_data[".ctrlpkt.pm." + std::to_string(pm_ctrl.first)] = pm_ctrl.second;
-      pm_id_list.push_back(pm_ctrl.first);
-    }
-
-    if (patch_json.size() !=0 )
-    {
-      vector_streambuf vsb(patch_json);
-      std::istream elf_stream(&vsb);
-      readmetajson(elf_stream);
-    }
+    set_patch_data(patch_json, control_packet, ctrlpkt);
+    set_code(mc_code, libs, libpaths);
+  }
 
-    auto col = extractSymbolFromBuffer(m_data[".ctrltext"], ctrlText, "");
+  // set_args() in two steps, the code is walked with the buffer names of
+  // the patch metadata and the pm ids of set_patch_data()
+  void set_patch_data(const buffer_view& patch_json,
+                      const buffer_view& control_packet,
+                      const std::map<uint8_t, buffer_view>& ctrlpkt);
 
-    for (const auto& lib: libs)
-    {
-      if (lib == preempt_lib)
-      {
-        m_data[preempt_save] = readfile(findFilePath("preempt_save_stx_4x" + std::to_string(col) + ".bin", libpaths));
-        m_data[preempt_restore] = readfile(findFilePath("preempt_restore_stx_4x" + std::to_string(col) + ".bin", libpaths));
-        extractSymbolFromBuffer(m_data[preempt_save], preempt_save, scratch_pad);
-        extractSymbolFromBuffer(m_data[preempt_restore], preempt_restore, scratch_pad);
-      }
-      else
-        std::cout << "Invalid flag: " << lib << ", ignored !!!" << std::endl;
-    }
-
-  }
+  virtual void set_code(const buffer_view& mc_code,
+                        const std::vector<std::string>& libs,
+                        const std::vector<std::string>& libpaths);
+
+  // Paths of the files set_code() maps for libs, for control code of
+  // num_cols columns. Unknown libs have none. its throws aiebu::error
+  // object when a file is not found in libpaths.
+  static std::vector<std::string>
+  resolve_libs(uint32_t num_cols,
+               const std::vector<std::string>& libs,
+               const std::vector<std::string>& libpaths);
+
+  // Code of set_code() for reuse_code() of a later input, the mapped
+  // libs move to the cache
+  code_cache save_code();
+
+  // Code of an earlier input instead of set_code(). Returns false, and
+  // adds nothing, when that code was walked with other buffer names or
+  // pm ids.
+  bool reuse_code(const code_cache& cache);
 };
 
 class aie2_blob_transaction_preprocessor_input : public aie2_blob_preprocessor_input
 {
 protected:
-  virtual uint32_t extractSymbolFromBuffer(std::vector<char>& mc_code, const std::string& section_name, const std::string& argname) override;
+  virtual uint32_t extractSymbolFromBuffer(buffer_view& mc_code, const std::string& section_name, const std::string& argname) override;
 
   struct patch_helper_input {
     const std::string& section_name;
@@ -128,40 +136,38 @@ protected:
     uint64_t buffer_length_in_bytes;
     uint64_t addend;
   };
-  void patch_helper(std::vector<char>& mc_code, const patch_helper_input& input);
-  uint32_t process_txn(const char *ptr, std::vector<char>& mc_code, const std::string& section_name, const std::string& argname);
-  uint32_t process_txn_opt(const char *ptr, std::vector<char>& mc_code, const std::string& section_name, const std::string& argname);
+  void patch_helper(buffer_view& mc_code, const patch_helper_input& input);
+  // Collects patch symbols while walking the ops of a txn buffer
+  struct txn_visitor;
   void resize_scratchpad(const std::string& section_name)
   {
-    std::vector<symbol> &syms = get_symbols();
+    symbol_table &syms = get_symbols();
+    const uint32_t section = syms.intern(section_name);
     uint64_t size = 0;
-    for (auto& sym : syms)
+    for (size_t i = 0; i < syms.size(); ++i)
     {
-      if (section_name.compare(sym.get_section_name()))
+      if (syms.get_section_id(i) != section)
         continue;
 
-      auto ssize = sym.get_size();
-      auto saddend = sym.get_addend();
+      auto ssize = syms.get_size(i);
+      auto saddend = syms.get_addend(i);
       size = ssize + saddend > size ? ssize + saddend : size;
     }
 
-    for (auto& sym : syms)
+    for (size_t i = 0; i < syms.size(); ++i)
     {
-      if (section_name.compare(sym.get_section_name()))
+      if (syms.get_section_id(i) != section)
         continue;
 
-      sym.set_size(size);
+      syms.set_size(i, size);
     }
   }
 public:
-  virtual void set_args(const std::vector<char>& mc_code,
-                        const std::vector<char>& patch_json,
-                        const std::vector<char>& control_packet,
+  virtual void set_code(const buffer_view& mc_code,
                         const std::vector<std::string>& libs,
-                        const std::vector<std::string>& libpaths,
-                        const std::map<uint8_t, std::vector<char> >& ctrlpkt) override
+                        const std::vector<std::string>& libpaths) override
   {
-    aie2_blob_preprocessor_input::set_args(mc_code, patch_json, control_packet, libs, libpaths, ctrlpkt);
+    aie2_blob_preprocessor_input::set_code(mc_code, libs, libpaths);
     resize_scratchpad(preempt_save);
     resize_scratchpad(preempt_restore);
   }
@@ -230,7 +236,7 @@ class aie2_blob_dpu_preprocessor_input : public aie2_blob_preprocessor_input
 
 protected:
   void patch_shimbd(const uint32_t* ins_buffer, size_t pc, const std::string& section_name);
-  virtual uint32_t extractSymbolFromBuffer(std::vector<char>& mc_code, const std::string& section_name, const std::string& argname) override;
+  virtual uint32_t extractSymbolFromBuffer(buffer_view& mc_code, const std::string& section_name, const std::string& argname) override;
 };
 
 }
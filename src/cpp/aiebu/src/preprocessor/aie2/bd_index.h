@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_PREPROCESSOR_AIE2_BD_INDEX_H_
+#define _AIEBU_PREPROCESSOR_AIE2_BD_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "bd_decoder.h"
+
+namespace aiebu {
+
+// BDs written by the BLOCKWRITE ops of a transaction, looked up by the
+// DDR patch ops that follow them.
+// BDs of the tiles described by the txn header live in a table allocated
+// once per buffer, one slot per (column, row, BD). A register outside of
+// that grid, or a chunk not starting at a BD, goes to an overflow map so
+// lookups stay exact for any address. The header is not trusted for the
+// size of the table, a grid larger than max_table_tiles has no table and
+// all BDs go to the overflow map.
+class bd_index
+{
+public:
+  struct entry
+  {
+    uint32_t offset = 0;                 // offset of the BD payload in the txn
+    uint64_t buffer_length_in_bytes = 0;
+    bool valid = false;
+    bool patched = false;
+  };
+
+  struct stats
+  {
+    uint32_t indexed = 0; // BD writes inserted
+    uint32_t patched = 0; // BD writes referenced by a patch op
+  };
+
+private:
+  // shim layout BDs first, then mem tile layout BDs
+  static constexpr uint32_t slots_per_tile = aie2_bd::shim_bd_num + aie2_bd::mem_bd_num;
+  // tiles of the largest AIE2 array with room to spare, 384 KiB of table
+  static constexpr uint32_t max_table_tiles = 256;
+
+  static bool
+  fits_table(uint32_t cols, uint32_t rows)
+  {
+    return cols <= aie2_bd::col_mask + 1 && rows <= aie2_bd::row_mask + 1 && cols * rows <= max_table_tiles;
+  }
+
+  uint32_t m_cols;
+  uint32_t m_rows;
+  std::vector<entry> m_table;
+  std::unordered_map<uint64_t, entry> m_overflow;
+  stats m_stats;
+
+  entry*
+  slot(uint64_t reg)
+  {
+    if (reg >> 32)
+      return nullptr;
+    auto reg32 = static_cast<uint32_t>(reg);
+    auto loc = aie2_bd::decode(reg32);
+    auto col = aie2_bd::column(reg32);
+    auto row = aie2_bd::row(reg32);
+    if (!loc.valid() || loc.word || col >= m_cols || row >= m_rows)
+      return nullptr;
+    auto bd = loc.kind == aie2_bd::tile::shim ? loc.bd : aie2_bd::shim_bd_num + loc.bd;
+    return &m_table[(col * m_rows + row) * slots_per_tile + bd];
+  }
+
+public:
+  bd_index(uint32_t cols, uint32_t rows)
+    : m_cols(fits_table(cols, rows) ? cols : 0), m_rows(fits_table(cols, rows) ? rows : 0),
+      m_table(static_cast<size_t>(m_cols) * m_rows * slots_per_tile)
+  {}
+
+  // A later write of the same BD replaces the earlier one
+  void
+  insert(uint64_t reg, uint32_t offset, uint64_t buffer_length_in_bytes)
+  {
+    entry* e = slot(reg);
+    if (!e)
+      e = &m_overflow[reg];
+    *e = {offset, buffer_length_in_bytes, true, false};
+    ++m_stats.indexed;
+  }
+
+  // Returns the BD written at reg and counts it as patched,
+  // nullptr if no BD was written there
+  const entry*
+  patch(uint64_t reg)
+  {
+    entry* e = slot(reg);
+    if (!e) {
+      auto it = m_overflow.find(reg);
+      e = it == m_overflow.end() ? nullptr : &it->second;
+    }
+    if (!e || !e->valid)
+      return nullptr;
+    if (!e->patched) {
+      e->patched = true;
+      ++m_stats.patched;
+    }
+    return e;
+  }
+
+  const stats&
+  get_stats() const
+  {
+    return m_stats;
+  }
+};
+
+}
+#endif //_AIEBU_PREPROCESSOR_AIE2_BD_INDEX_H_
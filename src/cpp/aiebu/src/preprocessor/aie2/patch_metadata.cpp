@@ -0,0 +1,715 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#include <cstring>
+#include <boost/format.hpp>
+
+#include "patch_metadata.h"
+#include "aiebu_error.h"
+#include "json_reader.h"
+#include "symbol.h"
+
+namespace aiebu::patch_metadata {
+
+namespace {
+
+/*
+sample json
+{
+    "external_buffers": {
+        "buffer0": {
+            "xrt_id": 1,
+            "size_in_bytes": 345088,
+            "name": "coalesed_weights",
+            "coalesed_buffers": [
+                {
+                    "logical_id": 0,
+                    "offset_in_bytes": 0,
+                    "name": "compute_graph.resnet_layers[0].wts_ddr",
+                    "control_packet_patch_locations": [
+                        {
+                            "offset": 17420,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 17484,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 17548,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 17612,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        }
+                    ]
+                },
+                {
+                    "logical_id": 1,
+                    "offset_in_bytes": 37888,
+                    "name": "compute_graph.resnet_layers[1].wts_ddr",
+                    "control_packet_patch_locations": [
+                        {
+                            "offset": 19404,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 19468,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 19532,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 19596,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        }
+                    ]
+                },
+                {
+                    "logical_id": 2,
+                    "offset_in_bytes": 195584,
+                    "name": "compute_graph.resnet_layers[2].wts_ddr",
+                    "control_packet_patch_locations": [
+                        {
+                            "offset": 40012,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 40076,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 40140,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        },
+                        {
+                            "offset": 40204,
+                            "size": 6,
+                            "operation": "read_add_write"
+                        }
+                    ]
+                }
+            ]
+        },
+        "buffer1": {
+            "xrt_id": 2,
+            "logical_id": 3,
+            "size_in_bytes": 802816,
+            "name": "compute_graph.ifm_ddr",
+            "control_packet_patch_locations": [
+                {
+                    "offset": 12,
+                    "size": 6,
+                    "operation": "read_add_write"
+                },
+                {
+                    "offset": 76,
+                    "size": 6,
+                    "operation": "read_add_write"
+                }
+            ]
+        },
+        "buffer2": {
+            "xrt_id": 3,
+            "logical_id": 4,
+            "size_in_bytes": 458752,
+            "name": "compute_graph.ofm_ddr",
+            "control_packet_patch_locations": [
+                {
+                    "offset": 60428,
+                    "size": 6,
+                    "operation": "read_add_write"
+                },
+                {
+                    "offset": 60492,
+                    "size": 6,
+                    "operation": "read_add_write"
+                }
+            ]
+        },
+        "buffer3": {
+            "xrt_id": 0,
+            "logical_id": -1,
+            "size_in_bytes": 60736,
+            "ctrl_pkt_buffer": 1,
+            "name": "runtime_control_packet"
+        }
+    }
+}
+*/
+// A scalar member read with the semantics of boost::property_tree get:
+// the first occurrence of a name wins, a container or text that does not
+// convert reads as an invalid value.
+struct json_field
+{
+  bool present = false;
+  bool valid32 = false;
+  bool valid64 = false;
+  bool valid_bool = false;
+  uint32_t u32 = 0;
+  uint64_t u64 = 0;
+  bool b = false;
+
+  void
+  read(json_reader& reader)
+  {
+    if (present || reader.is_container()) {
+      present = true;
+      reader.skip();
+      return;
+    }
+    present = true;
+    auto value = reader.value();
+    valid32 = json_reader::to_uint32(value, u32);
+    valid64 = json_reader::to_uint64(value, u64);
+    valid_bool = json_reader::to_bool(value, b);
+  }
+
+  [[noreturn]] static void
+  missing(const char* name, bool present)
+  {
+    throw error(error::error_code::invalid_asm, std::string("INVALID JSON: ")
+                + (present ? "invalid value of " : "missing ") + name + ". ");
+  }
+
+  uint32_t
+  get_u32(const char* name) const
+  {
+    if (!valid32)
+      missing(name, present);
+    return u32;
+  }
+
+  uint64_t
+  get_u64(const char* name) const
+  {
+    if (!valid64)
+      missing(name, present);
+    return u64;
+  }
+
+  uint64_t
+  get_u64_or(uint64_t value) const
+  {
+    return valid64 ? u64 : value;
+  }
+
+  int32_t
+  get_id() const
+  {
+    return valid32 ? static_cast<int32_t>(u32) : -1;
+  }
+};
+
+// A string member, the first occurrence wins
+void
+read_string(json_reader& reader, bool& present, std::string& out)
+{
+  if (present || reader.is_container()) {
+    present = true;
+    reader.skip();
+    return;
+  }
+  present = true;
+  out = reader.value().text;
+}
+
+struct json_patch
+{
+  json_field offset;
+  json_field size;
+  bool has_operation = false;
+  std::string operation;
+};
+
+// One entry of external_buffers. Members may come in any order so the
+// patch locations are held until the entry is complete. Coalesced
+// buffers index ranges of patches.
+struct json_external_buffer
+{
+  struct coalesed_buffer
+  {
+    json_field logical_id;
+    json_field offset_in_bytes;
+    bool has_name = false;
+    std::string name;
+    size_t first = 0;
+    size_t count = 0;
+  };
+
+  json_field xrt_id;
+  json_field logical_id;
+  json_field size_in_bytes;
+  json_field offset_in_bytes;
+  json_field ctrl_pkt_buffer;
+  bool has_name = false;
+  std::string name;
+  bool has_coalesed_buffers = false;
+  std::vector<coalesed_buffer> coalesed_buffers;
+  bool has_patch_locations = false;
+  size_t first = 0;
+  size_t count = 0;
+  std::vector<json_patch> patches;
+
+  void
+  clear()
+  {
+    // vectors keep their capacity for the next entry
+    auto coalesed = std::move(coalesed_buffers);
+    auto locations = std::move(patches);
+    *this = {};
+    coalesed.clear();
+    locations.clear();
+    coalesed_buffers = std::move(coalesed);
+    patches = std::move(locations);
+  }
+};
+
+struct json_dma_patch
+{
+  json_field offset;
+  json_field xrt_arg_idx;
+  json_field bo_offset;
+};
+
+// Call fn for each member of an object, or each element of an array with
+// an empty name, like the children of a ptree node. A scalar has none.
+template <typename Fn>
+void
+for_each_child(json_reader& reader, Fn&& fn)
+{
+  if (!reader.is_container()) {
+    reader.skip();
+    return;
+  }
+  reader.enter();
+  std::string_view key;
+  while (reader.next(&key))
+    fn(key);
+}
+
+// Append each patch location, returns their number
+size_t
+read_patch_locations(json_reader& reader, std::vector<json_patch>& patches)
+{
+  size_t count = 0;
+  for_each_child(reader, [&](std::string_view) {
+    auto& patch = patches.emplace_back();
+    ++count;
+    for_each_child(reader, [&](std::string_view key) {
+      if (key == "offset")
+        patch.offset.read(reader);
+      else if (key == "size")
+        patch.size.read(reader);
+      else if (key == "operation")
+        read_string(reader, patch.has_operation, patch.operation);
+      else
+        reader.skip();
+    });
+  });
+  return count;
+}
+
+uint8_t
+to_operation(const json_patch& patch)
+{
+  if (!patch.has_operation)
+    return static_cast<uint8_t>(operation::unspecified);
+  if (patch.operation == "read_add_write")
+    return static_cast<uint8_t>(operation::read_add_write);
+  return static_cast<uint8_t>(operation::other);
+}
+
+constexpr uint8_t control_packet_schema = static_cast<uint8_t>(symbol::patch_schema::control_packet_48);
+
+class json_parser
+{
+  builder& m_builder;
+  json_reader m_reader;
+
+  void
+  add_patches(uint32_t xrt_id, int32_t logical_id, uint64_t addend,
+              const std::vector<json_patch>& patches, size_t first, size_t count)
+  {
+    for (size_t i = first; i < first + count; ++i) {
+      const auto& patch = patches[i];
+      m_builder.add_patch({xrt_id, logical_id, patch.offset.get_u32("offset"),
+                           patch.size.valid32 ? patch.size.u32 : 0, addend,
+                           to_operation(patch), control_packet_schema, {}});
+    }
+  }
+
+  void
+  add_external_buffer(const json_external_buffer& buffer)
+  {
+    auto xrt_id = buffer.xrt_id.get_u32("xrt_id");
+    uint32_t flags = buffer.ctrl_pkt_buffer.valid_bool && buffer.ctrl_pkt_buffer.b ? buffer_flag_control_packet : 0;
+    m_builder.add_buffer({xrt_id, buffer.logical_id.get_id(), buffer.size_in_bytes.get_u64_or(0),
+                          m_builder.intern(buffer.name), flags});
+
+    if (!buffer.has_coalesed_buffers) {
+      const uint64_t addend = validate_addend(buffer.offset_in_bytes.get_u64_or(0));
+      add_patches(xrt_id, buffer.logical_id.get_id(), addend, buffer.patches, buffer.first, buffer.count);
+      return;
+    }
+
+    uint32_t buffer_size = buffer.size_in_bytes.get_u32("size_in_bytes");
+    for (const auto& coalesed_buffer : buffer.coalesed_buffers) {
+      uint32_t buffer_offset = coalesed_buffer.offset_in_bytes.get_u32("offset_in_bytes");
+      // Check if the buffer offset is within the buffer size
+      validate_offset(buffer_offset, buffer_size, xrt_id, false);
+      m_builder.add_buffer({xrt_id, coalesed_buffer.logical_id.get_id(), buffer_offset,
+                            m_builder.intern(coalesed_buffer.name), flags | buffer_flag_coalesed});
+      const uint64_t addend = validate_addend(coalesed_buffer.offset_in_bytes.get_u64_or(0));
+      add_patches(xrt_id, coalesed_buffer.logical_id.get_id(), addend,
+                  buffer.patches, coalesed_buffer.first, coalesed_buffer.count);
+    }
+  }
+
+  void
+  read_coalesed_buffers(json_external_buffer& buffer)
+  {
+    for_each_child(m_reader, [&](std::string_view) {
+      auto& coalesed_buffer = buffer.coalesed_buffers.emplace_back();
+      bool has_patch_locations = false;
+      for_each_child(m_reader, [&](std::string_view key) {
+        if (key == "offset_in_bytes")
+          coalesed_buffer.offset_in_bytes.read(m_reader);
+        else if (key == "logical_id")
+          coalesed_buffer.logical_id.read(m_reader);
+        else if (key == "name")
+          read_string(m_reader, coalesed_buffer.has_name, coalesed_buffer.name);
+        else if (key == "control_packet_patch_locations" && !has_patch_locations) {
+          has_patch_locations = true;
+          coalesed_buffer.first = buffer.patches.size();
+          coalesed_buffer.count = read_patch_locations(m_reader, buffer.patches);
+        }
+        else
+          m_reader.skip();
+      });
+    });
+  }
+
+  // external_buffers, records are added as each buffer completes
+  void
+  read_aiecompiler()
+  {
+    json_external_buffer buffer;
+    for_each_child(m_reader, [&](std::string_view) {
+      buffer.clear();
+      for_each_child(m_reader, [&](std::string_view key) {
+        if (key == "xrt_id")
+          buffer.xrt_id.read(m_reader);
+        else if (key == "logical_id")
+          buffer.logical_id.read(m_reader);
+        else if (key == "size_in_bytes")
+          buffer.size_in_bytes.read(m_reader);
+        else if (key == "offset_in_bytes")
+          buffer.offset_in_bytes.read(m_reader);
+        else if (key == "ctrl_pkt_buffer")
+          buffer.ctrl_pkt_buffer.read(m_reader);
+        else if (key == "name")
+          read_string(m_reader, buffer.has_name, buffer.name);
+        else if (key == "control_packet_patch_locations" && !buffer.has_patch_locations) {
+          buffer.has_patch_locations = true;
+          buffer.first = buffer.patches.size();
+          buffer.count = read_patch_locations(m_reader, buffer.patches);
+        }
+        else if (key == "coalesed_buffers" && !buffer.has_coalesed_buffers) {
+          buffer.has_coalesed_buffers = true;
+          read_coalesed_buffers(buffer);
+        }
+        else
+          m_reader.skip();
+      });
+      add_external_buffer(buffer);
+    });
+  }
+
+  void
+  read_dmacompiler(std::vector<json_dma_patch>& patches)
+  {
+    for_each_child(m_reader, [&](std::string_view) {
+      auto& patch = patches.emplace_back();
+      for_each_child(m_reader, [&](std::string_view key) {
+        if (key == "offset")
+          patch.offset.read(m_reader);
+        else if (key == "xrt_arg_idx")
+          patch.xrt_arg_idx.read(m_reader);
+        else if (key == "bo_offset")
+          patch.bo_offset.read(m_reader);
+        else
+          m_reader.skip();
+      });
+    });
+  }
+
+  void
+  add_dmacompiler(const json_field& ctrl_pkt_xrt_arg_idx, const std::vector<json_dma_patch>& patches)
+  {
+    // args 0-4 are fixed in dma compiler, the control packet is
+    // "ctrl_pkt_xrt_arg_idx" when present else arg4
+    const uint32_t ctrl_pkt = ctrl_pkt_xrt_arg_idx.valid32 ? ctrl_pkt_xrt_arg_idx.u32 : 4;
+    for (uint32_t arg = 0; arg <= 4; ++arg)
+      m_builder.add_buffer({arg, -1, 0, 0, arg == ctrl_pkt ? buffer_flag_control_packet : 0});
+    if (ctrl_pkt > 4)
+      m_builder.add_buffer({ctrl_pkt, -1, 0, 0, buffer_flag_control_packet});
+
+    for (const auto& patch : patches) {
+      uint32_t offset = patch.offset.get_u32("offset");
+      uint32_t arg_index = patch.xrt_arg_idx.get_u32("xrt_arg_idx");
+      const uint64_t addend = validate_addend(patch.bo_offset.get_u64("bo_offset"));
+      m_builder.add_patch({arg_index, -1, offset, 0, addend,
+                           static_cast<uint8_t>(operation::unspecified), control_packet_schema, {}});
+    }
+  }
+
+public:
+  json_parser(builder& b, const char* data, size_t size)
+    : m_builder(b), m_reader(data, size)
+  {}
+
+  // Single pass over the json. The dmacompiler schema is only used when
+  // the document has no external_buffers, which may follow its patches,
+  // so those are held until the end.
+  void
+  parse()
+  {
+    bool aiecompiler_json = false;
+    bool dmacompiler_json = false;
+    json_field ctrl_pkt_xrt_arg_idx;
+    std::vector<json_dma_patch> dma_patches;
+
+    if (m_reader.peek() != json_reader::kind::object) {
+      m_reader.skip();
+      m_reader.finish();
+      return;
+    }
+
+    m_reader.enter();
+    std::string_view key;
+    while (m_reader.next(&key)) {
+      if (key == "external_buffers" && !aiecompiler_json) {
+        aiecompiler_json = true;
+        read_aiecompiler();
+      }
+      else if (key == "ctrl_pkt_patch_info" && !dmacompiler_json && !aiecompiler_json) {
+        dmacompiler_json = true;
+        read_dmacompiler(dma_patches);
+      }
+      else if (key == "ctrl_pkt_xrt_arg_idx")
+        ctrl_pkt_xrt_arg_idx.read(m_reader);
+      else
+        m_reader.skip();
+    }
+    m_reader.finish();
+
+    if (dmacompiler_json && !aiecompiler_json)
+      add_dmacompiler(ctrl_pkt_xrt_arg_idx, dma_patches);
+  }
+};
+
+constexpr size_t
+align8(size_t value)
+{
+  return (value + 7) & ~size_t(7);
+}
+
+[[noreturn]] void
+malformed(const std::string& msg)
+{
+  throw error(error::error_code::invalid_asm, "Invalid patch metadata: " + msg + " !!!");
+}
+
+// The checks json_parser::add_external_buffer() makes on coalesced
+// buffers, for buffer records that were not read from json
+void
+validate_buffers(const view& v)
+{
+  const buffer_record* parent = nullptr;
+  for (size_t i = 0; i < v.num_buffers; ++i) {
+    const auto& buffer = v.buffers[i];
+    if (!(buffer.flags & buffer_flag_coalesed)) {
+      parent = &buffer;
+      continue;
+    }
+    if (!parent || parent->xrt_id != buffer.xrt_id)
+      malformed("coalesed buffer " + std::to_string(i) + " does not follow its buffer");
+    if (parent->size_in_bytes > UINT32_MAX)
+      json_field::missing("size_in_bytes", true);
+    if (buffer.size_in_bytes > UINT32_MAX)
+      json_field::missing("offset_in_bytes", true);
+    validate_offset(static_cast<uint32_t>(buffer.size_in_bytes), static_cast<uint32_t>(parent->size_in_bytes),
+                    buffer.xrt_id, false);
+  }
+}
+
+}
+
+bool
+is_binary(const char* data, size_t size)
+{
+  return size >= sizeof(magic) && !std::memcmp(data, magic, sizeof(magic));
+}
+
+view
+parse(const char* data, size_t size)
+{
+  if (!is_binary(data, size) || size < sizeof(header))
+    malformed("bad magic or truncated header");
+  if (reinterpret_cast<uintptr_t>(data) % alignof(header))
+    malformed("buffer is not 8 byte aligned");
+
+  const auto& hdr = *reinterpret_cast<const header*>(data);
+  if (hdr.version != version)
+    malformed("unsupported version " + std::to_string(hdr.version));
+  if (hdr.header_size < sizeof(header) || hdr.header_size > size)
+    malformed("bad header size");
+
+  // offset + count * record size must stay within the buffer, checked
+  // without overflow
+  auto check = [size](uint64_t offset, uint64_t count, size_t record, const char* what) {
+    if (offset % 8 || offset > size || count > (size - offset) / record)
+      malformed(std::string("bad ") + what + " table");
+  };
+  check(hdr.buffers_offset, hdr.num_buffers, sizeof(buffer_record), "buffer");
+  check(hdr.patches_offset, hdr.num_patches, sizeof(patch_record), "patch");
+  check(hdr.strtab_offset, hdr.strtab_size, 1, "string");
+  if (!hdr.strtab_size || data[hdr.strtab_offset + hdr.strtab_size - 1])
+    malformed("string table is not terminated");
+
+  view v;
+  v.buffers = reinterpret_cast<const buffer_record*>(data + hdr.buffers_offset);
+  v.num_buffers = hdr.num_buffers;
+  v.patches = reinterpret_cast<const patch_record*>(data + hdr.patches_offset);
+  v.num_patches = hdr.num_patches;
+  v.strtab = data + hdr.strtab_offset;
+  v.strtab_size = hdr.strtab_size;
+
+  uint32_t bad = 0;
+  for (size_t i = 0; i < v.num_buffers; ++i)
+    bad |= v.buffers[i].name >= v.strtab_size;
+  if (bad)
+    malformed("bad buffer name");
+  for (size_t i = 0; i < v.num_patches; ++i)
+    bad |= (v.patches[i].schema < static_cast<uint8_t>(symbol::patch_schema::uc_dma_remote_ptr_symbol))
+         | (v.patches[i].schema > static_cast<uint8_t>(symbol::patch_schema::shim_dma_57_aie4));
+  if (bad)
+    malformed("bad patch schema");
+  validate_buffers(v);
+  return v;
+}
+
+uint32_t
+builder::
+intern(std::string_view name)
+{
+  if (name.empty())
+    return 0;
+  auto it = m_names.find(name);
+  if (it != m_names.end())
+    return it->second;
+  auto offset = static_cast<uint32_t>(m_strtab.size());
+  m_strtab.append(name.data(), name.size());
+  m_strtab += '\0';
+  m_names.emplace(name, offset);
+  return offset;
+}
+
+view
+builder::
+get_view() const
+{
+  return {m_buffers.data(), m_buffers.size(), m_patches.data(), m_patches.size(),
+          m_strtab.data(), m_strtab.size()};
+}
+
+std::vector<char>
+builder::
+serialize() const
+{
+  header hdr = {};
+  std::memcpy(hdr.magic, magic, sizeof(magic));
+  hdr.version = version;
+  hdr.header_size = sizeof(header);
+  hdr.num_buffers = static_cast<uint32_t>(m_buffers.size());
+  hdr.num_patches = static_cast<uint32_t>(m_patches.size());
+  hdr.buffers_offset = align8(sizeof(header));
+  hdr.patches_offset = align8(hdr.buffers_offset + m_buffers.size() * sizeof(buffer_record));
+  hdr.strtab_offset = align8(hdr.patches_offset + m_patches.size() * sizeof(patch_record));
+  hdr.strtab_size = m_strtab.size();
+
+  std::vector<char> out(align8(hdr.strtab_offset + hdr.strtab_size), 0);
+  std::memcpy(out.data(), &hdr, sizeof(hdr));
+  if (!m_buffers.empty())
+    std::memcpy(out.data() + hdr.buffers_offset, m_buffers.data(), m_buffers.size() * sizeof(buffer_record));
+  if (!m_patches.empty())
+    std::memcpy(out.data() + hdr.patches_offset, m_patches.data(), m_patches.size() * sizeof(patch_record));
+  std::memcpy(out.data() + hdr.strtab_offset, m_strtab.data(), m_strtab.size());
+  return out;
+}
+
+builder
+from_json(const char* data, size_t size)
+{
+  builder b;
+  json_parser(b, data, size).parse();
+  return b;
+}
+
+void
+validate_offset(uint32_t offset, uint32_t size, uint32_t arg_index, bool control_packet)
+{
+  // Return if the offset and arg_index are within their respective sizes.
+  if ((offset <= size) && (arg_index <= max_arg_index)) {
+    return;
+  }
+  std::string errorMessage;
+  if (offset > size ) {
+    errorMessage = std::string("INVALID JSON: Offset(")
+    + std::to_string(offset)
+    + ") is greater than size("
+    + std::to_string(size)
+    + ") for offset Type: "
+    + (control_packet ? "CONTROL PACKET" : "BUFFER")
+    + " and arg index is "
+    + (arg_index > max_arg_index ? "INVALID = " : "VALID = ")
+    + std::to_string(arg_index) + ". ";
+  }
+  else {
+    errorMessage = std::string("INVALID JSON: arg index (")
+    + std::to_string(arg_index)
+    + ") is greater than Max arg index ="
+    + std::to_string(max_arg_index)
+    + ". ";
+  }
+  throw error(error::error_code::invalid_asm, errorMessage);
+}
+
+uint32_t
+validate_addend(uint64_t addend)
+{
+  // we dont support addend greater then 32 bit
+  if (addend > max_addend)
+  {
+    auto error_msg = boost::format("Invalid addend (0x%x) > 32bit found") % addend;
+    throw error(error::error_code::invalid_asm, error_msg.str());
+  }
+  return static_cast<uint32_t>(addend);
+}
+
+}
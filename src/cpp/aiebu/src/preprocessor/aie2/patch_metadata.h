@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024, Advanced Micro Devices, Inc. All rights reserved.
+
+#ifndef _AIEBU_PREPROCESSOR_AIE2_PATCH_METADATA_H_
+#define _AIEBU_PREPROCESSOR_AIE2_PATCH_METADATA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace aiebu::patch_metadata {
+
+// Control packet patching information of a transaction.
+//
+// It is read from the aiecompiler or dmacompiler patch json, or from a
+// binary form which is used in place without parsing. The binary form is
+// little endian and laid out as
+//
+//   header | buffer records | patch records | string table
+//
+// with each part 8 byte aligned, so a memory mapped file can be used
+// directly. Buffer records describe the xrt arguments, patch records the
+// control packet locations patched with a buffer address. Names are
+// offsets into the string table, offset 0 is the empty string.
+
+constexpr char magic[8] = {'A', 'I', 'E', 'B', 'U', 'P', 'M', '\0'};
+constexpr uint16_t version = 1;
+
+constexpr uint32_t max_arg_index = 24; // approximated value 24 to limit the number of arguments in XRT kernel call
+constexpr uint64_t max_addend = 0xFFFFFFFF; // Max argplus/addend supported
+
+enum class operation : uint8_t
+{
+  unspecified = 0,
+  read_add_write = 1,
+  other = 0xFF
+};
+
+struct header
+{
+  char magic[8];
+  uint16_t version;
+  uint16_t header_size;
+  uint32_t flags;
+  uint32_t num_buffers;
+  uint32_t num_patches;
+  uint64_t buffers_offset;
+  uint64_t patches_offset;
+  uint64_t strtab_offset;
+  uint64_t strtab_size;
+};
+
+constexpr uint32_t buffer_flag_control_packet = 1U << 0;
+constexpr uint32_t buffer_flag_coalesed = 1U << 1;       // a part of the preceding buffer
+
+struct buffer_record
+{
+  uint32_t xrt_id;
+  int32_t logical_id;      // -1 when not given
+  uint64_t size_in_bytes;  // offset in the preceding buffer when coalesed
+  uint32_t name;           // string table offset
+  uint32_t flags;          // buffer_flag_*
+};
+
+struct patch_record
+{
+  uint32_t xrt_id;
+  int32_t logical_id;      // -1 when not given
+  uint32_t offset;         // in .ctrldata, including the 8 byte packet header
+  uint32_t size;
+  uint64_t addend;
+  uint8_t operation;       // operation
+  uint8_t schema;          // symbol::patch_schema
+  uint8_t reserved[6];
+};
+
+static_assert(sizeof(header) == 56);
+static_assert(sizeof(buffer_record) == 24);
+static_assert(sizeof(patch_record) == 32);
+
+// Read only view of patch metadata, from a binary buffer or a builder
+struct view
+{
+  const buffer_record* buffers = nullptr;
+  size_t num_buffers = 0;
+  const patch_record* patches = nullptr;
+  size_t num_patches = 0;
+  const char* strtab = nullptr;
+  size_t strtab_size = 0;
+
+  std::string_view
+  name(uint32_t offset) const
+  {
+    return offset < strtab_size ? std::string_view(strtab + offset) : std::string_view();
+  }
+};
+
+// True when data starts with the binary patch metadata magic
+bool
+is_binary(const char* data, size_t size);
+
+// Validate a binary buffer and return a view into it, throws on a
+// malformed buffer. Coalesced buffers are checked as when read from json,
+// patch records are checked when they are used. data must be 8 byte
+// aligned.
+view
+parse(const char* data, size_t size);
+
+// Owning patch metadata
+class builder
+{
+  std::vector<buffer_record> m_buffers;
+  std::vector<patch_record> m_patches;
+  std::string m_strtab{'\0'};
+  std::map<std::string, uint32_t, std::less<>> m_names;
+
+public:
+  uint32_t intern(std::string_view name);
+
+  void
+  add_buffer(const buffer_record& buffer)
+  {
+    m_buffers.push_back(buffer);
+  }
+
+  void
+  add_patch(const patch_record& patch)
+  {
+    m_patches.push_back(patch);
+  }
+
+  view get_view() const;
+
+  // Binary form
+  std::vector<char> serialize() const;
+};
+
+// Read an aiecompiler (external_buffers) or dmacompiler
+// (ctrl_pkt_patch_info) patch json
+builder
+from_json(const char* data, size_t size);
+
+// Throws when offset is beyond size or arg_index beyond max_arg_index
+void
+validate_offset(uint32_t offset, uint32_t size, uint32_t arg_index, bool control_packet);
+
+// Throws when addend does not fit 32 bits
+uint32_t
+validate_addend(uint64_t addend);
+
+}
+#endif //_AIEBU_PREPROCESSOR_AIE2_PATCH_METADATA_H_
@@ -9,25 +9,37 @@
 #include <algorithm>
 #include <map>
 #include "symbol.h"
+#include "buffer_view.h"
+#include "mapped_file.h"
 #include "aiebu_error.h"
+#include "aiebu_assembler.h"
 
 namespace aiebu {
 
 class preprocessor_input
 {
 protected:
-  std::map<std::string, std::vector<char>> m_data;
-  std::vector<symbol> m_sym;
+  std::map<std::string, buffer_view> m_data;
+  // Files read by the assembler itself (e.g. libs), m_data holds views into them
+  std::vector<mapped_file> m_storage;
+  symbol_table m_sym;
+  assembly_stats m_stats;
+
+  buffer_view map_file(const std::string& filename)
+  {
+    m_storage.emplace_back(filename);
+    return buffer_view(m_storage.back().data(), m_storage.back().size());
+  }
 public:
   preprocessor_input() {}
   virtual ~preprocessor_input() = default;
 
-  virtual void set_args(const std::vector<char>&,
-                        const std::vector<char>& patch_json,
-                        const std::vector<char>&,
+  virtual void set_args(const buffer_view&,
+                        const buffer_view& patch_json,
+                        const buffer_view&,
                         const std::vector<std::string>&,
                         const std::vector<std::string>&,
-                        const std::map<uint8_t, std::vector<char> >& ctrlpkt) = 0;
+                        const std::map<uint8_t, buffer_view>& ctrlpkt) = 0;
 
   const std::vector<std::string> get_keys()
   {
@@ -37,27 +49,33 @@ public:
     return keys;
   }
 
-  virtual std::vector<char>& get_data(std::string& key)
+  virtual buffer_view& get_data(const std::string& key)
   {
     auto it = m_data.find(key);
     if (it == m_data.end())
       throw error(error::error_code::internal_error, "Key (" + key  + ") not found!!!");
-    return m_data[key];
+    return it->second;
   }
 
-  std::vector<symbol>& get_symbols()
+  symbol_table& get_symbols()
   {
     return m_sym;
   }
 
-  void add_symbol(const symbol buf)
+  const assembly_stats& get_stats() const
+  {
+    return m_stats;
+  }
+
+  void add_symbol(std::string_view name, offset_type pos, uint32_t addend, uint64_t size,
+                  std::string_view section_name, symbol::patch_schema schema)
   {
-    m_sym.emplace_back(buf);
+    m_sym.add(name, pos, addend, size, section_name, schema);
   }
 
-  void add_symbols(const std::vector<symbol>& syms)
+  void add_symbols(symbol_table&& syms)
   {
-    m_sym.insert( m_sym.end(), syms.begin(), syms.end());
+    m_sym.append(std::move(syms));
   }
 };
 
@@ -28,7 +28,7 @@ void main_helper(int argc, char** argv,
       .allow_unrecognised_options()
       .add_options()
       ("h,help", "show help message and exit", cxxopts::value<bool>()->default_value("false"))
-      ("t,target", "supported targets aie2txn/aie2dpu", cxxopts::value<decltype(target_name)>())
+      ("t,target", "supported targets aie2txn/aie2dpu/bundle/patchmeta/diff", cxxopts::value<decltype(target_name)>())
     ;
 
     auto result = global_options.parse(argc, argv);
@@ -80,6 +80,9 @@ int main( int argc, char** argv )
   {
     targets.emplace_back(std::make_shared<aiebu::utilities::target_aie2blob_transaction>(executable));
     targets.emplace_back(std::make_shared<aiebu::utilities::target_aie2blob_dpu>(executable));
+    targets.emplace_back(std::make_shared<aiebu::utilities::target_aie2blob_bundle>(executable));
+    targets.emplace_back(std::make_shared<aiebu::utilities::target_patch_metadata>(executable));
+    targets.emplace_back(std::make_shared<aiebu::utilities::target_diff>(executable));
   }
 
   // -- Program Description
@@ -1,18 +1,70 @@
 // SPDX-License-Identifier: MIT
 // Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved.
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <boost/format.hpp>
 
 #include "target.h"
+#include "aiebu_report.h"
 #include "utils.h"
 
-std::map<uint8_t, std::vector<char> >
+namespace {
+
+std::vector<std::string>
+split(const std::string& str, char delimiter)
+{
+  std::vector<std::string> fields;
+  std::stringstream ss(str);
+  std::string field;
+  while (std::getline(ss, field, delimiter))
+    fields.push_back(field);
+  return fields;
+}
+
+aiebu::elf_options::uid_algorithm
+uid_algorithm(const std::string& name)
+{
+  if (name == "md5")
+    return aiebu::elf_options::uid_algorithm::md5;
+  if (name == "xxh3_128")
+    return aiebu::elf_options::uid_algorithm::xxh3_128;
+  auto errMsg = boost::format("Unknown uid hash: %s, expected md5 or xxh3_128\n") % name;
+  throw std::runtime_error(errMsg.str());
+}
+
+aiebu::report_format
+parse_report_format(const std::string& name)
+{
+  if (name == "text")
+    return aiebu::report_format::text;
+  if (name == "json")
+    return aiebu::report_format::json;
+  if (name == "csv")
+    return aiebu::report_format::csv;
+  auto errMsg = boost::format("Unknown report format: %s, expected text, json or csv\n") % name;
+  throw std::runtime_error(errMsg.str());
+}
+
+// Built in table of a device or a json file overriding one
+aiebu::cost_table
+load_cost_table(const std::string& name)
+{
+  if (name == "phx" || name == "stx")
+    return aiebu::cost_table::get(name);
+  aiebu::mapped_file json(name);
+  return aiebu::cost_table::from_json({json.data(), json.size()});
+}
+
+}
+
+std::map<uint8_t, aiebu::mapped_file>
 aiebu::utilities::
 target_aie2blob::parse_pmctrlpkt(const std::vector<std::string> pm_key_value_pairs)
 {
-  std::map<uint8_t, std::vector<char> > mappmctrl;
+  std::map<uint8_t, aiebu::mapped_file> mappmctrl;
 
   for (const auto& kv : pm_key_value_pairs) {
     size_t pos = kv.find(':');
@@ -24,13 +76,21 @@ target_aie2blob::parse_pmctrlpkt(const std::vector<std::string> pm_key_value_pai
     std::string key = kv.substr(0, pos);
     uint8_t ikey = std::stoi(key);
     std::string value = kv.substr(pos + 1);
-    std::vector<char> buffer;
-    readfile(value, buffer);
-    mappmctrl[ikey] = buffer;
+    mappmctrl[ikey] = mapfile(value);
   }
   return mappmctrl;
 }
 
+std::map<uint8_t, aiebu::const_buffer>
+aiebu::utilities::
+target_aie2blob::get_ctrlpkt_buffers() const
+{
+  std::map<uint8_t, aiebu::const_buffer> buffers;
+  for (const auto& [id, file] : m_ctrlpkt)
+    buffers[id] = view(file);
+  return buffers;
+}
+
 bool
 aiebu::utilities::
 target_aie2blob::parseOption(const sub_cmd_options &_options)
@@ -50,7 +110,12 @@ target_aie2blob::parseOption(const sub_cmd_options &_options)
             ("l,lib", "linked libs", cxxopts::value<decltype(m_libs)>())
             ("L,libpath", "libs path", cxxopts::value<decltype(m_libpaths)>())
             ("m,pmctrl", "pm ctrlpkt <id>:<file>", cxxopts::value<decltype(pm_key_value_pairs)>())
-            ("r,report", "Generate Report", cxxopts::value<bool>()->default_value("false"))
+            ("r,report", "Generate Report: text, json, csv", cxxopts::value<std::string>()->implicit_value("text"))
+            ("compact-reloc", "Compact relocation section instead of .rela.dyn", cxxopts::value<bool>()->default_value("false"))
+            ("compress", "zlib compressed control code sections", cxxopts::value<bool>()->default_value("false"))
+            ("uid", "Hash of the UID note: md5, xxh3_128", cxxopts::value<std::string>()->default_value("md5"))
+            ("page-align", "Align loadable code segments to this many bytes, e.g. 4096", cxxopts::value<uint32_t>()->default_value("0"))
+            ("cost", "Estimate the control code cost: phx, stx or a cost table json file", cxxopts::value<std::string>())
             ("h,help", "show help message and exit", cxxopts::value<bool>()->default_value("false"))
     ;
 
@@ -87,7 +152,22 @@ target_aie2blob::parseOption(const sub_cmd_options &_options)
       pm_key_value_pairs = result["pmctrl"].as<decltype(pm_key_value_pairs)>();
 
     if (result.count("report"))
-      m_print_report = result["report"].as<decltype(m_print_report)>();
+      m_report = parse_report_format(result["report"].as<std::string>());
+
+    if (result.count("compact-reloc"))
+      m_elf_options.compact_relocations = result["compact-reloc"].as<bool>();
+
+    if (result.count("compress"))
+      m_elf_options.compress_sections = result["compress"].as<bool>();
+
+    if (result.count("uid"))
+      m_elf_options.uid = uid_algorithm(result["uid"].as<std::string>());
+
+    if (result.count("page-align"))
+      m_elf_options.page_align = result["page-align"].as<uint32_t>();
+
+    if (result.count("cost"))
+      m_cost_table = result["cost"].as<std::string>();
 
   }
   catch (const cxxopts::exceptions::exception& e) {
@@ -96,19 +176,41 @@ target_aie2blob::parseOption(const sub_cmd_options &_options)
     throw std::runtime_error(errMsg.str());
   }
 
-  readfile(input_file, m_transaction_buffer);
+  m_transaction_buffer = mapfile(input_file);
 
   m_ctrlpkt = parse_pmctrlpkt(pm_key_value_pairs);
 
   if (!controlpkt_file.empty())
-    readfile(controlpkt_file, m_control_packet_buffer);
+    m_control_packet_buffer = mapfile(controlpkt_file);
 
   if (!external_buffers_file.empty())
-    readfile(external_buffers_file, m_patch_data_buffer);
+    m_patch_data_buffer = mapfile(external_buffers_file);
 
   return true;
 }
 
+std::ostream&
+aiebu::utilities::
+target_aie2blob::log() const
+{
+  if (m_report && *m_report != aiebu::report_format::text)
+    return std::cerr;
+  return std::cout;
+}
+
+void
+aiebu::utilities::
+target_aie2blob::print_analysis(const aiebu::aiebu_assembler& as) const
+{
+  if (m_report)
+    as.get_report(std::cout, *m_report);
+
+  if (!m_cost_table.empty()) {
+    aiebu::elf_view elf(as.get_elf_buffer());
+    aiebu::write_text(aiebu::estimate_cost(elf, load_cost_table(m_cost_table)), log());
+  }
+}
+
 void
 aiebu::utilities::
 target_aie2blob_dpu::assemble(const sub_cmd_options &_options)
@@ -118,11 +220,10 @@ target_aie2blob_dpu::assemble(const sub_cmd_options &_options)
 
   try {
     aiebu::aiebu_assembler as(aiebu::aiebu_assembler::buffer_type::blob_instr_dpu,
-                              m_transaction_buffer, m_control_packet_buffer, m_patch_data_buffer,
-                              m_libs, m_libpaths);
-    write_elf(as, m_output_elffile);
-    if (m_print_report)
-      as.get_report(std::cout);
+                              view(m_transaction_buffer), view(m_control_packet_buffer), view(m_patch_data_buffer),
+                              m_libs, m_libpaths, {}, m_elf_options);
+    write_elf(as, m_output_elffile, log());
+    print_analysis(as);
   } catch (aiebu::error &ex) {
     auto errMsg = boost::format("Error: %s, code:%d\n") % ex.what() % ex.get_code() ;
     throw std::runtime_error(errMsg.str());
@@ -138,10 +239,256 @@ target_aie2blob_transaction::assemble(const sub_cmd_options &_options)
 
   try {
     aiebu::aiebu_assembler as(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
-                              m_transaction_buffer, m_control_packet_buffer, m_patch_data_buffer, m_libs, m_libpaths, m_ctrlpkt);
-    write_elf(as, m_output_elffile);
-    if (m_print_report)
-      as.get_report(std::cout);
+                              view(m_transaction_buffer), view(m_control_packet_buffer), view(m_patch_data_buffer),
+                              m_libs, m_libpaths, get_ctrlpkt_buffers(), m_elf_options);
+    write_elf(as, m_output_elffile, log());
+    print_analysis(as);
+  } catch (aiebu::error &ex) {
+    auto errMsg = boost::format("Error: %s, code:%d\n") % ex.what() % ex.get_code() ;
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+aiebu::const_buffer
+aiebu::utilities::
+target_aie2blob_bundle::read(const std::string& filename, std::vector<aiebu::mapped_file>& files)
+{
+  if (filename.empty())
+    return {};
+  // jobs reference the mapping, files keeps it alive
+  files.emplace_back(filename);
+  return {files.back().data(), files.back().size()};
+}
+
+void
+aiebu::utilities::
+target_aie2blob_bundle::assemble(const sub_cmd_options &_options)
+{
+  std::string output_file;
+  std::vector<std::string> kernel_specs;
+  std::vector<std::string> pm_specs;
+  std::vector<std::string> libs;
+  std::vector<std::string> libpaths;
+  aiebu::elf_options elf_options;
+  cxxopts::Options all_options("Target bundle Options", m_description);
+
+  try {
+    all_options.add_options()
+            ("o,outputelf", "ELF output file name", cxxopts::value<decltype(output_file)>())
+            ("k,kernel", "kernel <name>:<controlcode>[:<controlpkt>[:<json>]]", cxxopts::value<decltype(kernel_specs)>())
+            ("m,pmctrl", "pm ctrlpkt of a kernel <name>:<id>:<file>", cxxopts::value<decltype(pm_specs)>())
+            ("l,lib", "linked libs, for all kernels", cxxopts::value<decltype(libs)>())
+            ("L,libpath", "libs path", cxxopts::value<decltype(libpaths)>())
+            ("compact-reloc", "Compact relocation section instead of .rela.dyn", cxxopts::value<bool>()->default_value("false"))
+            ("compress", "zlib compressed control code sections", cxxopts::value<bool>()->default_value("false"))
+            ("uid", "Hash of the UID note: md5, xxh3_128", cxxopts::value<std::string>()->default_value("md5"))
+            ("page-align", "Align loadable code segments to this many bytes, e.g. 4096", cxxopts::value<uint32_t>()->default_value("0"))
+            ("h,help", "show help message and exit", cxxopts::value<bool>()->default_value("false"))
+    ;
+
+    auto char_ver = aiebu::utilities::vector_of_string_to_vector_of_char(_options);
+
+    auto result = all_options.parse(char_ver.size(), char_ver.data());
+
+    if (result.count("help")) {
+      std::cout << all_options.help({"", "Target bundle Options"});
+      return;
+    }
+
+    if (result.count("outputelf"))
+      output_file = result["outputelf"].as<decltype(output_file)>();
+    else
+      throw std::runtime_error("the option '--outputelf' is required but missing\n");
+
+    if (result.count("kernel"))
+      kernel_specs = result["kernel"].as<decltype(kernel_specs)>();
+    else
+      throw std::runtime_error("the option '--kernel' is required but missing\n");
+
+    if (result.count("pmctrl"))
+      pm_specs = result["pmctrl"].as<decltype(pm_specs)>();
+
+    if (result.count("lib"))
+      libs = result["lib"].as<decltype(libs)>();
+
+    if (result.count("libpath"))
+      libpaths = result["libpath"].as<decltype(libpaths)>();
+
+    if (result.count("compact-reloc"))
+      elf_options.compact_relocations = result["compact-reloc"].as<bool>();
+
+    if (result.count("compress"))
+      elf_options.compress_sections = result["compress"].as<bool>();
+
+    if (result.count("uid"))
+      elf_options.uid = uid_algorithm(result["uid"].as<std::string>());
+
+    if (result.count("page-align"))
+      elf_options.page_align = result["page-align"].as<uint32_t>();
+  }
+  catch (const cxxopts::exceptions::exception& e) {
+    std::cout << all_options.help({"", "Target bundle Options"});
+    auto errMsg = boost::format("Error parsing options: %s\n") % e.what() ;
+    throw std::runtime_error(errMsg.str());
+  }
+
+  std::vector<aiebu::mapped_file> files;
+  std::vector<aiebu::aiebu_assembler_bundle::kernel> kernels;
+  std::map<std::string, size_t> kernel_index;
+  for (const auto& spec : kernel_specs) {
+    auto fields = split(spec, ':');
+    if (fields.size() < 2 || fields.size() > 4) {
+      auto errMsg = boost::format("Invalid kernel: %s\n") % spec ;
+      throw std::runtime_error(errMsg.str());
+    }
+    fields.resize(4);
+    if (!file_exists(fields[1]))
+      throw std::runtime_error("file:" + fields[1] + " not found\n");
+
+    kernel_index[fields[0]] = kernels.size();
+    aiebu::aiebu_assembler_bundle::kernel k;
+    k.name = fields[0];
+    k.job.type = aiebu::aiebu_assembler::buffer_type::blob_instr_transaction;
+    k.job.buffer1 = read(fields[1], files);
+    k.job.buffer2 = read(fields[2], files);
+    k.job.patch_json = read(fields[3], files);
+    k.job.libs = libs;
+    k.job.libpaths = libpaths;
+    kernels.push_back(std::move(k));
+  }
+
+  for (const auto& spec : pm_specs) {
+    auto fields = split(spec, ':');
+    auto it = fields.size() == 3 ? kernel_index.find(fields[0]) : kernel_index.end();
+    if (it == kernel_index.end()) {
+      auto errMsg = boost::format("Invalid pmctrl: %s\n") % spec ;
+      throw std::runtime_error(errMsg.str());
+    }
+    kernels[it->second].job.pm_ctrlpkt[static_cast<uint8_t>(std::stoi(fields[1]))] = read(fields[2], files);
+  }
+
+  try {
+    aiebu::aiebu_assembler_bundle bundle(kernels, elf_options);
+    auto e = bundle.get_elf_buffer();
+    std::cout << "elf size:" << e.size << "\n";
+    aiebu::write_file(output_file, e.data, e.size);
+  } catch (aiebu::error &ex) {
+    auto errMsg = boost::format("Error: %s, code:%d\n") % ex.what() % ex.get_code() ;
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+void
+aiebu::utilities::
+target_patch_metadata::assemble(const sub_cmd_options &_options)
+{
+  std::string json_file;
+  std::string output_file;
+  cxxopts::Options all_options("Target patchmeta Options", m_description);
+
+  try {
+    all_options.add_options()
+            ("o,output", "binary patch metadata output file name", cxxopts::value<decltype(output_file)>())
+            ("j,json", "control packet Patching json file", cxxopts::value<decltype(json_file)>())
+            ("h,help", "show help message and exit", cxxopts::value<bool>()->default_value("false"))
+    ;
+
+    auto char_ver = aiebu::utilities::vector_of_string_to_vector_of_char(_options);
+
+    auto result = all_options.parse(char_ver.size(), char_ver.data());
+
+    if (result.count("help")) {
+      std::cout << all_options.help({"", "Target patchmeta Options"});
+      return;
+    }
+
+    if (result.count("output"))
+      output_file = result["output"].as<decltype(output_file)>();
+    else
+      throw std::runtime_error("the option '--output' is required but missing\n");
+
+    if (result.count("json"))
+      json_file = result["json"].as<decltype(json_file)>();
+    else
+      throw std::runtime_error("the option '--json' is required but missing\n");
+  }
+  catch (const cxxopts::exceptions::exception& e) {
+    std::cout << all_options.help({"", "Target patchmeta Options"});
+    auto errMsg = boost::format("Error parsing options: %s\n") % e.what() ;
+    throw std::runtime_error(errMsg.str());
+  }
+
+  auto json = mapfile(json_file);
+  try {
+    auto metadata = aiebu::aiebu_patch_metadata_from_json(view(json));
+    std::cout << "patch metadata size:" << metadata.size() << "\n";
+    aiebu::write_file(output_file, metadata.data(), metadata.size());
+  } catch (aiebu::error &ex) {
+    auto errMsg = boost::format("Error: %s, code:%d\n") % ex.what() % ex.get_code() ;
+    throw std::runtime_error(errMsg.str());
+  }
+}
+
+void
+aiebu::utilities::
+target_diff::assemble(const sub_cmd_options &_options)
+{
+  std::string old_file;
+  std::string new_file;
+  size_t max_changes = 1000;
+  cxxopts::Options all_options("Target diff Options", m_description);
+
+  try {
+    all_options.add_options()
+            ("a,old", "old elf or txn binary file name", cxxopts::value<decltype(old_file)>())
+            ("b,new", "new elf or txn binary file name", cxxopts::value<decltype(new_file)>())
+            ("m,max-changes", "changed ops listed, counts cover all", cxxopts::value<decltype(max_changes)>())
+            ("h,help", "show help message and exit", cxxopts::value<bool>()->default_value("false"))
+    ;
+
+    auto char_ver = aiebu::utilities::vector_of_string_to_vector_of_char(_options);
+
+    auto result = all_options.parse(char_ver.size(), char_ver.data());
+
+    if (result.count("help")) {
+      std::cout << all_options.help({"", "Target diff Options"});
+      return;
+    }
+
+    if (result.count("old"))
+      old_file = result["old"].as<decltype(old_file)>();
+    else
+      throw std::runtime_error("the option '--old' is required but missing\n");
+
+    if (result.count("new"))
+      new_file = result["new"].as<decltype(new_file)>();
+    else
+      throw std::runtime_error("the option '--new' is required but missing\n");
+
+    if (result.count("max-changes"))
+      max_changes = result["max-changes"].as<decltype(max_changes)>();
+  }
+  catch (const cxxopts::exceptions::exception& e) {
+    std::cout << all_options.help({"", "Target diff Options"});
+    auto errMsg = boost::format("Error parsing options: %s\n") % e.what() ;
+    throw std::runtime_error(errMsg.str());
+  }
+
+  // elfs start with the elf magic, anything else is taken as a txn binary
+  auto is_elf = [](const aiebu::mapped_file& file) {
+    return file.size() >= 4 && !std::memcmp(file.data(), "\x7f" "ELF", 4);
+  };
+  auto old_buffer = mapfile(old_file);
+  auto new_buffer = mapfile(new_file);
+  if (is_elf(old_buffer) != is_elf(new_buffer))
+    throw std::runtime_error("cannot diff an elf against a txn binary\n");
+
+  try {
+    if (is_elf(old_buffer))
+      aiebu::write_text(aiebu::diff(aiebu::elf_view(view(old_buffer)), aiebu::elf_view(view(new_buffer)), max_changes),
+                        std::cout);
+    else
+      aiebu::write_text(aiebu::diff_transaction(view(old_buffer), view(new_buffer), max_changes), std::cout);
   } catch (aiebu::error &ex) {
     auto errMsg = boost::format("Error: %s, code:%d\n") % ex.what() % ex.get_code() ;
     throw std::runtime_error(errMsg.str());
@@ -6,9 +6,12 @@
 
 #include <fstream>
 #include <filesystem>
+#include <iostream>
+#include <optional>
 
 #include "aiebu_assembler.h"
 #include "aiebu_error.h"
+#include "mapped_file.h"
 
 namespace aiebu::utilities {
 
@@ -27,23 +30,26 @@ protected:
     return std::filesystem::exists(name);
   }
 
-  inline void readfile(const std::string& filename, std::vector<char>& buffer)
+  // Inputs are memory mapped, not read into heap buffers
+  inline aiebu::mapped_file mapfile(const std::string& filename)
   {
     if (!file_exists(filename))
       throw std::runtime_error("file:" + filename + " not found\n");
 
-    std::ifstream input(filename, std::ios::in | std::ios::binary);
-    auto file_size = std::filesystem::file_size(filename);
-    buffer.resize(file_size);
-    input.read(buffer.data(), file_size);
+    return aiebu::mapped_file(filename);
   }
 
-  inline void write_elf(const aiebu::aiebu_assembler& as, const std::string& outfile)
+  static inline aiebu::const_buffer view(const aiebu::mapped_file& file)
   {
-    auto e = as.get_elf();
-    std::cout << "elf size:" << e.size() << "\n";
-    std::ofstream output_file(outfile, std::ios_base::binary);
-    output_file.write(e.data(), e.size());
+    return {file.data(), file.size()};
+  }
+
+  inline void write_elf(const aiebu::aiebu_assembler& as, const std::string& outfile,
+                        std::ostream& log = std::cout)
+  {
+    auto e = as.get_elf_buffer();
+    log << "elf size:" << e.size << "\n";
+    aiebu::write_file(outfile, e.data, e.size);
   }
 
 public:
@@ -63,20 +69,29 @@ public:
 class target_aie2blob: public target
 {
 protected:
-  std::vector<char> m_transaction_buffer;
-  std::vector<char> m_control_packet_buffer;
-  std::vector<char> m_patch_data_buffer;
+  aiebu::mapped_file m_transaction_buffer;
+  aiebu::mapped_file m_control_packet_buffer;
+  aiebu::mapped_file m_patch_data_buffer;
   std::vector<std::string> m_libs;
   std::vector<std::string> m_libpaths;
-  std::map<uint8_t, std::vector<char> > m_ctrlpkt;
+  std::map<uint8_t, aiebu::mapped_file> m_ctrlpkt;
   std::string m_output_elffile;
-  bool m_print_report = false;
+  std::optional<aiebu::report_format> m_report;
+  std::string m_cost_table;
+  aiebu::elf_options m_elf_options;
   target_aie2blob(const std::string& exename, const std::string& name, const std::string& description)
     : target(exename, name, description) {}
   bool parseOption(const sub_cmd_options &_options);
+  // Informational lines, on stderr when a json or csv report owns stdout
+  std::ostream& log() const;
+  // Report and cost estimate of the assembled elf, as asked for
+  void print_analysis(const aiebu::aiebu_assembler& as) const;
 
-  std::map<uint8_t, std::vector<char> >
+  std::map<uint8_t, aiebu::mapped_file>
   parse_pmctrlpkt(std::vector<std::string> pm_key_value_pairs);
+
+  std::map<uint8_t, aiebu::const_buffer>
+  get_ctrlpkt_buffers() const;
 };
 
 class target_aie2blob_transaction: public target_aie2blob
@@ -95,6 +110,31 @@ public:
   virtual void assemble(const sub_cmd_options &_options);
 };
 
+class target_aie2blob_bundle: public target
+{
+  static aiebu::const_buffer read(const std::string& filename, std::vector<aiebu::mapped_file>& files);
+public:
+  target_aie2blob_bundle(const std::string& name)
+    : target(name, "bundle", "aie2 txn blob bundle assembler, many kernels in one elf") {}
+  virtual void assemble(const sub_cmd_options &_options);
+};
+
+class target_patch_metadata: public target
+{
+public:
+  target_patch_metadata(const std::string& name)
+    : target(name, "patchmeta", "patch json to binary patch metadata converter") {}
+  virtual void assemble(const sub_cmd_options &_options);
+};
+
+class target_diff: public target
+{
+public:
+  target_diff(const std::string& name)
+    : target(name, "diff", "op level diff of two elfs or txn binaries") {}
+  virtual void assemble(const sub_cmd_options &_options);
+};
+
 } //namespace aiebu::utilities
 
 #endif //__AIEBU_UTILITIES_TARGET_H_
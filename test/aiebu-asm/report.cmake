@@ -0,0 +1,80 @@
+# SPDX-License-Identifier: MIT
+# Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+# Helper CMake script to check that aiebu-asm --report=json|csv writes
+# nothing but the report to stdout, e.g. for piping it into jq.
+# You can manually run this script using the following synopsys:
+# cmake -P report.cmake <aiebu-asm> <txn_bin> <output_elf> <json|csv>
+# e.g. cmake -P report.cmake Debug/src/cpp/aiebu/utils/asm/aiebu-asm Debug/lib/gen/copy_DDR_to_Mem_Tile.bin report.elf json
+
+cmake_minimum_required(VERSION 3.19)
+
+set(format "${CMAKE_ARGV6}")
+execute_process(
+  COMMAND "${CMAKE_ARGV3}" -t aie2txn -c "${CMAKE_ARGV4}" -o "${CMAKE_ARGV5}" --report=${format}
+  RESULT_VARIABLE result
+  OUTPUT_VARIABLE report
+  ERROR_VARIABLE log
+)
+
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "aiebu-asm failed with ${result}:\n${report}${log}")
+endif()
+
+if (NOT log MATCHES "elf size:")
+  message(FATAL_ERROR "elf size not written to stderr:\n${log}")
+endif()
+
+if (format STREQUAL "json")
+
+  string(JSON type ERROR_VARIABLE error TYPE "${report}")
+  if (error OR NOT type STREQUAL "OBJECT")
+    message(FATAL_ERROR "stdout is not a json object (${error}):\n${report}")
+  endif()
+
+  string(JSON uid GET "${report}" uid)
+  if (uid STREQUAL "")
+    message(FATAL_ERROR "report has no uid:\n${report}")
+  endif()
+
+  # the control code section is decoded
+  string(JSON sections LENGTH "${report}" sections)
+  set(ctrltext_ops 0)
+  math(EXPR last "${sections} - 1")
+  foreach(i RANGE ${last})
+    string(JSON name GET "${report}" sections ${i} name)
+    if (name STREQUAL ".ctrltext")
+      string(JSON txn_format GET "${report}" sections ${i} txn_format)
+      string(JSON ctrltext_ops LENGTH "${report}" sections ${i} ops)
+    endif()
+  endforeach()
+  if (ctrltext_ops EQUAL 0)
+    message(FATAL_ERROR "report has no .ctrltext ops:\n${report}")
+  endif()
+
+  string(JSON ops LENGTH "${report}" ops)
+  if (ops EQUAL 0)
+    message(FATAL_ERROR "report has no ops:\n${report}")
+  endif()
+
+  message("-- ${format} report: uid ${uid}, ${sections} sections, ${txn_format} txn, ${ops} opcodes")
+
+else()
+
+  # every line a record,section,name,schema,value row
+  string(REPLACE "\n" ";" rows "${report}")
+  list(FILTER rows EXCLUDE REGEX "^$")
+  list(POP_FRONT rows header)
+  if (NOT header STREQUAL "record,section,name,schema,value")
+    message(FATAL_ERROR "stdout does not start with the csv header:\n${report}")
+  endif()
+  foreach(row ${rows})
+    if (NOT row MATCHES "^(uid|section_size|content_size|op_count|op_bytes|relocations),")
+      message(FATAL_ERROR "not a csv report row: ${row}")
+    endif()
+  endforeach()
+
+  list(LENGTH rows count)
+  message("-- ${format} report: ${count} rows")
+
+endif()
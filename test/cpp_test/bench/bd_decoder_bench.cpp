@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Compares aie2_bd::decode against the BD address tables and std::find
+// scans patch_helper used to rebuild on every patch op.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "bd_decoder.h"
+
+namespace {
+
+// 0 none, 1 mem length, 2 mem address, 3 shim length, 4 shim address
+int
+classify_tables(uint32_t reg)
+{
+  std::vector<uint32_t> MEM_BD_ADDRESS;
+  for (auto i=0U; i < aiebu::aie2_bd::mem_bd_num; ++i)
+    MEM_BD_ADDRESS.push_back(aiebu::aie2_bd::mem_bd0 + i * aiebu::aie2_bd::mem_bd_size);
+
+  std::vector<uint32_t> SHIM_BD_ADDRESS;
+  for (auto i=0U; i < aiebu::aie2_bd::shim_bd_num; ++i)
+    SHIM_BD_ADDRESS.push_back(aiebu::aie2_bd::shim_bd0 + i * aiebu::aie2_bd::shim_bd_size);
+
+  if (std::find(MEM_BD_ADDRESS.begin(), MEM_BD_ADDRESS.end(), reg) != MEM_BD_ADDRESS.end())
+    return 1;
+  if (std::find(MEM_BD_ADDRESS.begin(), MEM_BD_ADDRESS.end(), reg-4) != MEM_BD_ADDRESS.end())
+    return 2;
+  if (std::find(SHIM_BD_ADDRESS.begin(), SHIM_BD_ADDRESS.end(), reg) != SHIM_BD_ADDRESS.end())
+    return 3;
+  if (std::find(SHIM_BD_ADDRESS.begin(), SHIM_BD_ADDRESS.end(), reg-4) != SHIM_BD_ADDRESS.end())
+    return 4;
+  return 0;
+}
+
+int
+classify_decoder(uint32_t reg)
+{
+  auto loc = aiebu::aie2_bd::decode(reg);
+  if (!loc.valid() || loc.word > 1)
+    return 0;
+  return (loc.kind == aiebu::aie2_bd::tile::mem ? 1 : 3) + static_cast<int>(loc.word);
+}
+
+template <typename Func>
+double
+measure(Func&& func, const std::vector<uint32_t>& regs, long& checksum)
+{
+  auto start = std::chrono::steady_clock::now();
+  checksum = 0;
+  for (auto reg : regs)
+    checksum += func(reg);
+  std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+  return ms.count();
+}
+
+}
+
+int main()
+{
+  // Mix of BD words of both tiles and unrelated registers
+  std::mt19937 gen(42);
+  std::vector<uint32_t> regs(1000000);
+  for (auto& reg : regs) {
+    switch (gen() % 3) {
+    case 0: reg = aiebu::aie2_bd::shim_bd0 + (gen() % (aiebu::aie2_bd::shim_bd_num * 8)) * 4; break;
+    case 1: reg = aiebu::aie2_bd::mem_bd0 + (gen() % (aiebu::aie2_bd::mem_bd_num * 8)) * 4; break;
+    default: reg = (gen() & aiebu::aie2_bd::reg_mask) & ~3u;
+    }
+  }
+
+  for (auto reg : regs) {
+    if (classify_tables(reg) != classify_decoder(reg)) {
+      std::cout << "mismatch for reg 0x" << std::hex << reg << "\n";
+      return 1;
+    }
+  }
+
+  long tables_sum = 0;
+  long decoder_sum = 0;
+  double tables_ms = measure(classify_tables, regs, tables_sum);
+  double decoder_ms = measure(classify_decoder, regs, decoder_sum);
+  std::cout << "patch ops:" << regs.size() << "\n"
+            << "tables ms:" << tables_ms << " checksum:" << tables_sum << "\n"
+            << "decoder ms:" << decoder_ms << " checksum:" << decoder_sum << "\n"
+            << "speedup:" << (decoder_ms > 0 ? tables_ms / decoder_ms : 0) << "\n";
+  return tables_sum == decoder_sum ? 0 : 1;
+}
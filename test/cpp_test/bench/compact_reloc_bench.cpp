@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Compares compact relocations against 12 byte RELA entries on the patch
+// sites of a large transaction: size, and time to decode every entry.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <tuple>
+#include <vector>
+#include "compact_reloc.h"
+
+namespace {
+
+struct rela32
+{
+  uint32_t r_offset;
+  uint32_t r_info;
+  int32_t r_addend;
+};
+
+// shim BD address (shim_dma_48) and mem BD length (scaler_32) patches
+// of num_bds BDs written 48 bytes apart, over 5 arguments
+std::vector<aiebu::compact_reloc::entry>
+make_entries(uint32_t num_bds)
+{
+  std::vector<aiebu::compact_reloc::entry> entries;
+  for (uint32_t bd = 0; bd < num_bds; ++bd) {
+    uint32_t arg = 1 + bd % 5;
+    entries.push_back({16 + bd * 48ULL, arg, 5, 0});
+    entries.push_back({24 + bd * 48ULL, arg + 5, 3, 0});
+  }
+  return entries;
+}
+
+std::vector<rela32>
+to_rela(const std::vector<aiebu::compact_reloc::entry>& entries)
+{
+  std::vector<rela32> rela;
+  for (const auto& e : entries)
+    rela.push_back({static_cast<uint32_t>(e.offset), (e.symbol << 8) + e.type, static_cast<int32_t>(e.addend)});
+  return rela;
+}
+
+}
+
+int main()
+{
+  auto entries = make_entries(50000);
+  auto rela = to_rela(entries);
+  std::vector<char> rela_bytes(rela.size() * sizeof(rela32));
+  std::memcpy(rela_bytes.data(), rela.data(), rela_bytes.size());
+  auto compact = aiebu::compact_reloc::encode(entries);
+
+  auto start = std::chrono::steady_clock::now();
+  uint64_t rela_sum = 0;
+  for (size_t i = 0; i < rela_bytes.size(); i += sizeof(rela32)) {
+    rela32 r;
+    std::memcpy(&r, rela_bytes.data() + i, sizeof(r));
+    rela_sum += r.r_offset ^ (r.r_info >> 8) ^ (r.r_info & 0xff) ^ r.r_addend;
+  }
+  std::chrono::duration<double, std::milli> rela_ms = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  uint64_t compact_sum = 0;
+  std::vector<aiebu::compact_reloc::entry> decoded;
+  decoded.reserve(entries.size());
+  aiebu::compact_reloc::decode(compact.data(), compact.size(), [&](const aiebu::compact_reloc::entry& e) {
+    compact_sum += e.offset ^ e.symbol ^ e.type ^ e.addend;
+    decoded.push_back(e);
+  });
+  std::chrono::duration<double, std::milli> compact_ms = std::chrono::steady_clock::now() - start;
+
+  std::cout << "relocations:" << entries.size() << "\n"
+            << "rela bytes:" << rela_bytes.size() << " decode ms:" << rela_ms.count() << "\n"
+            << "compact bytes:" << compact.size() << " decode ms:" << compact_ms.count() << "\n"
+            << "size ratio:" << double(rela_bytes.size()) / compact.size() << "\n";
+
+  // encode sorted entries, decoding must give them back in that order
+  auto same = [](const aiebu::compact_reloc::entry& a, const aiebu::compact_reloc::entry& b) {
+    return std::tie(a.offset, a.symbol, a.type, a.addend) == std::tie(b.offset, b.symbol, b.type, b.addend);
+  };
+  if (rela_sum != compact_sum || !std::equal(entries.begin(), entries.end(), decoded.begin(), decoded.end(), same)) {
+    std::cout << "mismatch\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Compares elf_serializer against ELFIO::save() into a stringstream copied
+// out with istream_iterator, which is what elf_writer::finalize() used to do.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+#include "elf_serializer.h"
+
+namespace {
+
+constexpr int iterations = 5;
+
+void
+build_model(ELFIO::elfio& elf)
+{
+  elf.create(ELFIO::ELFCLASS32, ELFIO::ELFDATA2LSB);
+  elf.set_type(ELFIO::ET_EXEC);
+  elf.set_machine(ELFIO::EM_M32);
+
+  ELFIO::segment* phdr = elf.segments.add();
+  phdr->set_type(ELFIO::PT_PHDR);
+  phdr->set_flags(ELFIO::PF_R);
+}
+
+ELFIO::section*
+add_text(ELFIO::elfio& elf, size_t size)
+{
+  ELFIO::section* sec = elf.sections.add(".ctrltext");
+  sec->set_type(ELFIO::SHT_PROGBITS);
+  sec->set_flags(ELFIO::SHF_ALLOC | ELFIO::SHF_EXECINSTR);
+  sec->set_addr_align(16);
+  sec->set_size(size);
+
+  ELFIO::segment* seg = elf.segments.add();
+  seg->set_type(ELFIO::PT_LOAD);
+  seg->set_flags(ELFIO::PF_X | ELFIO::PF_R);
+  seg->set_align(16);
+  seg->add_section_index(sec->get_index(), sec->get_addr_align());
+  return sec;
+}
+
+std::vector<char>
+legacy(const std::vector<char>& text)
+{
+  ELFIO::elfio elf;
+  build_model(elf);
+  ELFIO::section* sec = add_text(elf, text.size());
+  sec->set_data(text.data(), static_cast<ELFIO::Elf_Word>(text.size()));
+
+  std::stringstream stream;
+  stream << std::noskipws;
+  elf.save(stream);
+  std::vector<char> v;
+  std::copy(std::istream_iterator<char>(stream),
+            std::istream_iterator<char>(),
+            std::back_inserter(v));
+  return v;
+}
+
+std::vector<char>
+direct(const std::vector<char>& text)
+{
+  ELFIO::elfio elf;
+  build_model(elf);
+  ELFIO::section* sec = add_text(elf, text.size());
+  aiebu::buffer_view view(text);
+
+  aiebu::elf_serializer serializer(elf);
+  serializer.set_content(sec->get_index(), &view);
+  serializer.layout();
+  std::vector<char> v;
+  serializer.write([&v](size_t size) {
+    v.resize(size);
+    return v.data();
+  });
+  return v;
+}
+
+template <typename Func>
+double
+measure(Func&& func, const std::vector<char>& text, size_t& elf_size)
+{
+  double best = 0;
+  for (int i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    auto elf = func(text);
+    std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+    elf_size = elf.size();
+    if (i == 0 || ms.count() < best)
+      best = ms.count();
+  }
+  return best;
+}
+
+}
+
+int main()
+{
+  std::cout << "text_size,legacy_elf_size,legacy_ms,direct_elf_size,direct_ms,speedup\n";
+  for (size_t size = 1024; size <= 64 * 1024 * 1024; size *= 4) {
+    std::vector<char> text(size);
+    for (size_t i = 0; i < size; ++i)
+      text[i] = static_cast<char>(i * 31);
+
+    size_t legacy_size = 0;
+    size_t direct_size = 0;
+    double legacy_ms = measure(legacy, text, legacy_size);
+    double direct_ms = measure(direct, text, direct_size);
+
+    std::cout << size << "," << legacy_size << "," << legacy_ms << ","
+              << direct_size << "," << direct_ms << ","
+              << (direct_ms > 0 ? legacy_ms / direct_ms : 0) << "\n";
+  }
+  return 0;
+}
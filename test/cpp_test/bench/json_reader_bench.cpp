@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Compares json_reader against boost::property_tree on an aiecompiler
+// patch json: both must find the same (xrt_id, offset) pairs.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/property_tree/json_parser.hpp>
+#include "json_reader.h"
+
+namespace {
+
+using patch_list = std::vector<std::pair<uint32_t, uint32_t>>;
+
+std::string
+make_json(int buffers, int coalesed, int patches)
+{
+  std::ostringstream json;
+  json << "{\"external_buffers\": {";
+  for (int b = 0; b < buffers; ++b) {
+    json << (b ? "," : "") << "\"buffer" << b << "\": {\"xrt_id\": " << b
+         << ", \"size_in_bytes\": 1048576, \"name\": \"compute_graph.buffer\", \"coalesed_buffers\": [";
+    for (int c = 0; c < coalesed; ++c) {
+      json << (c ? "," : "") << "{\"logical_id\": " << c << ", \"offset_in_bytes\": " << c * 1024
+           << ", \"control_packet_patch_locations\": [";
+      for (int p = 0; p < patches; ++p)
+        json << (p ? "," : "") << "{\"offset\": " << 12 + 64 * p << ", \"size\": 6, \"operation\": \"read_add_write\"}";
+      json << "]}";
+    }
+    json << "]}";
+  }
+  json << "}}";
+  return json.str();
+}
+
+patch_list
+parse_ptree(const std::string& text)
+{
+  patch_list out;
+  std::istringstream stream(text);
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_json(stream, pt);
+  for (const auto& buffer : pt.get_child("external_buffers")) {
+    auto xrt_id = buffer.second.get<uint32_t>("xrt_id");
+    for (const auto& coalesed : buffer.second.get_child("coalesed_buffers"))
+      for (const auto& patch : coalesed.second.get_child("control_packet_patch_locations"))
+        out.emplace_back(xrt_id, patch.second.get<uint32_t>("offset"));
+  }
+  return out;
+}
+
+// Children of the current container, json_reader::next() has been called
+template <typename Fn>
+void
+for_each_child(aiebu::json_reader& reader, Fn&& fn)
+{
+  reader.enter();
+  std::string_view key;
+  while (reader.next(&key))
+    fn(key);
+}
+
+patch_list
+parse_reader(const std::string& text)
+{
+  patch_list out;
+  std::vector<uint32_t> offsets;
+  aiebu::json_reader reader(text.data(), text.size());
+  for_each_child(reader, [&](std::string_view) {
+    for_each_child(reader, [&](std::string_view) {
+      uint32_t xrt_id = 0;
+      offsets.clear();
+      for_each_child(reader, [&](std::string_view key) {
+        if (key == "xrt_id") {
+          aiebu::json_reader::to_uint32(reader.value(), xrt_id);
+          return;
+        }
+        if (key != "coalesed_buffers") {
+          reader.skip();
+          return;
+        }
+        for_each_child(reader, [&](std::string_view) {
+          for_each_child(reader, [&](std::string_view key) {
+            if (key != "control_packet_patch_locations") {
+              reader.skip();
+              return;
+            }
+            for_each_child(reader, [&](std::string_view) {
+              for_each_child(reader, [&](std::string_view key) {
+                uint32_t offset = 0;
+                if (key == "offset" && aiebu::json_reader::to_uint32(reader.value(), offset))
+                  offsets.push_back(offset);
+                else if (key != "offset")
+                  reader.skip();
+              });
+            });
+          });
+        });
+      });
+      for (auto offset : offsets)
+        out.emplace_back(xrt_id, offset);
+    });
+  });
+  reader.finish();
+  return out;
+}
+
+template <typename Func>
+double
+measure(Func&& func, const std::string& text, patch_list& out)
+{
+  auto start = std::chrono::steady_clock::now();
+  out = func(text);
+  std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+  return ms.count();
+}
+
+}
+
+int main()
+{
+  auto text = make_json(8, 16, 1000);
+
+  patch_list ptree_patches;
+  patch_list reader_patches;
+  double ptree_ms = measure(parse_ptree, text, ptree_patches);
+  double reader_ms = measure(parse_reader, text, reader_patches);
+  std::cout << "json bytes:" << text.size() << " patches:" << ptree_patches.size() << "\n"
+            << "ptree ms:" << ptree_ms << "\n"
+            << "json_reader ms:" << reader_ms << "\n"
+            << "speedup:" << (reader_ms > 0 ? ptree_ms / reader_ms : 0) << "\n";
+  if (ptree_patches != reader_patches) {
+    std::cout << "mismatch\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Compressed size and decompression throughput of control code
+// sections, on the generated preempt and copy blobs in lib/gen or on
+// the files given as arguments.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "compressed_section.h"
+#include "mapped_file.h"
+
+#ifndef AIEBU_GEN_DIR
+#define AIEBU_GEN_DIR "lib/gen"
+#endif
+
+int main(int argc, char** argv)
+{
+  if (!aiebu::compressed_section::available()) {
+    std::cout << "aiebu built without zlib, nothing to measure\n";
+    return 0;
+  }
+
+  std::vector<std::string> files(argv + 1, argv + argc);
+  if (files.empty() && std::filesystem::is_directory(AIEBU_GEN_DIR))
+    for (const auto& entry : std::filesystem::directory_iterator(AIEBU_GEN_DIR))
+      if (entry.path().extension() == ".bin")
+        files.push_back(entry.path().string());
+
+  constexpr int rounds = 20;
+  size_t total_size = 0;
+  size_t total_compressed = 0;
+  double total_ms = 0;
+  for (const auto& file : files) {
+    aiebu::mapped_file input(file);
+    aiebu::buffer_view view(input.data(), input.size());
+    if (view.empty())
+      continue;
+
+    auto compressed = aiebu::compressed_section::compress(view, 16);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+      auto content = aiebu::compressed_section::decompress(compressed.data(), compressed.size());
+      if (content.size() != view.size() || !std::equal(content.begin(), content.end(), view.data())) {
+        std::cout << file << ": mismatch\n";
+        return 1;
+      }
+    }
+    std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::filesystem::path(file).filename().string() << " bytes:" << view.size()
+              << " compressed:" << compressed.size()
+              << " ratio:" << double(view.size()) / compressed.size()
+              << " decompress MB/s:" << view.size() * rounds / (ms.count() * 1000) << "\n";
+    total_size += view.size();
+    total_compressed += compressed.size();
+    total_ms += ms.count();
+  }
+
+  if (total_compressed)
+    std::cout << "total bytes:" << total_size << " compressed:" << total_compressed
+              << " ratio:" << double(total_size) / total_compressed
+              << " decompress MB/s:" << total_size * rounds / (total_ms * 1000) << "\n";
+  return 0;
+}
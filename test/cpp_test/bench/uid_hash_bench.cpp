@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc. All rights reserved.
+
+// Throughput of the UID note hashes on a control code sized buffer
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "uid_hash.h"
+
+int main()
+{
+  std::vector<uint8_t> content(16 * 1024 * 1024);
+  for (size_t i = 0; i < content.size(); ++i)
+    content[i] = static_cast<uint8_t>(i * 7 + 3);
+
+  constexpr int rounds = 8;
+  for (auto [name, algorithm] : {std::make_pair("md5", aiebu::elf_options::uid_algorithm::md5),
+                                 std::make_pair("xxh3_128", aiebu::elf_options::uid_algorithm::xxh3_128)}) {
+    std::string uid;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+      auto hasher = aiebu::uid_hasher::create(algorithm);
+      hasher->update(content.data(), content.size());
+      uid = hasher->calculate();
+    }
+    std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+    std::cout << name << " " << uid << " MB/s:" << content.size() * rounds / (ms.count() * 1000) << "\n";
+  }
+  return 0;
+}
@@ -42,5 +42,27 @@ int main(int argc, char **argv)
     free((void*)elf_buf);
     printf("Size returned :%zd\n", elf_buf_size);
   }
+
+  /* Two phase: query size, then assemble into caller owned buffer */
+  int size = aiebu_assembler_get_elf_to_buffer(aiebu_assembler_buffer_type_blob_instr_transaction,
+                                               txn_buf, txn_buf_size,
+                                               control_packet_buf, control_packet_buf_size,
+                                               NULL, 0,
+                                               external_buffer_id_json_buf, external_buffer_id_json_buf_size,
+                                               "", "", NULL, 0);
+  if (size > 0)
+  {
+    elf_buf = (char*)malloc(size);
+    int ret = aiebu_assembler_get_elf_to_buffer(aiebu_assembler_buffer_type_blob_instr_transaction,
+                                                txn_buf, txn_buf_size,
+                                                control_packet_buf, control_packet_buf_size,
+                                                elf_buf, size,
+                                                external_buffer_id_json_buf, external_buffer_id_json_buf_size,
+                                                "", "", NULL, 0);
+    free((void*)elf_buf);
+    printf("Size written to caller buffer :%d\n", ret);
+    if (ret != size)
+      return 1;
+  }
   return 0;
 }
@@ -1,11 +1,22 @@
 // SPDX-License-Identifier: MIT
 // Copyright (C) 2023-2024 Advanced Micro Devices, Inc.
 
+#include <cmath>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
 #include <vector>
 #include <iterator>
 #include "aiebu_assembler.h"
+#include "aiebu_error.h"
+#include "aiebu_elf_view.h"
+#include "aiebu_report.h"
 #include <algorithm>
 
 void usage_exit()
@@ -14,15 +25,460 @@ void usage_exit()
   exit(1);
 }
 
+static int failures = 0;
+
+// Report a failed check, the test fails once all checks have run
+static void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+struct inputs {
+  std::vector<char> txn;
+  std::vector<char> control_packet;
+  std::vector<char> external_buffer_id_json;
+  // elf assembled by aiebu_assembler, the reference of other checks
+  std::vector<char> elf;
+};
+
+static aiebu::aiebu_assembler_batch::job
+make_job(const inputs& in)
+{
+  return {aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+          in.txn, in.control_packet, in.external_buffer_id_json, {}, {}, {}, {}};
+}
+
+// Same input assembled concurrently must give identical elfs
+static void
+test_batch(const inputs& in)
+{
+  std::vector<aiebu::aiebu_assembler_batch::job> jobs(4, make_job(in));
+  aiebu::aiebu_assembler_batch batch;
+  auto results = batch.run(jobs);
+  check(results.size() == jobs.size(), "batch returns one result per job");
+  for (size_t i = 0; i < results.size(); ++i) {
+    check(!results[i].error_code, "batch job " + std::to_string(i) + " failed: " + results[i].message);
+    check(results[i].elf == in.elf, "batch job " + std::to_string(i) + " elf differs from aiebu_assembler");
+  }
+}
+
+// Counters of an assembly are returned, not printed
+static void
+test_stats(const aiebu::aiebu_assembler& as, const inputs& in)
+{
+  auto stats = as.get_stats();
+  check(stats.bd_writes_patched <= stats.bd_writes_indexed, "more BD writes patched than indexed");
+  check(!stats.symbols || stats.symbol_memory, "symbols without symbol table memory");
+
+  aiebu::aiebu_assembler_batch batch;
+  auto results = batch.run({make_job(in)});
+  check(results.size() == 1 && results[0].stats.bd_writes_indexed == stats.bd_writes_indexed &&
+        results[0].stats.bd_writes_patched == stats.bd_writes_patched,
+        "batch job BD counters differ from aiebu_assembler");
+  check(results.size() == 1 && results[0].stats.symbols == stats.symbols,
+        "batch job symbol count differs from aiebu_assembler");
+}
+
+// Second assembly of the same input is served from cache
+static void
+test_cache(const inputs& in)
+{
+  aiebu::aiebu_assembler as(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                            in.txn, in.control_packet, in.external_buffer_id_json);
+  const auto expected = as.get_stats();
+  auto same_stats = [&expected](const aiebu::assembly_stats& s) {
+    return s.bd_writes_indexed == expected.bd_writes_indexed && s.bd_writes_patched == expected.bd_writes_patched &&
+           s.symbols == expected.symbols && s.symbol_memory == expected.symbol_memory;
+  };
+
+  aiebu::aiebu_assembler_cache cache;
+  for (int i = 0; i < 2; ++i) {
+    aiebu::aiebu_assembler cas(cache, aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                               in.txn, in.control_packet, in.external_buffer_id_json, {});
+    check(cas.get_elf() == in.elf, "cached assembly " + std::to_string(i) + " elf differs from aiebu_assembler");
+    check(same_stats(cas.get_stats()), "cached assembly " + std::to_string(i) + " stats differ from aiebu_assembler");
+  }
+  auto stats = cache.get_stats();
+  check(stats.misses == 1, "cache misses " + std::to_string(stats.misses) + ", expected 1");
+  check(stats.memory_hits == 1, "cache memory hits " + std::to_string(stats.memory_hits) + ", expected 1");
+  check(stats.disk_hits == 0, "cache disk hits without a disk store");
+
+  // the stats are kept on disk with the elf, a disk store is only used by
+  // builds with a build id
+  const auto dir = std::filesystem::temp_directory_path() / "aie2_test_cache";
+  std::filesystem::remove_all(dir);
+  {
+    aiebu::aiebu_assembler_cache writer(64 * 1024 * 1024, dir.string());
+    aiebu::aiebu_assembler cas(writer, aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                               in.txn, in.control_packet, in.external_buffer_id_json, {});
+  }
+  aiebu::aiebu_assembler_cache reader(64 * 1024 * 1024, dir.string());
+  aiebu::aiebu_assembler cas(reader, aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                             in.txn, in.control_packet, in.external_buffer_id_json, {});
+  check(cas.get_elf() == in.elf, "disk cached elf differs from aiebu_assembler");
+  check(same_stats(cas.get_stats()), "disk cached stats differ from aiebu_assembler");
+  std::filesystem::remove_all(dir);
+}
+
+// Relocations of an elf as (offset, symbol name, type, addend), sorted
+using relocation_list = std::vector<std::tuple<uint64_t, std::string, uint32_t, int64_t>>;
+
+static relocation_list
+relocations(const aiebu::elf_view& elf, const aiebu::elf_view::section& rel)
+{
+  relocation_list out;
+  auto dynsym = elf.get_section(rel.link);
+  elf.for_each_relocation(rel, [&](const aiebu::elf_view::relocation& r) {
+    out.emplace_back(r.offset, std::string(elf.get_symbol(dynsym, r.symbol).name), r.type, r.addend);
+  });
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+// Compact relocations replace .rela.dyn with the same entries
+static void
+test_compact_relocations(const inputs& in)
+{
+  // SHT_XRT_CRELA
+  constexpr uint32_t compact_type = 0x80000001;
+
+  aiebu::elf_options options;
+  options.compact_relocations = true;
+  aiebu::aiebu_assembler compact(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                                 in.txn, in.control_packet, in.external_buffer_id_json, {}, {}, {}, options);
+  aiebu::elf_view celf(compact.get_elf_buffer());
+  aiebu::elf_view elf(aiebu::const_buffer(in.elf));
+
+  auto rela = elf.find_section(".rela.dyn");
+  if (!rela) {
+    check(!celf.find_section(".rela.compact"), "compact relocations of an elf without relocations");
+    return;
+  }
+
+  auto crela = celf.find_section(".rela.compact");
+  check(!celf.find_section(".rela.dyn"), "compact relocation elf has .rela.dyn");
+  check(crela.has_value(), "compact relocation elf has no .rela.compact");
+  if (!crela)
+    return;
+  check(crela->type == compact_type, "compact relocation section type " + std::to_string(crela->type));
+
+  auto expected = relocations(elf, *rela);
+  auto decoded = relocations(celf, *crela);
+  check(!expected.empty(), ".rela.dyn has no entries");
+  check(decoded.size() == expected.size(), "compact relocations decode to " + std::to_string(decoded.size()) +
+        " entries, .rela.dyn has " + std::to_string(expected.size()));
+  check(decoded == expected, "compact relocations differ from .rela.dyn");
+}
+
+// Compressed control code sections decompress to the sections of the
+// default elf and are not loaded
+static void
+test_compressed_sections(const inputs& in)
+{
+  constexpr uint32_t shf_alloc = 0x2;
+  constexpr uint32_t shf_compressed = 0x800;
+  constexpr uint32_t pt_load = 1;
+
+  aiebu::elf_options options;
+  options.compress_sections = true;
+  std::unique_ptr<aiebu::aiebu_assembler> compressed;
+  try {
+    compressed = std::make_unique<aiebu::aiebu_assembler>(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                                                           in.txn, in.control_packet, in.external_buffer_id_json,
+                                                           std::vector<std::string>{}, std::vector<std::string>{},
+                                                           std::map<uint8_t, aiebu::const_buffer>{}, options);
+  }
+  catch (aiebu::error& ex) {
+    // library built without zlib
+    std::cout << "compressed sections skipped: " << ex.what() << std::endl;
+    return;
+  }
+
+  aiebu::elf_view celf(compressed->get_elf_buffer());
+  aiebu::elf_view elf(aiebu::const_buffer(in.elf));
+  auto report = aiebu::make_report(celf);
+  for (const char* name : {".ctrltext", ".ctrldata"}) {
+    auto sec = elf.find_section(name);
+    if (!sec)
+      continue;
+    auto csec = celf.find_section(name);
+    check(csec.has_value(), std::string("compressed elf has no ") + name);
+    if (!csec)
+      continue;
+
+    check(csec->flags & shf_compressed, std::string(name) + " is not SHF_COMPRESSED");
+    check(!(csec->flags & shf_alloc), std::string(name) + " is still SHF_ALLOC");
+    for (size_t i = 0; i < celf.num_segments(); ++i) {
+      auto seg = celf.get_segment(i);
+      check(seg.type != pt_load || csec->offset < seg.offset || csec->offset >= seg.offset + seg.filesz,
+            std::string(name) + " is covered by PT_LOAD segment " + std::to_string(i));
+    }
+
+    std::vector<char> storage;
+    auto content = celf.get_content(*csec, storage);
+    check(content.size == sec->size && !std::memcmp(content.data, sec->data, sec->size),
+          std::string(name) + " decompresses to other bytes than the default elf");
+
+    auto it = std::find_if(report.sections.begin(), report.sections.end(),
+                           [name](const aiebu::elf_report::section& r) { return r.name == name; });
+    check(it != report.sections.end() && it->content_size == sec->size,
+          std::string("report of compressed ") + name + " has another content size");
+    if (std::string(name) == ".ctrltext")
+      check(it != report.sections.end() && !it->ops.empty(), "report of compressed .ctrltext has no ops");
+  }
+
+  auto expected = aiebu::make_report(elf);
+  bool same_ops = report.ops.size() == expected.ops.size();
+  for (size_t i = 0; same_ops && i < report.ops.size(); ++i)
+    same_ops = report.ops[i].name == expected.ops[i].name && report.ops[i].count == expected.ops[i].count &&
+               report.ops[i].bytes == expected.ops[i].bytes;
+  check(same_ops, "report ops of the compressed elf differ from the default elf");
+}
+
+// The op histogram of the control code is available as data, and the json
+// and csv reports write that data
+static void
+test_report(const aiebu::aiebu_assembler& as)
+{
+  auto report = aiebu::make_report(aiebu::elf_view(as.get_elf_buffer()));
+  check(!report.uid.empty(), "report has no uid");
+  check(!report.ops.empty(), "report has no ops");
+
+  std::map<std::string, uint64_t> counts;
+  bool ctrltext = false;
+  for (const auto& sec : report.sections) {
+    if (sec.txn_format.empty())
+      continue;
+    ctrltext |= sec.name == ".ctrltext";
+    check(sec.txn_format == "legacy" || sec.txn_format == "opt",
+          "report section " + sec.name + " txn format " + sec.txn_format);
+    for (const auto& op : sec.ops)
+      counts[op.name] += op.count;
+  }
+  check(ctrltext, "report has no .ctrltext ops");
+  for (const auto& op : report.ops)
+    check(counts[op.name] == op.count, "report total of " + op.name + " is not the sum over its sections");
+
+  std::ostringstream json;
+  as.get_report(json, aiebu::report_format::json);
+  check(json.str().rfind("{\n  \"uid\": \"" + report.uid + "\"", 0) == 0, "json report does not start with the uid");
+
+  std::ostringstream csv;
+  as.get_report(csv, aiebu::report_format::csv);
+  check(csv.str().rfind("record,section,name,schema,value\nuid,,", 0) == 0, "csv report does not start with the header");
+}
+
+// Static cost with the built in table of a device, the total is the sum
+// of the sections and the top regions are the most expensive first
+static void
+test_cost(const inputs& in)
+{
+  aiebu::elf_view elf{aiebu::const_buffer(in.elf)};
+  auto stx = aiebu::cost_table::get("stx");
+  auto cost = aiebu::estimate_cost(elf, stx, 3);
+  check(cost.device == "stx", "cost estimate of device " + cost.device);
+  check(!cost.sections.empty(), "cost estimate has no sections");
+  check(cost.ns > 0, "cost estimate of " + std::to_string(cost.ns) + " ns");
+
+  double sum = 0;
+  for (const auto& sec : cost.sections)
+    sum += sec.ns;
+  check(std::abs(sum - cost.ns) <= 1e-6 * cost.ns, "cost estimate is not the sum of its sections");
+
+  check(!cost.top_regions.empty() && cost.top_regions.size() <= 3,
+        std::to_string(cost.top_regions.size()) + " top regions, asked for 3");
+  for (size_t i = 1; i < cost.top_regions.size(); ++i)
+    check(cost.top_regions[i - 1].ns >= cost.top_regions[i].ns, "top region " + std::to_string(i) + " out of order");
+  for (const auto& region : cost.top_regions)
+    check(region.ns <= cost.ns, "top region in " + region.section + " costs more than the control code");
+
+  // a json table based on stx gives the same estimate, one with every
+  // cost zero gives none
+  const std::string same = R"({"base": "stx", "device": "stx"})";
+  auto from_json = aiebu::estimate_cost(elf, aiebu::cost_table::from_json({same.data(), same.size()}), 3);
+  check(from_json.ns == cost.ns, "cost estimate with a json stx table differs");
+
+  const std::string zero = R"({"write_ns": 0, "mask_write_ns": 0, "block_write_ns": 0, "block_write_byte_ns": 0,
+    "mask_poll_ns": 0, "dma_byte_ns": 0, "tct_ns": 0, "merge_sync_ns": 0, "ddr_patch_ns": 0, "other_ns": 0})";
+  auto none = aiebu::estimate_cost(elf, aiebu::cost_table::from_json({zero.data(), zero.size()}), 3);
+  check(none.ns == 0, "cost estimate with a zero table is " + std::to_string(none.ns) + " ns");
+  check(none.device == "custom", "json table without a device named " + none.device);
+
+  std::ostringstream text;
+  aiebu::write_text(cost, text);
+  check(text.str().find("stx") != std::string::npos, "cost text does not name the device");
+
+  bool thrown = false;
+  try {
+    (void)aiebu::cost_table::get("npu9");
+  }
+  catch (aiebu::error&) {
+    thrown = true;
+  }
+  check(thrown, "cost table of an unknown device");
+}
+
+// An elf has no differences with itself, one with another UID hash has
+// the same control code
+static void
+test_diff(const inputs& in)
+{
+  aiebu::elf_view elf{aiebu::const_buffer(in.elf)};
+  auto self = aiebu::diff(elf, elf);
+  check(self.changes.empty(), std::to_string(self.changes.size()) + " changes of an elf with itself");
+  check(self.relocations.empty(), std::to_string(self.relocations.size()) + " relocation changes of an elf with itself");
+  check(self.old_uid == self.new_uid, "UID of an elf differs from itself");
+  for (const auto& sec : self.sections)
+    check(sec.in_old && sec.in_new && sec.old_size == sec.new_size && !sec.inserted && !sec.removed && !sec.changed,
+          "section " + sec.name + " of an elf differs from itself");
+
+  aiebu::elf_options xxh3;
+  xxh3.uid = aiebu::elf_options::uid_algorithm::xxh3_128;
+  aiebu::aiebu_assembler as(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                            in.txn, in.control_packet, in.external_buffer_id_json, {}, {}, {}, xxh3);
+  auto other = aiebu::diff(elf, aiebu::elf_view(as.get_elf_buffer()));
+  check(other.old_uid != other.new_uid, "UID of an xxh3_128 elf is the md5 UID");
+  check(other.changes.empty(), std::to_string(other.changes.size()) + " changes of the control code with an xxh3_128 UID");
+
+  std::ostringstream text;
+  aiebu::write_text(other, text);
+  check(text.str().rfind("UID: " + other.old_uid + " -> " + other.new_uid, 0) == 0, "diff text does not start with the UIDs");
+}
+
+// Loadable segments start on page boundaries, the sections keep their
+// content and the alignment is recorded in a note
+static void
+test_page_align(const inputs& in)
+{
+  constexpr uint32_t pt_load = 1;
+
+  aiebu::elf_options paged;
+  paged.page_align = 4096;
+  aiebu::aiebu_assembler page_aligned(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                                      in.txn, in.control_packet, in.external_buffer_id_json, {}, {}, {}, paged);
+  aiebu::elf_view pelf(page_aligned.get_elf_buffer());
+  aiebu::elf_view elf(aiebu::const_buffer(in.elf));
+
+  size_t loads = 0;
+  for (size_t i = 0; i < pelf.num_segments(); ++i) {
+    auto seg = pelf.get_segment(i);
+    if (seg.type != pt_load)
+      continue;
+    ++loads;
+    check(seg.offset % paged.page_align == 0, "PT_LOAD segment " + std::to_string(i) + " at offset " +
+          std::to_string(seg.offset) + " is not page aligned");
+    check(seg.align == paged.page_align, "PT_LOAD segment " + std::to_string(i) + " align " + std::to_string(seg.align));
+  }
+  check(loads > 0, "page aligned elf has no PT_LOAD segment");
+
+  auto note = pelf.find_section(".note.xrt.page_align");
+  check(note.has_value(), "page aligned elf has no .note.xrt.page_align");
+  if (note) {
+    uint32_t align = 0;
+    pelf.for_each_note(*note, [&align](const aiebu::elf_view::note& n) {
+      if (n.desc.size >= sizeof(align))
+        std::memcpy(&align, n.desc.data, sizeof(align));
+    });
+    check(align == paged.page_align, "page align note records " + std::to_string(align));
+  }
+  check(!elf.find_section(".note.xrt.page_align"), "default elf has a page align note");
+
+  for (const char* name : {".ctrltext", ".ctrldata"}) {
+    auto sec = elf.find_section(name);
+    auto psec = pelf.find_section(name);
+    if (!sec)
+      continue;
+    check(psec && psec->size == sec->size && !std::memcmp(psec->data, sec->data, sec->size),
+          std::string(name) + " of the page aligned elf differs from the default elf");
+  }
+
+  // not a power of two
+  aiebu::elf_options bad;
+  bad.page_align = 4000;
+  bool thrown = false;
+  try {
+    aiebu::aiebu_assembler as(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                              in.txn, in.control_packet, in.external_buffer_id_json, {}, {}, {}, bad);
+  }
+  catch (aiebu::error&) {
+    thrown = true;
+  }
+  check(thrown, "page align 4000 accepted");
+}
+
+// A session walks the txn once, later updates with the same buffers are
+// written in place and give the elf aiebu_assembler gives
+static void
+test_session(const inputs& in)
+{
+  aiebu::aiebu_assembler_session session(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction, in.txn);
+  for (int i = 0; i < 2; ++i) {
+    bool in_place = session.update(in.external_buffer_id_json, in.control_packet);
+    check(in_place == (i == 1), "session update " + std::to_string(i) + (in_place ? " in place" : " not in place"));
+    check(session.get_elf() == in.elf, "session update " + std::to_string(i) + " elf differs from aiebu_assembler");
+    auto buf = session.get_elf_buffer();
+    check(buf.size == in.elf.size() && !std::memcmp(buf.data, in.elf.data(), buf.size),
+          "session elf buffer differs from get_elf");
+  }
+
+  if (in.control_packet.empty())
+    return;
+  auto control_packet = in.control_packet;
+  control_packet.back() ^= 0x1;
+  session.update(in.external_buffer_id_json, control_packet);
+  aiebu::aiebu_assembler as(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction,
+                            in.txn, control_packet, in.external_buffer_id_json);
+  check(session.get_elf() == as.get_elf(), "session elf of a changed control packet differs from aiebu_assembler");
+}
+
+// Kernels with the same control code share its sections in a bundle,
+// each kernel keeps its own UID note and relocations
+static void
+test_bundle(const inputs& in)
+{
+  std::vector<aiebu::aiebu_assembler_bundle::kernel> kernels;
+  for (int i = 0; i < 4; ++i)
+    kernels.push_back({"k" + std::to_string(i), make_job(in)});
+  aiebu::aiebu_assembler_bundle bundle(kernels);
+  check(bundle.get_elf_buffer().size < kernels.size() * in.elf.size(),
+        "bundle of " + std::to_string(kernels.size()) + " same kernels is not smaller than their elfs");
+
+  aiebu::elf_view belf(bundle.get_elf_buffer());
+  aiebu::elf_view elf(aiebu::const_buffer(in.elf));
+  const bool relocated = elf.find_section(".rela.dyn").has_value();
+  std::string first_uid;
+  for (const auto& k : kernels) {
+    auto note = belf.find_section(".note.xrt.UID." + k.name);
+    check(note.has_value(), "bundle has no UID note of kernel " + k.name);
+    if (note) {
+      std::string uid;
+      belf.for_each_note(*note, [&uid](const aiebu::elf_view::note& n) {
+        uid.assign(n.desc.data, strnlen(n.desc.data, n.desc.size));
+      });
+      check(!uid.empty(), "empty UID of kernel " + k.name);
+      if (first_uid.empty())
+        first_uid = uid;
+      check(uid == first_uid, "UID of kernel " + k.name + " differs from kernel " + kernels[0].name);
+    }
+    check(belf.find_section(".rela.dyn." + k.name).has_value() == relocated,
+          "relocations of kernel " + k.name + " do not match the elf of the kernel");
+  }
+}
+
 int main(int argc, char ** argv)
 {
 
   if (argc != 2 && argc != 4)
     usage_exit();
 
-  std::vector<char> txn_buf;
-  std::vector<char> control_packet_buf;
-  std::vector<char> external_buffer_id_json_buf;
+  inputs in;
+  auto& txn_buf = in.txn;
+  auto& control_packet_buf = in.control_packet;
+  auto& external_buffer_id_json_buf = in.external_buffer_id_json;
 
   // Reading txn buffer
   std::ifstream input(argv[1], std::ios::binary);
@@ -50,5 +506,25 @@ int main(int argc, char ** argv)
   std::ofstream output_file("out.elf");
   std::ostream_iterator<char> output_iterator(output_file);
   std::copy(e.begin(), e.end(), output_iterator);
-  return 0;
+
+  in.elf = e;
+  test_report(as);
+  test_cost(in);
+  test_diff(in);
+  test_stats(as, in);
+  test_batch(in);
+
+  test_cache(in);
+
+  test_compact_relocations(in);
+  test_compressed_sections(in);
+
+  test_page_align(in);
+
+  test_session(in);
+
+  test_bundle(in);
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
 }
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// BD lookups of the DDR patch ops are exact whether a BD is in the table
+// of the txn header grid or in the overflow map, also for a grid the
+// header claims but no device has.
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "bd_index.h"
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+uint32_t
+reg(uint32_t col, uint32_t row, uint32_t bd0, uint32_t bd)
+{
+  return col << aiebu::aie2_bd::col_shift | row << aiebu::aie2_bd::row_shift | (bd0 + bd * 0x20);
+}
+
+void
+test_grid(uint32_t cols, uint32_t rows)
+{
+  const std::string grid = std::to_string(cols) + "x" + std::to_string(rows) + " grid: ";
+  aiebu::bd_index index(cols, rows);
+
+  const uint32_t shim = reg(0, 0, aiebu::aie2_bd::shim_bd0, 3);
+  const uint32_t mem = reg(1, 1, aiebu::aie2_bd::mem_bd0, 47);
+  // outside of any grid the header may give
+  const uint64_t high = 0x100000000ULL | shim;
+  const uint32_t unaligned = shim + 4;
+
+  check(!index.patch(shim), grid + "BD found before it was written");
+  index.insert(shim, 16, 64);
+  index.insert(mem, 48, 128);
+  index.insert(high, 80, 256);
+  index.insert(unaligned, 112, 512);
+  index.insert(shim, 144, 1024);
+
+  auto e = index.patch(shim);
+  check(e && e->offset == 144 && e->buffer_length_in_bytes == 1024, grid + "later shim BD write not found");
+  e = index.patch(mem);
+  check(e && e->offset == 48 && e->buffer_length_in_bytes == 128, grid + "mem tile BD not found");
+  e = index.patch(high);
+  check(e && e->offset == 80, grid + "BD beyond 32 bits not found");
+  e = index.patch(unaligned);
+  check(e && e->offset == 112, grid + "BD chunk not at a BD start not found");
+  check(!index.patch(reg(1, 1, aiebu::aie2_bd::mem_bd0, 46)), grid + "unwritten BD found");
+
+  index.patch(shim);
+  const auto& stats = index.get_stats();
+  check(stats.indexed == 5, grid + std::to_string(stats.indexed) + " BD writes indexed, expected 5");
+  check(stats.patched == 4, grid + std::to_string(stats.patched) + " BD writes patched, expected 4");
+}
+
+}
+
+int main()
+{
+  test_grid(4, 6);
+  test_grid(0, 0);
+  // a header with the largest counts, the BDs go to the overflow map
+  test_grid(255, 255);
+  test_grid(129, 1);
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
+}
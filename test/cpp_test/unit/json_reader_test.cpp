@@ -0,0 +1,310 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// The json reader must walk a document the way boost::property_tree read
+// it, decode escaped strings and reject malformed input. Patch metadata
+// of both json schemas, aiecompiler external_buffers and dmacompiler
+// ctrl_pkt_patch_info, must give the expected records.
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "aiebu_error.h"
+#include "json_reader.h"
+#include "patch_metadata.h"
+
+namespace pm = aiebu::patch_metadata;
+using aiebu::json_reader;
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+// fn must throw aiebu::error with invalid_asm
+void
+check_invalid(const std::function<void()>& fn, const std::string& what)
+{
+  try {
+    fn();
+  }
+  catch (aiebu::error& ex) {
+    check(ex.get_code() == static_cast<int>(aiebu::error::error_code::invalid_asm),
+          what + ": error code " + std::to_string(ex.get_code()) + " is not invalid_asm");
+    return;
+  }
+  check(false, what + ": accepted");
+}
+
+// Read the whole document, as the patch metadata parser does
+void
+read_all(const std::string& json)
+{
+  json_reader reader(json.data(), json.size());
+  reader.skip();
+  reader.finish();
+}
+
+void
+test_walk()
+{
+  const std::string json = "\xEF\xBB\xBF { \"a\" : [1, -2.5e3, \"x\", []],\n"
+                           "  \"b\\\"k\": {\"c\": true, \"d\": null},\t\"e\": false }\r\n";
+  json_reader reader(json.data(), json.size());
+  std::string_view key;
+
+  check(reader.peek() == json_reader::kind::object, "document is not an object");
+  reader.enter();
+
+  check(reader.next(&key) && key == "a", "first member is not a");
+  check(reader.peek() == json_reader::kind::array, "a is not an array");
+  reader.enter();
+  check(reader.next(&key) && key.empty(), "array element has a name");
+  auto one = reader.value();
+  check(one.type == json_reader::kind::number && one.text == "1", "a[0] is not 1");
+  check(reader.next(&key), "a[1] missing");
+  auto real = reader.value();
+  check(real.type == json_reader::kind::number && real.text == "-2.5e3", "a[1] text not kept");
+  check(reader.next(&key), "a[2] missing");
+  auto x = reader.value();
+  check(x.type == json_reader::kind::string && x.text == "x", "a[2] is not x");
+  check(reader.next(&key) && reader.is_container(), "a[3] is not a container");
+  reader.skip();
+  check(!reader.next(&key), "a has more than 4 elements");
+
+  check(reader.next(&key) && key == "b\"k", "escaped key not decoded");
+  reader.enter();
+  check(reader.next(&key) && key == "c", "b.c missing");
+  auto c = reader.value();
+  check(c.type == json_reader::kind::literal && c.text == "true", "b.c is not true");
+  check(reader.next(&key) && key == "d", "b.d missing");
+  check(reader.value().text == "null", "b.d is not null");
+  check(!reader.next(&key), "b has more than 2 members");
+
+  check(reader.next(&key) && key == "e", "e missing");
+  check(reader.value().text == "false", "e is not false");
+  check(!reader.next(&key), "document has more than 3 members");
+  reader.finish();
+}
+
+void
+test_escapes()
+{
+  const std::string json = R"(["q\"b\\s\/n\nr\rt\tb\bf\f", "\u0041\u00e9\u20ac\ud83d\ude00", "plain"])";
+  json_reader reader(json.data(), json.size());
+  reader.enter();
+
+  reader.next();
+  check(reader.value().text == "q\"b\\s/n\nr\rt\tb\bf\f", "simple escapes not decoded");
+  reader.next();
+  check(reader.value().text == "A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", "\\u escapes not decoded to utf-8");
+  // a string that follows an escaped one is not left in the scratch
+  reader.next();
+  check(reader.value().text == "plain", "string after escaped string differs");
+  check(!reader.next(), "array has more than 3 elements");
+  reader.finish();
+}
+
+void
+test_conversions()
+{
+  using kind = json_reader::kind;
+  uint32_t u32 = 0;
+  uint64_t u64 = 0;
+  bool b = false;
+
+  check(json_reader::to_uint32({kind::number, "4294967295"}, u32) && u32 == 0xFFFFFFFF, "max uint32");
+  check(!json_reader::to_uint32({kind::number, "4294967296"}, u32), "uint32 overflow accepted");
+  check(json_reader::to_uint32({kind::number, "-1"}, u32) && u32 == 0xFFFFFFFF, "-1 does not wrap");
+  check(json_reader::to_uint32({kind::string, " 12 "}, u32) && u32 == 12, "number in a string");
+  check(!json_reader::to_uint32({kind::number, "1.5"}, u32), "fraction accepted");
+  check(!json_reader::to_uint32({kind::literal, "true"}, u32), "literal accepted as number");
+  check(json_reader::to_uint64({kind::number, "18446744073709551615"}, u64) && u64 == UINT64_MAX,
+        "max uint64");
+  check(!json_reader::to_uint64({kind::number, "18446744073709551616"}, u64), "uint64 overflow accepted");
+  check(!json_reader::to_uint64({kind::string, ""}, u64), "empty string accepted as number");
+
+  check(json_reader::to_bool({kind::literal, "true"}, b) && b, "true");
+  check(json_reader::to_bool({kind::number, "0"}, b) && !b, "0");
+  check(json_reader::to_bool({kind::string, "1"}, b) && b, "\"1\"");
+  check(!json_reader::to_bool({kind::string, "yes"}, b), "yes accepted as bool");
+}
+
+void
+test_malformed()
+{
+  read_all(R"({"a": [1, {"b": ""}], "c": -0.5E+2})");
+
+  const std::vector<std::string> inputs = {
+    "",
+    "[1,]",
+    "[1 2]",
+    "{\"a\" 1}",
+    "{\"a\": 1,}",
+    "{,}",
+    "{1: 2}",
+    "[1",
+    "{\"a\": 1} x",
+    "\"abc",
+    "\"a\\x\"",
+    "\"a\\",
+    "\"\\u12\"",
+    "\"\\u12g4\"",
+    "\"\\ud800\"",
+    "\"\\ud800\\u0041\"",
+    "\"\\udc00\"",
+    std::string("\"a\x01\""),
+    "tru",
+    "-",
+    "1.",
+    "1e",
+    "01",
+    "+1",
+  };
+  for (const auto& input : inputs)
+    check_invalid([&input] { read_all(input); }, "malformed json '" + input + "'");
+
+  const std::string json = "[1]";
+  json_reader reader(json.data(), json.size());
+  reader.enter();
+  check_invalid([&reader] { reader.finish(); }, "finish inside an array");
+}
+
+const std::string dmacompiler_json = R"({
+  "ctrl_pkt_patch_info": [
+    {"offset": 16, "xrt_arg_idx": 3, "bo_offset": 4096},
+    {"xrt_arg_idx": "1", "bo_offset": 0, "offset": 80, "unknown": [1, 2]}
+  ]
+})";
+
+void
+test_dmacompiler()
+{
+  auto metadata = pm::from_json(dmacompiler_json.data(), dmacompiler_json.size());
+  auto v = metadata.get_view();
+  check(v.num_buffers == 5, "dmacompiler buffers " + std::to_string(v.num_buffers) + ", expected 5");
+  for (size_t i = 0; i < v.num_buffers; ++i) {
+    const auto& buffer = v.buffers[i];
+    check(buffer.xrt_id == i && buffer.logical_id == -1, "dmacompiler buffer " + std::to_string(i) + " differs");
+    check(buffer.flags == (i == 4 ? pm::buffer_flag_control_packet : 0),
+          "dmacompiler buffer " + std::to_string(i) + " flags");
+  }
+  check(v.num_patches == 2, "dmacompiler patches " + std::to_string(v.num_patches) + ", expected 2");
+  if (v.num_patches == 2) {
+    check(v.patches[0].xrt_id == 3 && v.patches[0].offset == 16 && v.patches[0].addend == 4096 &&
+          v.patches[0].logical_id == -1, "dmacompiler patch 0 differs");
+    check(v.patches[1].xrt_id == 1 && v.patches[1].offset == 80 && v.patches[1].addend == 0,
+          "dmacompiler patch 1 differs");
+  }
+
+  // the control packet arg may come after the patches
+  std::string json = dmacompiler_json;
+  json.insert(json.rfind('}'), ", \"ctrl_pkt_xrt_arg_idx\": 2");
+  auto arg2 = pm::from_json(json.data(), json.size());
+  v = arg2.get_view();
+  check(v.num_buffers == 5 && v.buffers[2].flags == pm::buffer_flag_control_packet && v.buffers[4].flags == 0,
+        "control packet not moved to arg 2");
+
+  json = dmacompiler_json;
+  json.insert(json.find('{') + 1, "\"ctrl_pkt_xrt_arg_idx\": 6, ");
+  auto arg6 = pm::from_json(json.data(), json.size());
+  v = arg6.get_view();
+  check(v.num_buffers == 6 && v.buffers[5].xrt_id == 6 && v.buffers[5].flags == pm::buffer_flag_control_packet &&
+        v.buffers[4].flags == 0, "control packet arg 6 not added");
+
+  json = dmacompiler_json;
+  json.replace(json.find("\"offset\": 16, "), 14, "");
+  check_invalid([&json] { (void)pm::from_json(json.data(), json.size()); }, "dmacompiler patch without offset");
+
+  json = dmacompiler_json;
+  json.replace(json.find("\"xrt_arg_idx\": 3"), 16, "\"xrt_arg_idx\": [3]");
+  check_invalid([&json] { (void)pm::from_json(json.data(), json.size()); }, "dmacompiler arg index not a number");
+}
+
+const std::string aiecompiler_json = R"({
+  "ctrl_pkt_patch_info": [{"offset": 16, "xrt_arg_idx": 3, "bo_offset": 0}],
+  "external_buffers": {
+    "buffer0": {
+      "xrt_id": 1,
+      "size_in_bytes": 8192,
+      "name": "graph.\"weights\"\\\u00e9",
+      "coalesed_buffers": [
+        {
+          "logical_id": 0,
+          "offset_in_bytes": 4096,
+          "name": "graph\tw0",
+          "control_packet_patch_locations": [{"offset": 12, "size": 6, "operation": "read_add_write"}]
+        }
+      ]
+    },
+    "buffer1": {
+      "xrt_id": "0",
+      "logical_id": -1,
+      "ctrl_pkt_buffer": true,
+      "name": "ctrl"
+    }
+  }
+})";
+
+// external_buffers wins over ctrl_pkt_patch_info in the same document
+void
+test_aiecompiler()
+{
+  auto metadata = pm::from_json(aiecompiler_json.data(), aiecompiler_json.size());
+  auto v = metadata.get_view();
+  check(v.num_buffers == 3, "aiecompiler buffers " + std::to_string(v.num_buffers) + ", expected 3");
+  check(v.num_patches == 1, "aiecompiler patches " + std::to_string(v.num_patches) + ", expected 1");
+  if (v.num_buffers == 3) {
+    check(v.buffers[0].xrt_id == 1 && v.buffers[0].size_in_bytes == 8192 &&
+          v.name(v.buffers[0].name) == "graph.\"weights\"\\\xC3\xA9", "escaped buffer name not decoded");
+    check((v.buffers[1].flags & pm::buffer_flag_coalesed) && v.buffers[1].size_in_bytes == 4096 &&
+          v.buffers[1].logical_id == 0 && v.name(v.buffers[1].name) == "graph\tw0", "coalesced buffer differs");
+    check(v.buffers[2].xrt_id == 0 && v.buffers[2].flags == pm::buffer_flag_control_packet,
+          "control packet buffer differs");
+  }
+  if (v.num_patches == 1)
+    check(v.patches[0].xrt_id == 1 && v.patches[0].logical_id == 0 && v.patches[0].offset == 12 &&
+          v.patches[0].size == 6 && v.patches[0].addend == 4096, "coalesced patch differs");
+
+  std::string json = aiecompiler_json;
+  json.replace(json.find("\"xrt_id\": 1,"), 12, "");
+  check_invalid([&json] { (void)pm::from_json(json.data(), json.size()); }, "external buffer without xrt_id");
+
+  json = aiecompiler_json;
+  json.replace(json.find("\"offset\": 12, "), 14, "");
+  check_invalid([&json] { (void)pm::from_json(json.data(), json.size()); }, "patch location without offset");
+
+  json = aiecompiler_json;
+  json.replace(json.find("\"offset_in_bytes\": 4096"), 23, "\"offset_in_bytes\": 8193");
+  check_invalid([&json] { (void)pm::from_json(json.data(), json.size()); }, "coalesced offset beyond buffer");
+
+  json = aiecompiler_json;
+  json.erase(json.rfind('}'));
+  check_invalid([&json] { (void)pm::from_json(json.data(), json.size()); }, "truncated external_buffers");
+}
+
+}
+
+int main()
+{
+  test_walk();
+  test_escapes();
+  test_conversions();
+  test_malformed();
+  test_dmacompiler();
+  test_aiecompiler();
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
+}
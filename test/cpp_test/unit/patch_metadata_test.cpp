@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Patch metadata read from json, written in binary form and loaded again
+// must give the same records, and a binary file must fail the checks a
+// json file fails.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "aiebu_error.h"
+#include "patch_metadata.h"
+
+namespace pm = aiebu::patch_metadata;
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+// fn must throw aiebu::error with invalid_asm
+void
+check_invalid(const std::function<void()>& fn, const std::string& what)
+{
+  try {
+    fn();
+  }
+  catch (aiebu::error& ex) {
+    check(ex.get_code() == static_cast<int>(aiebu::error::error_code::invalid_asm),
+          what + ": error code " + std::to_string(ex.get_code()) + " is not invalid_asm");
+    return;
+  }
+  check(false, what + ": accepted");
+}
+
+const std::string aiecompiler_json = R"({
+  "external_buffers": {
+    "buffer0": {
+      "xrt_id": 1,
+      "size_in_bytes": 345088,
+      "name": "coalesed_weights",
+      "coalesed_buffers": [
+        {
+          "logical_id": 0,
+          "offset_in_bytes": 0,
+          "name": "compute_graph.resnet_layers[0].wts_ddr",
+          "control_packet_patch_locations": [
+            {"offset": 17420, "size": 6, "operation": "read_add_write"},
+            {"offset": 17484, "size": 6, "operation": "read_add_write"}
+          ]
+        },
+        {
+          "logical_id": 1,
+          "offset_in_bytes": 37888,
+          "name": "compute_graph.resnet_layers[1].wts_ddr",
+          "control_packet_patch_locations": [
+            {"offset": 19404, "size": 6, "operation": "read_add_write"}
+          ]
+        }
+      ]
+    },
+    "buffer1": {
+      "xrt_id": 2,
+      "logical_id": 3,
+      "size_in_bytes": 802816,
+      "name": "compute_graph.ifm_ddr",
+      "control_packet_patch_locations": [
+        {"offset": 12, "size": 6, "operation": "read_add_write"},
+        {"offset": 76, "size": 6}
+      ]
+    },
+    "buffer3": {
+      "xrt_id": 0,
+      "logical_id": -1,
+      "size_in_bytes": 60736,
+      "ctrl_pkt_buffer": 1,
+      "name": "runtime_control_packet"
+    }
+  }
+})";
+
+bool
+same_buffer(const pm::view& a, size_t i, const pm::view& b, size_t j)
+{
+  const auto& x = a.buffers[i];
+  const auto& y = b.buffers[j];
+  return x.xrt_id == y.xrt_id && x.logical_id == y.logical_id && x.size_in_bytes == y.size_in_bytes &&
+         x.flags == y.flags && a.name(x.name) == b.name(y.name);
+}
+
+bool
+same_patch(const pm::patch_record& x, const pm::patch_record& y)
+{
+  return x.xrt_id == y.xrt_id && x.logical_id == y.logical_id && x.offset == y.offset &&
+         x.size == y.size && x.addend == y.addend && x.operation == y.operation && x.schema == y.schema;
+}
+
+void
+test_round_trip()
+{
+  auto json = pm::from_json(aiecompiler_json.data(), aiecompiler_json.size());
+  auto expected = json.get_view();
+  check(expected.num_buffers == 5, "json buffers " + std::to_string(expected.num_buffers) + ", expected 5");
+  check(expected.num_patches == 5, "json patches " + std::to_string(expected.num_patches) + ", expected 5");
+
+  auto binary = json.serialize();
+  check(binary.size() % 8 == 0, "binary size is not a multiple of 8");
+  check(pm::is_binary(binary.data(), binary.size()), "binary form has no magic");
+  check(!pm::is_binary(aiecompiler_json.data(), aiecompiler_json.size()), "json taken for binary form");
+
+  auto loaded = pm::parse(binary.data(), binary.size());
+  check(loaded.num_buffers == expected.num_buffers, "loaded buffer count differs");
+  check(loaded.num_patches == expected.num_patches, "loaded patch count differs");
+  for (size_t i = 0; i < std::min(loaded.num_buffers, expected.num_buffers); ++i)
+    check(same_buffer(loaded, i, expected, i), "loaded buffer " + std::to_string(i) + " differs");
+  for (size_t i = 0; i < std::min(loaded.num_patches, expected.num_patches); ++i)
+    check(same_patch(loaded.patches[i], expected.patches[i]), "loaded patch " + std::to_string(i) + " differs");
+
+  // the coalesced buffer at 37888 keeps its offset, its patch the addend
+  check(loaded.num_buffers > 2 && (loaded.buffers[2].flags & pm::buffer_flag_coalesed) &&
+        loaded.buffers[2].size_in_bytes == 37888, "coalesced buffer offset not kept");
+  check(loaded.num_patches > 2 && loaded.patches[2].addend == 37888, "coalesced patch addend not kept");
+  check(loaded.num_buffers > 4 && (loaded.buffers[4].flags & pm::buffer_flag_control_packet),
+        "control packet flag not kept");
+
+  // serializing the loaded view again gives the same bytes
+  pm::builder again;
+  for (size_t i = 0; i < loaded.num_buffers; ++i) {
+    auto buffer = loaded.buffers[i];
+    buffer.name = again.intern(loaded.name(buffer.name));
+    again.add_buffer(buffer);
+  }
+  for (size_t i = 0; i < loaded.num_patches; ++i)
+    again.add_patch(loaded.patches[i]);
+  check(again.serialize() == binary, "binary form of the loaded metadata differs");
+}
+
+// A coalesced buffer beyond its buffer is rejected from both forms
+void
+test_coalesced_bounds()
+{
+  std::string json = aiecompiler_json;
+  auto pos = json.find("37888");
+  json.replace(pos, 5, "345089");
+  check_invalid([&json] { (void)pm::from_json(json.data(), json.size()); },
+                "json coalesced offset beyond buffer size");
+
+  pm::builder b;
+  b.add_buffer({1, -1, 4096, b.intern("weights"), 0});
+  b.add_buffer({1, 0, 4096, 0, pm::buffer_flag_coalesed});
+  auto at_end = b.serialize();
+  pm::parse(at_end.data(), at_end.size());
+
+  b.add_buffer({1, 1, 4097, 0, pm::buffer_flag_coalesed});
+  auto beyond = b.serialize();
+  check_invalid([&beyond] { (void)pm::parse(beyond.data(), beyond.size()); },
+                "binary coalesced offset beyond buffer size");
+
+  pm::builder wide;
+  wide.add_buffer({1, -1, 0x100000000ULL, 0, 0});
+  wide.add_buffer({1, 0, 0, 0, pm::buffer_flag_coalesed});
+  auto too_big = wide.serialize();
+  check_invalid([&too_big] { (void)pm::parse(too_big.data(), too_big.size()); },
+                "binary buffer size beyond 32 bits");
+
+  pm::builder arg;
+  arg.add_buffer({pm::max_arg_index + 1, -1, 4096, 0, 0});
+  arg.add_buffer({pm::max_arg_index + 1, 0, 0, 0, pm::buffer_flag_coalesed});
+  auto bad_arg = arg.serialize();
+  check_invalid([&bad_arg] { (void)pm::parse(bad_arg.data(), bad_arg.size()); },
+                "binary coalesced buffer arg index beyond max");
+
+  pm::builder orphan;
+  orphan.add_buffer({2, -1, 4096, 0, 0});
+  orphan.add_buffer({1, 0, 0, 0, pm::buffer_flag_coalesed});
+  auto no_parent = orphan.serialize();
+  check_invalid([&no_parent] { (void)pm::parse(no_parent.data(), no_parent.size()); },
+                "binary coalesced buffer of another buffer");
+}
+
+void
+test_malformed()
+{
+  auto binary = pm::from_json(aiecompiler_json.data(), aiecompiler_json.size()).serialize();
+
+  check_invalid([&binary] { (void)pm::parse(binary.data(), sizeof(pm::header) - 8); },
+                "truncated header");
+  check_invalid([&binary] { (void)pm::parse(binary.data(), binary.size() - 8); },
+                "truncated string table");
+
+  auto bad_version = binary;
+  bad_version[offsetof(pm::header, version)] = 2;
+  check_invalid([&bad_version] { (void)pm::parse(bad_version.data(), bad_version.size()); },
+                "unsupported version");
+
+  auto bad_count = binary;
+  uint32_t num_patches = 0x10000000;
+  std::memcpy(bad_count.data() + offsetof(pm::header, num_patches), &num_patches, sizeof(num_patches));
+  check_invalid([&bad_count] { (void)pm::parse(bad_count.data(), bad_count.size()); },
+                "patch table beyond buffer");
+}
+
+}
+
+int main()
+{
+  test_round_trip();
+  test_coalesced_bounds();
+  test_malformed();
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// The .note.xrt.reloc_index of an assembled transaction must describe
+// .rela.dyn exactly: section ranges partition the relocations in order,
+// argument ranges partition their section, and each range holds only the
+// relocations of its section and argument, in address order.
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "aiebu_assembler.h"
+#include "aiebu_elf_view.h"
+#include "aiebu_error.h"
+#include "bd_decoder.h"
+#include "xaiengine.h"
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+// Same values as elfwriter.h, the note is part of the elf format
+constexpr uint32_t NT_XRT_RELOC_INDEX = 5;
+constexpr uint32_t reloc_index_version = 1;
+
+template <typename T>
+void
+put(std::vector<char>& txn, const T& value)
+{
+  auto data = reinterpret_cast<const char*>(&value);
+  txn.insert(txn.end(), data, data + sizeof(value));
+}
+
+uint32_t
+shim_bd(uint32_t col, uint32_t bd)
+{
+  return col << aiebu::aie2_bd::col_shift | (aiebu::aie2_bd::shim_bd0 + bd * aiebu::aie2_bd::shim_bd_size);
+}
+
+// A legacy format transaction writing one shim BD per patch and patching
+// its base address with the arg, the args are not in order
+std::vector<char>
+make_txn(const std::vector<std::pair<uint32_t, uint32_t>>& patches)
+{
+  std::vector<char> txn(sizeof(XAie_TxnHeader));
+  uint32_t num_ops = 0;
+  uint32_t bd = 0;
+  for (const auto& [col, arg] : patches) {
+    const uint32_t reg = shim_bd(col, bd++ % aiebu::aie2_bd::shim_bd_num);
+
+    XAie_BlockWrite32Hdr bw{};
+    bw.OpHdr.Op = XAIE_IO_BLOCKWRITE;
+    bw.RegOff = reg;
+    bw.Size = static_cast<uint32_t>(sizeof(bw) + aiebu::aie2_bd::shim_bd_size);
+    put(txn, bw);
+    put(txn, uint32_t(1024));
+    for (uint32_t word = 1; word < aiebu::aie2_bd::shim_bd_size / sizeof(uint32_t); ++word)
+      put(txn, word);
+
+    XAie_CustomOpHdr op{};
+    op.OpHdr.Op = XAIE_IO_CUSTOM_OP_DDR_PATCH;
+    op.Size = static_cast<uint32_t>(sizeof(op) + sizeof(patch_op_t));
+    put(txn, op);
+    patch_op_t patch{};
+    patch.regaddr = reg + aiebu::aie2_bd::word_size;
+    patch.argidx = arg;
+    patch.argplus = 64 * num_ops;
+    put(txn, patch);
+    num_ops += 2;
+  }
+
+  XAie_TxnHeader hdr{};
+  hdr.Major = 0;
+  hdr.Minor = 1;
+  hdr.NumCols = 4;
+  hdr.NumRows = 6;
+  hdr.NumOps = num_ops;
+  hdr.TxnSize = static_cast<uint32_t>(txn.size());
+  std::memcpy(txn.data(), &hdr, sizeof(hdr));
+  return txn;
+}
+
+uint32_t
+word(const char* desc, size_t index)
+{
+  uint32_t value = 0;
+  std::memcpy(&value, desc + index * sizeof(value), sizeof(value));
+  return value;
+}
+
+void
+test_reloc_index()
+{
+  // ctrltext patches of args 2, 0, 1 on several columns, arg 0 twice
+  auto txn = make_txn({{0, 2}, {1, 0}, {0, 1}, {2, 0}, {3, 2}, {1, 1}});
+  std::vector<char> ctrlpkt(256);
+  const std::string json = R"({
+    "ctrl_pkt_patch_info": [
+      {"offset": 200, "xrt_arg_idx": 3, "bo_offset": 0},
+      {"offset": 16, "xrt_arg_idx": 1, "bo_offset": 128},
+      {"offset": 104, "xrt_arg_idx": 3, "bo_offset": 0},
+      {"offset": 40, "xrt_arg_idx": 1, "bo_offset": 0}
+    ]
+  })";
+  std::vector<char> patch_json(json.begin(), json.end());
+
+  aiebu::aiebu_assembler as(aiebu::aiebu_assembler::buffer_type::blob_instr_transaction, txn, ctrlpkt, patch_json);
+  auto elf = as.get_elf();
+  aiebu::elf_view view{aiebu::const_buffer(elf)};
+
+  auto rela = view.find_section(".rela.dyn");
+  auto dynsym = view.find_section(".dynsym");
+  auto notes = view.find_section(".note.xrt.reloc_index");
+  check(rela.has_value() && dynsym.has_value() && notes.has_value(), "elf has no .rela.dyn, .dynsym or reloc index");
+  if (!rela || !dynsym || !notes)
+    return;
+
+  std::vector<aiebu::elf_view::relocation> relocs;
+  view.for_each_relocation(*rela, [&relocs](const auto& r) { relocs.push_back(r); });
+  check(relocs.size() == 10, "relocations " + std::to_string(relocs.size()) + ", expected 10");
+
+  std::vector<uint32_t> desc;
+  view.for_each_note(*notes, [&desc](const auto& note) {
+    if (note.type != NT_XRT_RELOC_INDEX)
+      return;
+    for (size_t i = 0; i < note.desc.size / sizeof(uint32_t); ++i)
+      desc.push_back(word(note.desc.data, i));
+  });
+  check(desc.size() >= 3 && desc[0] == reloc_index_version, "reloc index note missing or bad version");
+  if (desc.size() < 3)
+    return;
+  const uint32_t num_sections = desc[1];
+  const uint32_t num_arguments = desc[2];
+  check(desc.size() == 3 + 3 * num_sections + 4 * num_arguments, "reloc index note size");
+  if (desc.size() != 3 + 3 * num_sections + 4 * num_arguments)
+    return;
+  // .ctrltext args 3, 4, 5 and .ctrldata args 4, 6
+  check(num_sections == 2, std::to_string(num_sections) + " sections indexed, expected 2");
+  check(num_arguments == 5, std::to_string(num_arguments) + " arguments indexed, expected 5");
+
+  // sections partition the relocations in order, each relocation's
+  // symbol is defined in the section of its range
+  uint32_t next = 0;
+  std::set<uint32_t> sections;
+  for (uint32_t s = 0; s < num_sections; ++s) {
+    const uint32_t* sec = &desc[3 + 3 * s];
+    const std::string what = "section range " + std::to_string(s);
+    check(sec[1] == next && sec[2] > 0, what + " not contiguous");
+    check(sections.insert(sec[0]).second, what + " section indexed twice");
+    next = sec[1] + sec[2];
+    for (uint32_t r = sec[1]; r < next && r < relocs.size(); ++r)
+      check(view.get_symbol(*dynsym, relocs[r].symbol).shndx == sec[0],
+            what + ": relocation " + std::to_string(r) + " of another section");
+  }
+  check(next == relocs.size(), "section ranges do not cover .rela.dyn");
+
+  // arguments partition their section, each range holds one name in
+  // address order and a name has one range per section
+  next = 0;
+  std::set<std::pair<uint32_t, std::string>> arguments;
+  for (uint32_t a = 0; a < num_arguments; ++a) {
+    const uint32_t* arg = &desc[3 + 3 * num_sections + 4 * a];
+    const std::string what = "argument range " + std::to_string(a);
+    check(arg[2] == next && arg[3] > 0, what + " not contiguous");
+    next = arg[2] + arg[3];
+    const std::string name(view.get_symbol(*dynsym, arg[1]).name);
+    check(arguments.insert({arg[0], name}).second, what + ": argument " + name + " split");
+
+    bool in_section = false;
+    for (uint32_t s = 0; s < num_sections; ++s) {
+      const uint32_t* sec = &desc[3 + 3 * s];
+      in_section |= sec[0] == arg[0] && arg[2] >= sec[1] && next <= sec[1] + sec[2];
+    }
+    check(in_section, what + " not within its section range");
+
+    for (uint32_t r = arg[2]; r < next && r < relocs.size(); ++r) {
+      const auto sym = view.get_symbol(*dynsym, relocs[r].symbol);
+      check(sym.name == name && sym.shndx == arg[0],
+            what + ": relocation " + std::to_string(r) + " of " + std::string(sym.name));
+      check(r == arg[2] || relocs[r - 1].offset < relocs[r].offset,
+            what + ": relocation " + std::to_string(r) + " out of address order");
+    }
+  }
+  check(next == relocs.size(), "argument ranges do not cover .rela.dyn");
+
+  auto ctrldata = view.find_section(".ctrldata");
+  check(ctrldata && arguments.count({ctrldata->index, "4"}) && arguments.count({ctrldata->index, "6"}),
+        ".ctrldata arguments 4 and 6 not indexed");
+}
+
+}
+
+int main()
+{
+  try {
+    test_reloc_index();
+  }
+  catch (aiebu::error& ex) {
+    check(false, std::string("assembly failed: ") + ex.what());
+  }
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Every string added to the .dynstr string table must resolve to itself,
+// NUL terminated, while suffixes and duplicates share storage and the
+// empty string is offset 0.
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "string_table.h"
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+// Each handle's offset must point to its string followed by a NUL
+void
+check_offsets(const aiebu::string_table& table, const std::vector<std::string>& strings,
+              const std::vector<uint32_t>& handles, const std::string& name)
+{
+  const auto& data = table.data();
+  check(!data.empty() && data.front() == '\0', name + ": table does not start with NUL");
+  check(!data.empty() && data.back() == '\0', name + ": table does not end with NUL");
+  for (size_t i = 0; i < strings.size(); ++i) {
+    const auto offset = table.offset(handles[i]);
+    if (offset >= data.size()) {
+      check(false, name + ": offset of '" + strings[i] + "' beyond the table");
+      continue;
+    }
+    check(std::strlen(data.c_str() + offset) == strings[i].size() &&
+          data.compare(offset, strings[i].size(), strings[i]) == 0,
+          name + ": offset of '" + strings[i] + "' resolves to '" + (data.c_str() + offset) + "'");
+  }
+}
+
+void
+test_tail_merge()
+{
+  const std::vector<std::string> strings = {
+    "arg", "scratch-arg", "", "ctrltext", "text", "scratch-arg", "xt", "arg", "", "g", "ctrldata", "data"
+  };
+  aiebu::string_table table;
+  std::vector<uint32_t> handles;
+  for (const auto& str : strings)
+    handles.push_back(table.add(str));
+  table.finalize();
+
+  check_offsets(table, strings, handles, "tail merge");
+  // only the longest string of each suffix chain is stored
+  const std::string expected = std::string(1, '\0') + "scratch-arg" + '\0' + "ctrltext" + '\0' + "ctrldata" + '\0';
+  check(table.data().size() == expected.size(),
+        "tail merge: table size " + std::to_string(table.data().size()) + ", expected " +
+        std::to_string(expected.size()));
+
+  check(table.offset(handles[2]) == 0 && table.offset(handles[8]) == 0, "empty string is not offset 0");
+  check(table.offset(handles[0]) == table.offset(handles[7]), "duplicate 'arg' not merged");
+  check(table.offset(handles[1]) == table.offset(handles[5]), "duplicate 'scratch-arg' not merged");
+  check(table.offset(handles[0]) == table.offset(handles[1]) + 8, "'arg' does not point into 'scratch-arg'");
+  check(table.offset(handles[6]) == table.offset(handles[4]) + 2, "'xt' does not point into 'text'");
+}
+
+// Strings that share a prefix but not a suffix are all stored
+void
+test_no_merge()
+{
+  const std::vector<std::string> strings = {"ab", "abc", "a", "b", "ba"};
+  aiebu::string_table table;
+  std::vector<uint32_t> handles;
+  for (const auto& str : strings)
+    handles.push_back(table.add(str));
+  table.finalize();
+
+  check_offsets(table, strings, handles, "no merge");
+  // "b" is a suffix of "ab", "a" of "ba"
+  check(table.data().size() == 1 + 3 + 4 + 3, "no merge: table size " + std::to_string(table.data().size()));
+}
+
+// Many names, as the dynsyms of a large elf, with repeated suffixes
+void
+test_many()
+{
+  std::vector<std::string> strings;
+  for (int i = 0; i < 500; ++i) {
+    strings.push_back("arg" + std::to_string(i % 37));
+    strings.push_back("ctrl" + std::to_string(i % 11) + ".text");
+    strings.push_back(std::to_string(i % 37));
+  }
+  strings.push_back("");
+  aiebu::string_table table;
+  std::vector<uint32_t> handles;
+  for (const auto& str : strings)
+    handles.push_back(table.add(str));
+  table.finalize();
+
+  check_offsets(table, strings, handles, "many");
+  size_t unique_size = 1;
+  for (int i = 0; i < 37; ++i)
+    unique_size += std::string("arg" + std::to_string(i)).size() + 1;
+  for (int i = 0; i < 11; ++i)
+    unique_size += std::string("ctrl" + std::to_string(i) + ".text").size() + 1;
+  check(table.data().size() == unique_size,
+        "many: table size " + std::to_string(table.data().size()) + ", expected " + std::to_string(unique_size));
+}
+
+void
+test_empty()
+{
+  aiebu::string_table table;
+  table.finalize();
+  check(table.data() == std::string(1, '\0'), "empty table is not a single NUL");
+}
+
+}
+
+int main()
+{
+  test_tail_merge();
+  test_no_merge();
+  test_many();
+  test_empty();
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
+}
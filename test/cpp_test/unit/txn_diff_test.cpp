@@ -0,0 +1,388 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Transaction diffs with known edit scripts: an inserted, a removed and a
+// changed op each give that one change, and the same ops in the legacy
+// and the opt header format compare clean. Ops that do not fit the buffer
+// are rejected by the transaction walker.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "aiebu_error.h"
+#include "aiebu_report.h"
+#include "txn_cursor.h"
+
+namespace txn = aiebu::txn;
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+// One op of a test transaction, a block write when payload is not empty
+struct op
+{
+  uint8_t code;
+  uint32_t reg;
+  uint32_t value = 0;
+  uint32_t mask = 0;
+  std::vector<uint32_t> payload = {};
+};
+
+op
+write(uint32_t reg, uint32_t value)
+{
+  return {XAIE_IO_WRITE, reg, value};
+}
+
+op
+mask_write(uint32_t reg, uint32_t mask, uint32_t value)
+{
+  return {XAIE_IO_MASKWRITE, reg, value, mask};
+}
+
+op
+block_write(uint32_t reg, std::vector<uint32_t> payload)
+{
+  return {XAIE_IO_BLOCKWRITE, reg, 0, 0, std::move(payload)};
+}
+
+template <typename T>
+void
+put(std::vector<char>& txn, const T& value)
+{
+  auto data = reinterpret_cast<const char*>(&value);
+  txn.insert(txn.end(), data, data + sizeof(value));
+}
+
+// Legacy headers carry the size of every op, opt headers of block writes only
+template <typename Format, typename Hdr>
+void
+set_size(Hdr& hdr, size_t size)
+{
+  if constexpr (std::is_same_v<Format, txn::format_legacy>)
+    hdr.Size = static_cast<uint32_t>(size);
+}
+
+template <typename Format>
+std::vector<char>
+encode(const std::vector<op>& ops)
+{
+  std::vector<char> txn(sizeof(XAie_TxnHeader));
+  for (const auto& o : ops) {
+    if (o.code == XAIE_IO_WRITE) {
+      typename Format::write32 hdr{};
+      hdr.OpHdr.Op = o.code;
+      hdr.RegOff = o.reg;
+      hdr.Value = o.value;
+      set_size<Format>(hdr, sizeof(hdr));
+      put(txn, hdr);
+    }
+    else if (o.code == XAIE_IO_MASKWRITE) {
+      typename Format::mask_write32 hdr{};
+      hdr.OpHdr.Op = o.code;
+      hdr.RegOff = o.reg;
+      hdr.Mask = o.mask;
+      hdr.Value = o.value;
+      set_size<Format>(hdr, sizeof(hdr));
+      put(txn, hdr);
+    }
+    else {
+      typename Format::block_write32 hdr{};
+      hdr.OpHdr.Op = o.code;
+      hdr.RegOff = o.reg;
+      hdr.Size = static_cast<uint32_t>(sizeof(hdr) + o.payload.size() * sizeof(uint32_t));
+      put(txn, hdr);
+      for (auto word : o.payload)
+        put(txn, word);
+    }
+  }
+
+  XAie_TxnHeader hdr{};
+  const bool opt = std::is_same_v<Format, txn::format_opt>;
+  hdr.Major = opt ? txn::opt_major : 0;
+  hdr.Minor = opt ? txn::opt_minor : 1;
+  hdr.NumOps = static_cast<uint32_t>(ops.size());
+  hdr.TxnSize = static_cast<uint32_t>(txn.size());
+  std::memcpy(txn.data(), &hdr, sizeof(hdr));
+  return txn;
+}
+
+aiebu::elf_diff
+diff(const std::vector<char>& old_txn, const std::vector<char>& new_txn, size_t max_changes = 1000)
+{
+  return aiebu::diff_transaction({old_txn.data(), old_txn.size()}, {new_txn.data(), new_txn.size()}, max_changes);
+}
+
+// An expected change, index, register and value of the old and new op,
+// those of the side a change does not have are ignored
+struct edit
+{
+  aiebu::elf_diff::kind type;
+  uint32_t old_index, old_reg, old_value;
+  uint32_t new_index, new_reg, new_value;
+};
+
+const char*
+kind_name(aiebu::elf_diff::kind type)
+{
+  switch (type) {
+  case aiebu::elf_diff::kind::inserted: return "inserted";
+  case aiebu::elf_diff::kind::removed: return "removed";
+  case aiebu::elf_diff::kind::changed: return "changed";
+  }
+  return "unknown";
+}
+
+void
+check_edits(const aiebu::elf_diff& d, const std::vector<edit>& expected, uint64_t unchanged, const std::string& what)
+{
+  check(d.sections.size() == 1 && d.sections[0].name == "txn", what + ": not one txn section");
+  if (d.sections.empty())
+    return;
+  const auto& sec = d.sections[0];
+  uint64_t inserted = 0, removed = 0, changed = 0;
+  for (const auto& e : expected) {
+    inserted += e.type == aiebu::elf_diff::kind::inserted;
+    removed += e.type == aiebu::elf_diff::kind::removed;
+    changed += e.type == aiebu::elf_diff::kind::changed;
+  }
+  check(sec.inserted == inserted, what + ": " + std::to_string(sec.inserted) + " inserted");
+  check(sec.removed == removed, what + ": " + std::to_string(sec.removed) + " removed");
+  check(sec.changed == changed, what + ": " + std::to_string(sec.changed) + " changed");
+  check(sec.unchanged == unchanged, what + ": " + std::to_string(sec.unchanged) + " unchanged");
+
+  check(d.changes.size() == expected.size(), what + ": " + std::to_string(d.changes.size()) + " changes");
+  for (size_t i = 0; i < std::min(d.changes.size(), expected.size()); ++i) {
+    const auto& c = d.changes[i];
+    const auto& e = expected[i];
+    const std::string at = what + ": change " + std::to_string(i) + " ";
+    check(c.type == e.type, at + "is " + kind_name(c.type) + ", expected " + kind_name(e.type));
+    check(c.section == "txn", at + "in section " + c.section);
+    if (e.type != aiebu::elf_diff::kind::inserted)
+      check(c.old_op.index == e.old_index && c.old_op.reg == e.old_reg && c.old_op.value == e.old_value,
+            at + "old op " + std::to_string(c.old_op.index) + " reg " + std::to_string(c.old_op.reg) +
+            " value " + std::to_string(c.old_op.value));
+    if (e.type != aiebu::elf_diff::kind::removed)
+      check(c.new_op.index == e.new_index && c.new_op.reg == e.new_reg && c.new_op.value == e.new_value,
+            at + "new op " + std::to_string(c.new_op.index) + " reg " + std::to_string(c.new_op.reg) +
+            " value " + std::to_string(c.new_op.value));
+  }
+}
+
+const std::vector<op> base = {
+  write(0x100, 1),
+  write(0x200, 2),
+  mask_write(0x300, 0xff, 3),
+  block_write(0x400, {4, 5, 6}),
+  write(0x500, 7),
+};
+
+using kind = aiebu::elf_diff::kind;
+
+void
+test_inserted()
+{
+  auto ops = base;
+  ops.insert(ops.begin() + 2, write(0x250, 9));
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops)),
+              {{kind::inserted, 0, 0, 0, 2, 0x250, 9}}, base.size(), "inserted op");
+
+  auto d = diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops));
+  check(!d.sections.empty() && d.sections[0].old_ops == base.size() && d.sections[0].new_ops == ops.size(),
+        "inserted op: op counts");
+  check(!d.sections.empty() && d.sections[0].ops.size() == 1 && d.sections[0].ops[0].name == "XAIE_IO_WRITE" &&
+        d.sections[0].ops[0].count == 1 && d.sections[0].ops[0].bytes == sizeof(XAie_Write32Hdr_opt),
+        "inserted op: op delta is not one write");
+
+  // at the front and at the end
+  ops = base;
+  ops.insert(ops.begin(), write(0x50, 1));
+  ops.push_back(write(0x600, 1));
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops)),
+              {{kind::inserted, 0, 0, 0, 0, 0x50, 1}, {kind::inserted, 0, 0, 0, 6, 0x600, 1}},
+              base.size(), "ops inserted at both ends");
+}
+
+void
+test_removed()
+{
+  auto ops = base;
+  ops.erase(ops.begin() + 1);
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops)),
+              {{kind::removed, 1, 0x200, 2, 0, 0, 0}}, base.size() - 1, "removed op");
+
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>({})),
+              {{kind::removed, 0, 0x100, 1, 0, 0, 0}, {kind::removed, 1, 0x200, 2, 0, 0, 0},
+               {kind::removed, 2, 0x300, 3, 0, 0, 0}, {kind::removed, 3, 0x400, 0, 0, 0, 0},
+               {kind::removed, 4, 0x500, 7, 0, 0, 0}},
+              0, "all ops removed");
+}
+
+void
+test_changed()
+{
+  auto ops = base;
+  ops[1].value = 8;
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops)),
+              {{kind::changed, 1, 0x200, 2, 1, 0x200, 8}}, base.size() - 1, "changed value");
+
+  ops = base;
+  ops[2].mask = 0xf0;
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops)),
+              {{kind::changed, 2, 0x300, 3, 2, 0x300, 3}}, base.size() - 1, "changed mask");
+
+  ops = base;
+  ops[3].payload[1] = 50;
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops)),
+              {{kind::changed, 3, 0x400, 0, 3, 0x400, 0}}, base.size() - 1, "changed block write payload");
+
+  // a write to another register is not the same op
+  ops = base;
+  ops[4].reg = 0x510;
+  check_edits(diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops)),
+              {{kind::removed, 4, 0x500, 7, 0, 0, 0}, {kind::inserted, 0, 0, 0, 4, 0x510, 7}},
+              base.size() - 1, "write to another register");
+}
+
+// Fields are compared decoded, the header format alone is no difference
+void
+test_legacy_vs_opt()
+{
+  auto legacy = encode<txn::format_legacy>(base);
+  auto opt = encode<txn::format_opt>(base);
+  check(legacy.size() != opt.size(), "legacy and opt encodings of the same size");
+
+  auto d = diff(legacy, opt);
+  check_edits(d, {}, base.size(), "legacy vs opt");
+  if (!d.sections.empty()) {
+    const auto& sec = d.sections[0];
+    check(sec.old_format == "legacy" && sec.new_format == "opt",
+          "legacy vs opt: formats " + sec.old_format + " -> " + sec.new_format);
+    check(sec.old_size == legacy.size() && sec.new_size == opt.size(), "legacy vs opt: sizes");
+    for (const auto& delta : sec.ops)
+      check(delta.count == 0, "legacy vs opt: " + delta.name + " count delta " + std::to_string(delta.count));
+  }
+
+  // and a change still shows across formats
+  auto ops = base;
+  ops[0].value = 11;
+  check_edits(diff(legacy, encode<txn::format_opt>(ops)),
+              {{kind::changed, 0, 0x100, 1, 0, 0x100, 11}}, base.size() - 1, "legacy vs changed opt");
+}
+
+// Counters cover every difference, changes only the first max_changes
+void
+test_max_changes()
+{
+  auto ops = base;
+  for (auto& o : ops)
+    o.value += 100;
+  auto d = diff(encode<txn::format_opt>(base), encode<txn::format_opt>(ops), 2);
+  check(d.changes.size() == 2, "max_changes 2 kept " + std::to_string(d.changes.size()) + " changes");
+  // the block write has no value
+  check(!d.sections.empty() && d.sections[0].changed == base.size() - 1,
+        "max_changes 2 counted " + std::to_string(d.sections.empty() ? 0 : d.sections[0].changed) + " changed");
+}
+
+// fn must throw aiebu::error
+template <typename Fn>
+void
+check_rejected(Fn fn, const std::string& what)
+{
+  try {
+    fn();
+  }
+  catch (aiebu::error&) {
+    return;
+  }
+  check(false, what + " accepted");
+}
+
+// Header fields are trusted no further than the buffer, TxnSize matches
+// the buffer in all of these
+template <typename Format>
+void
+test_out_of_bounds(const std::string& format)
+{
+  const auto txn = encode<Format>(base);
+  auto header = [](std::vector<char>& t) { return reinterpret_cast<XAie_TxnHeader*>(t.data()); };
+  auto diff_self = [](const std::vector<char>& t) { return [&t] { (void)diff(t, t); }; };
+
+  // more ops than the buffer holds
+  auto more_ops = txn;
+  header(more_ops)->NumOps += 1;
+  check_rejected(diff_self(more_ops), format + " NumOps beyond the buffer");
+
+  // the last op cut after its op header
+  auto cut = txn;
+  cut.resize(cut.size() - sizeof(typename Format::write32) + sizeof(typename Format::op_hdr));
+  header(cut)->TxnSize = static_cast<uint32_t>(cut.size());
+  check_rejected(diff_self(cut), format + " op header cut short");
+
+  // a block write payload running past the end
+  auto oversized = encode<Format>({write(0x100, 1), block_write(0x400, {4, 5, 6})});
+  auto& block = *reinterpret_cast<typename Format::block_write32*>(
+    oversized.data() + sizeof(XAie_TxnHeader) + sizeof(typename Format::write32));
+  block.Size += sizeof(uint32_t);
+  check_rejected(diff_self(oversized), format + " block write payload beyond the buffer");
+
+  // a size smaller than the op header
+  block.Size = sizeof(typename Format::op_hdr);
+  check_rejected(diff_self(oversized), format + " block write smaller than its header");
+
+  check_rejected([] {
+    std::vector<char> small(sizeof(XAie_TxnHeader) - 1);
+    txn::visitor_base visitor;
+    txn::walk(small.data(), small.size(), visitor);
+  }, format + " buffer smaller than the header");
+
+  // walk itself stops at the given size, whatever TxnSize says
+  check_rejected([&txn] {
+    txn::visitor_base visitor;
+    txn::walk(txn.data(), txn.size() - 1, visitor);
+  }, format + " walk of a short size");
+  txn::visitor_base visitor;
+  txn::walk(txn.data(), txn.size(), visitor);
+}
+
+void
+test_corrupted()
+{
+  auto txn = encode<txn::format_opt>(base);
+  auto truncated = txn;
+  truncated.resize(truncated.size() - 4);
+  check_rejected([&] { (void)diff(txn, truncated); }, "truncated transaction");
+
+  test_out_of_bounds<txn::format_opt>("opt");
+  test_out_of_bounds<txn::format_legacy>("legacy");
+}
+
+}
+
+int main()
+{
+  test_inserted();
+  test_removed();
+  test_changed();
+  test_legacy_vs_opt();
+  test_max_changes();
+  test_corrupted();
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2024 Advanced Micro Devices, Inc.
+
+// Known answers of the UID note hashes. xxh3_128 is checked against the
+// reference xxHash on the xxhsum sanity buffer for a length in each of
+// its code paths, md5 against md5sum.
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "uid_hash.h"
+#include "xxh3.h"
+
+namespace {
+
+int failures = 0;
+
+void
+check(bool ok, const std::string& what)
+{
+  if (ok)
+    return;
+  std::cout << "FAILED: " << what << std::endl;
+  ++failures;
+}
+
+// Test buffer of xxhsum --sanity-check
+std::vector<uint8_t>
+sanity_buffer(size_t size)
+{
+  std::vector<uint8_t> buffer(size);
+  uint64_t gen = 2654435761U;
+  for (auto& byte : buffer) {
+    byte = static_cast<uint8_t>(gen >> 56);
+    gen *= 11400714785074694797ULL;
+  }
+  return buffer;
+}
+
+struct known_answer
+{
+  size_t size;
+  const char* hex;
+};
+
+// XXH3_128bits() of the sanity buffer, by path: empty, 1-3, 4-8, 9-16,
+// 17-128, 129-240, then longer inputs within one block, over a block
+// boundary and over many blocks
+const known_answer xxh3_answers[] = {
+  {0, "99aa06d3014798d86001c324468d497f"},
+  {1, "a6cd5e9392000f6ac44bdff4074eecdb"},
+  {2, "76750c3c7bf956687a9978044cb8a8bb"},
+  {3, "20efc49ff02422ea54247382a8d6b94d"},
+  {4, "970d585ac632bf8e2e7d8d6876a39fe9"},
+  {8, "47a7f080d82bb45664c69cab4bb21dc5"},
+  {9, "564ef6078950d457ed7ccbc501eb7501"},
+  {16, "c68c368ecf8a9c05562980258a998629"},
+  {17, "955fa78643ed3669abbc12d11973d7db"},
+  {64, "6d90e81a9b0fd622efdb6a44690721a9"},
+  {128, "39992220e045260aebb15e34a7fb5ab1"},
+  {129, "03815fc91f1b30b686c9e3bc8f0a3b5c"},
+  {240, "aa4202daa2769dc85c9aae94c8ebe5a0"},
+  {241, "99a80ecf0ecfc647c5a639ecd2030e5e"},
+  {1024, "0d30d24071c64c57dd85c9b5c1109c5c"},
+  {1025, "fd3ee4fe7f2954c6d870c0fa13211c6a"},
+  {2367, "e89c0f6ff369b427cb37aeb9e5d361ed"},
+  {100000, "351330331bc078fb34d658192a014311"},
+};
+
+std::string
+xxh3(const std::vector<uint8_t>& data, size_t split)
+{
+  aiebu::xxh3_128 hash;
+  for (size_t offset = 0; offset < data.size(); offset += split)
+    hash.update(data.data() + offset, std::min(split, data.size() - offset));
+  return hash.calculate();
+}
+
+void
+test_xxh3_known_answers()
+{
+  for (const auto& answer : xxh3_answers) {
+    auto data = sanity_buffer(answer.size);
+    check(xxh3(data, data.size() + 1) == answer.hex,
+          "xxh3_128 of " + std::to_string(answer.size) + " bytes is " + xxh3(data, data.size() + 1));
+  }
+}
+
+// Any split into update() calls gives the one shot hash
+void
+test_xxh3_split_update()
+{
+  for (const auto& answer : xxh3_answers) {
+    auto data = sanity_buffer(answer.size);
+    for (size_t split : {1, 3, 16, 63, 64, 65, 240, 241, 1000, 1024}) {
+      check(xxh3(data, split) == answer.hex,
+            "xxh3_128 of " + std::to_string(answer.size) + " bytes in updates of " + std::to_string(split));
+    }
+  }
+
+  // calculate() does not change the state, hashing may go on
+  auto data = sanity_buffer(100000);
+  aiebu::xxh3_128 hash;
+  hash.update(data.data(), 777);
+  auto partial = hash.calculate();
+  check(partial == hash.calculate(), "xxh3_128 calculate() twice differs");
+  hash.update(data.data() + 777, data.size() - 777);
+  check(hash.calculate() == xxh3_answers[sizeof(xxh3_answers) / sizeof(xxh3_answers[0]) - 1].hex,
+        "xxh3_128 after calculate() differs");
+
+  // zero sized updates change nothing
+  aiebu::xxh3_128 empty;
+  empty.update(data.data(), 0);
+  check(empty.calculate() == xxh3_answers[0].hex, "xxh3_128 of a zero sized update");
+}
+
+std::string
+uid(aiebu::elf_options::uid_algorithm algorithm, const std::string& text)
+{
+  auto hasher = aiebu::uid_hasher::create(algorithm);
+  hasher->update(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+  auto out = hasher->calculate();
+  check(out.size() == hasher->size(), "UID of size " + std::to_string(out.size()) + ", declared " +
+        std::to_string(hasher->size()));
+  return out;
+}
+
+// The md5 note is the plain hex md5sum prints, for any boost digest type
+void
+test_md5_uid()
+{
+  const std::pair<const char*, const char*> md5sum[] = {
+    {"", "d41d8cd98f00b204e9800998ecf8427e"},
+    {"a", "0cc175b9c0f1b6a831c399e269772661"},
+    {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+    {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+    {"The quick brown fox jumps over the lazy dog", "9e107d9d372bb6826bd81d3542a419d6"},
+  };
+  for (const auto& [text, hex] : md5sum)
+    check(uid(aiebu::elf_options::uid_algorithm::md5, text) == hex,
+          std::string("md5 UID of \"") + text + "\" is not md5sum " + hex);
+
+  auto data = sanity_buffer(100000);
+  auto hasher = aiebu::uid_hasher::create(aiebu::elf_options::uid_algorithm::md5);
+  for (size_t offset = 0; offset < data.size(); offset += 4099)
+    hasher->update(data.data() + offset, std::min<size_t>(4099, data.size() - offset));
+  check(hasher->calculate() == "ddb2ab79632a8a2989ac7f6ec9cf215d", "md5 UID of 100000 bytes in updates");
+}
+
+void
+test_xxh3_uid()
+{
+  check(uid(aiebu::elf_options::uid_algorithm::xxh3_128, "") == std::string("xxh3_128:") + xxh3_answers[0].hex,
+        "xxh3_128 UID is not prefixed canonical hex");
+}
+
+}
+
+int main()
+{
+  test_xxh3_known_answers();
+  test_xxh3_split_update();
+  test_md5_uid();
+  test_xxh3_uid();
+  if (failures)
+    std::cout << failures << " checks failed" << std::endl;
+  return failures ? 1 : 0;
+}